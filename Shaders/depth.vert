@@ -0,0 +1,37 @@
+#version 450
+
+// prepass de profondeur : position seule, pas de fragment shader
+
+layout(binding = 0) uniform FrameUniforms {
+    mat4 viewProj;
+    mat4 view;
+    mat4 proj;
+    vec4 frustum[6];
+    vec4 cullProjection;
+    vec4 cullScreen;
+} frame;
+
+layout(push_constant) uniform DrawConstants {
+    mat4 box;
+    uint objectId;
+} draw;
+
+layout(binding = 2, std430) readonly buffer ObjectClip {
+    mat4 clip[];
+} objects;
+
+// voir shader.vert
+layout(constant_id = 0) const bool INDIRECT_DRAWS = false;
+// --occlusion : le cube unité est placé sur la boite du draw, dans l'espace de l'objet
+layout(constant_id = 1) const bool BOX_PROXY = false;
+
+layout(location = 0) in vec3 inPosition;
+
+// meme calcul que shader.vert, invariant pour que la passe principale passe le test EQUAL
+invariant gl_Position;
+
+void main() {
+    uint objectId = INDIRECT_DRAWS ? uint(gl_InstanceIndex) : draw.objectId;
+    vec4 position = BOX_PROXY ? draw.box * vec4(inPosition, 1.0) : vec4(inPosition, 1.0);
+    gl_Position = objects.clip[objectId] * position;
+}
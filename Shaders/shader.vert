@@ -1,21 +1,44 @@
 #version 450
 
-layout(binding = 0) uniform UniformBufferObject {
-    mat4 model;
+// par frame, viewProj = proj * view multipliée sur le cpu
+layout(binding = 0) uniform FrameUniforms {
+    mat4 viewProj;
     mat4 view;
     mat4 proj;
-} ubo;
+    vec4 frustum[6];
+    vec4 cullProjection;
+    vec4 cullScreen;
+} frame;
+
+// par draw, seul objectId est poussé : box ne sert qu'aux boites des occlusion queries (depth.vert)
+layout(push_constant) uniform DrawConstants {
+    mat4 box;
+    uint objectId;
+} draw;
+
+// par frame, viewProj * model de chaque objet multipliée sur le cpu
+layout(binding = 2, std430) readonly buffer ObjectClip {
+    mat4 clip[];
+} objects;
+
+// --hiz : les draws viennent de cull.comp, firstInstance porte l'id de l'objet et aucune push constant n'est
+// poussée par draw
+layout(constant_id = 0) const bool INDIRECT_DRAWS = false;
 
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec3 inNormal;
 layout(location = 3) in vec2 inTexCoord;
 
+// la prepass (depth.vert) calcule la meme position, la profondeur doit etre identique au bit près pour le test EQUAL
+invariant gl_Position;
+
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragUV;
 
 void main() {
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
+    uint objectId = INDIRECT_DRAWS ? uint(gl_InstanceIndex) : draw.objectId;
+    gl_Position = objects.clip[objectId] * vec4(inPosition, 1.0);
     fragColor = inColor;
     fragUV = inTexCoord;
-}
\ No newline at end of file
+}
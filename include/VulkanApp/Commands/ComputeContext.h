@@ -0,0 +1,66 @@
+#pragma once
+
+#include <VulkanApp/Core/VulkanContext.h>
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+// stages of the graphics submission that may read what the compute work of its frame wrote, or overwrite what it
+// read (the Hi-Z pyramid is rebuilt by a compute shader of the graphics queue)
+constexpr VkPipelineStageFlags g_compute_consumer_stages{VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+							 VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+							 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT};
+
+// records the compute work of a frame on the compute queue, one command buffer per frame slot. submit() signals a
+// timeline semaphore that the graphics submission of the same frame waits on at g_compute_consumer_stages only, so
+// with a separate compute family the dispatches overlap with the previous frame and the start of this one.
+// without one everything goes to the graphics queue just before the frame, same ordering and no overlap.
+// the first phase of the Hi-Z culling is recorded here, see VulkanApp::recordEarlyCull.
+// resources written on one queue and read on the other are created CONCURRENT, see VulkanContext::getSharingFamilies
+class ComputeContext {
+
+      public:
+	ComputeContext() = default;
+	~ComputeContext() = default;
+
+	void init(VulkanContext* context, uint32_t framesInFlight);
+	// waits for the last submission then destroys the pools
+	void cleanup() noexcept;
+
+	// recreates the pools for a new frame count, none of the buffers may still be in use
+	void setFramesInFlight(uint32_t framesInFlight);
+
+	// command buffer of the frame slot, begun on first use. the previous frame of the slot is finished on the
+	// compute queue as soon as its graphics submission is, since that one waited for it
+	VkCommandBuffer getCommandBuffer(uint32_t frame);
+	// the work will not start stage before semaphore reaches value, for inputs produced by another queue
+	void waitFor(VkSemaphore semaphore, uint64_t value, VkPipelineStageFlags stage);
+	// submits what was recorded for the frame, 0 when nothing was and there is nothing to wait for
+	uint64_t submit(uint32_t frame);
+
+	VkSemaphore getSemaphore() const { return m_semaphore; }
+	uint32_t getQueueFamily() const { return m_queueFamily; }
+	bool isAsync() const { return m_context->hasAsyncCompute(); }
+
+      private:
+	void createPools(uint32_t framesInFlight);
+	void destroyPools() noexcept;
+
+	VulkanContext* m_context = nullptr;
+	uint32_t m_queueFamily = 0;
+
+	VkSemaphore m_semaphore = VK_NULL_HANDLE;
+	uint64_t m_nextValue = 1;
+
+	// [frame], reset as a whole
+	std::vector<VkCommandPool> m_pools;
+	std::vector<VkCommandBuffer> m_commandBuffers;
+	std::vector<uint8_t> m_recording; // [frame], begun and not submitted yet
+
+	// réservés a l'init, submit() n'alloue pas
+	std::vector<VkSemaphore> m_waitSemaphores;
+	std::vector<uint64_t> m_waitValues;
+	std::vector<VkPipelineStageFlags> m_waitStages;
+};
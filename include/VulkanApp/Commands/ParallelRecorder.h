@@ -0,0 +1,70 @@
+#pragma once
+
+#include <VulkanApp/Core/VulkanContext.h>
+#include <VulkanApp/Jobs/JobSystem.h>
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// below this many draws a secondary buffer costs more than it saves, the list is split in fewer parts
+constexpr uint32_t g_min_draws_per_thread{64};
+
+// records a draw list inside a render pass with the job system. the list is cut in at most one contiguous part per
+// thread, every part owns one command pool per frame in flight and records into its own secondary buffer, the
+// primary executes them in order. a part runs on one thread at a time, so its pool never needs a lock
+class ParallelRecorder {
+
+      public:
+	// records items [first, first + count) into a secondary buffer already begun, the state is not inherited
+	// so every call binds its pipeline, buffers and dynamic state again
+	using RecordFunction = std::function<void(VkCommandBuffer commandBuffer, uint32_t first, uint32_t count)>;
+
+	ParallelRecorder() = default;
+	~ParallelRecorder() = default;
+
+	void init(VulkanContext* context, JobSystem* jobs, uint32_t queueFamily, uint32_t framesInFlight);
+	void cleanup() noexcept;
+
+	// recreates the pools for a new frame count, none of the secondaries may still be in use
+	void setFramesInFlight(uint32_t framesInFlight);
+
+	// the secondaries previously recorded for this frame slot must be finished on the GPU,
+	// primaries that execute them are invalidated and must be recorded again
+	void record(uint32_t frame, const VkCommandBufferInheritanceInfo& inheritance, uint32_t itemCount, const RecordFunction& recordItems);
+
+	// secondaries last recorded for this frame slot, in draw list order, for vkCmdExecuteCommands
+	const VkCommandBuffer* getCommandBuffers(uint32_t frame) const { return m_commandBuffers.data() + frame * m_partCapacity; }
+	uint32_t getCommandBufferCount(uint32_t frame) const { return m_recordedCounts[frame]; }
+
+	uint32_t getThreadCount() const { return m_partCapacity; }
+
+      private:
+	void createPools(uint32_t framesInFlight);
+	void destroyPools() noexcept;
+
+	// ce que les parts du record() en cours partagent
+	struct Pass {
+		uint32_t frame;
+		uint32_t partCount;
+		uint32_t itemCount;
+		const VkCommandBufferInheritanceInfo* inheritance;
+		const RecordFunction* recordItems;
+	};
+
+	void recordPart(uint32_t part);
+
+	VulkanContext* m_context = nullptr;
+	JobSystem* m_jobs = nullptr;
+	uint32_t m_queueFamily = 0;
+	uint32_t m_partCapacity = 0; // une part par thread du job system
+	Pass m_pass{};
+
+	// [frame * m_partCapacity + part], reset as a whole instead of buffer by buffer
+	std::vector<VkCommandPool> m_pools;
+	std::vector<VkCommandBuffer> m_commandBuffers;
+	// the parts of a frame are its first buffers
+	std::vector<uint32_t> m_recordedCounts;
+};
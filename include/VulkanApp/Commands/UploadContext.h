@@ -0,0 +1,120 @@
+#pragma once
+
+#include <VulkanApp/Core/VulkanContext.h>
+#include <VulkanApp/Resources/MemoryAllocator.h>
+#include <VulkanApp/Sync/BarrierBatcher.h>
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+// timeline value signaled by the upload context once a batch has executed, 0 = nothing to wait for
+struct UploadTicket {
+	uint64_t value = 0;
+};
+
+// records transfers of one queue into a single command buffer, submit() sends the whole batch at once
+// and signals a timeline semaphore, the CPU only blocks when it explicitly waits on a ticket.
+// copies and mip chains are deferred until submit() so their barriers are batched: one call before every copy,
+// one per mip level for all the chains and one after, instead of a few per resource
+class UploadContext {
+
+      public:
+	UploadContext() = default;
+	~UploadContext() = default;
+
+	// submits to the queue the pool gives to role
+	void init(VulkanContext* context, MemoryAllocator* allocator, QueueRole role);
+	void cleanup() noexcept;
+
+	// batch being recorded, opened on first use. the deferred work is recorded first
+	VkCommandBuffer getCommandBuffer();
+	// ticket the batch being recorded will signal
+	UploadTicket getPendingTicket() const { return {m_nextValue}; }
+
+	// the batch will not start stage before semaphore reaches value, used to chain uploads of different queues
+	void waitFor(VkSemaphore semaphore, uint64_t value, VkPipelineStageFlags stage);
+	// the staging buffer is destroyed once the batch that reads it is complete
+	void releaseAfterUpload(VkBuffer buffer, const Allocation& allocation);
+
+	void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+	void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
+	void transitionImageLayout(VkImage image, uint32_t mipLevels, VkImageLayout oldLayout, VkImageLayout newLayout);
+	void generateMipmaps(VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels);
+
+	// queue family ownership transfer of EXCLUSIVE resources written by a transfer, the release is recorded on the
+	// source queue, the acquire on the destination one after waiting the source semaphore at the transfer stage.
+	// with a single family there is nothing to release and the acquire becomes a plain barrier
+	void releaseBuffer(VkBuffer buffer, uint32_t dstFamily);
+	void acquireBuffer(VkBuffer buffer, uint32_t srcFamily, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+	void releaseImage(VkImage image, uint32_t mipLevels, VkImageLayout layout, uint32_t dstFamily);
+	void acquireImage(VkImage image, uint32_t mipLevels, VkImageLayout layout, uint32_t srcFamily,
+			  VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+
+	// returns an empty ticket if nothing was recorded
+	UploadTicket submit();
+
+	bool isComplete(UploadTicket ticket) const;
+	void wait(UploadTicket ticket) const;
+	// frees the command buffers and staging buffers of the completed batches
+	void collect() noexcept;
+
+	VkSemaphore getSemaphore() const { return m_semaphore; }
+	uint32_t getQueueFamily() const { return m_queueFamily; }
+
+      private:
+	struct Copy {
+		VkBuffer srcBuffer = VK_NULL_HANDLE;
+		VkBuffer dstBuffer = VK_NULL_HANDLE; // ou dstImage
+		VkImage dstImage = VK_NULL_HANDLE;
+		VkDeviceSize size = 0;
+		uint32_t width = 0;
+		uint32_t height = 0;
+	};
+
+	struct MipChain {
+		VkImage image = VK_NULL_HANDLE;
+		int32_t width = 0;
+		int32_t height = 0;
+		uint32_t levels = 0;
+	};
+
+	struct Pending {
+		uint64_t value = 0;
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		VkBuffer buffer = VK_NULL_HANDLE;
+		Allocation allocation{};
+	};
+
+	VkCommandBuffer beginCommandBuffer();
+	bool isDeferred(VkImage image) const;
+	bool isDeferred(VkBuffer buffer) const;
+	BarrierBatcher& getBatcher(VkImage image);
+	BarrierBatcher& getBatcher(VkBuffer buffer);
+	void recordDeferred();
+	void recordMipChains(VkCommandBuffer commandBuffer);
+
+	VulkanContext* m_context = nullptr;
+	MemoryAllocator* m_allocator = nullptr;
+	QueueRole m_role = QueueRole::Transfer;
+	uint32_t m_queueFamily = 0;
+
+	VkCommandPool m_commandPool = VK_NULL_HANDLE;
+	VkSemaphore m_semaphore = VK_NULL_HANDLE;
+	uint64_t m_nextValue = 1;
+
+	VkCommandBuffer m_commandBuffer = VK_NULL_HANDLE;
+	std::vector<VkSemaphore> m_waitSemaphores;
+	std::vector<uint64_t> m_waitValues;
+	std::vector<VkPipelineStageFlags> m_waitStages;
+
+	// travail différé jusqu'au prochain recordDeferred()
+	BarrierBatcher m_before;
+	std::vector<Copy> m_copies;
+	std::vector<MipChain> m_mipChains;
+	BarrierBatcher m_mipBarriers;
+	BarrierBatcher m_after;
+
+	std::vector<Pending> m_pending;
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+struct QueueFamilyIndices;
+
+// who submits to a queue, each role gets its own VkQueue while the family has queues left
+enum class QueueRole : uint8_t {
+	Render,		 // rendu de la frame, thread principal
+	Present,	 // la queue de rendu si la famille présente, pour garder l'ordre sans sémaphore de plus
+	Transfer,	 // uploads en streaming sur la famille transfer
+	GraphicsUploads, // blits des mipmaps, besoin d'une famille graphics
+	Compute,	 // compute en arrière plan
+	Count,
+};
+
+// requests every queue of the families the device uses and hands them out by role, with a priority per role.
+// a queue given to a single role is submitted to without any lock, roles that have to share one (family with
+// too few queues) go through a mutex of that queue only, so two roles never contend unless the hardware forces it
+class QueuePool {
+
+      public:
+	QueuePool() = default;
+	~QueuePool() = default;
+
+	// picks a queue of each role and fills the create infos, before vkCreateDevice
+	void configure(VkPhysicalDevice physicalDevice, const QueueFamilyIndices& indices);
+	const std::vector<VkDeviceQueueCreateInfo>& getCreateInfos() const { return m_createInfos; }
+	// retrieves the queues of the device created with getCreateInfos()
+	void init(VkDevice device);
+	// the queues go with the device, only the handles are forgotten
+	void cleanup() noexcept;
+
+	VkQueue getQueue(QueueRole role) const { return m_queues[static_cast<size_t>(role)]; }
+	uint32_t getFamily(QueueRole role) const { return m_slots[static_cast<size_t>(role)].family; }
+	uint32_t getQueueIndex(QueueRole role) const { return m_slots[static_cast<size_t>(role)].index; }
+	// true when another role submits to the same VkQueue
+	bool isShared(QueueRole role) const { return m_shared[static_cast<size_t>(role)]; }
+
+	// vkQueueSubmit / vkQueuePresentKHR / vkQueueWaitIdle with the external synchronization Vulkan asks for,
+	// the mutex is only taken for a shared queue
+	VkResult submit(QueueRole role, uint32_t submitCount, const VkSubmitInfo* submits, VkFence fence);
+	VkResult present(const VkPresentInfoKHR& presentInfo);
+	VkResult waitIdle(QueueRole role);
+
+	// family, queue index and priority of each role, printed once at startup
+	void print() const;
+
+      private:
+	struct Slot {
+		uint32_t family = 0;
+		uint32_t index = 0;
+		float priority = 0.0f;
+	};
+
+	std::array<Slot, static_cast<size_t>(QueueRole::Count)> m_slots{};
+	std::array<VkQueue, static_cast<size_t>(QueueRole::Count)> m_queues{};
+	std::array<bool, static_cast<size_t>(QueueRole::Count)> m_shared{};
+	// un mutex par role, les roles qui partagent une queue utilisent celui du premier
+	std::array<uint8_t, static_cast<size_t>(QueueRole::Count)> m_mutexIndex{};
+	std::array<std::mutex, static_cast<size_t>(QueueRole::Count)> m_mutexes;
+
+	std::vector<VkDeviceQueueCreateInfo> m_createInfos;
+	std::vector<std::vector<float>> m_priorities; // [create info][queue], pointées par m_createInfos
+};
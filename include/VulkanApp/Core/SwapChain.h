@@ -1,6 +1,7 @@
 #pragma once
 
 #include <VulkanApp/Core/VulkanContext.h>
+#include <VulkanApp/Resources/DeletionQueue.h>
 
 #include <GLFW/glfw3.h>
 #include <vulkan/vulkan.h>
@@ -15,19 +16,29 @@ class SwapChain {
 
 	void init(VulkanContext* context, GLFWwindow* window);
 	void cleanup();
-	void recreate(GLFWwindow* window);
+	void recreate(GLFWwindow* window, DeletionQueue& deletionQueue);
 
-	void createFrameBuffers(VkRenderPass renderPass, VkImageView depthImageView, VkImageView colorImageView);
+	// the previous frame buffers are destroyed, no frame in flight may still use them. extent : the render extent of
+	// the quality preset. colorImageView : the msaa color, VK_NULL_HANDLE without msaa. targetImageView : the resolve
+	// or single-sample target the image is upscaled from, VK_NULL_HANDLE for the swapchain image of each frame buffer
+	void createFrameBuffers(VkRenderPass renderPass, VkExtent2D extent, VkImageView depthImageView, VkImageView colorImageView,
+				VkImageView targetImageView);
+	// one frame buffer for every image, the prepass only writes the depth
+	void createDepthFrameBuffer(VkRenderPass depthPrepass, VkExtent2D extent, VkImageView depthImageView);
 
 	VkSwapchainKHR getSwapChain() const { return m_swapChain; }
     VkFormat getImageFormat() const { return m_imageFormat; }
     VkExtent2D getExtent() const { return m_extent; }
+	// the images can be blitted to, a render scale below 1 is upscaled on them
+	bool canUpscale() const { return m_canUpscale; }
+    const std::vector<VkImage>& getImages() const { return m_images; }
     const std::vector<VkImageView>& getImageViews() const { return m_imageViews; }
 	 const std::vector<VkFramebuffer>& getFramebuffers() const { return m_frameBuffers; }
+	VkFramebuffer getDepthFramebuffer() const { return m_depthFrameBuffer; }
     size_t getImageCount() const { return m_images.size(); }
 
       private:
-	void create(GLFWwindow* window);
+	void create(GLFWwindow* window, VkSwapchainKHR oldSwapChain = VK_NULL_HANDLE);
 	void createImageViews();
 
 	void cleanupFramebuffers();
@@ -42,6 +53,8 @@ class SwapChain {
 	std::vector<VkImage> m_images;
 	std::vector<VkImageView> m_imageViews;
 	std::vector<VkFramebuffer> m_frameBuffers;
+	VkFramebuffer m_depthFrameBuffer = VK_NULL_HANDLE;
 	VkFormat m_imageFormat;
 	VkExtent2D m_extent;
+	bool m_canUpscale = false;
 };
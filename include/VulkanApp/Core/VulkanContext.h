@@ -1,6 +1,7 @@
 #pragma once
 
 
+#include <VulkanApp/Core/QueuePool.h>
 #include <VulkanApp/Debug/VulkanDebug.h>
 
 #include <GLFW/glfw3.h>
@@ -14,6 +15,7 @@ struct QueueFamilyIndices {
 	std::optional<uint32_t> graphicsFamily; // on peut voir si on a une graphics queue, pour certaines queue on est pas obligé de l'avoir forcément
 	std::optional<uint32_t> presentFamily;	// see if we can present images to the surface
 	std::optional<uint32_t> transferFamily;
+	std::optional<uint32_t> computeFamily; // famille sans graphics si elle existe, sinon celle de graphics
 
 	bool isComplete() {
 		return graphicsFamily.has_value() && presentFamily.has_value() && transferFamily.has_value();
@@ -49,16 +51,41 @@ public:
     VkDevice getDevice() const { return m_device; }
     VkPhysicalDevice getPhysicalDevice() const { return m_physicalDevice; }
     VkSurfaceKHR getSurface() const { return m_surface; }
-    VkQueue getGraphicsQueue() const { return m_graphicsQueue; }
-    VkQueue getPresentQueue() const { return m_presentQueue; }
-    VkQueue getTransferQueue() const { return m_transferQueue; }
+    // submissions go through the pool, it only locks the queues several roles share
+    QueuePool& getQueues() { return m_queues; }
+    VkQueue getGraphicsQueue() const { return m_queues.getQueue(QueueRole::Render); }
+    VkQueue getPresentQueue() const { return m_queues.getQueue(QueueRole::Present); }
+    VkQueue getTransferQueue() const { return m_queues.getQueue(QueueRole::Transfer); }
+    VkQueue getComputeQueue() const { return m_queues.getQueue(QueueRole::Compute); }
+    // false when compute shares the render queue, nothing then runs concurrently with the graphics pass.
+    // a second queue of the graphics family counts, it overlaps as well as a separate family
+    bool hasAsyncCompute() const { return getComputeQueue() != getGraphicsQueue(); }
     VkSampleCountFlagBits getMsaaSamples() const { return m_msaaSamples; }
+	// the sample count of the render pass, the pipelines and the targets, chosen by the quality preset. 1x until set
+	void setMsaaSamples(VkSampleCountFlagBits samples) { m_msaaSamples = samples; }
+	// the highest count both the color and the depth framebuffers support, at most limit
+	VkSampleCountFlagBits getMaxMsaa(VkSampleCountFlagBits limit) const;
+	float getMaxAnisotropy() const;
 	
     SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
 	SwapChainSupportDetails getSwapChainSupport();
 
+	// VK_KHR_present_id and VK_KHR_present_wait were enabled, presents can carry an id and be waited for
+	bool hasPresentWait() const { return m_waitForPresent != nullptr; }
+	VkResult waitForPresent(VkSwapchainKHR swapchain, uint64_t presentId, uint64_t timeout) const;
+	// multiDrawIndirect, drawIndirectFirstInstance and drawIndirectCount were enabled, the gpu can fill and count draws
+	bool hasIndirectCount() const { return m_indirectCount; }
+	// VK_EXT_conditional_rendering was enabled, draws can be skipped by a value the gpu wrote in a buffer
+	bool hasConditionalRendering() const { return m_beginConditionalRendering != nullptr; }
+	// the commands until endConditionalRendering() are discarded when the uint32 at offset in buffer is 0
+	void beginConditionalRendering(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset) const;
+	void endConditionalRendering(VkCommandBuffer commandBuffer) const;
+
 	QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device);
 	QueueFamilyIndices getQueueFamilies();
+	// distinct graphics, transfer and compute families, the ones a CONCURRENT resource is shared between.
+	// returns how many were written, 1 means EXCLUSIVE is equivalent
+	uint32_t getSharingFamilies(uint32_t (&families)[3]);
 
 private:
 	VulkanDebug m_debug;
@@ -68,12 +95,13 @@ private:
 	VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
 	VkDevice m_device = VK_NULL_HANDLE;
 
-	VkQueue m_graphicsQueue = VK_NULL_HANDLE;
-	VkQueue m_presentQueue = VK_NULL_HANDLE;
-	VkQueue m_transferQueue= VK_NULL_HANDLE;
+	QueuePool m_queues;
+	PFN_vkWaitForPresentKHR m_waitForPresent = nullptr;
+	bool m_indirectCount = false;
+	PFN_vkCmdBeginConditionalRenderingEXT m_beginConditionalRendering = nullptr;
+	PFN_vkCmdEndConditionalRenderingEXT m_endConditionalRendering = nullptr;
 
-	VkSampleCountFlagBits m_msaaSamples;
-	VkSampleCountFlagBits getMaxMsaa();
+	VkSampleCountFlagBits m_msaaSamples = VK_SAMPLE_COUNT_1_BIT;
 
 	void createInstance(bool enableValidationLayers);
 	void createSurface(GLFWwindow* window);
@@ -82,6 +110,9 @@ private:
 
 	bool checkValidationLayerSupport();
 	bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+	bool checkPresentWaitSupport(VkPhysicalDevice device);
+	bool checkIndirectCountSupport(VkPhysicalDevice device);
+	bool checkConditionalRenderingSupport(VkPhysicalDevice device);
 	bool isDeviceSuitable(VkPhysicalDevice device);
 
 
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <cstdint>
+
+// CPU only scaling benchmark of the job system (--job-bench N): the same workloads with 1 to maxThreads threads,
+// no window nor Vulkan device is created
+void runJobBenchmark(uint32_t maxThreads);
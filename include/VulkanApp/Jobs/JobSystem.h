@@ -0,0 +1,129 @@
+#pragma once
+
+#include <VulkanApp/Jobs/WorkStealingQueue.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// jobs alive at the same time, preallocated so that submitting never touches the heap
+constexpr uint32_t g_max_jobs{4096};
+constexpr size_t g_job_queue_capacity{1024};
+
+enum class JobAffinity {
+	Any,
+	MainThread, // GLFW and anything else that must run on the thread that created the window
+};
+
+class JobCounter;
+
+// one entry of the preallocated pool, recycled as soon as its function returned
+struct Job {
+	std::function<void()> function;
+	JobCounter* counter = nullptr;
+	JobAffinity affinity = JobAffinity::Any;
+	Job* next = nullptr; // liste des continuations d'un JobCounter
+};
+
+// counts the unfinished jobs submitted with it, lives with whoever waits on it (often the stack).
+// continuations registered on it are queued when it reaches zero
+class JobCounter {
+
+      public:
+	JobCounter() = default;
+	~JobCounter() = default;
+
+	JobCounter(const JobCounter&) = delete;
+	JobCounter& operator=(const JobCounter&) = delete;
+
+	bool isDone() const { return m_pending.load(std::memory_order_acquire) == 0; }
+
+      private:
+	friend class JobSystem;
+
+	// pending est aussi lu sans lock par isDone, les écritures se font toutes sous m_mutex
+	std::atomic<uint32_t> m_pending{0};
+	std::mutex m_mutex;
+	Job* m_continuations = nullptr; // liste chaînée par Job::next
+	std::exception_ptr m_error;
+};
+
+// work-stealing scheduler: one Chase-Lev deque per thread, a worker pops its own jobs and steals from the others
+// when it runs dry. the main thread is thread 0, it owns a deque too and executes jobs while it waits
+class JobSystem {
+
+      public:
+	using JobFunction = std::function<void()>;
+	// [first, first + count) of a parallelFor
+	using RangeFunction = std::function<void(uint32_t first, uint32_t count)>;
+
+	JobSystem() = default;
+	~JobSystem() = default;
+
+	// workerCount threads besides the calling one, which becomes the main thread
+	void init(uint32_t workerCount);
+	// one worker per hardware thread, the main thread excluded
+	static uint32_t getDefaultWorkerCount();
+	void cleanup() noexcept;
+
+	void submit(JobFunction function, JobCounter* counter = nullptr, JobAffinity affinity = JobAffinity::Any);
+	// continuation: the job is queued once dependency reaches zero, right away if it already did
+	void submitAfter(JobCounter& dependency, JobFunction function, JobCounter* counter = nullptr, JobAffinity affinity = JobAffinity::Any);
+
+	// executes other jobs until counter reaches zero, rethrows the first exception thrown by its jobs
+	void wait(JobCounter& counter);
+
+	// splits [0, count) in ranges of grain items and blocks until all of them ran, the caller takes part
+	void parallelFor(uint32_t count, uint32_t grain, const RangeFunction& function);
+
+	// main thread only, between two frames: runs the MainThread jobs queued so far. they never run anywhere else, the
+	// main thread must not wait for their counter before calling it
+	void runMainThreadJobs();
+
+	uint32_t getThreadCount() const { return static_cast<uint32_t>(m_workers.size()) + 1; }
+	// 0 for the main thread, 1..N for the workers, UINT32_MAX for a thread the system does not know
+	static uint32_t getThreadIndex();
+
+      private:
+	Job* allocate(JobFunction&& function, JobCounter* counter, JobAffinity affinity);
+	void release(Job* job) noexcept;
+
+	void push(Job* job);
+	Job* find(uint32_t thread);
+	void execute(Job* job);
+	void finish(JobCounter* counter, std::exception_ptr error);
+
+	void workerLoop(uint32_t thread);
+	void wakeWorkers();
+
+	std::vector<Job> m_jobs;
+	std::vector<Job*> m_freeJobs;
+	std::mutex m_freeMutex;
+
+	// [thread], 0 = main
+	std::vector<std::unique_ptr<WorkStealingQueue<Job*, g_job_queue_capacity>>> m_queues;
+
+	// jobs poussés par des threads inconnus, ils ne possèdent pas de deque
+	std::vector<Job*> m_injected;
+	std::mutex m_injectedMutex;
+	std::atomic<uint32_t> m_injectedCount{0};
+
+	std::vector<Job*> m_mainThreadJobs;
+	std::mutex m_mainThreadMutex;
+	std::atomic<uint32_t> m_mainThreadCount{0};
+
+	std::vector<std::thread> m_workers;
+
+	// jobs en file que les workers peuvent prendre, ils dorment quand il n'y en a plus
+	std::atomic<uint32_t> m_queued{0};
+	std::atomic<uint32_t> m_sleeping{0};
+	std::mutex m_sleepMutex;
+	std::condition_variable m_sleepCondition;
+	std::atomic<bool> m_stop{false};
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Chase-Lev deque of fixed capacity (memory orders from Le et al., "Correct and Efficient Work-Stealing for Weak
+// Memory Models"). only the owner thread pushes and pops at the bottom, any thread steals from the top
+template <typename T, size_t Capacity>
+class WorkStealingQueue {
+	static_assert((Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+      public:
+	WorkStealingQueue() = default;
+
+	WorkStealingQueue(const WorkStealingQueue&) = delete;
+	WorkStealingQueue& operator=(const WorkStealingQueue&) = delete;
+
+	// owner only, false when full
+	bool push(T item) {
+		int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+		int64_t top = m_top.load(std::memory_order_acquire);
+		if (bottom - top >= static_cast<int64_t>(Capacity))
+			return false;
+
+		// release sur bottom publie l'élément au voleur qui lit bottom en acquire
+		m_items[bottom & g_mask].store(item, std::memory_order_relaxed);
+		m_bottom.store(bottom + 1, std::memory_order_release);
+		return true;
+	}
+
+	// owner only, LIFO : the last pushed job is the hottest in cache
+	bool pop(T& item) {
+		int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+		m_bottom.store(bottom, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t top = m_top.load(std::memory_order_relaxed);
+
+		if (top > bottom) {
+			m_bottom.store(bottom + 1, std::memory_order_relaxed);
+			return false;
+		}
+
+		item = m_items[bottom & g_mask].load(std::memory_order_relaxed);
+		if (top == bottom) {
+			// dernier élément, on le dispute aux voleurs sur top
+			bool won = m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+			m_bottom.store(bottom + 1, std::memory_order_relaxed);
+			return won;
+		}
+		return true;
+	}
+
+	// any thread, FIFO
+	bool steal(T& item) {
+		int64_t top = m_top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t bottom = m_bottom.load(std::memory_order_acquire);
+		if (top >= bottom)
+			return false;
+
+		T stolen = m_items[top & g_mask].load(std::memory_order_relaxed);
+		if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			return false;
+		item = stolen;
+		return true;
+	}
+
+      private:
+	static constexpr int64_t g_mask = static_cast<int64_t>(Capacity) - 1;
+
+	// top et bottom sur des lignes de cache différentes, l'un est écrit par les voleurs, l'autre par le propriétaire
+	alignas(64) std::atomic<int64_t> m_top{0};
+	alignas(64) std::atomic<int64_t> m_bottom{0};
+	alignas(64) std::array<std::atomic<T>, Capacity> m_items{};
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <VulkanApp/Core/VulkanContext.h>
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+// sets of the first pool of a chain, each new pool of the chain doubles up to g_descriptor_pool_max_sets
+constexpr uint32_t g_descriptor_pool_first_sets{32};
+constexpr uint32_t g_descriptor_pool_max_sets{1024};
+
+// one descriptor as the update templates read it, buffer or image depending on the type of its binding
+union DescriptorInfo {
+	VkDescriptorBufferInfo buffer;
+	VkDescriptorImageInfo image;
+};
+
+// descriptor sets from chains of pools that grow by size class instead of one pool sized for the sets known upfront.
+// the sets of a frame come from its own chain, reset wholesale once the gpu has finished that frame; immutable sets
+// are cached by the hash of their contents so the same bindings give the same set. every write goes through the
+// update template of the layout, one call per set instead of an array of VkWriteDescriptorSet
+class DescriptorAllocator {
+
+      public:
+	DescriptorAllocator() = default;
+	~DescriptorAllocator() = default;
+
+	void init(VulkanContext* context, uint32_t framesInFlight);
+	// destroys the pools, the layouts and their templates, no set may still be used by the gpu
+	void cleanup() noexcept;
+
+	// resets and resizes the frame chains, every submitted frame must be finished
+	void setFramesInFlight(uint32_t framesInFlight);
+
+	// the layout and its update template, owned by the allocator. the DescriptorInfo of a set follow the bindings in
+	// order, descriptorCount entries per binding
+	VkDescriptorSetLayout createLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings);
+
+	// the set already written with these infos, or a new one. main thread, no allocation on a hit
+	VkDescriptorSet getCached(VkDescriptorSetLayout layout, const DescriptorInfo* infos);
+	// drops a cached set before what it references is destroyed or replaced, the set is reused by the next miss of
+	// its layout. it must not be used by a frame still in flight
+	void evict(VkDescriptorSet set);
+
+	// valid until resetFrame(frame), for what changes each frame
+	VkDescriptorSet allocateFrame(uint32_t frame, VkDescriptorSetLayout layout, const DescriptorInfo* infos);
+	// the frame fence or timeline has passed, every set of its chain is freed at once
+	void resetFrame(uint32_t frame);
+
+	size_t getPoolCount() const;
+	size_t getCachedCount() const { return m_cache.size(); }
+
+      private:
+	struct Layout {
+		VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+		VkDescriptorUpdateTemplate updateTemplate = VK_NULL_HANDLE;
+		std::vector<VkDescriptorType> types; // un par DescriptorInfo
+		std::vector<VkDescriptorSet> freeSets; // évincés du cache, réécrits au prochain miss
+	};
+
+	// les pools [0, current] ont servi, les suivants sont vides depuis le dernier reset
+	struct PoolChain {
+		std::vector<VkDescriptorPool> pools;
+		size_t current = 0;
+		uint32_t nextSets = g_descriptor_pool_first_sets;
+	};
+
+	struct CachedSet {
+		VkDescriptorSet set = VK_NULL_HANDLE;
+		Layout* layout = nullptr;
+		std::vector<DescriptorInfo> infos; // départage les collisions
+	};
+
+	Layout& findLayout(VkDescriptorSetLayout layout);
+	VkDescriptorPool createPool(uint32_t maxSets);
+	VkDescriptorSet allocate(PoolChain& chain, const Layout& layout);
+	void reset(PoolChain& chain);
+	void destroy(PoolChain& chain) noexcept;
+
+	static uint64_t hash(const Layout& layout, const DescriptorInfo* infos);
+	static bool equal(const Layout& layout, const DescriptorInfo* a, const DescriptorInfo* b);
+
+	VulkanContext* m_context = nullptr;
+
+	std::deque<Layout> m_layouts; // deque : les entrées du cache pointent sur leur layout
+	PoolChain m_persistent; // sets du cache, jamais reset
+	std::vector<PoolChain> m_frames;
+	std::unordered_multimap<uint64_t, CachedSet> m_cache;
+};
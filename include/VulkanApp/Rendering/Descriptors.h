@@ -1,39 +1,50 @@
 #pragma once
 
 #include <VulkanApp/Core/VulkanContext.h>
+#include <VulkanApp/Rendering/DescriptorAllocator.h>
 
 #include <vulkan/vulkan.h>
 
+#include <array>
 #include <vector>
 
 
-
+// the set layout of the main pipeline and one set per frame in flight, cached by the allocator
 class Descriptors {
 
       public:
 	Descriptors() = default;
 	~Descriptors() = default;
 
-	void init(VulkanContext* context, const uint32_t max_frames_in_flight, const std::vector<VkBuffer>& uniformBuffers, VkImageView textureImageView, VkSampler textureSampler);
+	// allocator : owns the layout and the sets, cleaned up after this
+	// uniformBuffers : FrameUniforms then the clip matrices of the objects at g_object_clip_offset
+	void init(VulkanContext* context, DescriptorAllocator* allocator, const uint32_t max_frames_in_flight, const std::vector<VkBuffer>& uniformBuffers,
+		  VkImageView textureImageView, VkSampler textureSampler);
 	void cleanup() noexcept;
 
+	// sets for another frame count, the layout is kept so the pipeline layout stays valid
+	void resize(const uint32_t max_frames_in_flight, const std::vector<VkBuffer>& uniformBuffers, VkImageView textureImageView, VkSampler textureSampler);
+
+	void updateTexture(uint32_t frame, VkImageView textureImageView, VkSampler textureSampler);
+
 	VkDescriptorSetLayout getSetLayout() { return  m_setLayout;};
-	VkDescriptorPool getPool() { return m_pool; };
 	std::vector<VkDescriptorSet>& getSets() { return m_sets; };
 
 
       private:
 
 	void createSetLayout();
-	void createPool(const uint32_t max_frames_in_flight);
 	void createSets( const uint32_t max_frames_in_flight, 
 								const std::vector<VkBuffer>& uniformBuffers,
 								VkImageView textureImageView,
 								VkSampler textureSampler);
+	// binding 0 : FrameUniforms, binding 1 : texture, binding 2 : ObjectClip, dans le même buffer que le 0
+	std::array<DescriptorInfo, 3> makeInfos(VkBuffer uniformBuffer, VkImageView textureImageView, VkSampler textureSampler) const;
 
 	VulkanContext* m_context = nullptr;
+	DescriptorAllocator* m_allocator = nullptr;
 
 	VkDescriptorSetLayout m_setLayout = VK_NULL_HANDLE;
-	VkDescriptorPool m_pool = VK_NULL_HANDLE;
 	std::vector<VkDescriptorSet> m_sets;
+	std::vector<VkBuffer> m_uniformBuffers; // ceux des sets, pour les réécrire avec une autre texture
 };
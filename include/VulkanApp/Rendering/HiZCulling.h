@@ -0,0 +1,148 @@
+#pragma once
+
+#include <VulkanApp/Commands/UploadContext.h>
+#include <VulkanApp/Core/VulkanContext.h>
+#include <VulkanApp/Rendering/DescriptorAllocator.h>
+#include <VulkanApp/Resources/DeletionQueue.h>
+#include <VulkanApp/Resources/MemoryAllocator.h>
+#include <VulkanApp/Sync/BarrierBatcher.h>
+#include <VulkanApp/Utils/Uniforms.h>
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+const std::string g_cull_shader = "Shaders/cull.spv";
+const std::string g_depth_reduce_shader = "Shaders/depth_reduce.spv";
+// niveau 0 depuis un depth buffer multisamplé
+const std::string g_depth_reduce_ms_shader = "Shaders/depth_reduce_ms.spv";
+
+// local_size des compute shaders
+constexpr uint32_t g_cull_group_size{64};
+constexpr uint32_t g_depth_reduce_group_size{8};
+
+// IndirectDraws : counts[4] puis les commandes des deux phases
+constexpr VkDeviceSize g_indirect_counts_size{4 * sizeof(uint32_t)};
+constexpr VkDeviceSize g_indirect_command_size{sizeof(VkDrawIndexedIndirectCommand)};
+
+// two phase occlusion culling on the gpu against a hierarchical depth buffer. the first phase tests every draw against
+// the pyramid of the previous frame and draws the visible ones into the depth buffer, the pyramid is rebuilt from that
+// depth, the second phase tests again what the first one rejected and draws what it got wrong. the surviving draws are
+// compacted into indirect commands counted on the gpu, the cpu records the same command buffer every frame.
+// the first phase only needs the previous pyramid and runs on the ComputeContext, the rest is recorded by the render
+// graph of VulkanApp. this owns the buffers, the pyramid and the pipelines, the ones both queues use are CONCURRENT
+class HiZCulling {
+
+      public:
+	HiZCulling() = default;
+	~HiZCulling() = default;
+
+	// uploads : the graphics queue one, the pyramid clear needs a queue with graphics or compute support.
+	// maxFramesInFlight sizes the readback of the counts, one slot per frame
+	void init(VulkanContext* context, MemoryAllocator* allocator, DescriptorAllocator* descriptorAllocator, DeletionQueue* deletionQueue,
+		  UploadContext* uploads, VkPipelineCache cache, uint32_t maxFramesInFlight);
+	// no frame may still use the buffers, the descriptor sets belong to the allocator
+	void cleanup() noexcept;
+
+	// indirect count draws and a depth format compute shaders can sample
+	static bool isSupported(VulkanContext* context, VkFormat depthFormat);
+
+	// the draws to test, uploaded with the next submit of the upload context. objectId indexes the object buffer
+	void setDraws(const std::vector<CullDraw>& draws);
+	uint32_t getDrawCount() const { return m_drawCount; }
+	VkBuffer getIndirectBuffer() const { return m_indirectBuffer; }
+	// written by the first phase, one uint per draw rounded up to a whole group
+	VkBuffer getVisibilityBuffer() const { return m_visibilityBuffer; }
+
+	// pyramid for a depth buffer of this extent, cleared to the far plane so the first frame culls nothing.
+	// the previous one goes through the deletion queue, the clear with the next submit of the upload context
+	void createPyramid(VkExtent2D extent);
+	VkExtent2D getPyramidSource() const { return m_pyramidSource; }
+	VkImage getPyramid() const { return m_pyramid; }
+	uint32_t getPyramidLevels() const { return m_pyramidLevels; }
+
+	// sets for the current frame count, the depth buffer of the compiled graph and the pyramid. the sets
+	// replaced are evicted once the frames in flight that may bind them are finished, see collect()
+	void updateDescriptors(const std::vector<VkBuffer>& uniformBuffers, VkBuffer objectBuffer, VkImageView depthView, VkSampleCountFlagBits depthSamples);
+	// every set at once, no frame may still be in flight
+	void evictDescriptors();
+	// same frame numbers as DeletionQueue::collect
+	void collect(uint64_t frameNumber, uint64_t completedFrames);
+
+	// counts of both phases to 0 then phase 0, on the compute queue. the previous frame must be finished : it built the
+	// pyramid and was the last to use the counts and the visibility. recorded every frame, its set comes from the
+	// frame chain of the descriptor allocator
+	void recordEarlyCull(VkCommandBuffer commandBuffer, uint32_t frame);
+	// phase 1, one thread per draw that phase 0 rejected
+	void recordLateCull(VkCommandBuffer commandBuffer, uint32_t frame);
+	// every level from the depth buffer, the pyramid is in GENERAL
+	void recordPyramid(VkCommandBuffer commandBuffer);
+	// the commands of a phase, the pipeline, vertex and index buffers and set are bound by the caller
+	void drawIndirect(VkCommandBuffer commandBuffer, uint32_t phase);
+	// copies the counts of both phases for readStats(), transfer stage
+	void recordReadback(VkCommandBuffer commandBuffer, uint32_t frame);
+	// draws of each phase in the last finished frame of this slot
+	void readStats(uint32_t frame, uint32_t& early, uint32_t& late) const;
+
+      private:
+	struct RetiredSet {
+		VkDescriptorSet set;
+		uint64_t frameNumber;
+	};
+
+	void createPipelines(VkPipelineCache cache);
+	// shared : used by the graphics and compute queues, CONCURRENT when they are different families
+	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, bool shared, VkBuffer& buffer, Allocation& allocation);
+	void destroyPyramid(bool deferred) noexcept;
+	void retire(VkDescriptorSet set);
+	void unretire(VkDescriptorSet set);
+	void recordCull(VkCommandBuffer commandBuffer, VkDescriptorSet set, uint32_t phase);
+
+	VulkanContext* m_context = nullptr;
+	MemoryAllocator* m_allocator = nullptr;
+	DescriptorAllocator* m_descriptorAllocator = nullptr;
+	DeletionQueue* m_deletionQueue = nullptr;
+	UploadContext* m_uploads = nullptr;
+
+	// binding 0 FrameUniforms, 1 CullDraws, 2 ObjectTransforms, 3 IndirectDraws, 4 Visibility, 5 pyramide
+	VkDescriptorSetLayout m_cullSetLayout = VK_NULL_HANDLE;
+	VkPipelineLayout m_cullLayout = VK_NULL_HANDLE;
+	VkPipeline m_cullPipeline = VK_NULL_HANDLE;
+	// binding 0 niveau source, 1 niveau écrit, pour les deux pipelines de réduction
+	VkDescriptorSetLayout m_reduceSetLayout = VK_NULL_HANDLE;
+	VkPipelineLayout m_reduceLayout = VK_NULL_HANDLE;
+	VkPipeline m_reducePipeline = VK_NULL_HANDLE;
+	VkPipeline m_reduceMsPipeline = VK_NULL_HANDLE;
+
+	uint32_t m_drawCount = 0;
+	VkBuffer m_drawBuffer = VK_NULL_HANDLE;
+	Allocation m_drawAllocation{};
+	VkBuffer m_indirectBuffer = VK_NULL_HANDLE;
+	Allocation m_indirectAllocation{};
+	VkBuffer m_visibilityBuffer = VK_NULL_HANDLE;
+	Allocation m_visibilityAllocation{};
+	// deux compteurs par frame in flight, host visible
+	VkBuffer m_readbackBuffer = VK_NULL_HANDLE;
+	Allocation m_readbackAllocation{};
+
+	// niveau 0 = moitié du depth buffer arrondie a une puissance de 2, chaque niveau divise exactement par 2
+	VkExtent2D m_pyramidSource{};
+	VkExtent2D m_pyramidExtent{};
+	uint32_t m_pyramidLevels = 0;
+	VkImage m_pyramid = VK_NULL_HANDLE;
+	Allocation m_pyramidAllocation{};
+	VkImageView m_pyramidView = VK_NULL_HANDLE; // tous les niveaux, lue par cull.comp
+	std::vector<VkImageView> m_mipViews; // un par niveau, écrits par la réduction
+
+	VkSampleCountFlagBits m_depthSamples = VK_SAMPLE_COUNT_1_BIT;
+	std::vector<VkDescriptorSet> m_cullSets; // [frame], phase 1 dans les command buffers en cache
+	std::vector<std::array<DescriptorInfo, 6>> m_cullInfos; // [frame], réécrits chaque frame pour la phase 0
+	std::vector<VkDescriptorSet> m_reduceSets; // [niveau]
+	std::vector<RetiredSet> m_retiredSets;
+	uint64_t m_frameNumber = 0;
+
+	BarrierBatcher m_barriers;
+};
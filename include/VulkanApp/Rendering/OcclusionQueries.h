@@ -0,0 +1,81 @@
+#pragma once
+
+#include <VulkanApp/Commands/UploadContext.h>
+#include <VulkanApp/Core/VulkanContext.h>
+#include <VulkanApp/Resources/MemoryAllocator.h>
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+// la boite unité du proxy, 12 triangles
+constexpr uint32_t g_proxy_index_count{36};
+
+// bounding box proxies drawn inside occlusion queries against the depth of the occluders. with
+// VK_EXT_conditional_rendering the results are copied into a predicate buffer and the real draws are skipped on the
+// gpu in the same frame, without it the cpu reads them once the frame is finished and leaves the hidden draws out of
+// the next lists. the queries are a ring of one range per frame in flight, a query is the position of its draw in
+// the list of the frame
+class OcclusionQueries {
+
+      public:
+	OcclusionQueries() = default;
+	~OcclusionQueries() = default;
+
+	// maxQueries per frame, one range for each of maxFramesInFlight slots. uploads : the graphics queue one, the
+	// proxy box is uploaded with its next submit
+	void init(VulkanContext* context, MemoryAllocator* allocator, UploadContext* uploads, uint32_t maxQueries, uint32_t maxFramesInFlight);
+	// no frame may still use the pool or the buffers
+	void cleanup() noexcept;
+
+	// the draws are skipped by the gpu, otherwise the results go through readResults()
+	bool usesConditionalRendering() const { return m_context->hasConditionalRendering(); }
+	VkBuffer getPredicateBuffer() const { return m_predicateBuffer; }
+
+	// queries [0, count) of this slot, outside a render pass. in the command buffer: a cached primary starts clean
+	void recordReset(VkCommandBuffer commandBuffer, uint32_t frame, uint32_t count);
+	// vertex and index buffers of the unit box, the pipeline and the set are bound by the caller
+	void bindProxy(VkCommandBuffer commandBuffer);
+	// the box scaled by the push constants of the caller, inside the query of this slot
+	void drawProxy(VkCommandBuffer commandBuffer, uint32_t frame, uint32_t query);
+	// the predicates [0, count) from the queries of this slot, transfer stage, outside a render pass
+	void recordResolve(VkCommandBuffer commandBuffer, uint32_t frame, uint32_t count);
+	// the draws recorded in between run only if a sample of the proxy of this query passed. any thread
+	void beginConditional(VkCommandBuffer commandBuffer, uint32_t query) const;
+	void endConditional(VkCommandBuffer commandBuffer) const;
+
+	// the draw of each query of this slot, copied when its frame (frameNumber) is submitted
+	void markSubmitted(uint32_t frame, const uint32_t* draws, uint32_t count, uint64_t frameNumber);
+	// false while the queries of the last frame of this slot are not all available, never waits, or when a newer frame
+	// was already read. once read the samples of each query are in getResults(), its draw in getResultDraws(), and the
+	// slot is not read again
+	bool readResults(uint32_t frame);
+	const std::vector<uint32_t>& getResultDraws() const { return m_submittedDraws[m_resultFrame]; }
+	const std::vector<uint32_t>& getResults() const { return m_results; }
+
+      private:
+	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, Allocation& allocation);
+	void createProxy();
+
+	VulkanContext* m_context = nullptr;
+	MemoryAllocator* m_allocator = nullptr;
+	UploadContext* m_uploads = nullptr;
+
+	uint32_t m_maxQueries = 0;
+	VkQueryPool m_queryPool = VK_NULL_HANDLE; // [frame * m_maxQueries + query]
+	// un uint32 par query, le nombre de samples copié par recordResolve
+	VkBuffer m_predicateBuffer = VK_NULL_HANDLE;
+	Allocation m_predicateAllocation{};
+	// 8 sommets puis les indices, comme le buffer du mesh
+	VkBuffer m_proxyBuffer = VK_NULL_HANDLE;
+	Allocation m_proxyAllocation{};
+	VkDeviceSize m_proxyIndicesOffset = 0;
+
+	std::vector<std::vector<uint32_t>> m_submittedDraws; // [frame], capacité réservée par init
+	std::vector<bool> m_submitted;
+	std::vector<uint64_t> m_submittedFrameNumbers; // [frame]
+	uint32_t m_resultFrame = 0;
+	uint64_t m_resultFrameNumber = 0; // des résultats plus vieux ne remplacent pas ceux déja lus
+	std::vector<uint32_t> m_results;
+};
@@ -4,10 +4,62 @@
 
 #include <vulkan/vulkan.h>
 
+#include <array>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 const std::string g_vertex_shader = "Shaders/vert.spv";
 const std::string g_fragment_shader = "Shaders/frag.spv";
+// position seule, pour la prepass de profondeur
+const std::string g_depth_vertex_shader = "Shaders/depth.spv";
+
+// specialization constants of a variant, shared by the vertex and fragment stages
+constexpr uint32_t g_max_specialization_constants{8};
+
+// vertex input of a variant, each layout maps to binding and attribute descriptions
+enum class VertexLayout : uint8_t {
+	Mesh, // Vertex : position, couleur, uv
+	Position, // Vertex, seul l'attribut 0 est lu
+};
+
+// everything a graphics pipeline is built from. two equal descriptions give the same pipeline, hash() keys the variants
+struct PipelineDesc {
+	std::string vertexShader = g_vertex_shader;
+	std::string fragmentShader = g_fragment_shader; // vide = depth only, sans fragment shader ni color attachment
+
+	// constantID -> value, un id que le shader ne déclare pas est ignoré
+	uint32_t specializationCount = 0;
+	std::array<uint32_t, g_max_specialization_constants> specializationIds{};
+	std::array<uint32_t, g_max_specialization_constants> specializationValues{};
+
+	VertexLayout vertexLayout = VertexLayout::Mesh;
+
+	// VK_NULL_HANDLE = dynamic rendering, la pipeline est créée pour les formats des attachments
+	VkRenderPass renderPass = VK_NULL_HANDLE;
+	uint32_t subpass = 0;
+	VkFormat colorFormat = VK_FORMAT_UNDEFINED;
+	VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+
+	VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+	VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+	VkFrontFace frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+	VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+	bool sampleShading = true;
+	float minSampleShading = 0.2f; // part des samples shadés séparément, avec sampleShading
+	bool depthTest = true;
+	bool depthWrite = true;
+	VkCompareOp depthCompare = VK_COMPARE_OP_LESS;
+	bool blend = false;
+
+	void setSpecialization(uint32_t constantId, uint32_t value);
+	bool isDepthOnly() const { return fragmentShader.empty(); }
+
+	uint64_t hash() const;
+	bool operator==(const PipelineDesc& other) const;
+	bool operator!=(const PipelineDesc& other) const { return !(*this == other); }
+};
 
 class Pipeline
 {
@@ -17,25 +69,37 @@ public:
 	~Pipeline() = default;
 
 	// Initialize with required external objects. Pipeline does not own them.
-	void init(VulkanContext* context, VkRenderPass renderPass, VkDescriptorSetLayout descriptorSetLayout);
+	// desc : the base variant, its render pass or its attachment formats for dynamic rendering
+	void init(VulkanContext* context, const PipelineDesc& desc, VkDescriptorSetLayout descriptorSetLayout, VkPipelineCache cache = VK_NULL_HANDLE);
 	void cleanup();
+	// the base variant built again from another description with the same layout, the previous pipeline is
+	// destroyed: no frame may still use it
+	void setDesc(const PipelineDesc& desc);
+
+	// builds the pipeline described by desc, thread safe: the variants are compiled on the job system threads
+	static VkPipeline create(VulkanContext* context, const PipelineDesc& desc, VkPipelineLayout layout, VkPipelineCache cache);
+	// a compute pipeline of one shader, main entry point and no specialization
+	static VkPipeline createCompute(VulkanContext* context, const std::string& shader, VkPipelineLayout layout, VkPipelineCache cache);
 
 	VkPipeline get() const { return m_pipeline; }
 	VkPipelineLayout getLayout() const { return m_layout; }
-	VkRenderPass getRenderPass() const { return m_renderPass; }
+	VkRenderPass getRenderPass() const { return m_desc.renderPass; }
 	VkDescriptorSetLayout getDescriptorSetLayout() const { return m_descriptorSetLayout; }
 	VulkanContext* getContext() const { return m_context; }
+	// description of get(), the base the other variants change
+	const PipelineDesc& getDesc() const { return m_desc; }
 
 private:
 
 	VulkanContext* m_context = nullptr;
 
-	VkRenderPass m_renderPass = VK_NULL_HANDLE;
 	VkDescriptorSetLayout m_descriptorSetLayout = VK_NULL_HANDLE;
+	VkPipelineCache m_cache = VK_NULL_HANDLE;
 
+	PipelineDesc m_desc;
 	VkPipelineLayout m_layout = VK_NULL_HANDLE;
-	VkPipeline m_pipeline = VK_NULL_HANDLE; 	
+	VkPipeline m_pipeline = VK_NULL_HANDLE;
 
-	VkShaderModule createShaderModule(const std::vector<char>& code);
+	static VkShaderModule createShaderModule(VkDevice device, const std::vector<char>& code);
 	void createGraphicsPipeline();
 };
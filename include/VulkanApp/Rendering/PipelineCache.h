@@ -0,0 +1,42 @@
+#pragma once
+
+#include <VulkanApp/Core/VulkanContext.h>
+
+#include <vulkan/vulkan.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+const std::string g_pipeline_cache_path = "pipeline_cache.bin";
+
+// VkPipelineCache shared by every pipeline creation, loaded from disk at startup and written back on shutdown.
+// the file is only handed to the driver when its header matches this device (vendor, device id, cache UUID): a cache
+// from another gpu or driver version starts cold instead of relying on the driver to reject it
+class PipelineCache {
+
+      public:
+	PipelineCache() = default;
+	~PipelineCache() = default;
+
+	void init(VulkanContext* context, const std::string& path = g_pipeline_cache_path);
+	// saves then destroys the cache, the pipelines created from it may outlive it
+	void cleanup() noexcept;
+
+	// writes the cache to a temporary file renamed over the previous one, a crash never leaves a truncated cache
+	bool save() const;
+
+	VkPipelineCache get() const { return m_cache; }
+	// false = no file, unreadable or made for another device
+	bool isWarm() const { return m_loadedBytes > 0; }
+	size_t getLoadedBytes() const { return m_loadedBytes; }
+
+      private:
+	bool isCompatible(const std::vector<char>& data) const;
+
+	VulkanContext* m_context = nullptr;
+	std::string m_path;
+
+	VkPipelineCache m_cache = VK_NULL_HANDLE;
+	size_t m_loadedBytes = 0;
+};
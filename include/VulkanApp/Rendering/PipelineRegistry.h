@@ -0,0 +1,81 @@
+#pragma once
+
+#include <VulkanApp/Core/VulkanContext.h>
+#include <VulkanApp/Jobs/JobSystem.h>
+#include <VulkanApp/Rendering/Pipeline.h>
+
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+
+using PipelineId = uint32_t;
+
+// pipeline variants keyed by the hash of their PipelineDesc. a variant asked for the first time is compiled on the job
+// system threads while get() hands out the fallback, so a new material never stalls a frame on the driver compiler.
+// only a variant drawn like the material (same shaders, vertex layout and attachments) can stand in for it, the others
+// have no pipeline until they are ready. the variants share the layout and the pipeline cache they were created with
+class PipelineRegistry {
+
+      public:
+	PipelineRegistry() = default;
+	~PipelineRegistry() = default;
+
+	// fallback : drawn with until a variant is ready, not owned. it is registered as the variant of fallbackDesc
+	void init(VulkanContext* context, JobSystem* jobs, VkPipelineLayout layout, VkPipelineCache cache, const PipelineDesc& fallbackDesc, VkPipeline fallback);
+	// waits for the compilations in progress then destroys the variants, none may still be used by the gpu
+	void cleanup() noexcept;
+
+	// main thread, the base pipeline was built again for another render pass or sample count: id 0 becomes it. the
+	// other variants stay, the ones of the previous base are asked for again by the caller
+	void setFallback(const PipelineDesc& fallbackDesc, VkPipeline fallback);
+
+	// main thread, never while draws are recorded. the same description gives the same id, compiled once
+	PipelineId request(const PipelineDesc& desc);
+	// the variant once compiled. until then or if compilation failed : the fallback for a variant of the material,
+	// VK_NULL_HANDLE for a depth only, specialized or other attachments one. any thread, never blocks
+	VkPipeline get(PipelineId id) const;
+	bool isReady(PipelineId id) const;
+	// the variant will never be ready, what needs it has to be turned off
+	bool isFailed(PipelineId id) const;
+	// main thread, to derive another variant from this one
+	const PipelineDesc& getDesc(PipelineId id) const { return m_variants[id].desc; }
+
+	// incremented each time a variant becomes ready, command buffers recorded with the fallback are recorded again
+	uint32_t getGeneration() const { return m_generation.load(std::memory_order_acquire); }
+	size_t getVariantCount() const { return m_variants.size(); }
+	// a job is still compiling a variant, its allocations and output are not the frame's
+	bool isCompiling() const { return !m_compiling.isDone(); }
+
+      private:
+	enum class State : uint8_t {
+		Compiling,
+		Ready,
+		Failed,
+	};
+
+	struct Variant {
+		PipelineDesc desc;
+		std::atomic<VkPipeline> pipeline{VK_NULL_HANDLE};
+		std::atomic<State> state{State::Compiling};
+		bool owned = true; // le fallback n'est pas détruit ici
+		bool fallbackCompatible = false; // le fallback peut la remplacer tant qu'elle n'est pas prête
+	};
+
+	void compile(Variant& variant);
+	bool isFallbackCompatible(const PipelineDesc& desc) const;
+
+	VulkanContext* m_context = nullptr;
+	JobSystem* m_jobs = nullptr;
+	VkPipelineLayout m_layout = VK_NULL_HANDLE;
+	VkPipelineCache m_cache = VK_NULL_HANDLE;
+	VkPipeline m_fallback = VK_NULL_HANDLE;
+
+	// deque : les jobs gardent une référence sur leur variant pendant que d'autres sont ajoutés
+	std::deque<Variant> m_variants;
+	std::unordered_multimap<uint64_t, PipelineId> m_ids; // hash -> variants, les collisions sont départagées par ==
+	JobCounter m_compiling;
+	std::atomic<uint32_t> m_generation{0};
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <VulkanApp/Core/VulkanContext.h>
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+
+// --quality et touches F1 a F4, du moins cher au plus beau
+enum class QualityPreset : uint8_t {
+	Low,
+	Medium,
+	High,
+	Ultra,
+};
+
+// what a preset changes, each field is rebuilt on its own when a switch changes it
+struct QualitySettings {
+	VkSampleCountFlagBits msaaSamples = VK_SAMPLE_COUNT_1_BIT; // render passes, pipelines et cibles du graph
+	float minSampleShading = 0.0f; // pipelines, 0 = sans sample shading
+	float maxAnisotropy = 1.0f;    // sampler de la texture, 1 = filtrage anisotrope désactivé
+	float renderScale = 1.0f;      // cibles du graph, en dessous de 1 l'image est agrandie sur la swapchain
+};
+
+// the settings of a preset as asked, before the limits of the device
+QualitySettings getQualitySettings(QualityPreset preset);
+// the settings of a preset clamped to what the device supports. upscale : the swapchain images can be blitted to,
+// without it the render scale stays 1
+QualitySettings resolveQualitySettings(const VulkanContext* context, QualityPreset preset, bool upscale);
+
+const char* getQualityName(QualityPreset preset);
+// "low", "medium", "high" or "ultra", false for anything else
+bool parseQualityPreset(const char* name, QualityPreset& preset);
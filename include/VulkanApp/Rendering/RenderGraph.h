@@ -0,0 +1,182 @@
+#pragma once
+
+#include <VulkanApp/Core/VulkanContext.h>
+#include <VulkanApp/Resources/DeletionQueue.h>
+#include <VulkanApp/Resources/MemoryAllocator.h>
+#include <VulkanApp/Sync/ResourceAccess.h>
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// index of an image or buffer in the graph
+using RenderGraphResource = uint32_t;
+constexpr RenderGraphResource g_invalid_resource{std::numeric_limits<uint32_t>::max()};
+
+struct RenderGraphImageDesc {
+	VkFormat format = VK_FORMAT_UNDEFINED;
+	VkExtent2D extent{};
+	VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+	VkImageUsageFlags usage = 0; // en plus de celles déduites des accès des passes
+};
+
+// passes declare what they read and write, compile() culls the passes nothing depends on, places the transient
+// resources whose lifetimes do not overlap in the same memory and computes the barriers between the passes.
+// execute() records the barriers and the passes in declaration order, the graph is compiled once per swapchain
+class RenderGraph {
+
+      public:
+	using PassFunction = std::function<void(VkCommandBuffer commandBuffer)>;
+
+	RenderGraph() = default;
+	~RenderGraph() = default;
+
+	void init(VulkanContext* context, MemoryAllocator* allocator, DeletionQueue* deletionQueue);
+	// destroys the transient resources now, the GPU must be idle
+	void cleanup() noexcept;
+	// forgets the passes and resources, the transient ones go through the deletion queue
+	void reset();
+
+	// transient resources, created by compile() and owned by the graph
+	RenderGraphResource createImage(const std::string& name, const RenderGraphImageDesc& desc);
+	RenderGraphResource createBuffer(const std::string& name, VkDeviceSize size);
+	// owned elsewhere, in the initial state when the graph starts and moved to the final one at the end.
+	// ResourceAccess::None as final leaves the resource in the state of its last pass
+	RenderGraphResource importImage(const std::string& name, VkImageAspectFlags aspect, ResourceAccess initial, ResourceAccess final);
+	RenderGraphResource importBuffer(const std::string& name, ResourceAccess initial, ResourceAccess final);
+
+	uint32_t addPass(const std::string& name, PassFunction execute);
+	// read() keeps the passes that wrote the resource before, a read with a write access loads and modifies it :
+	// the pass is then kept like a writer of the resource
+	void read(uint32_t pass, RenderGraphResource resource, ResourceAccess access);
+	void write(uint32_t pass, RenderGraphResource resource, ResourceAccess access);
+	// the pass is kept even if nothing reads what it writes (queries, readbacks)
+	void setSideEffects(uint32_t pass);
+
+	void compile();
+	void execute(VkCommandBuffer commandBuffer);
+
+	// imported resources may change between two executions (swapchain image, defragmentation)
+	void setImage(RenderGraphResource resource, VkImage image) { m_resources[resource].image = image; }
+	void setBuffer(RenderGraphResource resource, VkBuffer buffer) { m_resources[resource].buffer = buffer; }
+
+	VkImage getImage(RenderGraphResource resource) const { return m_resources[resource].image; }
+	VkImageView getImageView(RenderGraphResource resource) const { return m_resources[resource].view; }
+	VkBuffer getBuffer(RenderGraphResource resource) const { return m_resources[resource].buffer; }
+
+	// passes, barriers and memory placement of the compiled graph
+	void dump(std::ostream& out) const;
+
+      private:
+	struct Resource {
+		std::string name;
+		bool isImage = true;
+		bool imported = false;
+		RenderGraphImageDesc desc{};
+		VkImageAspectFlags aspect = 0;
+		VkImageUsageFlags imageUsage = 0;
+		VkDeviceSize size = 0;
+		VkBufferUsageFlags bufferUsage = 0;
+		ResourceAccess initial = ResourceAccess::None;
+		ResourceAccess final = ResourceAccess::None;
+
+		VkImage image = VK_NULL_HANDLE;
+		VkImageView view = VK_NULL_HANDLE;
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkMemoryRequirements requirements{};
+
+		// passes gardées qui l'utilisent, UINT32_MAX si aucune
+		uint32_t firstPass = std::numeric_limits<uint32_t>::max();
+		uint32_t lastPass = 0;
+		uint32_t slot = std::numeric_limits<uint32_t>::max();
+	};
+
+	struct Use {
+		RenderGraphResource resource;
+		ResourceAccess access;
+		bool read;
+		bool write;
+	};
+
+	struct Barrier {
+		RenderGraphResource resource;
+		VkPipelineStageFlags srcStages;
+		VkPipelineStageFlags dstStages;
+		VkAccessFlags srcAccesses;
+		VkAccessFlags dstAccesses;
+		VkImageLayout oldLayout;
+		VkImageLayout newLayout;
+		bool image; // sinon fusionnée dans la VkMemoryBarrier du lot
+	};
+
+	// what one vkCmdPipelineBarrier2 records before a pass
+	struct BarrierBatch {
+		uint32_t firstBarrier = 0;
+		uint32_t barrierCount = 0;
+		uint32_t firstImageBarrier = 0;
+		uint32_t imageBarrierCount = 0;
+		VkPipelineStageFlags memorySrcStages = 0;
+		VkPipelineStageFlags memoryDstStages = 0;
+		VkAccessFlags memorySrcAccesses = 0;
+		VkAccessFlags memoryDstAccesses = 0;
+		bool hasMemoryBarrier = false;
+	};
+
+	struct Pass {
+		std::string name;
+		PassFunction execute;
+		std::vector<Use> uses;
+		bool sideEffects = false;
+		bool culled = false;
+		BarrierBatch barriers;
+	};
+
+	// memory shared by transient resources whose lifetimes do not overlap
+	struct MemorySlot {
+		VkMemoryRequirements requirements{};
+		bool linear = false;
+		uint32_t lastPass = 0;
+		std::vector<RenderGraphResource> resources; // par première utilisation
+		Allocation allocation{};
+	};
+
+	// état d'une ressource pendant la simulation de l'éxécution
+	struct State {
+		VkPipelineStageFlags stages = 0;
+		VkAccessFlags accesses = 0;
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		bool write = false;
+	};
+
+	Use& findUse(uint32_t pass, RenderGraphResource resource, ResourceAccess access);
+
+	void cullPasses();
+	void computeLifetimes();
+	void createTransients();
+	void allocateSlots();
+	// first run only computes the state every resource ends in, the second emits the barriers
+	void buildBarriers(std::vector<State>& finalStates, bool emit);
+	void addBarrier(BarrierBatch& batch, RenderGraphResource resource, const State& from, const AccessInfo& to, bool discard);
+	void recordBarriers(VkCommandBuffer commandBuffer, const BarrierBatch& batch);
+
+	void destroyTransients(bool deferred) noexcept;
+
+	VulkanContext* m_context = nullptr;
+	MemoryAllocator* m_allocator = nullptr;
+	DeletionQueue* m_deletionQueue = nullptr;
+
+	std::vector<Resource> m_resources;
+	std::vector<Pass> m_passes;
+	std::vector<MemorySlot> m_slots;
+
+	std::vector<Barrier> m_barriers;
+	// préparées par compile(), seules les images importées sont patchées a l'éxécution
+	std::vector<VkImageMemoryBarrier2> m_imageBarriers;
+	std::vector<RenderGraphResource> m_imageBarrierResources;
+	BarrierBatch m_epilogue; // vers l'état final des ressources importées
+};
@@ -5,6 +5,8 @@
 
 #include <vulkan/vulkan.h>
 
+#include <array>
+
 class RenderPass
 {
 
@@ -12,22 +14,44 @@ public:
 	RenderPass() = default;
 	~RenderPass() = default;
 
+	// the passes for the sample count of the context
 	void init(VulkanContext* context, SwapChain* swapchain);
 	void cleanup() noexcept;
-
-	VkRenderPass get() { return m_renderPass; };
-
-	VkFormat findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
-	VkFormat findDepthFormat();
+	// the passes for another sample count, created the first time only: the pipelines built for the previous ones
+	// stay valid, a preset switched back finds its variants under the same key
+	void setSamples(VkSampleCountFlagBits samples);
+
+	// without msaa the color attachment is the target itself and there is no resolve attachment
+	VkRenderPass get() { return m_current->main; };
+	// compatible with get() so the same pipelines and framebuffers work with both: depth loaded read-only, written by
+	// the prepass before
+	VkRenderPass getAfterPrepass() { return m_current->afterPrepass; };
+	// depth only, cleared and stored for the main pass
+	VkRenderPass getDepthPrepass() { return m_current->depthPrepass; };
+	// compatible with getDepthPrepass(), the depth is loaded: the second depth pass of the Hi-Z culling
+	VkRenderPass getDepthPrepassLoad() { return m_current->depthPrepassLoad; };
+
+	// static : the dynamic rendering path needs the depth format without creating a render pass
+	static VkFormat findSupportedFormat(VulkanContext* context, const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
+	static VkFormat findDepthFormat(VulkanContext* context);
 
 private:
 
 	VulkanContext* m_context = nullptr;
 	SwapChain* m_swapchain = nullptr;
 
-	VkRenderPass m_renderPass = VK_NULL_HANDLE;
-
-	void createRenderPass();
+	struct Passes {
+		VkRenderPass main = VK_NULL_HANDLE;
+		VkRenderPass afterPrepass = VK_NULL_HANDLE;
+		VkRenderPass depthPrepass = VK_NULL_HANDLE;
+		VkRenderPass depthPrepassLoad = VK_NULL_HANDLE;
+	};
+	// [log2 du sample count], de 1x a 64x
+	std::array<Passes, 7> m_passes{};
+	Passes* m_current = &m_passes[0];
+
+	VkRenderPass createRenderPass(VkSampleCountFlagBits samples, bool afterPrepass);
+	VkRenderPass createDepthPrepass(VkSampleCountFlagBits samples, bool load);
 };
 
 
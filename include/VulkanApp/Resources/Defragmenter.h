@@ -0,0 +1,91 @@
+#pragma once
+
+#include <VulkanApp/Core/VulkanContext.h>
+#include <VulkanApp/Resources/DeletionQueue.h>
+#include <VulkanApp/Resources/MemoryAllocator.h>
+#include <VulkanApp/Sync/BarrierBatcher.h>
+#include <VulkanApp/Utils/FrameArena.h>
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+// limits for one call to step(), the work is spread over as many frames as needed
+struct DefragBudget {
+	VkDeviceSize maxBytesPerFrame = 8ull * 1024 * 1024;
+	uint32_t maxMovesPerFrame = 4;
+	double maxMilliseconds = 0.5;
+};
+
+// barriers reserved up front for one step(), a bigger budget grows the batcher once
+constexpr uint32_t g_defrag_reserved_barriers{16};
+
+struct DefragStats {
+	uint32_t moves = 0;
+	VkDeviceSize bytesMoved = 0;
+	uint32_t blocksReleased = 0;
+};
+
+class Defragmenter {
+
+      public:
+	Defragmenter() = default;
+	~Defragmenter() = default;
+
+	// the old handles of moved resources go through deletionQueue
+	void init(VulkanContext* context, MemoryAllocator* allocator, DeletionQueue* deletionQueue);
+	void cleanup() noexcept;
+
+	// the defragmenter writes the new handle / allocation back through these pointers after a move
+	void registerBuffer(VkBuffer* buffer, Allocation* allocation, const VkBufferCreateInfo& createInfo);
+	void registerImage(VkImage* image, Allocation* allocation, const VkImageCreateInfo& createInfo,
+			   VkImageLayout layout, VkImageAspectFlags aspect);
+	void unregister(const Allocation* allocation);
+
+	void begin();
+	bool isActive() const { return m_active; }
+
+	// records the copies of this frame in commandBuffer, outside of any render pass
+	// temporary lists live in the frame arena
+	DefragStats step(VkCommandBuffer commandBuffer, uint64_t frameNumber, const DefragBudget& budget, FrameArena& arena);
+
+	// gives back the blocks emptied by moves whose old allocations are freed, call after DeletionQueue::collect
+	void collect(uint64_t completedFrames) noexcept;
+
+	const DefragStats& getTotalStats() const { return m_total; }
+
+      private:
+	struct Movable {
+		VkBuffer* buffer = nullptr;
+		VkImage* image = nullptr;
+		Allocation* allocation = nullptr;
+		VkMemoryRequirements requirements{};
+		VkBufferCreateInfo bufferInfo{};
+		VkImageCreateInfo imageInfo{};
+		uint32_t queueFamilies[3]{}; // graphics, transfer, compute si CONCURRENT
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkImageAspectFlags aspect = 0;
+		VkPipelineStageFlags dstStages = 0;
+		VkAccessFlags dstAccess = 0;
+	};
+
+	bool findDestination(const Movable& movable, Allocation& destination, ArenaVector<MemoryBlock*>& blocks);
+	void moveBuffer(VkCommandBuffer commandBuffer, Movable& movable, Allocation& destination);
+	void moveImage(VkCommandBuffer commandBuffer, Movable& movable, Allocation& destination, FrameArena& arena);
+
+	VulkanContext* m_context = nullptr;
+	MemoryAllocator* m_allocator = nullptr;
+	DeletionQueue* m_deletionQueue = nullptr;
+
+	std::vector<Movable> m_movables;
+	BarrierBatcher m_before; // flushée avant chaque copie d'image
+	BarrierBatcher m_after;  // flushée une fois par step()
+
+	// frame of the last move, its old allocations are freed once the GPU has finished it
+	uint64_t m_lastMoveFrame = 0;
+	bool m_releasePending = false;
+
+	bool m_active = false;
+	DefragStats m_total{};
+};
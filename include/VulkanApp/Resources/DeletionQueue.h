@@ -0,0 +1,62 @@
+#pragma once
+
+#include <VulkanApp/Core/VulkanContext.h>
+#include <VulkanApp/Resources/MemoryAllocator.h>
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <deque>
+
+// objects released while a frame is recorded are destroyed once the GPU has finished that frame,
+// nothing has to drain the device to replace a resource the GPU may still read
+class DeletionQueue {
+
+      public:
+	DeletionQueue() = default;
+	~DeletionQueue() = default;
+
+	void init(VulkanContext* context, MemoryAllocator* allocator);
+	void cleanup() noexcept;
+
+	// every push is tagged with the frame given to the last collect(), the one being recorded
+	void push(VkBuffer buffer, const Allocation& allocation);
+	void push(VkImage image, const Allocation& allocation);
+	void push(VkImageView view);
+	void push(VkSampler sampler);
+	void push(VkPipeline pipeline);
+	void push(VkPipelineLayout layout);
+	void push(VkFramebuffer framebuffer);
+	void push(VkSwapchainKHR swapchain);
+
+	// frameNumber is the frame about to be recorded, completedFrames comes from FrameTimeline
+	void collect(uint64_t frameNumber, uint64_t completedFrames) noexcept;
+	// destroys everything now, every submitted frame must be finished
+	void flush() noexcept;
+
+	size_t getPendingCount() const { return m_entries.size(); }
+
+      private:
+	// un seul handle est renseigné, vkDestroy* ignore VK_NULL_HANDLE
+	struct Entry {
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkImage image = VK_NULL_HANDLE;
+		VkImageView view = VK_NULL_HANDLE;
+		VkSampler sampler = VK_NULL_HANDLE;
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		VkPipelineLayout layout = VK_NULL_HANDLE;
+		VkFramebuffer framebuffer = VK_NULL_HANDLE;
+		VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+		Allocation allocation{};
+		uint64_t frameNumber = 0;
+	};
+
+	void push(Entry entry);
+	void destroy(Entry& entry) noexcept;
+
+	VulkanContext* m_context = nullptr;
+	MemoryAllocator* m_allocator = nullptr;
+
+	uint64_t m_frameNumber = 0;
+	std::deque<Entry> m_entries; // frame numbers only grow, the oldest entries are always at the front
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <VulkanApp/Core/VulkanContext.h>
+#include <VulkanApp/Utils/FrameArena.h>
+
+#include <vulkan/vulkan.h>
+
+#include <memory>
+#include <vector>
+
+constexpr VkDeviceSize g_memory_block_size{64ull * 1024 * 1024};
+
+struct MemoryBlock;
+
+// sub-allocation inside a MemoryBlock, what createBuffer / createImage hand back instead of a VkDeviceMemory
+struct Allocation {
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0;
+	uint32_t memoryType = 0;
+	void* mapped = nullptr; // only set for host visible memory, the block stays persistently mapped
+	MemoryBlock* block = nullptr;
+};
+
+struct FreeRange {
+	VkDeviceSize offset;
+	VkDeviceSize size;
+};
+
+struct MemoryBlock {
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize size = 0;
+	VkDeviceSize used = 0;
+	uint32_t memoryType = 0;
+	uint32_t allocationCount = 0;
+	bool linear = true; // buffers and optimal images never share a block, no bufferImageGranularity to respect
+	void* mapped = nullptr;
+	std::vector<FreeRange> freeRanges; // sorted by offset, adjacent ranges are always merged, room for one more kept
+};
+
+struct MemoryStats {
+	uint32_t blockCount = 0;
+	uint32_t allocationCount = 0;
+	uint32_t freeRangeCount = 0;
+	VkDeviceSize totalBytes = 0;
+	VkDeviceSize usedBytes = 0;
+	VkDeviceSize largestFreeRange = 0;
+
+	VkDeviceSize freeBytes() const { return totalBytes - usedBytes; }
+
+	// 0 = all the free space is one contiguous range, close to 1 = free space is scattered in small holes
+	float fragmentation() const {
+		if (freeBytes() == 0)
+			return 0.0f;
+		return 1.0f - static_cast<float>(largestFreeRange) / static_cast<float>(freeBytes());
+	}
+};
+
+class MemoryAllocator {
+
+      public:
+	MemoryAllocator() = default;
+	~MemoryAllocator() = default;
+
+	void init(VulkanContext* context);
+	void cleanup() noexcept;
+
+	Allocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool linear);
+	Allocation allocateInBlock(MemoryBlock* block, const VkMemoryRequirements& requirements, VkDeviceSize maxOffset);
+	void free(Allocation& allocation) noexcept;
+
+	uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+
+	// blocks of the given memory type sorted from the most to the least used, defragmentation destinations come first
+	void getBlocks(uint32_t memoryType, ArenaVector<MemoryBlock*>& blocks);
+
+	MemoryStats getStats(VkMemoryPropertyFlags requiredProperties = 0) const;
+	uint32_t releaseEmptyBlocks() noexcept;
+
+      private:
+	MemoryBlock* createBlock(uint32_t memoryType, VkDeviceSize size, bool linear);
+	bool tryAllocate(MemoryBlock* block, const VkMemoryRequirements& requirements, VkDeviceSize maxOffset, Allocation& allocation);
+
+	VulkanContext* m_context = nullptr;
+
+	VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+	std::vector<std::unique_ptr<MemoryBlock>> m_blocks;
+};
@@ -32,6 +32,13 @@ class Mesh {
 		return indices.data();
 	}
 
+	const Vertex& vertex(uint32_t index) const {
+		return vertices[index];
+	}
+	uint32_t index(uint32_t i) const {
+		return indices[i];
+	}
+
 	void loadMesh(const std::string& modelPath) {
 		tinyobj::attrib_t attrib;
 		std::vector<tinyobj::shape_t> shapes;
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+// accumulates synchronization2 barriers until the point where the resources are used, flush() records them all in a
+// single vkCmdPipelineBarrier2. barriers of the same image and aspect are merged: a transition that continues a
+// pending one (A -> B then B -> C) becomes A -> C, identical ones on adjacent mip levels or layers become one range.
+// buffer barriers with the same masks on touching ranges are merged the same way, global ones are OR-ed together
+class BarrierBatcher {
+
+      public:
+	BarrierBatcher() = default;
+	~BarrierBatcher() = default;
+
+	// flushing never allocates once the batcher has seen this many barriers
+	void reserve(size_t imageCount, size_t bufferCount);
+
+	void image(VkImage image, const VkImageSubresourceRange& range, VkImageLayout oldLayout, VkImageLayout newLayout,
+		   VkPipelineStageFlags2 srcStages, VkAccessFlags2 srcAccesses, VkPipelineStageFlags2 dstStages, VkAccessFlags2 dstAccesses,
+		   uint32_t srcFamily = VK_QUEUE_FAMILY_IGNORED, uint32_t dstFamily = VK_QUEUE_FAMILY_IGNORED);
+	void buffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size,
+		    VkPipelineStageFlags2 srcStages, VkAccessFlags2 srcAccesses, VkPipelineStageFlags2 dstStages, VkAccessFlags2 dstAccesses,
+		    uint32_t srcFamily = VK_QUEUE_FAMILY_IGNORED, uint32_t dstFamily = VK_QUEUE_FAMILY_IGNORED);
+	void memory(VkPipelineStageFlags2 srcStages, VkAccessFlags2 srcAccesses, VkPipelineStageFlags2 dstStages, VkAccessFlags2 dstAccesses);
+
+	// records the pending barriers, does nothing when there are none
+	void flush(VkCommandBuffer commandBuffer);
+	// drops the pending barriers without recording them
+	void clear();
+
+	bool empty() const { return m_images.empty() && m_buffers.empty() && !m_hasMemory; }
+	bool touches(VkImage image) const;
+	bool touches(VkBuffer buffer) const;
+
+	// vkCmdPipelineBarrier2 calls recorded by this batcher
+	uint32_t getFlushCount() const { return m_flushCount; }
+
+      private:
+	std::vector<VkImageMemoryBarrier2> m_images;
+	std::vector<VkBufferMemoryBarrier2> m_buffers;
+	VkMemoryBarrier2 m_memory{};
+	bool m_hasMemory = false;
+
+	uint32_t m_flushCount = 0;
+};
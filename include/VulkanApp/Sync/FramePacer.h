@@ -0,0 +1,61 @@
+#pragma once
+
+#include <VulkanApp/Core/VulkanContext.h>
+#include <VulkanApp/Utils/FrameStats.h>
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+// input sample times kept per frame number, more than any frame count between sampling and presentation
+constexpr uint32_t g_latency_ring_size{8};
+// a lost present (swapchain recreated, window hidden) must not block the loop forever
+constexpr uint64_t g_present_wait_timeout_ns{100'000'000};
+
+// pacing of the main loop: an optional CPU limiter sleeping to a target rate, and the low latency wait that lets the
+// next frame sample its input only once the previous one is on screen. measures input sample -> present for every
+// frame: up to the image being displayed with VK_KHR_present_wait, up to vkQueuePresentKHR returning without it
+class FramePacer {
+
+      public:
+	FramePacer() = default;
+	~FramePacer() = default;
+
+	// targetFps 0 = no limiter, statsCapacity latencies are kept for printing
+	void init(VulkanContext* context, double targetFps, size_t statsCapacity);
+
+	// sleeps until the start of the next period, late frames move the schedule instead of catching up
+	void limit();
+
+	void markInput(uint64_t frameNumber);
+	// to chain in VkPresentInfoKHR::pNext, nullptr without present_wait. the id is frameNumber + 1, 0 is not valid
+	const void* getPresentChain(uint64_t frameNumber);
+	// after vkQueuePresentKHR, collects the latencies of the frames already displayed without blocking
+	void markPresented(VkSwapchainKHR swapchain, uint64_t frameNumber);
+	// blocks until frameNumber is displayed, only with present_wait
+	void waitPresented(VkSwapchainKHR swapchain, uint64_t frameNumber);
+	// the ids presented to a retired swapchain will never be waited for, nextFrame is the first on the new one
+	void resetSwapchain(uint64_t nextFrame);
+
+	bool measuresDisplay() const { return m_context->hasPresentWait(); }
+	const FrameStats& getLatency() const { return m_latency; }
+
+      private:
+	void record(uint64_t frameNumber);
+
+	VulkanContext* m_context = nullptr;
+
+	std::chrono::steady_clock::duration m_period{0};
+	std::chrono::steady_clock::time_point m_nextFrame{};
+
+	std::array<std::chrono::steady_clock::time_point, g_latency_ring_size> m_inputTimes{};
+	uint64_t m_nextMeasured = 0; // première frame présentée dont la latence n'est pas encore mesurée
+	uint64_t m_presented = 0;    // frames passées a vkQueuePresentKHR
+
+	VkPresentIdKHR m_presentIdInfo{};
+	uint64_t m_presentId = 0;
+
+	FrameStats m_latency;
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <VulkanApp/Core/VulkanContext.h>
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+
+// one timeline semaphore counting the frames the GPU has finished, frame N signals N + 1 on the graphics queue.
+// subsystems ask "is frame N done" without owning any fence
+class FrameTimeline {
+
+      public:
+	FrameTimeline() = default;
+	~FrameTimeline() = default;
+
+	void init(VulkanContext* context);
+	void cleanup() noexcept;
+
+	VkSemaphore getSemaphore() const { return m_semaphore; }
+
+	// value the submission of frameNumber signals
+	static uint64_t signalValue(uint64_t frameNumber) { return frameNumber + 1; }
+
+	// number of frames the GPU has finished
+	uint64_t getCompletedFrames() const;
+	bool isFrameComplete(uint64_t frameNumber) const { return getCompletedFrames() > frameNumber; }
+
+	// blocks the CPU until frameCount frames are finished, returns immediately for 0
+	void waitForFrames(uint64_t frameCount) const;
+	void waitForFrame(uint64_t frameNumber) const { waitForFrames(frameNumber + 1); }
+
+      private:
+	VulkanContext* m_context = nullptr;
+	VkSemaphore m_semaphore = VK_NULL_HANDLE;
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+constexpr uint32_t g_tuner_window_frames{120};
+
+// picks the number of frames in flight from measured CPU and GPU frame times. one more frame in flight lets the
+// CPU run further ahead and absorb its spikes, at the cost of one frame of input latency: the tuner keeps the
+// smallest depth for which the slowest CPU frames still fit in the GPU time already queued
+class FramesInFlightTuner {
+
+      public:
+	FramesInFlightTuner() = default;
+	~FramesInFlightTuner() = default;
+
+	void init(uint32_t minFrames, uint32_t maxFrames);
+
+	// cpuMilliseconds excludes the time spent blocked on the GPU or the swapchain
+	void add(double cpuMilliseconds, double gpuMilliseconds);
+
+	// new frame count once a full window asks for the same change twice in a row, 0 otherwise
+	uint32_t evaluate(uint32_t current);
+
+      private:
+	uint32_t pick() const;
+
+	uint32_t m_minFrames = 2;
+	uint32_t m_maxFrames = 2;
+
+	// tableaux fixes, appelé dans drawFrame qui ne doit pas allouer
+	std::array<double, g_tuner_window_frames> m_cpuSamples{};
+	std::array<double, g_tuner_window_frames> m_gpuSamples{};
+	uint32_t m_sampleCount = 0;
+
+	uint32_t m_candidate = 0;
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+
+// the ways a pass can use an image or a buffer, each one maps to the stages, accesses and layout it needs
+enum class ResourceAccess : uint8_t {
+	None, // pas encore utilisée, layout UNDEFINED
+	ColorAttachmentWrite,
+	DepthAttachmentWrite,
+	DepthAttachmentRead,
+	SampledFragment,
+	SampledCompute,
+	StorageReadCompute,
+	StorageWriteCompute,
+	TransferSrc,
+	TransferDst,
+	VertexBuffer,
+	IndexBuffer,
+	UniformBuffer,
+	IndirectBuffer,
+	ConditionalRendering, // prédicats de VK_EXT_conditional_rendering
+	Acquire, // image de la swapchain juste acquise, attendue par le sémaphore au stage color attachment output
+	Present,
+};
+
+struct AccessInfo {
+	VkPipelineStageFlags stages;
+	VkAccessFlags accesses;
+	VkImageLayout layout; // ignoré pour un buffer
+	bool write;
+};
+
+const AccessInfo& getAccessInfo(ResourceAccess access);
+const char* getAccessName(ResourceAccess access);
+
+// stages and accesses an image in this layout is used with, for transitions that only know the layouts.
+// unknown layouts get ALL_COMMANDS and every memory access, slower but never wrong
+AccessInfo getLayoutAccess(VkImageLayout layout);
+
+const char* getLayoutName(VkImageLayout layout);
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// global operator new is replaced in AllocationCounter.cpp to count every heap allocation of the process
+namespace AllocationCounter {
+
+// every thread, background work included
+uint64_t getCount() noexcept;
+// the calling thread only, without what a Scope of this thread has taken
+uint64_t getThreadCount() noexcept;
+
+// while alive the allocations of the calling thread go to total instead of its own count. a job run for someone else
+// counts in total, on whichever thread it runs, and never twice when the waiting thread runs it itself
+class Scope {
+
+      public:
+	explicit Scope(std::atomic<uint64_t>& total) noexcept;
+	~Scope();
+
+	Scope(const Scope&) = delete;
+	Scope& operator=(const Scope&) = delete;
+
+      private:
+	std::atomic<uint64_t>* m_previous;
+};
+
+} // namespace AllocationCounter
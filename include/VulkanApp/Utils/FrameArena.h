@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+constexpr size_t g_frame_arena_size{256 * 1024};
+
+// bump allocator for transient CPU data of one frame in flight,
+// everything is released at once by reset() when the frame fence has been reached
+class FrameArena {
+
+      public:
+	FrameArena() = default;
+	~FrameArena() = default;
+
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+	FrameArena(FrameArena&&) = default;
+	FrameArena& operator=(FrameArena&&) = default;
+
+	void init(size_t capacity);
+	void reset();
+
+	void* allocate(size_t size, size_t alignment);
+
+	template <typename T>
+	T* allocateArray(size_t count) { return static_cast<T*>(allocate(sizeof(T) * count, alignof(T))); }
+
+	size_t getUsed() const { return m_used; }
+	size_t getCapacity() const { return m_capacity; }
+	size_t getHighWater() const { return m_highWater; }
+
+      private:
+	std::unique_ptr<std::byte[]> m_buffer;
+	size_t m_capacity = 0;
+	size_t m_used = 0;
+	size_t m_highWater = 0;
+
+	// quand la capacité est dépassée on alloue sur le heap, reset() agrandit le buffer pour les frames suivantes
+	std::vector<std::unique_ptr<std::byte[]>> m_overflow;
+	size_t m_overflowBytes = 0;
+};
+
+// STL allocator adapter, deallocate is a no-op, memory comes back with FrameArena::reset. default constructed it is
+// the heap, for a member container that takes the arena of each frame by move assignment
+template <typename T>
+class ArenaAllocator {
+
+      public:
+	using value_type = T;
+	// un conteneur réassigné prend l'arena de la frame au lieu de garder celle de sa construction
+	using propagate_on_container_move_assignment = std::true_type;
+	using propagate_on_container_swap = std::true_type;
+
+	ArenaAllocator() noexcept = default;
+	explicit ArenaAllocator(FrameArena& arena) noexcept : m_arena(&arena) {}
+
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) noexcept : m_arena(other.getArena()) {}
+
+	T* allocate(size_t count) {
+		if (!m_arena)
+			return static_cast<T*>(::operator new(sizeof(T) * count));
+		return m_arena->allocateArray<T>(count);
+	}
+	void deallocate(T* ptr, size_t) noexcept {
+		if (!m_arena) {
+			::operator delete(ptr);
+		}
+	}
+
+	FrameArena* getArena() const noexcept { return m_arena; }
+
+	template <typename U>
+	bool operator==(const ArenaAllocator<U>& other) const noexcept { return m_arena == other.getArena(); }
+	template <typename U>
+	bool operator!=(const ArenaAllocator<U>& other) const noexcept { return m_arena != other.getArena(); }
+
+      private:
+	FrameArena* m_arena = nullptr;
+};
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
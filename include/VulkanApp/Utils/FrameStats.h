@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// frame time samples of a benchmark run, the storage is reserved up front so add() never allocates
+class FrameStats {
+
+      public:
+	FrameStats() = default;
+	~FrameStats() = default;
+
+	void init(size_t capacity);
+	void add(double milliseconds);
+
+	size_t count() const { return m_samples.size(); }
+	double average() const;
+	double percentile(double p) const;
+	double max() const;
+
+	void print(const char* label) const;
+
+      private:
+	std::vector<double> m_samples;
+};
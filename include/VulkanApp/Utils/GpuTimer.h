@@ -0,0 +1,37 @@
+#pragma once
+
+#include <VulkanApp/Core/VulkanContext.h>
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+// GPU duration of each frame in flight measured with two timestamps around its primary command buffer.
+// the queries of a slot are read back once the frame that wrote them is finished, never waited on
+class GpuTimer {
+
+      public:
+	GpuTimer() = default;
+	~GpuTimer() = default;
+
+	void init(VulkanContext* context, uint32_t frameCount);
+	void cleanup() noexcept;
+
+	// recorded at the start and at the end of the frame primary, outside any render pass
+	void begin(VkCommandBuffer commandBuffer, uint32_t frame);
+	void end(VkCommandBuffer commandBuffer, uint32_t frame);
+	// the queries of this slot are written by a submitted command buffer, they can be read once it is finished
+	void markSubmitted(uint32_t frame) { m_submitted[frame] = true; }
+
+	// false while the timestamps of the last frame of this slot are not available
+	bool getMilliseconds(uint32_t frame, double& milliseconds) const;
+
+	bool isSupported() const { return m_queryPool != VK_NULL_HANDLE; }
+
+      private:
+	VulkanContext* m_context = nullptr;
+	VkQueryPool m_queryPool = VK_NULL_HANDLE;
+	double m_timestampPeriod = 1.0; // nanosecondes par tick
+	std::vector<bool> m_submitted;
+};
@@ -3,11 +3,54 @@
 
 #include <glm/glm.hpp>
 
-struct UniformBufferObject {
-	glm::mat4 model;
+#include <cstddef>
+#include <cstdint>
+
+// binding 0, réécrit une fois par frame. viewProj est multipliée sur le cpu
+struct FrameUniforms {
+	glm::mat4 viewProj;
 	glm::mat4 view;
 	glm::mat4 proj;
+	// --hiz, lus par cull.comp
+	glm::vec4 frustumPlanes[6]; // espace du monde, normalisés
+	glm::vec4 cullProjection; // proj[0][0], proj[1][1], proj[2][2], proj[3][2]
+	glm::vec4 cullScreen; // largeur et hauteur en pixels, niveaux de la pyramide, near
 };
 // doit etre aligné, voir https://docs.vulkan.org/spec/latest/chapters/interfaces.html#interfaces-resources-layout
 
+// binding 2 : viewProj * model de chaque objet, réécrit par frame a la suite de FrameUniforms dans le même buffer.
+// le vertex shader ne fait qu'un produit matrice * vecteur par sommet. 256 est la plus grande valeur permise de
+// minStorageBufferOffsetAlignment
+constexpr size_t g_object_clip_offset{(sizeof(FrameUniforms) + 255) & ~size_t{255}};
+
+// push constants du vertex shader. les draws ne poussent que objectId, quand l'objet change : leur transformation est
+// dans le buffer de la frame et les command buffers en cache restent valides quand la caméra bouge. box : les boites
+// des occlusion queries, dans l'espace de l'objet
+struct DrawConstants {
+	glm::mat4 box;
+	uint32_t objectId;
+};
+
+// un draw a tester par cull.comp, std430 : 32 octets
+struct CullDraw {
+	glm::vec4 sphere; // centre dans l'espace de l'objet, rayon
+	uint32_t indexCount;
+	uint32_t firstIndex;
+	int32_t vertexOffset;
+	uint32_t objectId;
+};
+
+// push constants de cull.comp
+struct CullConstants {
+	uint32_t drawCount;
+	uint32_t phase; // 0 : contre la pyramide de la frame précédente, 1 : les draws cachés, contre la nouvelle
+};
+
+// push constants de depth_reduce.comp, un niveau de la pyramide par dispatch
+struct DepthReduceConstants {
+	glm::ivec2 srcSize;
+	glm::ivec2 dstSize;
+	int32_t samples; // depth_reduce_ms.comp, le max des samples du depth buffer
+};
+
 #endif // UNIFORMS_H
\ No newline at end of file
@@ -5,18 +5,46 @@
 #include <VulkanApp/Core/VulkanContext.h>
 #include <VulkanApp/Core/SwapChain.h>
 
+#include <VulkanApp/Commands/ComputeContext.h>
+#include <VulkanApp/Commands/ParallelRecorder.h>
+#include <VulkanApp/Commands/UploadContext.h>
+
+#include <VulkanApp/Jobs/JobSystem.h>
+
 #include <VulkanApp/Rendering/Pipeline.h>
+#include <VulkanApp/Rendering/PipelineCache.h>
+#include <VulkanApp/Rendering/PipelineRegistry.h>
 #include <VulkanApp/Rendering/RenderPass.h>
+#include <VulkanApp/Rendering/DescriptorAllocator.h>
 #include <VulkanApp/Rendering/Descriptors.h>
+#include <VulkanApp/Rendering/HiZCulling.h>
+#include <VulkanApp/Rendering/OcclusionQueries.h>
+#include <VulkanApp/Rendering/QualityPresets.h>
+#include <VulkanApp/Rendering/RenderGraph.h>
 
 #include <VulkanApp/Resources/Mesh.h>
+#include <VulkanApp/Resources/MemoryAllocator.h>
+#include <VulkanApp/Resources/Defragmenter.h>
+#include <VulkanApp/Resources/DeletionQueue.h>
+
+#include <VulkanApp/Sync/FramePacer.h>
+#include <VulkanApp/Sync/FrameTimeline.h>
+#include <VulkanApp/Sync/FramesInFlightTuner.h>
+
+#include <VulkanApp/Utils/FrameArena.h>
+#include <VulkanApp/Utils/FrameStats.h>
+#include <VulkanApp/Utils/GpuTimer.h>
 
 #include "Camera.h"
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cstdlib>
 #include <iostream>
+#include <limits>
 #include <optional>
 #include <set>
 #include <stdexcept>
@@ -25,15 +53,88 @@
 constexpr uint32_t g_screen_width{800};
 constexpr uint32_t g_screen_height{600};
 
-constexpr uint32_t g_max_frames_in_flight{2};
+// le nombre de frames in flight se change a l'éxécution (touches 1-4, 0 = auto), dans ces limites
+constexpr uint32_t g_max_frames_in_flight{4};
+constexpr uint32_t g_default_frames_in_flight{2};
 
 const std::string g_model_path = "Models/viking_room.obj";
 const std::string g_texture_path = "Textures/viking_room.png";
 
+// au dessus de ce seuil de fragmentation (memoire device local) on lance une defragmentation
+constexpr float g_defrag_threshold{0.5f};
+constexpr VkDeviceSize g_defrag_min_wasted_bytes{4ull * 1024 * 1024};
+
+// apres ce nombre de frames les arenas ont atteint leur taille, drawFrame ne doit plus toucher au heap
+constexpr uint64_t g_allocation_check_warmup_frames{16};
+
+// une rafale d'évènements de resize (bord de fenêtre tiré) ne recrée la swapchain qu'une fois la taille stable depuis ce temps,
+// entre temps on continue de présenter sur l'ancienne tant qu'elle n'est que VK_SUBOPTIMAL_KHR
+constexpr double g_resize_debounce_seconds{0.1};
+
+// --resize-bench : le script alterne une phase de drag (la taille change toutes les g_resize_bench_step_frames)
+// et une phase immobile, g_resize_bench_phase_frames chacune
+constexpr uint32_t g_resize_bench_phase_frames{120};
+constexpr uint32_t g_resize_bench_step_frames{2};
+constexpr int g_resize_bench_step_pixels{16};
+
+// le mesh est découpé en draws de cette taille pour avoir une liste a répartir entre les threads
+constexpr uint32_t g_draw_chunk_triangles{512};
+
+// plan near de la projection, la culling en a besoin pour savoir quand la caméra touche un objet
+constexpr float g_near_plane{0.1f};
+
+// --occlusion : un draw dont le rayon atteint cette fraction du plus grand de la liste est un occluder, dessiné sans
+// query dans la passe d'occlusion. les autres ne sont dessinés que si leur boite y reste visible
+constexpr float g_occluder_radius_ratio{0.5f};
+// m_drawQuery d'un draw sans occlusion query
+constexpr uint32_t g_no_query{std::numeric_limits<uint32_t>::max()};
+
 /* const std::string g_vertex_shader = "Shaders/vert.spv";
 const std::string g_fragment_shader = "Shaders/frag.spv"; */
 
 
+// options de la ligne de commande, voir main.cpp
+struct AppOptions {
+	bool concurrentSharing = false; // --concurrent : mesh et texture en CONCURRENT, sans transfert de propriété
+	uint32_t benchFrames = 0;	// --bench N : rend N frames, affiche les temps puis quitte
+	uint32_t threads = 0;		// --threads N : threads du job system, main compris, 0 = un par coeur
+	uint32_t stressCopies = 1;	// --stress N : la liste de draws est répétée N fois
+	bool cacheCommands = true;	// --no-cache : réenregistre toute la frame a chaque fois
+	uint32_t framesInFlight = g_default_frames_in_flight; // --frames N
+	bool autoFramesInFlight = false; // --frames auto : choisi a partir des temps cpu et gpu
+	bool dumpRenderGraph = false;	// --graph-dump : affiche les passes, barriers et placements du render graph compilé
+	bool lowLatency = false;	// --low-latency : les entrées sont lues juste avant l'enregistrement, une fois la frame précédente affichée
+	double targetFps = 0.0;		// --fps-limit N : limiteur cpu, 0 = pas de limite
+	bool dynamicRendering = false;	// --dynamic-rendering : vkCmdBeginRendering, ni VkRenderPass ni VkFramebuffer
+	bool resizeBench = false;	// --resize-bench N : redimensionne la fenêtre par script pendant N frames, mesure les pics
+	bool depthPrepass = false;	// --depth-prepass : profondeur d'abord, puis la passe principale en EQUAL (touche P)
+	bool prepassBench = false;	// --prepass-bench N : N frames, la prepass est activée a la moitié
+	bool hizCulling = false;	// --hiz : culling d'occlusion en deux phases sur le gpu, draws indirects (touche H)
+	bool occlusionQueries = false;	// --occlusion : boites des objets derrière les gros occluders dans des queries (touche O)
+	QualityPreset quality = QualityPreset::High; // --quality low|medium|high|ultra : msaa, sample shading, anisotropie, échelle (touches F1 a F4)
+};
+
+// une partie de l'index buffer du mesh
+struct DrawItem {
+	uint32_t indexCount;
+	uint32_t firstIndex;
+	int32_t vertexOffset;
+	glm::vec3 center; // sphère englobante dans l'espace du modèle, pour la culling
+	float radius;
+	uint32_t objectId; // index dans m_objectTransforms, poussé en push constant
+	glm::vec3 extent{0.0f}; // demi-taille de la boite englobante, centrée sur center : le proxy des occlusion queries
+	bool occluder{false}; // --occlusion : assez gros pour cacher les autres, jamais testé
+};
+
+// les deux variantes d'un matériau avec la prepass, 0 = pas encore demandées (0 est toujours le fallback)
+struct PrepassVariants {
+	PipelineId depth{0}; // position seule, sans fragment shader
+	PipelineId main{0};  // le matériau en EQUAL, sans écriture de profondeur
+	bool indirect{false}; // INDIRECT_DRAWS, la matrice de l'objet vient de gl_InstanceIndex pour le Hi-Z culling
+	PipelineId proxy{0}; // --occlusion : les boites, profondeur testée sans écriture ni culling, 0 = pas demandée
+};
+
+
 #ifdef NDEBUG
 constexpr bool enableValidationLayers = false;
 #else
@@ -43,30 +144,72 @@ constexpr bool enableValidationLayers = true;
 
 class VulkanApp {
       public:
-	void run() {
+	void run(const AppOptions& options = AppOptions{}) {
+		m_options = options;
 		initWindow();
-		initVulkan();
-		mainLoop();
+		try {
+			initVulkan();
+			mainLoop();
+		} catch (...) {
+			// les workers doivent être joints avant que les std::thread soient détruits
+			m_jobs.cleanup();
+			throw;
+		}
 		cleanup();
 	}
 
 	void setResized(bool b) {
 		m_framebufferResized = b;
 	}
+	// a resize event, the swapchain is recreated once they stop for g_resize_debounce_seconds
+	void onFramebufferResize();
 
       private:
 
 
 		GLFWwindow* m_window;
 
+		AppOptions m_options;
+
 		VulkanContext m_context;
 		SwapChain m_swapchain;
+		PipelineCache m_pipelineCache;
 		Pipeline m_pipeline;
-		RenderPass m_renderPass;
+		// variantes de m_pipeline compilées en arrière plan, m_pipeline sert de fallback
+		PipelineRegistry m_pipelines;
+		PipelineId m_materialVariant{0};
+		PipelineId m_twoSidedVariant{0}; // touche V, demandée au premier appui
+		uint32_t m_pipelineGeneration{0};
+		// prepass de profondeur : celles du matériau courant, et celles du graph actif, prêtes
+		PrepassVariants m_prepassRequested;
+		PrepassVariants m_prepassVariants;
+		bool m_depthPrepass{false}; // le graph a été construit avec la prepass
+		// culling d'occlusion sur le gpu, toujours avec la prepass : les passes de profondeur construisent la pyramide
+		HiZCulling m_hiz;
+		bool m_hizSupported{false};
+		bool m_hizCulling{false}; // le graph a été construit avec les passes du Hi-Z
+		// occlusion queries sur des boites, avec la prepass ou devant la passe principale
+		OcclusionQueries m_occlusion;
+		bool m_occlusionSupported{false};
+		bool m_occlusionQueries{false}; // le graph a été construit avec la passe d'occlusion
+		RenderPass m_renderPass; // VK_NULL_HANDLE avec --dynamic-rendering
+		VkFormat m_depthFormat{VK_FORMAT_UNDEFINED};
+		// ce avec quoi le render pass, les pipelines, le sampler et le graph ont été construits
+		QualitySettings m_quality{};
+		VkExtent2D m_renderExtent{}; // la swapchain a l'échelle du preset : cibles, viewport et render area
+		// pools en chaîne, sets par frame et sets mis en cache, possède les layouts
+		DescriptorAllocator m_descriptorAllocator;
 		Descriptors m_descriptors;
 
+		MemoryAllocator m_allocator;
+		DeletionQueue m_deletionQueue;
+		Defragmenter m_defragmenter;
+
 		Camera m_camera{};
 
+		// chargement, culling et enregistrement, le thread principal est le thread 0
+		JobSystem m_jobs;
+
 	void initWindow();
 
 	void initVulkan();
@@ -77,8 +220,8 @@ class VulkanApp {
 	//void createGraphicsPipeline();
 	//void createFrameBuffers();
 	void createCommandPools();
-	void createColorRessources();
-	void createDepthResources();
+	void buildRenderGraph();
+	void decodeTexture();
 	void createTextureImage();
 	void createTextureImageView();
 	void createTextureImageSampler();
@@ -89,29 +232,80 @@ class VulkanApp {
 
 	void loadMesh();
 	void createMeshBuffer();
+	void buildDrawList();
+	// --stress copies of the mesh, known before it is loaded: the frame buffers hold a clip matrix per object
+	uint32_t getObjectCount() const { return std::max(1u, m_options.stressCopies); }
+	// m_objectTransforms for cull.comp, uploaded once
+	void createObjectBuffer();
+	void updateFrustumPlanes();
+	void cullDrawList();
+	void cullDraws(uint32_t first, uint32_t count);
 
 	void createGraphicsCommandBuffers();
 	void createTransferCommandBuffer();
 	void createSyncObjects();
+	void createFrameArenas();
 
-	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkSharingMode sharingMode, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
-	void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
-	void createImage(uint32_t width, uint32_t height, VkFormat format, uint32_t mipLevels, VkSampleCountFlagBits numSamples, VkSharingMode sharingMode, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory);
-	void copyBufferToImage(VkCommandPool commandPool, VkQueue queue, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
-
-	void createCommandBuffers();
-	void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+	// tout ce qui existe une fois par frame in flight
+	void createFrameResources();
+	void destroyFrameResources() noexcept;
+	void setFramesInFlight(uint32_t count);
 
-	VkCommandBuffer beginSingleTimeCommands(VkCommandPool commandPool);
-	void endSingleTimeCommands(VkCommandBuffer commandBuffer, VkCommandPool commandPool, VkQueue queue);
-	void transitionImageLayout(VkCommandPool commandPool, VkQueue queue, VkImage image, VkFormat format, uint32_t mipLevels, VkImageLayout oldLayout, VkImageLayout newLayout);
+	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkSharingMode sharingMode, VkMemoryPropertyFlags properties, VkBuffer& buffer, Allocation& bufferAllocation, bool defragmentable = false);
+	void createImage(uint32_t width, uint32_t height, VkFormat format, uint32_t mipLevels, VkSampleCountFlagBits numSamples, VkSharingMode sharingMode, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, Allocation& imageAllocation, bool defragmentable = false);
 
-	uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags propreties);
+	void createCommandBuffers();
+	void allocateCachedCommandBuffers();
+	VkCommandBuffer recordFrame(uint32_t imageIndex);
+	void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex, bool recordSecondaries);
+	void recordMainPass(VkCommandBuffer commandBuffer);
+	// --dynamic-rendering, vkCmdBeginRendering with the views of the graph and of the swapchain
+	void recordMainPassDynamic(VkCommandBuffer commandBuffer);
+	void recordSecondaries(VkFramebuffer framebuffer);
+	void recordDraws(VkCommandBuffer commandBuffer, uint32_t first, uint32_t count);
+	// the whole visible list with the pipeline of the prepass, inline in the primary
+	void recordDepthPrepass(VkCommandBuffer commandBuffer);
+	// depth only render pass or dynamic rendering, clear = false keeps what the previous depth pass wrote
+	void beginDepthPass(VkCommandBuffer commandBuffer, bool clear);
+	void endDepthPass(VkCommandBuffer commandBuffer);
+	// --hiz, phase 0 of cull.comp on the compute context, before the frame
+	void recordEarlyCull();
+	// --hiz, the draws cull.comp kept in one phase with the depth pipeline
+	void recordHiZDepth(VkCommandBuffer commandBuffer, uint32_t phase);
+	// --occlusion, the occluders (or the whole list with the prepass) then the boxes of the others in their queries
+	void recordOcclusionPass(VkCommandBuffer commandBuffer);
+	// draws [first, first + count) of a list of m_drawList indices. conditional : the draws with a query only run if
+	// their box was visible
+	void recordDrawRange(VkCommandBuffer commandBuffer, VkPipeline pipeline, const uint32_t* draws, uint32_t first, uint32_t count,
+			     bool conditional);
+	// pipeline, mesh buffers, viewport, scissor and set of the frame
+	void bindDrawState(VkCommandBuffer commandBuffer, VkPipeline pipeline);
+	// the indirect commands of phases [firstPhase, firstPhase + phaseCount), the model matrices come from the object buffer
+	void recordIndirectDraws(VkCommandBuffer commandBuffer, VkPipeline pipeline, uint32_t firstPhase, uint32_t phaseCount);
+	// prepass variants of the current material, compiled on the job system
+	void requestPrepassVariants();
+	// between two frames: switches the prepass, the Hi-Z or the occlusion queries once their variants are ready, or off
+	void updateDepthPrepass();
+	// between two frames: rebuilds what the settings of the preset change and nothing else
+	void applyQualityPreset(QualityPreset preset);
+	// the base pipeline for the current samples and sample shading, then the variants in use asked for again
+	void rebuildPipelines();
+	// render scale below 1 : the resolved image blitted onto the swapchain image
+	void recordUpscale(VkCommandBuffer commandBuffer);
+	// a appeler quand la liste de draws, la pipeline ou les framebuffers changent
+	void invalidateCommandBuffers();
+
+	void submitUploads();
+	VkSharingMode getUploadSharingMode() const;
 
 	void recreateSwapChain();
 
 	void updateUniformBuffer(uint32_t currentFrame);
 	void drawFrame();
+	void waitForFrames();
+
+	void recordDefragmentation(VkCommandBuffer commandBuffer);
+	void printMemoryStats();
 
 	void recordGraphicsCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
 
@@ -139,7 +333,6 @@ class VulkanApp {
 
 	VkImageView createImageView(VkImage image, VkFormat format, uint32_t mipLevels, VkImageAspectFlags aspectFlags);
 
-	void generateMipmaps(VkCommandPool commandPool, VkQueue queue, VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels);
 
 
 
@@ -150,27 +343,82 @@ class VulkanApp {
 	VkPipeline m_graphicsPipeline; */
 
 	VkCommandPool m_commandPool;
-	VkCommandPool m_commandPoolTransfer;
 
+	// secondaires de la render pass, enregistrés en parallele avec un pool par thread et par frame
+	ParallelRecorder m_recorder;
+	ParallelRecorder::RecordFunction m_recordDraws; // créée une fois, drawFrame n'alloue pas
+	std::vector<DrawItem> m_drawList;
+
+	// culling sur le job system, une part de la liste par job, puis compactée sur le thread principal
+	JobSystem::RangeFunction m_cullDraws;
+	glm::mat4 m_viewProjection{1.0f};
+	glm::vec4 m_frustumPlanes[6]; // espace du monde
+	// transformation de chaque objet, enregistrée dans les command buffers : en changer une les invalide
+	std::vector<glm::mat4> m_objectTransforms;
+	// les mêmes sur le gpu, binding 2 : lues par les draws indirects et par cull.comp
+	VkBuffer m_objectBuffer{VK_NULL_HANDLE};
+	Allocation m_objectBufferAllocation{};
+	std::vector<uint8_t> m_drawVisible; // [draw], pas de vector<bool> les jobs écrivent en parallele
+	std::vector<uint32_t> m_visibleDraws; // index dans m_drawList, ce qu'enregistrent les secondaires
+	glm::vec3 m_cameraPosition{0.0f}; // dans l'espace des plans du frustum
+
+	// --occlusion : les draws visibles testés par une query (la query est leur position), ceux qui n'en ont pas
+	// (les occluders, ou la caméra est dans leur boite) et la query de chaque draw
+	// reconstruites par cullDrawList dans l'arena de la frame, elles ne servent qu'a l'enregistrer
+	ArenaVector<uint32_t> m_occlusionDraws;
+	ArenaVector<uint32_t> m_occluderDraws;
+	std::vector<uint32_t> m_drawQuery; // [draw], g_no_query sans query
+	// sans conditional rendering : caché d'après la dernière query relue, laissé hors de m_visibleDraws
+	std::vector<uint8_t> m_drawOccluded; // [draw]
+
+	// compute de la frame sur la queue compute async si elle existe, soumis juste avant le rendu
+	ComputeContext m_compute;
+
+	// copies sur la transfer queue, mipmaps (blit) sur la graphics queue, un seul submit chacun
+	UploadContext m_transferUploads;
+	UploadContext m_graphicsUploads;
+	// le rendu attend ces valeurs sur le gpu tant qu'elles ne sont pas atteintes
+	UploadTicket m_transferTicket;
+	UploadTicket m_graphicsTicket;
+
+	// mesh et texture sont lus et décodés par des jobs pendant la création des objets vulkan
+	JobCounter m_loading;
 	Mesh m_mesh;
+	unsigned char* m_texturePixels = nullptr;
+	int m_textureWidth = 0;
+	int m_textureHeight = 0;
+
 	VkBuffer m_meshBuffer; // combine vertices et indices, c'est ce qui est recommandé
-	VkDeviceMemory m_meshBufferMemory;
+	Allocation m_meshBufferAllocation;
 	VkDeviceSize m_indicesOffset;
 
-	VkImage m_depthImage;
-	VkDeviceMemory m_depthImageMemory;
-	VkImageView m_depthImageView;
+	// passes de la frame et leurs cibles, recompilé quand la swapchain change de taille
+	RenderGraph m_renderGraph;
+	RenderGraphResource m_colorTarget{g_invalid_resource}; // msaa, g_invalid_resource en 1x
+	RenderGraphResource m_depthTarget{g_invalid_resource};
+	RenderGraphResource m_swapchainTarget{g_invalid_resource};
+	// échelle de rendu sous 1 : le resolve (ou la couleur sans msaa), agrandi sur la swapchain par la passe "upscale"
+	RenderGraphResource m_scaledTarget{g_invalid_resource};
+	// --hiz : commandes indirectes et pyramide importées de m_hiz, visibilité de la phase 0 transitoire
+	RenderGraphResource m_indirectTarget{g_invalid_resource};
+	RenderGraphResource m_pyramidTarget{g_invalid_resource};
+	RenderGraphResource m_visibilityTarget{g_invalid_resource};
+	// --occlusion avec conditional rendering : les prédicats, copiés des queries avant la passe principale
+	RenderGraphResource m_predicateTarget{g_invalid_resource};
+	// ce que recordMainPass enregistre, fixé par recordCommandBuffer avant d'éxécuter le graph
+	uint32_t m_recordingImage{0};
+	bool m_recordingSecondaries{false};
 
 	uint32_t m_mipLevels{1};
 	VkImage m_textureImage;
-	VkDeviceMemory m_textureImageMemory;
+	Allocation m_textureImageAllocation;
 	VkImageView m_textureImageView;
 
 	VkSampler m_textureSampler;
 
 	// faut un inform buffer par frames in flight
 	std::vector<VkBuffer> m_uniformBuffers;
-	std::vector<VkDeviceMemory> m_uniformBuffersMemory;
+	std::vector<Allocation> m_uniformBuffersAllocation;
 	std::vector<void*> m_uniformBuffersMapped;
 
 
@@ -179,20 +427,56 @@ class VulkanApp {
 
 	std::vector<VkCommandBuffer> m_commandBuffers;
 
+	// un primary par (image de la swapchain, frame in flight), [image * m_framesInFlight + frame],
+	// resoumis tel quel tant que rien de ce qu'il référence n'a changé, seul l'ubo bouge
+	std::vector<VkCommandBuffer> m_cachedCommandBuffers;
+	std::vector<bool> m_cachedCommandBuffersValid;
+	// les secondaires du slot sont a réenregistrer, ce qui invalide tous les primaries du slot
+	std::vector<bool> m_commandsDirty;
+
 	std::vector<VkSemaphore> m_imageAvailableSemaphores;
 	std::vector<VkSemaphore> m_renderFinishedSemaphores;
 
-	std::vector<VkFence> m_inFlightFences;
+	// compte les frames finies par le gpu, remplace une fence par frame in flight
+	FrameTimeline m_frameTimeline;
+
+	uint32_t m_framesInFlight{g_default_frames_in_flight};
+	uint32_t m_requestedFramesInFlight{0}; // appliqué entre deux frames par mainLoop, 0 = rien a changer
+	std::optional<QualityPreset> m_requestedQuality; // de même
+	bool m_autoFramesInFlight{false};
+	FramesInFlightTuner m_framesTuner;
+	GpuTimer m_gpuTimer;
 
 	int m_currentFrame{0};
+	uint64_t m_frameNumber{0}; // nombre de frames soumises, sert a savoir quand les ressources deplacées sont libres
+
+	// un set par frame in flight, réécrit seulement quand la frame qui l'utilise est terminée
+	std::vector<bool> m_descriptorsDirty;
+
+	// données cpu temporaires d'une frame (barriers, listes...), libérées quand sa fence est atteinte
+	std::vector<FrameArena> m_frameArenas;
+	bool m_heapAllocationReported{false};
+	// allocations du heap pendant drawFrame en régime permanent, sans defragmentation ni compilation en cours,
+	// affichées par --bench
+	uint64_t m_steadyAllocations{0};
+	uint64_t m_steadyFrames{0};
+	std::atomic<uint64_t> m_jobAllocations{0}; // des jobs d'enregistrement et de culling, tous threads confondus
 
 	bool m_framebufferResized{false};
 	// VK_ERROR_OUT_OF_DATE_KHR, est pas garantie pendant le resize en fonction de la plateforme
 	// donc ajout du bool pour le gerer correctement
-
-	VkImage m_colorImage;
-	VkDeviceMemory m_colorImageMemory;
-	VkImageView m_colorImageView;
+	double m_lastResizeEvent{0.0};
+	uint32_t m_resizeEvents{0};
+	uint32_t m_swapchainRecreations{0};
+	// true when no resize event came for g_resize_debounce_seconds
+	bool isResizeSettled() const;
+	// --resize-bench, a job: asks the main thread for the window size of this frame of the script
+	void scriptResize(uint64_t frame);
+
+	// la boucle de rendu tourne et drawFrame n'est pas déjà dans la pile, le callback de refresh peut dessiner
+	bool m_loopRunning{false};
+	bool m_inDrawFrame{false};
+	static void windowRefreshCallback(GLFWwindow* window);
 
 	VkSampleCountFlagBits m_msaaSamples;
 	VkSampleCountFlagBits getMaxMsaa();
@@ -202,9 +486,41 @@ class VulkanApp {
 	// frame timing for smooth movement
 	float m_deltaTime{0.0f};
 	double m_lastFrame{0.0};
+	double m_lastInput{0.0};
+
+	// --fps-limit, --low-latency, latence entrée -> présentation
+	FramePacer m_pacer;
+
+	// --bench
+	FrameStats m_frameStats;
+	FrameStats m_recordStats;
+	FrameStats m_gpuStats;
+	// temps gpu par mode, une frame compte pour le mode avec lequel son slot a été soumis
+	FrameStats m_gpuDirectStats;
+	FrameStats m_gpuPrepassStats;
+	FrameStats m_gpuHiZStats;
+	FrameStats m_gpuOcclusionStats;
+	std::array<bool, g_max_frames_in_flight> m_slotPrepass{};
+	std::array<bool, g_max_frames_in_flight> m_slotHiZ{};
+	std::array<bool, g_max_frames_in_flight> m_slotOcclusion{};
+	// draws gardés par chaque phase, relus une fois la frame finie
+	uint64_t m_hizEarlyDraws{0};
+	uint64_t m_hizLateDraws{0};
+	uint64_t m_hizCountedFrames{0};
+	// boites testées et cachées, relues avec les résultats des queries
+	uint64_t m_occlusionTested{0};
+	uint64_t m_occlusionSkipped{0};
+	uint64_t m_occlusionCountedFrames{0};
+	// the results of the newest finished frame: hidden draws without conditional rendering, statistics
+	void readOcclusionResults();
+	double m_uploadMilliseconds{0.0};
+	double m_pipelineMilliseconds{0.0}; // création des pipelines, a froid ou avec le cache du disque
+	void printBenchmark();
 
 	// input processing (polling each frame)
 	void processInput(float dt);
+	// moves the camera by the time since the last sample with the state of the keys, the latency of the frame starts here
+	void sampleInput();
 
 	static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
 	void onKey(int key, int scancode, int action, int mods);
@@ -0,0 +1,163 @@
+#include <VulkanApp/Commands/ComputeContext.h>
+
+#include <stdexcept>
+
+namespace {
+// attentes d'une soumission, réservées pour que submit() n'alloue pas
+constexpr size_t g_reserved_waits{4};
+} // namespace
+
+void ComputeContext::init(VulkanContext* context, uint32_t framesInFlight) {
+	m_context = context;
+	m_queueFamily = m_context->getQueues().getFamily(QueueRole::Compute);
+
+	VkSemaphoreTypeCreateInfo typeInfo{};
+	typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	typeInfo.initialValue = 0;
+
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreInfo.pNext = &typeInfo;
+
+	if (vkCreateSemaphore(m_context->getDevice(), &semaphoreInfo, nullptr, &m_semaphore) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create compute timeline semaphore!");
+	}
+
+	m_waitSemaphores.reserve(g_reserved_waits);
+	m_waitValues.reserve(g_reserved_waits);
+	m_waitStages.reserve(g_reserved_waits);
+
+	createPools(framesInFlight);
+}
+
+void ComputeContext::cleanup() noexcept {
+	if (m_nextValue > 1) {
+		uint64_t lastValue = m_nextValue - 1;
+		VkSemaphoreWaitInfo waitInfo{};
+		waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+		waitInfo.semaphoreCount = 1;
+		waitInfo.pSemaphores = &m_semaphore;
+		waitInfo.pValues = &lastValue;
+		vkWaitSemaphores(m_context->getDevice(), &waitInfo, UINT64_MAX);
+	}
+
+	destroyPools();
+	vkDestroySemaphore(m_context->getDevice(), m_semaphore, nullptr);
+	m_semaphore = VK_NULL_HANDLE;
+	m_waitSemaphores.clear();
+	m_waitValues.clear();
+	m_waitStages.clear();
+}
+
+void ComputeContext::setFramesInFlight(uint32_t framesInFlight) {
+	destroyPools();
+	createPools(framesInFlight);
+}
+
+void ComputeContext::createPools(uint32_t framesInFlight) {
+	// TRANSIENT : réenregistré a chaque frame, le pool est reset d'un coup
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolInfo.queueFamilyIndex = m_queueFamily;
+
+	m_pools.resize(framesInFlight);
+	m_commandBuffers.resize(framesInFlight);
+	for (uint32_t i = 0; i < framesInFlight; ++i) {
+		if (vkCreateCommandPool(m_context->getDevice(), &poolInfo, nullptr, &m_pools[i]) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create compute command pool!");
+		}
+
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = m_pools[i];
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandBufferCount = 1;
+
+		if (vkAllocateCommandBuffers(m_context->getDevice(), &allocInfo, &m_commandBuffers[i]) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate compute command buffer!");
+		}
+	}
+
+	m_recording.assign(framesInFlight, 0);
+}
+
+void ComputeContext::destroyPools() noexcept {
+	for (auto pool : m_pools) {
+		vkDestroyCommandPool(m_context->getDevice(), pool, nullptr);
+	}
+	m_pools.clear();
+	m_commandBuffers.clear();
+	m_recording.clear();
+}
+
+VkCommandBuffer ComputeContext::getCommandBuffer(uint32_t frame) {
+	if (m_recording[frame])
+		return m_commandBuffers[frame];
+
+	vkResetCommandPool(m_context->getDevice(), m_pools[frame], 0);
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	if (vkBeginCommandBuffer(m_commandBuffers[frame], &beginInfo) != VK_SUCCESS) {
+		throw std::runtime_error("failed to begin recording compute command buffer!");
+	}
+	m_recording[frame] = 1;
+	return m_commandBuffers[frame];
+}
+
+void ComputeContext::waitFor(VkSemaphore semaphore, uint64_t value, VkPipelineStageFlags stage) {
+	m_waitSemaphores.push_back(semaphore);
+	m_waitValues.push_back(value);
+	m_waitStages.push_back(stage);
+}
+
+/// @brief The waits registered with waitFor() are consumed even when nothing was recorded
+uint64_t ComputeContext::submit(uint32_t frame) {
+	if (!m_recording[frame]) {
+		m_waitSemaphores.clear();
+		m_waitValues.clear();
+		m_waitStages.clear();
+		return 0;
+	}
+
+	VkCommandBuffer commandBuffer = m_commandBuffers[frame];
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to record compute command buffer!");
+	}
+	m_recording[frame] = 0;
+
+	uint64_t signalValue = m_nextValue;
+
+	VkTimelineSemaphoreSubmitInfo timelineInfo{};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(m_waitValues.size());
+	timelineInfo.pWaitSemaphoreValues = m_waitValues.data();
+	timelineInfo.signalSemaphoreValueCount = 1;
+	timelineInfo.pSignalSemaphoreValues = &signalValue;
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext = &timelineInfo;
+	submitInfo.waitSemaphoreCount = static_cast<uint32_t>(m_waitSemaphores.size());
+	submitInfo.pWaitSemaphores = m_waitSemaphores.data();
+	submitInfo.pWaitDstStageMask = m_waitStages.data();
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = &m_semaphore;
+
+	if (m_context->getQueues().submit(QueueRole::Compute, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+		throw std::runtime_error("failed to submit compute command buffer!");
+	}
+
+	m_waitSemaphores.clear();
+	m_waitValues.clear();
+	m_waitStages.clear();
+	m_nextValue++;
+
+	return signalValue;
+}
@@ -0,0 +1,118 @@
+#include <VulkanApp/Commands/ParallelRecorder.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+void ParallelRecorder::init(VulkanContext* context, JobSystem* jobs, uint32_t queueFamily, uint32_t framesInFlight) {
+	m_context = context;
+	m_jobs = jobs;
+	m_queueFamily = queueFamily;
+	m_partCapacity = m_jobs->getThreadCount();
+
+	createPools(framesInFlight);
+}
+
+/// @brief Destroys the pools, the secondaries must no longer be in use
+void ParallelRecorder::cleanup() noexcept {
+	destroyPools();
+}
+
+void ParallelRecorder::setFramesInFlight(uint32_t framesInFlight) {
+	destroyPools();
+	createPools(framesInFlight);
+}
+
+void ParallelRecorder::createPools(uint32_t framesInFlight) {
+	// TRANSIENT : les secondaires sont réenregistrés a chaque frame, le pool est reset d'un coup
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolInfo.queueFamilyIndex = m_queueFamily;
+
+	m_pools.resize(framesInFlight * m_partCapacity);
+	m_commandBuffers.resize(m_pools.size());
+	for (size_t i = 0; i < m_pools.size(); ++i) {
+		if (vkCreateCommandPool(m_context->getDevice(), &poolInfo, nullptr, &m_pools[i]) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create recording command pool!");
+		}
+
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = m_pools[i];
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+		allocInfo.commandBufferCount = 1;
+
+		if (vkAllocateCommandBuffers(m_context->getDevice(), &allocInfo, &m_commandBuffers[i]) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate secondary command buffer!");
+		}
+	}
+
+	m_recordedCounts.assign(framesInFlight, 0);
+}
+
+void ParallelRecorder::destroyPools() noexcept {
+	// détruire le pool libère ses command buffers
+	for (auto pool : m_pools) {
+		vkDestroyCommandPool(m_context->getDevice(), pool, nullptr);
+	}
+	m_pools.clear();
+	m_commandBuffers.clear();
+	m_recordedCounts.clear();
+}
+
+/// @brief Splits the list in contiguous parts, records them as jobs and blocks until every part is done.
+/// the calling thread records the first part and helps with the others, the first exception is rethrown here
+void ParallelRecorder::record(uint32_t frame, const VkCommandBufferInheritanceInfo& inheritance, uint32_t itemCount, const RecordFunction& recordItems) {
+	uint32_t partCount = std::clamp(itemCount / g_min_draws_per_thread, 1u, m_partCapacity);
+	m_recordedCounts[frame] = 0;
+
+	// les jobs ne capturent que this et leur part, ça tient dans le std::function sans allouer
+	m_pass = Pass{frame, partCount, itemCount, &inheritance, &recordItems};
+
+	JobCounter counter;
+	for (uint32_t part = 1; part < partCount; ++part) {
+		m_jobs->submit([this, part] { recordPart(part); }, &counter);
+	}
+
+	std::exception_ptr error;
+	try {
+		recordPart(0);
+	} catch (...) {
+		error = std::current_exception();
+	}
+	// record() ne rend la main qu'une fois tous les jobs finis, m_pass et ce qu'il pointe restent valides
+	m_jobs->wait(counter);
+	if (error) {
+		std::rethrow_exception(error);
+	}
+
+	m_recordedCounts[frame] = partCount;
+}
+
+void ParallelRecorder::recordPart(uint32_t part) {
+	const Pass& pass = m_pass;
+	size_t index = pass.frame * m_partCapacity + part;
+	VkCommandBuffer commandBuffer = m_commandBuffers[index];
+
+	uint32_t first = static_cast<uint32_t>(static_cast<uint64_t>(pass.itemCount) * part / pass.partCount);
+	uint32_t last = static_cast<uint32_t>(static_cast<uint64_t>(pass.itemCount) * (part + 1) / pass.partCount);
+
+	vkResetCommandPool(m_context->getDevice(), m_pools[index], 0);
+
+	// RENDER_PASS_CONTINUE : le buffer est entierement dans la render pass décrite par l'inheritance
+	// pas de ONE_TIME_SUBMIT, un primary mis en cache peut les réexécuter
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+	beginInfo.pInheritanceInfo = pass.inheritance;
+
+	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+		throw std::runtime_error("failed to begin recording secondary command buffer!");
+	}
+
+	(*pass.recordItems)(commandBuffer, first, last - first);
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to record secondary command buffer!");
+	}
+}
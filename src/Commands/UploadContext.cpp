@@ -0,0 +1,461 @@
+#include <VulkanApp/Commands/UploadContext.h>
+
+#include <VulkanApp/Sync/ResourceAccess.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+void UploadContext::init(VulkanContext* context, MemoryAllocator* allocator, QueueRole role) {
+	m_context = context;
+	m_allocator = allocator;
+	m_role = role;
+	m_queueFamily = m_context->getQueues().getFamily(role);
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolInfo.queueFamilyIndex = m_queueFamily;
+
+	if (vkCreateCommandPool(m_context->getDevice(), &poolInfo, nullptr, &m_commandPool) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create upload command pool!");
+	}
+
+	VkSemaphoreTypeCreateInfo typeInfo{};
+	typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	typeInfo.initialValue = 0;
+
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreInfo.pNext = &typeInfo;
+
+	if (vkCreateSemaphore(m_context->getDevice(), &semaphoreInfo, nullptr, &m_semaphore) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create upload timeline semaphore!");
+	}
+}
+
+/// @brief Waits for the last batch then frees everything, a batch still being recorded is dropped
+void UploadContext::cleanup() noexcept {
+	wait({m_nextValue - 1});
+	collect();
+
+	// le pool libère aussi le command buffer en cours d'enregistrement
+	vkDestroyCommandPool(m_context->getDevice(), m_commandPool, nullptr);
+	vkDestroySemaphore(m_context->getDevice(), m_semaphore, nullptr);
+	m_commandBuffer = VK_NULL_HANDLE;
+	m_waitSemaphores.clear();
+	m_waitValues.clear();
+	m_waitStages.clear();
+	m_before.clear();
+	m_after.clear();
+	m_copies.clear();
+	m_mipChains.clear();
+}
+
+/// @brief Records the deferred work first, what the caller records comes after it
+VkCommandBuffer UploadContext::getCommandBuffer() {
+	recordDeferred();
+	return beginCommandBuffer();
+}
+
+VkCommandBuffer UploadContext::beginCommandBuffer() {
+	if (m_commandBuffer != VK_NULL_HANDLE)
+		return m_commandBuffer;
+
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandPool = m_commandPool;
+	allocInfo.commandBufferCount = 1;
+
+	if (vkAllocateCommandBuffers(m_context->getDevice(), &allocInfo, &m_commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate upload command buffer!");
+	}
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkBeginCommandBuffer(m_commandBuffer, &beginInfo);
+	return m_commandBuffer;
+}
+
+void UploadContext::waitFor(VkSemaphore semaphore, uint64_t value, VkPipelineStageFlags stage) {
+	m_waitSemaphores.push_back(semaphore);
+	m_waitValues.push_back(value);
+	m_waitStages.push_back(stage);
+}
+
+void UploadContext::releaseAfterUpload(VkBuffer buffer, const Allocation& allocation) {
+	Pending pending{};
+	pending.value = m_nextValue;
+	pending.buffer = buffer;
+	pending.allocation = allocation;
+	m_pending.push_back(pending);
+}
+
+bool UploadContext::isDeferred(VkImage image) const {
+	return std::any_of(m_copies.begin(), m_copies.end(), [image](const Copy& copy) { return copy.dstImage == image; }) ||
+	       std::any_of(m_mipChains.begin(), m_mipChains.end(), [image](const MipChain& chain) { return chain.image == image; });
+}
+
+bool UploadContext::isDeferred(VkBuffer buffer) const {
+	return std::any_of(m_copies.begin(), m_copies.end(), [buffer](const Copy& copy) { return copy.dstBuffer == buffer; });
+}
+
+/// @brief Barriers of resources untouched by the deferred work are recorded before it, the others after it.
+/// a resource keeps at most one barrier after, a second one records everything deferred so far first
+BarrierBatcher& UploadContext::getBatcher(VkImage image) {
+	if (m_after.touches(image)) {
+		recordDeferred();
+	}
+	return isDeferred(image) ? m_after : m_before;
+}
+
+BarrierBatcher& UploadContext::getBatcher(VkBuffer buffer) {
+	if (m_after.touches(buffer)) {
+		recordDeferred();
+	}
+	return isDeferred(buffer) ? m_after : m_before;
+}
+
+void UploadContext::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
+	// une barrière attend déjà après les copies sur ce buffer, la nouvelle copie vient après elle
+	if (m_after.touches(dstBuffer)) {
+		recordDeferred();
+	}
+
+	Copy copy{};
+	copy.srcBuffer = srcBuffer;
+	copy.dstBuffer = dstBuffer;
+	copy.size = size;
+	m_copies.push_back(copy);
+}
+
+void UploadContext::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height) {
+	if (m_after.touches(image)) {
+		recordDeferred();
+	}
+
+	Copy copy{};
+	copy.srcBuffer = buffer;
+	copy.dstImage = image;
+	copy.width = width;
+	copy.height = height;
+	m_copies.push_back(copy);
+}
+
+void UploadContext::transitionImageLayout(VkImage image, uint32_t mipLevels, VkImageLayout oldLayout, VkImageLayout newLayout) {
+	VkImageSubresourceRange range{};
+	range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	range.baseMipLevel = 0;
+	range.levelCount = mipLevels;
+	range.baseArrayLayer = 0;
+	range.layerCount = 1;
+
+	// stages et accès déduits des layouts, une paire inconnue donne une barrier plus large au lieu d'une exception
+	AccessInfo src = getLayoutAccess(oldLayout);
+	AccessInfo dst = getLayoutAccess(newLayout);
+
+	// seules les écritures sont a rendre visibles, UNDEFINED donne un stage source NONE
+	getBatcher(image).image(image, range, oldLayout, newLayout,
+				src.stages, src.write ? src.accesses : 0, dst.stages, dst.accesses);
+}
+
+/// @brief Blits each mip level from the previous one, needs a queue with graphics support.
+/// the chain is recorded with every other chain of the batch, one barrier call per mip level for all of them
+void UploadContext::generateMipmaps(VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels) {
+	// on regarde si le format support le linear blitting
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(m_context->getPhysicalDevice(), imageFormat, &formatProperties);
+	if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)) {
+		throw std::runtime_error("texture image format does not support linear blitting!");
+	}
+
+	if (m_after.touches(image) || std::any_of(m_mipChains.begin(), m_mipChains.end(), [image](const MipChain& chain) { return chain.image == image; })) {
+		recordDeferred();
+	}
+
+	MipChain chain{};
+	chain.image = image;
+	chain.width = texWidth;
+	chain.height = texHeight;
+	chain.levels = mipLevels;
+	m_mipChains.push_back(chain);
+
+	// passage en shader read une fois la chaine finie : les niveaux blittés sont en SRC, le dernier encore en DST.
+	// ajoutées dès maintenant pour qu'une barrière suivante sur l'image les trouve dans m_after
+	VkImageSubresourceRange range{};
+	range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	range.baseArrayLayer = 0;
+	range.layerCount = 1;
+
+	if (mipLevels > 1) {
+		range.baseMipLevel = 0;
+		range.levelCount = mipLevels - 1;
+		m_after.image(image, range, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			      VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT,
+			      VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT);
+	}
+
+	// on transitionne en mode shader read le dernier mipLevel
+	range.baseMipLevel = mipLevels - 1;
+	range.levelCount = 1;
+	m_after.image(image, range, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		      VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+		      VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT);
+}
+
+void UploadContext::releaseBuffer(VkBuffer buffer, uint32_t dstFamily) {
+	if (dstFamily == m_queueFamily)
+		return;
+
+	// dst ignoré pour un release, l'acquire donne les accès de la queue destination
+	getBatcher(buffer).buffer(buffer, 0, VK_WHOLE_SIZE,
+				  VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_2_NONE, 0,
+				  m_queueFamily, dstFamily);
+}
+
+/// @brief Must match the release recorded on srcFamily, same buffer and range
+void UploadContext::acquireBuffer(VkBuffer buffer, uint32_t srcFamily, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess) {
+	bool transfer = srcFamily != m_queueFamily;
+
+	// même famille : simple barrière, les écritures du transfert doivent être rendues visibles
+	getBatcher(buffer).buffer(buffer, 0, VK_WHOLE_SIZE,
+				  transfer ? VK_PIPELINE_STAGE_2_NONE : VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+				  transfer ? 0 : VK_ACCESS_2_TRANSFER_WRITE_BIT, dstStage, dstAccess,
+				  transfer ? srcFamily : VK_QUEUE_FAMILY_IGNORED, transfer ? m_queueFamily : VK_QUEUE_FAMILY_IGNORED);
+}
+
+void UploadContext::releaseImage(VkImage image, uint32_t mipLevels, VkImageLayout layout, uint32_t dstFamily) {
+	if (dstFamily == m_queueFamily)
+		return;
+
+	VkImageSubresourceRange range{};
+	range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	range.baseMipLevel = 0;
+	range.levelCount = mipLevels;
+	range.baseArrayLayer = 0;
+	range.layerCount = 1;
+
+	// le layout ne change pas pendant le transfert de propriété
+	getBatcher(image).image(image, range, layout, layout,
+				VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_2_NONE, 0,
+				m_queueFamily, dstFamily);
+}
+
+/// @brief Must match the release recorded on srcFamily, same subresources and layout
+void UploadContext::acquireImage(VkImage image, uint32_t mipLevels, VkImageLayout layout, uint32_t srcFamily,
+				 VkPipelineStageFlags dstStage, VkAccessFlags dstAccess) {
+	bool transfer = srcFamily != m_queueFamily;
+
+	VkImageSubresourceRange range{};
+	range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	range.baseMipLevel = 0;
+	range.levelCount = mipLevels;
+	range.baseArrayLayer = 0;
+	range.layerCount = 1;
+
+	getBatcher(image).image(image, range, layout, layout,
+				transfer ? VK_PIPELINE_STAGE_2_NONE : VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+				transfer ? 0 : VK_ACCESS_2_TRANSFER_WRITE_BIT, dstStage, dstAccess,
+				transfer ? srcFamily : VK_QUEUE_FAMILY_IGNORED, transfer ? m_queueFamily : VK_QUEUE_FAMILY_IGNORED);
+}
+
+/// @brief Records the barriers before, the copies, the mip chains and the barriers after, in that order
+void UploadContext::recordDeferred() {
+	if (m_before.empty() && m_copies.empty() && m_mipChains.empty() && m_after.empty())
+		return;
+
+	VkCommandBuffer commandBuffer = beginCommandBuffer();
+	m_before.flush(commandBuffer);
+
+	for (const auto& copy : m_copies) {
+		if (copy.dstImage == VK_NULL_HANDLE) {
+			VkBufferCopy copyRegion{};
+			copyRegion.srcOffset = 0; // Optional
+			copyRegion.dstOffset = 0; // Optional
+			copyRegion.size = copy.size;
+			vkCmdCopyBuffer(commandBuffer, copy.srcBuffer, copy.dstBuffer, 1, &copyRegion);
+			continue;
+		}
+
+		VkBufferImageCopy region{};
+		region.bufferOffset = 0;
+		region.bufferRowLength = 0;
+		region.bufferImageHeight = 0;
+
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = 0;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = 1;
+
+		region.imageOffset = {0, 0, 0};
+		region.imageExtent = {
+		    copy.width,
+		    copy.height,
+		    1};
+
+		vkCmdCopyBufferToImage(commandBuffer, copy.srcBuffer, copy.dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+	}
+
+	recordMipChains(commandBuffer);
+	m_after.flush(commandBuffer);
+
+	m_copies.clear();
+	m_mipChains.clear();
+}
+
+/// @brief Level by level across every chain: one barrier call moves level i - 1 of all images to SRC, then
+/// their blits of level i are recorded back to back
+void UploadContext::recordMipChains(VkCommandBuffer commandBuffer) {
+	uint32_t maxLevels = 0;
+	for (const auto& chain : m_mipChains) {
+		maxLevels = std::max(maxLevels, chain.levels);
+	}
+
+	VkImageSubresourceRange range{};
+	range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	range.levelCount = 1;
+	range.baseArrayLayer = 0;
+	range.layerCount = 1;
+
+	for (uint32_t i = 1; i < maxLevels; i++) {
+		// permet d'attendre que le transfert avec copy ou la mipmap soit fini avant de continuer et de pouvoir écrire
+		range.baseMipLevel = i - 1;
+		for (const auto& chain : m_mipChains) {
+			if (i < chain.levels) {
+				m_mipBarriers.image(chain.image, range, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+						    VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+						    VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT);
+			}
+		}
+		m_mipBarriers.flush(commandBuffer);
+
+		for (const auto& chain : m_mipChains) {
+			if (i >= chain.levels)
+				continue;
+
+			// on va prendre la taille de la texture du miplevel precendent i-1
+			int32_t mipWidth = std::max(1, chain.width >> (i - 1));
+			int32_t mipHeight = std::max(1, chain.height >> (i - 1));
+
+			VkImageBlit blit{};
+			blit.srcOffsets[0] = {0, 0, 0};
+			blit.srcOffsets[1] = {mipWidth, mipHeight, 1};
+			blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			blit.srcSubresource.mipLevel = i - 1;
+			blit.srcSubresource.baseArrayLayer = 0;
+			blit.srcSubresource.layerCount = 1;
+
+			blit.dstOffsets[0] = {0, 0, 0};
+			blit.dstOffsets[1] = {
+			    mipWidth > 1 ? mipWidth / 2 : 1,
+			    mipHeight > 1 ? mipHeight / 2 : 1,
+			    1};
+			blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			blit.dstSubresource.mipLevel = i;
+			blit.dstSubresource.baseArrayLayer = 0;
+			blit.dstSubresource.layerCount = 1;
+			// on va "écrire" le miplevel i en fonction des données du miplevel precedent
+
+			vkCmdBlitImage(commandBuffer, // queue a besoin de la queue graphics
+				       chain.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				       chain.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				       1, &blit,
+				       VK_FILTER_LINEAR); // interpolation
+		}
+	}
+}
+
+/// @brief Ends the batch and submits it alone, the timeline semaphore is signaled to the returned value
+UploadTicket UploadContext::submit() {
+	recordDeferred();
+	if (m_commandBuffer == VK_NULL_HANDLE)
+		return {};
+
+	if (vkEndCommandBuffer(m_commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to record upload command buffer!");
+	}
+
+	uint64_t signalValue = m_nextValue;
+
+	VkTimelineSemaphoreSubmitInfo timelineInfo{};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(m_waitValues.size());
+	timelineInfo.pWaitSemaphoreValues = m_waitValues.data();
+	timelineInfo.signalSemaphoreValueCount = 1;
+	timelineInfo.pSignalSemaphoreValues = &signalValue;
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext = &timelineInfo;
+	submitInfo.waitSemaphoreCount = static_cast<uint32_t>(m_waitSemaphores.size());
+	submitInfo.pWaitSemaphores = m_waitSemaphores.data();
+	submitInfo.pWaitDstStageMask = m_waitStages.data();
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &m_commandBuffer;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = &m_semaphore;
+
+	if (m_context->getQueues().submit(m_role, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+		throw std::runtime_error("failed to submit upload command buffer!");
+	}
+
+	Pending pending{};
+	pending.value = signalValue;
+	pending.commandBuffer = m_commandBuffer;
+	m_pending.push_back(pending);
+
+	m_commandBuffer = VK_NULL_HANDLE;
+	m_waitSemaphores.clear();
+	m_waitValues.clear();
+	m_waitStages.clear();
+	m_nextValue++;
+
+	return {signalValue};
+}
+
+bool UploadContext::isComplete(UploadTicket ticket) const {
+	if (ticket.value == 0)
+		return true;
+
+	uint64_t value = 0;
+	vkGetSemaphoreCounterValue(m_context->getDevice(), m_semaphore, &value);
+	return value >= ticket.value;
+}
+
+/// @brief Blocks the CPU until the batch of ticket has executed
+void UploadContext::wait(UploadTicket ticket) const {
+	if (ticket.value == 0)
+		return;
+
+	VkSemaphoreWaitInfo waitInfo{};
+	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &m_semaphore;
+	waitInfo.pValues = &ticket.value;
+
+	vkWaitSemaphores(m_context->getDevice(), &waitInfo, UINT64_MAX);
+}
+
+void UploadContext::collect() noexcept {
+	if (m_pending.empty())
+		return;
+
+	uint64_t completed = 0;
+	vkGetSemaphoreCounterValue(m_context->getDevice(), m_semaphore, &completed);
+
+	for (auto it = m_pending.begin(); it != m_pending.end();) {
+		if (it->value > completed) {
+			++it;
+			continue;
+		}
+		if (it->commandBuffer != VK_NULL_HANDLE) {
+			vkFreeCommandBuffers(m_context->getDevice(), m_commandPool, 1, &it->commandBuffer);
+		}
+		vkDestroyBuffer(m_context->getDevice(), it->buffer, nullptr);
+		m_allocator->free(it->allocation);
+		it = m_pending.erase(it);
+	}
+}
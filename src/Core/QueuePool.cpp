@@ -0,0 +1,147 @@
+#include <VulkanApp/Core/QueuePool.h>
+
+#include <VulkanApp/Core/VulkanContext.h>
+
+#include <algorithm>
+#include <iostream>
+
+namespace {
+
+const char* getRoleName(QueueRole role) {
+	switch (role) {
+	case QueueRole::Render:
+		return "render";
+	case QueueRole::Present:
+		return "present";
+	case QueueRole::Transfer:
+		return "transfer";
+	case QueueRole::GraphicsUploads:
+		return "graphics uploads";
+	case QueueRole::Compute:
+		return "compute";
+	default:
+		return "?";
+	}
+}
+
+} // namespace
+
+/// @brief Roles are served in order of importance, one that finds its family exhausted shares the queue the
+/// role it is closest to already has
+void QueuePool::configure(VkPhysicalDevice physicalDevice, const QueueFamilyIndices& indices) {
+	uint32_t familyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> families(familyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+
+	std::vector<uint32_t> nextIndex(familyCount, 0);
+	auto assign = [&](QueueRole role, uint32_t family, float priority, QueueRole fallback) {
+		Slot& slot = m_slots[static_cast<size_t>(role)];
+		if (nextIndex[family] < families[family].queueCount) {
+			slot = {family, nextIndex[family]++, priority};
+			return;
+		}
+		// plus de queue libre dans la famille, on partage celle du fallback s'il est dans la même famille
+		const Slot& shared = m_slots[static_cast<size_t>(fallback)];
+		slot = {family, shared.family == family ? shared.index : 0, priority};
+	};
+
+	uint32_t graphics = indices.graphicsFamily.value();
+	uint32_t present = indices.presentFamily.value();
+
+	assign(QueueRole::Render, graphics, 1.0f, QueueRole::Render);
+	if (present == graphics) {
+		m_slots[static_cast<size_t>(QueueRole::Present)] = m_slots[static_cast<size_t>(QueueRole::Render)];
+	} else {
+		assign(QueueRole::Present, present, 1.0f, QueueRole::Present);
+	}
+	// une famille compute qui est celle de graphics peut quand même avoir une seconde queue, le compute recouvre alors le rendu
+	assign(QueueRole::Compute, indices.computeFamily.value(), 0.75f, QueueRole::Render);
+	assign(QueueRole::Transfer, indices.transferFamily.value(), 0.5f, QueueRole::Compute);
+	assign(QueueRole::GraphicsUploads, graphics, 0.5f, QueueRole::Compute);
+
+	// toutes les queues des familles utilisées sont demandées, celles sans role gardent la priorité la plus basse
+	m_createInfos.clear();
+	m_priorities.clear();
+	for (uint32_t family = 0; family < familyCount; ++family) {
+		bool used = std::any_of(m_slots.begin(), m_slots.end(), [family](const Slot& slot) { return slot.family == family; });
+		if (!used)
+			continue;
+
+		std::vector<float> priorities(families[family].queueCount, 0.0f);
+		for (const auto& slot : m_slots) {
+			if (slot.family == family) {
+				priorities[slot.index] = std::max(priorities[slot.index], slot.priority);
+			}
+		}
+		m_priorities.push_back(std::move(priorities));
+
+		VkDeviceQueueCreateInfo queueCreateInfo{};
+		queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+		queueCreateInfo.queueFamilyIndex = family;
+		queueCreateInfo.queueCount = families[family].queueCount;
+		m_createInfos.push_back(queueCreateInfo);
+	}
+	// les vecteurs de priorités ne bougent plus
+	for (size_t i = 0; i < m_createInfos.size(); ++i) {
+		m_createInfos[i].pQueuePriorities = m_priorities[i].data();
+	}
+
+	for (size_t role = 0; role < m_slots.size(); ++role) {
+		m_shared[role] = false;
+		m_mutexIndex[role] = static_cast<uint8_t>(role);
+		for (size_t other = 0; other < m_slots.size(); ++other) {
+			if (other != role && m_slots[other].family == m_slots[role].family && m_slots[other].index == m_slots[role].index) {
+				m_shared[role] = true;
+				m_mutexIndex[role] = std::min(m_mutexIndex[role], static_cast<uint8_t>(other));
+			}
+		}
+	}
+}
+
+void QueuePool::init(VkDevice device) {
+	for (size_t role = 0; role < m_slots.size(); ++role) {
+		vkGetDeviceQueue(device, m_slots[role].family, m_slots[role].index, &m_queues[role]);
+	}
+}
+
+void QueuePool::cleanup() noexcept {
+	m_queues.fill(VK_NULL_HANDLE);
+	m_createInfos.clear();
+	m_priorities.clear();
+}
+
+VkResult QueuePool::submit(QueueRole role, uint32_t submitCount, const VkSubmitInfo* submits, VkFence fence) {
+	size_t r = static_cast<size_t>(role);
+	if (!m_shared[r])
+		return vkQueueSubmit(m_queues[r], submitCount, submits, fence);
+
+	std::lock_guard<std::mutex> lock(m_mutexes[m_mutexIndex[r]]);
+	return vkQueueSubmit(m_queues[r], submitCount, submits, fence);
+}
+
+VkResult QueuePool::present(const VkPresentInfoKHR& presentInfo) {
+	size_t r = static_cast<size_t>(QueueRole::Present);
+	if (!m_shared[r])
+		return vkQueuePresentKHR(m_queues[r], &presentInfo);
+
+	std::lock_guard<std::mutex> lock(m_mutexes[m_mutexIndex[r]]);
+	return vkQueuePresentKHR(m_queues[r], &presentInfo);
+}
+
+VkResult QueuePool::waitIdle(QueueRole role) {
+	size_t r = static_cast<size_t>(role);
+	if (!m_shared[r])
+		return vkQueueWaitIdle(m_queues[r]);
+
+	std::lock_guard<std::mutex> lock(m_mutexes[m_mutexIndex[r]]);
+	return vkQueueWaitIdle(m_queues[r]);
+}
+
+void QueuePool::print() const {
+	for (size_t role = 0; role < m_slots.size(); ++role) {
+		const Slot& slot = m_slots[role];
+		std::cout << "Queue " << getRoleName(static_cast<QueueRole>(role)) << ": family " << slot.family << " index " << slot.index
+			  << " priority " << slot.priority << (m_shared[role] ? " (shared)" : "") << '\n';
+	}
+}
@@ -18,11 +18,29 @@ void SwapChain::init(VulkanContext* context, GLFWwindow* window) {
 	createImageViews();
 }
 
-/// @brief Recreates the swapchain and its image views and frame buffers, recreation of frame buffers not called here
+/// @brief Recreates the swapchain and its image views, recreation of frame buffers not called here
+/// the old swapchain is handed to the new one, it and its views / frame buffers are destroyed once the frames in flight are done
 /// @param window
-void SwapChain::recreate(GLFWwindow* window) {
-	cleanup();
-	create(window);
+/// @param deletionQueue
+void SwapChain::recreate(GLFWwindow* window, DeletionQueue& deletionQueue) {
+	for (auto framebuffer : m_frameBuffers) {
+		deletionQueue.push(framebuffer);
+	}
+	m_frameBuffers.clear();
+	if (m_depthFrameBuffer != VK_NULL_HANDLE) {
+		deletionQueue.push(m_depthFrameBuffer);
+		m_depthFrameBuffer = VK_NULL_HANDLE;
+	}
+
+	for (auto imageView : m_imageViews) {
+		deletionQueue.push(imageView);
+	}
+	m_imageViews.clear();
+
+	VkSwapchainKHR oldSwapChain = m_swapChain;
+	create(window, oldSwapChain);
+	deletionQueue.push(oldSwapChain);
+
 	createImageViews();
 }
 
@@ -44,6 +62,10 @@ void SwapChain::cleanupFramebuffers() {
         vkDestroyFramebuffer(m_context->getDevice(), framebuffer, nullptr);
     }
     m_frameBuffers.clear();
+    if (m_depthFrameBuffer != VK_NULL_HANDLE) {
+        vkDestroyFramebuffer(m_context->getDevice(), m_depthFrameBuffer, nullptr);
+        m_depthFrameBuffer = VK_NULL_HANDLE;
+    }
 }
 
 /// @brief Gives a color format for the swapchain images
@@ -96,7 +118,7 @@ VkExtent2D SwapChain::chooseSwapExtent(GLFWwindow* window, const VkSurfaceCapabi
 }
 
 
-void SwapChain::create(GLFWwindow* window) {
+void SwapChain::create(GLFWwindow* window, VkSwapchainKHR oldSwapChain) {
 
 	SwapChainSupportDetails swapChainSupport{m_context->getSwapChainSupport()};
 
@@ -122,6 +144,16 @@ void SwapChain::create(GLFWwindow* window) {
 	swapChainCreateInfo.imageExtent = extent;
 	swapChainCreateInfo.imageArrayLayers = 1;
 	swapChainCreateInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	// destination du blit quand le preset rend en plus petit, la cible agrandie a le même format
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(m_context->getPhysicalDevice(), surfaceFormat.format, &formatProperties);
+	constexpr VkFormatFeatureFlags blitFeatures =
+	    VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	m_canUpscale = (swapChainSupport.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT) != 0 &&
+		       (formatProperties.optimalTilingFeatures & blitFeatures) == blitFeatures;
+	if (m_canUpscale) {
+		swapChainCreateInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	}
 
 	QueueFamilyIndices indices = m_context->getQueueFamilies();
 	std::set<uint32_t> uniqueIndices{indices.graphicsFamily.value(), indices.presentFamily.value(), indices.transferFamily.value()};
@@ -142,7 +174,7 @@ void SwapChain::create(GLFWwindow* window) {
 	swapChainCreateInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
 	swapChainCreateInfo.presentMode = presentMode;
 	swapChainCreateInfo.clipped = VK_TRUE;
-	swapChainCreateInfo.oldSwapchain = VK_NULL_HANDLE;
+	swapChainCreateInfo.oldSwapchain = oldSwapChain; // retirée par la création, ses images déjà acquises restent valides
 
 	if (vkCreateSwapchainKHR(m_context->getDevice(), &swapChainCreateInfo, nullptr, &m_swapChain) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create swap chain");
@@ -160,24 +192,34 @@ void SwapChain::create(GLFWwindow* window) {
 /// @param renderPass 
 /// @param depthImageView 
 /// @param colorImageView 
-void SwapChain::createFrameBuffers(VkRenderPass renderPass, VkImageView depthImageView, VkImageView colorImageView) {
+void SwapChain::createFrameBuffers(VkRenderPass renderPass, VkExtent2D extent, VkImageView depthImageView, VkImageView colorImageView,
+				   VkImageView targetImageView) {
+	// apres recreate() ils sont déjà dans la deletion queue, il ne reste rien
+	cleanupFramebuffers();
 	m_frameBuffers.resize(m_imageViews.size());
 
 	for (size_t i{0}; i < m_frameBuffers.size(); ++i) {
+		VkImageView target = targetImageView != VK_NULL_HANDLE ? targetImageView : m_imageViews[i];
 
 		std::array<VkImageView, 3> attachments = {
 			colorImageView, // MSAA color 
 			depthImageView, // depth
-			m_imageViews[i], // swapchain image (resolve target)
+			target, // swapchain image (resolve target)
 		};
+		// sans msaa la cible est l'attachment couleur, pas de resolve
+		uint32_t attachmentCount = static_cast<uint32_t>(attachments.size());
+		if (colorImageView == VK_NULL_HANDLE) {
+			attachments[0] = target;
+			attachmentCount = 2;
+		}
 
 		VkFramebufferCreateInfo framebufferInfo{};
 		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
 		framebufferInfo.renderPass = renderPass;
-		framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+		framebufferInfo.attachmentCount = attachmentCount;
 		framebufferInfo.pAttachments = attachments.data();
-		framebufferInfo.width = m_extent.width;
-		framebufferInfo.height = m_extent.height;
+		framebufferInfo.width = extent.width;
+		framebufferInfo.height = extent.height;
 		framebufferInfo.layers = 1;
 
 		if (vkCreateFramebuffer(m_context->getDevice(), &framebufferInfo, nullptr, &m_frameBuffers[i]) != VK_SUCCESS) {
@@ -186,6 +228,21 @@ void SwapChain::createFrameBuffers(VkRenderPass renderPass, VkImageView depthIma
 	}
 }
 
+void SwapChain::createDepthFrameBuffer(VkRenderPass depthPrepass, VkExtent2D extent, VkImageView depthImageView) {
+	VkFramebufferCreateInfo framebufferInfo{};
+	framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+	framebufferInfo.renderPass = depthPrepass;
+	framebufferInfo.attachmentCount = 1;
+	framebufferInfo.pAttachments = &depthImageView;
+	framebufferInfo.width = extent.width;
+	framebufferInfo.height = extent.height;
+	framebufferInfo.layers = 1;
+
+	if (vkCreateFramebuffer(m_context->getDevice(), &framebufferInfo, nullptr, &m_depthFrameBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create framebuffer!");
+	}
+}
+
 /// @brief Creates an VkImageView for each swapchain image and stores them in m_imageViews. Each view is 2D, uses the swapchain image format, a single mip level/layer and the color aspect.
 void SwapChain::createImageViews() {
 	m_imageViews.resize(m_images.size());
@@ -4,6 +4,7 @@
 
 #include <GLFW/glfw3.h>
 
+#include <algorithm>
 #include <iostream>
 #include <stdexcept>
 #include <set>
@@ -11,7 +12,8 @@
 
 /// @brief Retrieve for the given physical device, each queue family ids
 /// @param device 
-/// @return A struct containing : graphicsFamily, presentFamily, transferFamily ids
+/// @return A struct containing : graphicsFamily, presentFamily, transferFamily, computeFamily ids.
+/// computeFamily falls back to the graphics family when the device has no separate compute family
 QueueFamilyIndices VulkanContext::findQueueFamilies(VkPhysicalDevice device) {
 	QueueFamilyIndices indices;
 	uint32_t queueFamilyCount = 0;
@@ -20,64 +22,55 @@ QueueFamilyIndices VulkanContext::findQueueFamilies(VkPhysicalDevice device) {
 	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
 	vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
 
-	int i = 0;
+	// toutes les familles sont parcourues, la compute async peut venir après les autres
+	for (uint32_t i = 0; i < queueFamilyCount; ++i) {
+		VkQueueFlags flags = queueFamilies[i].queueFlags;
+		bool graphics = flags & VK_QUEUE_GRAPHICS_BIT;
+		bool compute = flags & VK_QUEUE_COMPUTE_BIT;
 
-	for (const auto& queueFamily : queueFamilies) {
-		if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+		if (graphics && !indices.graphicsFamily.has_value()) {
 			indices.graphicsFamily = i;
 		}
-		if (queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT && !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
+		// une famille transfer sans compute (DMA) est préférée, la famille compute reste libre pour le compute async
+		if ((flags & VK_QUEUE_TRANSFER_BIT) && !graphics && (!indices.transferFamily.has_value() || !compute)) {
 			indices.transferFamily = i;
 		}
+		if (compute && !graphics && !indices.computeFamily.has_value()) {
+			indices.computeFamily = i;
+		}
 
 		VkBool32 presentSupport{false};
 		vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_surface, &presentSupport); 
 
-		if (presentSupport)
+		if (presentSupport && !indices.presentFamily.has_value())
 			indices.presentFamily = i;
+	}
 
-		if (indices.isComplete())
-			break;
-
-		++i;
+	// pas de famille compute séparée : le compute passe par la queue graphics, toujours correct mais sans recouvrement
+	if (!indices.computeFamily.has_value()) {
+		indices.computeFamily = indices.graphicsFamily;
 	}
 
 	return indices;
 }
 
 /// @brief Retrieve for the current physical device, each queue family ids
-/// @return A struct containing : graphicsFamily, presentFamily, transferFamily ids
+/// @return A struct containing : graphicsFamily, presentFamily, transferFamily, computeFamily ids
 QueueFamilyIndices VulkanContext::getQueueFamilies() {
-	QueueFamilyIndices indices;
-	uint32_t queueFamilyCount = 0;
-	vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevice, &queueFamilyCount, nullptr);
-
-	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
-	vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevice, &queueFamilyCount, queueFamilies.data());
+	return findQueueFamilies(m_physicalDevice);
+}
 
-	int i = 0;
+uint32_t VulkanContext::getSharingFamilies(uint32_t (&families)[3]) {
+	QueueFamilyIndices indices = getQueueFamilies();
+	uint32_t candidates[]{indices.graphicsFamily.value(), indices.transferFamily.value(), indices.computeFamily.value()};
 
-	for (const auto& queueFamily : queueFamilies) {
-		if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-			indices.graphicsFamily = i;
-		}
-		if (queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT && !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
-			indices.transferFamily = i;
+	uint32_t count = 0;
+	for (uint32_t family : candidates) {
+		if (std::find(families, families + count, family) == families + count) {
+			families[count++] = family;
 		}
-
-		VkBool32 presentSupport{false};
-		vkGetPhysicalDeviceSurfaceSupportKHR(m_physicalDevice, i, m_surface, &presentSupport); 
-
-		if (presentSupport)
-			indices.presentFamily = i;
-
-		if (indices.isComplete())
-			break;
-
-		++i;
 	}
-
-	return indices;
+	return count;
 }
 
 /// @brief check whether the validation layer is supported  
@@ -117,7 +110,7 @@ void VulkanContext::createInstance(bool enableValidationLayers) {
 	appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
 	appInfo.pEngineName = "no engine";
 	appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-	appInfo.apiVersion = VK_API_VERSION_1_0;
+	appInfo.apiVersion = VK_API_VERSION_1_3; // timeline semaphores, synchronization2
 
 	VkInstanceCreateInfo createInfo{};
 	createInfo.pApplicationInfo = &appInfo;
@@ -170,30 +163,30 @@ void VulkanContext::createSurface(GLFWwindow* window){
 	}
 }
 
-/// @brief Retrieve the max msaa samples possible for the current physical device
+/// @brief Retrieve the max msaa samples possible for the current physical device, no more than asked
+/// @param limit the count of the quality preset
 /// @return 
-VkSampleCountFlagBits VulkanContext::getMaxMsaa() {
+VkSampleCountFlagBits VulkanContext::getMaxMsaa(VkSampleCountFlagBits limit) const {
 	VkPhysicalDeviceProperties properties;
 	vkGetPhysicalDeviceProperties(m_physicalDevice, &properties);
 
 	VkSampleCountFlags counts = properties.limits.framebufferColorSampleCounts & properties.limits.framebufferDepthSampleCounts;
 
-	if (counts & VK_SAMPLE_COUNT_64_BIT)
-		return VK_SAMPLE_COUNT_64_BIT;
-	if (counts & VK_SAMPLE_COUNT_32_BIT)
-		return VK_SAMPLE_COUNT_32_BIT;
-	if (counts & VK_SAMPLE_COUNT_16_BIT)
-		return VK_SAMPLE_COUNT_16_BIT;
-	if (counts & VK_SAMPLE_COUNT_8_BIT)
-		return VK_SAMPLE_COUNT_8_BIT;
-	if (counts & VK_SAMPLE_COUNT_4_BIT)
-		return VK_SAMPLE_COUNT_4_BIT;
-	if (counts & VK_SAMPLE_COUNT_2_BIT)
-		return VK_SAMPLE_COUNT_2_BIT;
-
+	// les counts sont des bits, du plus grand demandé au plus petit. 1x est toujours supporté
+	for (uint32_t samples = limit; samples > VK_SAMPLE_COUNT_1_BIT; samples >>= 1) {
+		if (counts & samples)
+			return static_cast<VkSampleCountFlagBits>(samples);
+	}
 	return VK_SAMPLE_COUNT_1_BIT;
 }
 
+/// @brief samplerAnisotropy is required by isDeviceSuitable, only the level is limited
+float VulkanContext::getMaxAnisotropy() const {
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(m_physicalDevice, &properties);
+	return properties.limits.maxSamplerAnisotropy;
+}
+
 /// @brief Helper to retrieve the capabilities of the swapchain from the given physical device
 /// @param device 
 /// @return A struct containing, capabilities, formats, presentModes suppported by this device
@@ -277,12 +270,29 @@ bool VulkanContext::isDeviceSuitable(VkPhysicalDevice device) {
 	VkPhysicalDeviceFeatures supportedFeatures;
 	vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
 
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(device, &properties);
+	if (properties.apiVersion < VK_API_VERSION_1_3)
+		return false;
+
+	VkPhysicalDeviceVulkan13Features supported13Features{};
+	supported13Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+	VkPhysicalDeviceVulkan12Features supported12Features{};
+	supported12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	supported12Features.pNext = &supported13Features;
+	VkPhysicalDeviceFeatures2 supportedFeatures2{};
+	supportedFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	supportedFeatures2.pNext = &supported12Features;
+	vkGetPhysicalDeviceFeatures2(device, &supportedFeatures2);
+
 	bool swapChainAdequate{false};
 	if (extensionsSupported) {
 		SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
 		swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
 	}
-	return queueFamily.isComplete() && extensionsSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy;
+	return queueFamily.isComplete() && extensionsSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy &&
+	       supported12Features.timelineSemaphore && supported13Features.synchronization2 &&
+	       supported13Features.dynamicRendering;
 }
 
 /// @brief Iterate through the physical debices and picks a physical device that supports the required extensions/queues
@@ -299,7 +309,6 @@ void VulkanContext::pickPhysicalDevice() {
 	for (const auto& device : devices) {
 		if (isDeviceSuitable(device)) {
 			m_physicalDevice = device;
-			m_msaaSamples = getMaxMsaa();
 			break;
 		}
 	}
@@ -314,30 +323,70 @@ void VulkanContext::pickPhysicalDevice() {
 void VulkanContext::createLogicalDevice(bool enableValidationLayers) { 
 	QueueFamilyIndices indices = findQueueFamilies(m_physicalDevice);
 
-	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-	std::set<uint32_t> uniqueQueueFamilies{indices.graphicsFamily.value(), indices.presentFamily.value(), indices.transferFamily.value()};
-
-	float queuePriority = 1.0f;
-	for (uint32_t queueFamily : uniqueQueueFamilies) {
-		VkDeviceQueueCreateInfo queueCreateInfo{};
-		queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-		queueCreateInfo.queueFamilyIndex = queueFamily;
-		queueCreateInfo.queueCount = 1;
-		queueCreateInfo.pQueuePriorities = &queuePriority;
-		queueCreateInfos.push_back(queueCreateInfo);
-	}
+	// toutes les queues des familles utilisées, distribuées par role
+	m_queues.configure(m_physicalDevice, indices);
+	const std::vector<VkDeviceQueueCreateInfo>& queueCreateInfos = m_queues.getCreateInfos();
 
 	VkPhysicalDeviceFeatures deviceFeatures{};
 	deviceFeatures.samplerAnisotropy = VK_TRUE;
 	deviceFeatures.sampleRateShading = VK_TRUE;
 
+	// toutes les barrières passent par vkCmdPipelineBarrier2, stages et accès par barrière
+	VkPhysicalDeviceVulkan13Features vulkan13Features{};
+	vulkan13Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+	vulkan13Features.synchronization2 = VK_TRUE;
+	vulkan13Features.dynamicRendering = VK_TRUE; // --dynamic-rendering, vkCmdBeginRendering sans VkRenderPass ni VkFramebuffer
+
+	// uploads et rendu se synchronisent par des timeline semaphores
+	VkPhysicalDeviceVulkan12Features vulkan12Features{};
+	vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	vulkan12Features.pNext = &vulkan13Features;
+	vulkan12Features.timelineSemaphore = VK_TRUE;
+
+	// present_id + present_wait : optionnelles, le mode basse latence attend la présentation réelle avec
+	std::vector<const char*> extensions(deviceExtensions.begin(), deviceExtensions.end());
+	VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{};
+	presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+	presentWaitFeatures.presentWait = VK_TRUE;
+	VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{};
+	presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+	presentIdFeatures.pNext = &presentWaitFeatures;
+	presentIdFeatures.presentId = VK_TRUE;
+
+	// --hiz : les draws visibles sont compactés par un compute shader et comptés sur le gpu, optionnel
+	m_indirectCount = checkIndirectCountSupport(m_physicalDevice);
+	if (m_indirectCount) {
+		deviceFeatures.multiDrawIndirect = VK_TRUE;
+		deviceFeatures.drawIndirectFirstInstance = VK_TRUE; // firstInstance porte l'id de l'objet
+		vulkan12Features.drawIndirectCount = VK_TRUE;
+	}
+
+	bool presentWait = checkPresentWaitSupport(m_physicalDevice);
+	if (presentWait) {
+		extensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+		extensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+		vulkan13Features.pNext = &presentIdFeatures;
+	}
+
+	// --occlusion : les résultats des queries sautent les draws sur le gpu, sinon relus par le cpu
+	VkPhysicalDeviceConditionalRenderingFeaturesEXT conditionalRenderingFeatures{};
+	conditionalRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_CONDITIONAL_RENDERING_FEATURES_EXT;
+	conditionalRenderingFeatures.conditionalRendering = VK_TRUE;
+	bool conditionalRendering = checkConditionalRenderingSupport(m_physicalDevice);
+	if (conditionalRendering) {
+		extensions.push_back(VK_EXT_CONDITIONAL_RENDERING_EXTENSION_NAME);
+		conditionalRenderingFeatures.pNext = vulkan13Features.pNext;
+		vulkan13Features.pNext = &conditionalRenderingFeatures;
+	}
+
 	VkDeviceCreateInfo deviceCreateInfo{};
 	deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	deviceCreateInfo.pNext = &vulkan12Features;
 	deviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 	deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
 	deviceCreateInfo.pEnabledFeatures = &deviceFeatures;
-	deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-	deviceCreateInfo.ppEnabledExtensionNames = deviceExtensions.data();
+	deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+	deviceCreateInfo.ppEnabledExtensionNames = extensions.data();
 
 	// for compatibilty purposes
 	if (enableValidationLayers) {
@@ -353,9 +402,104 @@ void VulkanContext::createLogicalDevice(bool enableValidationLayers) {
 		std::cout << "Device created!" << std::endl;
 	}
 
-	vkGetDeviceQueue(m_device, indices.graphicsFamily.value(), 0, &m_graphicsQueue);
-	vkGetDeviceQueue(m_device, indices.presentFamily.value(), 0, &m_presentQueue);
-	vkGetDeviceQueue(m_device, indices.transferFamily.value(), 0, &m_transferQueue);
+	m_queues.init(m_device);
+	m_queues.print();
+
+	// fonction d'extension, pas exportée par le loader
+	if (presentWait) {
+		m_waitForPresent = (PFN_vkWaitForPresentKHR)vkGetDeviceProcAddr(m_device, "vkWaitForPresentKHR");
+	}
+	if (conditionalRendering) {
+		m_beginConditionalRendering = (PFN_vkCmdBeginConditionalRenderingEXT)vkGetDeviceProcAddr(m_device, "vkCmdBeginConditionalRenderingEXT");
+		m_endConditionalRendering = (PFN_vkCmdEndConditionalRenderingEXT)vkGetDeviceProcAddr(m_device, "vkCmdEndConditionalRenderingEXT");
+	}
+	std::cout << "Present wait: " << (m_waitForPresent ? "supported" : "not supported") << std::endl;
+	std::cout << "Indirect count: " << (m_indirectCount ? "supported" : "not supported") << std::endl;
+	std::cout << "Conditional rendering: " << (hasConditionalRendering() ? "supported" : "not supported") << std::endl;
+}
+
+/// @brief The extension and its conditionalRendering feature, the inherited variant is not needed: the secondaries
+/// begin and end their own conditional blocks
+bool VulkanContext::checkConditionalRenderingSupport(VkPhysicalDevice device) {
+	uint32_t extensionCount;
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+	bool found = false;
+	for (const auto& extension : availableExtensions) {
+		found |= std::strcmp(extension.extensionName, VK_EXT_CONDITIONAL_RENDERING_EXTENSION_NAME) == 0;
+	}
+	if (!found)
+		return false;
+
+	VkPhysicalDeviceConditionalRenderingFeaturesEXT conditionalRenderingFeatures{};
+	conditionalRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_CONDITIONAL_RENDERING_FEATURES_EXT;
+	VkPhysicalDeviceFeatures2 features2{};
+	features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features2.pNext = &conditionalRenderingFeatures;
+	vkGetPhysicalDeviceFeatures2(device, &features2);
+
+	return conditionalRenderingFeatures.conditionalRendering;
+}
+
+void VulkanContext::beginConditionalRendering(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset) const {
+	VkConditionalRenderingBeginInfoEXT beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_CONDITIONAL_RENDERING_BEGIN_INFO_EXT;
+	beginInfo.buffer = buffer;
+	beginInfo.offset = offset;
+	m_beginConditionalRendering(commandBuffer, &beginInfo);
+}
+
+void VulkanContext::endConditionalRendering(VkCommandBuffer commandBuffer) const {
+	m_endConditionalRendering(commandBuffer);
+}
+
+/// @brief vkCmdDrawIndexedIndirectCount is core in 1.2 but behind the drawIndirectCount feature, the commands also
+/// need several draws per call and a firstInstance other than 0
+bool VulkanContext::checkIndirectCountSupport(VkPhysicalDevice device) {
+	VkPhysicalDeviceVulkan12Features vulkan12Features{};
+	vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	VkPhysicalDeviceFeatures2 features2{};
+	features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features2.pNext = &vulkan12Features;
+	vkGetPhysicalDeviceFeatures2(device, &features2);
+
+	return features2.features.multiDrawIndirect && features2.features.drawIndirectFirstInstance && vulkan12Features.drawIndirectCount;
+}
+
+/// @brief Both extensions and both features are needed, present_wait waits for the ids given by present_id
+bool VulkanContext::checkPresentWaitSupport(VkPhysicalDevice device) {
+	uint32_t extensionCount;
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+	std::set<std::string> wantedExtensions{VK_KHR_PRESENT_ID_EXTENSION_NAME, VK_KHR_PRESENT_WAIT_EXTENSION_NAME};
+	for (const auto& extension : availableExtensions) {
+		wantedExtensions.erase(extension.extensionName);
+	}
+	if (!wantedExtensions.empty())
+		return false;
+
+	VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{};
+	presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+	VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{};
+	presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+	presentIdFeatures.pNext = &presentWaitFeatures;
+	VkPhysicalDeviceFeatures2 features2{};
+	features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features2.pNext = &presentIdFeatures;
+	vkGetPhysicalDeviceFeatures2(device, &features2);
+
+	return presentIdFeatures.presentId && presentWaitFeatures.presentWait;
+}
+
+/// @brief Blocks until the image presented with presentId is on screen, or timeout nanoseconds
+VkResult VulkanContext::waitForPresent(VkSwapchainKHR swapchain, uint64_t presentId, uint64_t timeout) const {
+	return m_waitForPresent(m_device, swapchain, presentId, timeout);
 }
 
 
@@ -393,9 +537,8 @@ void VulkanContext::cleanup() noexcept {
         m_instance = VK_NULL_HANDLE;
     }
 
-	m_graphicsQueue = VK_NULL_HANDLE;
-    m_presentQueue = VK_NULL_HANDLE;
-    m_transferQueue = VK_NULL_HANDLE;
+	m_queues.cleanup();
+	m_waitForPresent = nullptr;
     m_physicalDevice = VK_NULL_HANDLE;
     m_msaaSamples = VK_SAMPLE_COUNT_1_BIT;
 }
@@ -0,0 +1,122 @@
+#include <VulkanApp/Jobs/JobBenchmark.h>
+
+#include <VulkanApp/Jobs/JobSystem.h>
+#include <VulkanApp/Utils/FrameStats.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t g_bench_spheres{1u << 20};
+constexpr uint32_t g_bench_graph_jobs{1024};
+constexpr uint32_t g_bench_runs{15};
+
+struct Sphere {
+	float x, y, z, radius;
+};
+
+// même test que la culling du rendu : la sphère est dehors si elle est entièrement derrière un plan
+uint32_t cullRange(const std::vector<Sphere>& spheres, const float (&planes)[6][4], std::vector<uint8_t>& visible, uint32_t first, uint32_t count) {
+	uint32_t visibleCount = 0;
+	for (uint32_t i = first; i < first + count; ++i) {
+		const Sphere& sphere = spheres[i];
+		bool inside = true;
+		for (const auto& plane : planes) {
+			if (plane[0] * sphere.x + plane[1] * sphere.y + plane[2] * sphere.z + plane[3] < -sphere.radius) {
+				inside = false;
+				break;
+			}
+		}
+		visible[i] = inside;
+		visibleCount += inside;
+	}
+	return visibleCount;
+}
+
+// travail de calcul pur pour le graphe de jobs, aucune mémoire partagée
+uint32_t spin(uint32_t seed) {
+	uint32_t value = seed;
+	for (int i = 0; i < 20000; ++i) {
+		value ^= value << 13;
+		value ^= value >> 17;
+		value ^= value << 5;
+	}
+	return value;
+}
+
+double elapsedMilliseconds(std::chrono::high_resolution_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+} // namespace
+
+void runJobBenchmark(uint32_t maxThreads) {
+	if (maxThreads == 0) {
+		maxThreads = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	std::vector<Sphere> spheres(g_bench_spheres);
+	for (uint32_t i = 0; i < g_bench_spheres; ++i) {
+		float t = static_cast<float>(i);
+		spheres[i] = {std::sin(t) * 50.0f, std::cos(t * 0.7f) * 50.0f, std::sin(t * 0.3f) * 50.0f, 1.0f};
+	}
+	std::vector<uint8_t> visible(g_bench_spheres);
+	// un cube de 60 de côté centré sur l'origine
+	const float planes[6][4]{{1, 0, 0, 30}, {-1, 0, 0, 30}, {0, 1, 0, 30}, {0, -1, 0, 30}, {0, 0, 1, 30}, {0, 0, -1, 30}};
+
+	std::cout << "threads  parallelFor cull (ms)  job graph (ms)  speedup cull  speedup graph" << '\n';
+
+	double baseCull = 0.0;
+	double baseGraph = 0.0;
+	for (uint32_t threads = 1; threads <= maxThreads; ++threads) {
+		JobSystem jobs;
+		jobs.init(threads - 1);
+
+		FrameStats cullStats;
+		FrameStats graphStats;
+		cullStats.init(g_bench_runs);
+		graphStats.init(g_bench_runs);
+
+		for (uint32_t run = 0; run < g_bench_runs; ++run) {
+			std::atomic<uint32_t> visibleCount{0};
+			auto start = std::chrono::high_resolution_clock::now();
+			jobs.parallelFor(g_bench_spheres, 0, [&](uint32_t first, uint32_t count) {
+				visibleCount.fetch_add(cullRange(spheres, planes, visible, first, count), std::memory_order_relaxed);
+			});
+			cullStats.add(elapsedMilliseconds(start));
+
+			// fan-out puis une continuation qui réduit les résultats
+			std::vector<uint32_t> results(g_bench_graph_jobs);
+			uint32_t total = 0;
+			JobCounter produced;
+			JobCounter reduced;
+			start = std::chrono::high_resolution_clock::now();
+			for (uint32_t i = 0; i < g_bench_graph_jobs; ++i) {
+				jobs.submit([&results, i] { results[i] = spin(i + 1); }, &produced);
+			}
+			jobs.submitAfter(produced, [&results, &total] {
+				for (uint32_t value : results) {
+					total += value & 1;
+				}
+			}, &reduced);
+			jobs.wait(reduced);
+			graphStats.add(elapsedMilliseconds(start));
+		}
+
+		jobs.cleanup();
+
+		double cull = cullStats.percentile(0.5);
+		double graph = graphStats.percentile(0.5);
+		if (threads == 1) {
+			baseCull = cull;
+			baseGraph = graph;
+		}
+		std::cout << threads << "        " << cull << "                  " << graph << "            "
+			  << baseCull / cull << "          " << baseGraph / graph << '\n';
+	}
+}
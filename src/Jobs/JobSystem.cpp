@@ -0,0 +1,339 @@
+#include <VulkanApp/Jobs/JobSystem.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+// un seul JobSystem par thread, l'index sert a trouver sa deque
+thread_local uint32_t t_threadIndex = std::numeric_limits<uint32_t>::max();
+thread_local const JobSystem* t_system = nullptr;
+} // namespace
+
+uint32_t JobSystem::getThreadIndex() {
+	return t_threadIndex;
+}
+
+uint32_t JobSystem::getDefaultWorkerCount() {
+	return std::max(1u, std::thread::hardware_concurrency()) - 1;
+}
+
+void JobSystem::init(uint32_t workerCount) {
+	m_jobs.resize(g_max_jobs);
+	m_freeJobs.reserve(g_max_jobs);
+	for (auto& job : m_jobs) {
+		m_freeJobs.push_back(&job);
+	}
+	m_injected.reserve(g_max_jobs);
+	m_mainThreadJobs.reserve(g_max_jobs);
+
+	m_queues.clear();
+	for (uint32_t thread = 0; thread <= workerCount; ++thread) {
+		m_queues.push_back(std::make_unique<WorkStealingQueue<Job*, g_job_queue_capacity>>());
+	}
+
+	t_threadIndex = 0;
+	t_system = this;
+
+	m_stop = false;
+	m_workers.reserve(workerCount);
+	for (uint32_t thread = 1; thread <= workerCount; ++thread) {
+		m_workers.emplace_back(&JobSystem::workerLoop, this, thread);
+	}
+}
+
+/// @brief Joins the workers, jobs still queued are dropped
+void JobSystem::cleanup() noexcept {
+	m_stop = true;
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+	}
+	m_sleepCondition.notify_all();
+	for (auto& worker : m_workers) {
+		worker.join();
+	}
+	m_workers.clear();
+	m_queues.clear();
+
+	if (t_system == this) {
+		t_threadIndex = std::numeric_limits<uint32_t>::max();
+		t_system = nullptr;
+	}
+}
+
+/// @return nullptr when every job of the pool is in use
+Job* JobSystem::allocate(JobFunction&& function, JobCounter* counter, JobAffinity affinity) {
+	Job* job = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(m_freeMutex);
+		if (m_freeJobs.empty())
+			return nullptr;
+		job = m_freeJobs.back();
+		m_freeJobs.pop_back();
+	}
+	job->function = std::move(function);
+	job->counter = counter;
+	job->affinity = affinity;
+	job->next = nullptr;
+	return job;
+}
+
+void JobSystem::release(Job* job) noexcept {
+	job->function = nullptr; // libère les captures maintenant, pas a la prochaine réutilisation
+	std::lock_guard<std::mutex> lock(m_freeMutex);
+	m_freeJobs.push_back(job);
+}
+
+void JobSystem::submit(JobFunction function, JobCounter* counter, JobAffinity affinity) {
+	if (counter) {
+		std::lock_guard<std::mutex> lock(counter->m_mutex);
+		counter->m_pending.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	Job* job = allocate(std::move(function), counter, affinity);
+	if (!job) {
+		// pool épuisé : le job s'éxécute sur place, toujours correct mais sans parallélisme
+		Job inlineJob{std::move(function), counter, affinity, nullptr};
+		std::exception_ptr error;
+		try {
+			inlineJob.function();
+		} catch (...) {
+			error = std::current_exception();
+		}
+		finish(counter, error);
+		return;
+	}
+	push(job);
+}
+
+void JobSystem::submitAfter(JobCounter& dependency, JobFunction function, JobCounter* counter, JobAffinity affinity) {
+	if (counter) {
+		std::lock_guard<std::mutex> lock(counter->m_mutex);
+		counter->m_pending.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	Job* job = allocate(std::move(function), counter, affinity);
+	if (!job) {
+		wait(dependency);
+		std::exception_ptr error;
+		try {
+			function();
+		} catch (...) {
+			error = std::current_exception();
+		}
+		finish(counter, error);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(dependency.m_mutex);
+		if (dependency.m_pending.load(std::memory_order_relaxed) != 0) {
+			job->next = dependency.m_continuations;
+			dependency.m_continuations = job;
+			return;
+		}
+	}
+	push(job);
+}
+
+void JobSystem::push(Job* job) {
+	if (job->affinity == JobAffinity::MainThread) {
+		std::lock_guard<std::mutex> lock(m_mainThreadMutex);
+		m_mainThreadJobs.push_back(job);
+		m_mainThreadCount.fetch_add(1, std::memory_order_release);
+		return;
+	}
+
+	m_queued.fetch_add(1, std::memory_order_seq_cst);
+
+	uint32_t thread = t_system == this ? t_threadIndex : std::numeric_limits<uint32_t>::max();
+	if (thread < m_queues.size()) {
+		if (!m_queues[thread]->push(job)) {
+			// deque pleine, on l'éxécute tout de suite
+			m_queued.fetch_sub(1, std::memory_order_relaxed);
+			execute(job);
+			return;
+		}
+	} else {
+		std::lock_guard<std::mutex> lock(m_injectedMutex);
+		m_injected.push_back(job);
+		m_injectedCount.fetch_add(1, std::memory_order_release);
+	}
+	wakeWorkers();
+}
+
+/// @brief A worker only sleeps after re-checking m_queued with m_sleeping raised, see workerLoop
+void JobSystem::wakeWorkers() {
+	if (m_sleeping.load(std::memory_order_seq_cst) == 0)
+		return;
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+	}
+	m_sleepCondition.notify_one();
+}
+
+/// @brief Own deque first, then steals, then jobs of unknown threads. the MainThread jobs are left to
+/// runMainThreadJobs: a wait() of the main thread in the middle of a frame must not call GLFW
+Job* JobSystem::find(uint32_t thread) {
+	Job* job = nullptr;
+
+	uint32_t queueCount = static_cast<uint32_t>(m_queues.size());
+	if (thread < queueCount && m_queues[thread]->pop(job)) {
+		m_queued.fetch_sub(1, std::memory_order_relaxed);
+		return job;
+	}
+
+	// on commence par le voisin pour ne pas que tout le monde vole le même thread
+	uint32_t start = thread < queueCount ? thread + 1 : 0;
+	for (uint32_t i = 0; i < queueCount; ++i) {
+		uint32_t victim = (start + i) % queueCount;
+		if (victim != thread && m_queues[victim]->steal(job)) {
+			m_queued.fetch_sub(1, std::memory_order_relaxed);
+			return job;
+		}
+	}
+
+	if (m_injectedCount.load(std::memory_order_acquire) != 0) {
+		std::lock_guard<std::mutex> lock(m_injectedMutex);
+		if (!m_injected.empty()) {
+			job = m_injected.back();
+			m_injected.pop_back();
+			m_injectedCount.fetch_sub(1, std::memory_order_relaxed);
+			m_queued.fetch_sub(1, std::memory_order_relaxed);
+			return job;
+		}
+	}
+	return nullptr;
+}
+
+void JobSystem::execute(Job* job) {
+	std::exception_ptr error;
+	try {
+		job->function();
+	} catch (...) {
+		error = std::current_exception();
+	}
+
+	JobCounter* counter = job->counter;
+	release(job);
+	finish(counter, error);
+}
+
+/// @brief The waiter may destroy the counter as soon as it reads zero, so the decrement and the continuation
+/// list are handled under its mutex and wait() takes that mutex before returning
+void JobSystem::finish(JobCounter* counter, std::exception_ptr error) {
+	if (!counter)
+		return;
+
+	Job* continuations = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(counter->m_mutex);
+		if (error && !counter->m_error) {
+			counter->m_error = error;
+		}
+		if (counter->m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			continuations = counter->m_continuations;
+			counter->m_continuations = nullptr;
+		}
+	}
+
+	while (continuations) {
+		Job* next = continuations->next;
+		continuations->next = nullptr;
+		push(continuations);
+		continuations = next;
+	}
+}
+
+void JobSystem::wait(JobCounter& counter) {
+	uint32_t thread = t_system == this ? t_threadIndex : std::numeric_limits<uint32_t>::max();
+
+	while (!counter.isDone()) {
+		if (Job* job = find(thread)) {
+			execute(job);
+		} else {
+			std::this_thread::yield();
+		}
+	}
+
+	std::exception_ptr error;
+	{
+		// le dernier finish() a relâché le mutex, le compteur peut être détruit après
+		std::lock_guard<std::mutex> lock(counter.m_mutex);
+		error = counter.m_error;
+		counter.m_error = nullptr;
+	}
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
+
+void JobSystem::parallelFor(uint32_t count, uint32_t grain, const RangeFunction& function) {
+	if (count == 0)
+		return;
+	if (grain == 0) {
+		// quelques parts par thread pour que le vol équilibre les parts lentes
+		grain = std::max(1u, count / (getThreadCount() * 4));
+	}
+
+	JobCounter counter;
+	// la premiere part est gardée pour le thread appelant
+	for (uint32_t first = grain; first < count; first += grain) {
+		uint32_t rangeCount = std::min(grain, count - first);
+		submit([&function, first, rangeCount] { function(first, rangeCount); }, &counter);
+	}
+
+	std::exception_ptr error;
+	try {
+		function(0, std::min(grain, count));
+	} catch (...) {
+		error = std::current_exception();
+	}
+	wait(counter);
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
+
+void JobSystem::runMainThreadJobs() {
+	while (m_mainThreadCount.load(std::memory_order_acquire) != 0) {
+		Job* job = nullptr;
+		{
+			std::lock_guard<std::mutex> lock(m_mainThreadMutex);
+			if (m_mainThreadJobs.empty())
+				return;
+			// dans l'ordre de soumission, deux tailles de fenêtre demandées de suite finissent sur la dernière
+			job = m_mainThreadJobs.front();
+			m_mainThreadJobs.erase(m_mainThreadJobs.begin());
+			m_mainThreadCount.fetch_sub(1, std::memory_order_relaxed);
+		}
+		execute(job);
+	}
+}
+
+void JobSystem::workerLoop(uint32_t thread) {
+	t_threadIndex = thread;
+	t_system = this;
+
+	uint32_t idleSpins = 0;
+	while (!m_stop.load(std::memory_order_acquire)) {
+		if (Job* job = find(thread)) {
+			execute(job);
+			idleSpins = 0;
+			continue;
+		}
+
+		// quelques tours a vide avant de dormir, un job arrive souvent juste après
+		if (++idleSpins < 64) {
+			std::this_thread::yield();
+			continue;
+		}
+		idleSpins = 0;
+
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+		m_sleeping.fetch_add(1, std::memory_order_seq_cst);
+		m_sleepCondition.wait(lock, [this] {
+			return m_stop.load(std::memory_order_acquire) || m_queued.load(std::memory_order_seq_cst) != 0;
+		});
+		m_sleeping.fetch_sub(1, std::memory_order_seq_cst);
+	}
+}
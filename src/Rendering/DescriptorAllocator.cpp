@@ -0,0 +1,267 @@
+#include <VulkanApp/Rendering/DescriptorAllocator.h>
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+namespace {
+
+struct PoolRatio {
+	VkDescriptorType type;
+	uint32_t perSet;
+};
+
+// descripteurs de chaque type par set d'un pool, un set qui en demande plus épuise le pool plus tôt et passe au suivant
+constexpr std::array<PoolRatio, 5> g_pool_ratios{{
+    {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2},
+    {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4},
+    {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2},
+    {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1},
+    {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1},
+}};
+
+bool isImage(VkDescriptorType type) {
+	return type == VK_DESCRIPTOR_TYPE_SAMPLER || type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER || type == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE ||
+	       type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE || type == VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+}
+
+} // namespace
+
+void DescriptorAllocator::init(VulkanContext* context, uint32_t framesInFlight) {
+	m_context = context;
+	m_frames.resize(framesInFlight);
+}
+
+void DescriptorAllocator::cleanup() noexcept {
+	destroy(m_persistent);
+	for (auto& chain : m_frames) {
+		destroy(chain);
+	}
+	m_frames.clear();
+	m_cache.clear();
+
+	for (auto& layout : m_layouts) {
+		vkDestroyDescriptorUpdateTemplate(m_context->getDevice(), layout.updateTemplate, nullptr);
+		vkDestroyDescriptorSetLayout(m_context->getDevice(), layout.layout, nullptr);
+	}
+	m_layouts.clear();
+}
+
+void DescriptorAllocator::setFramesInFlight(uint32_t framesInFlight) {
+	for (auto& chain : m_frames) {
+		reset(chain);
+	}
+	// les chaînes en trop sont détruites, celles qui restent gardent leurs pools
+	for (size_t i = framesInFlight; i < m_frames.size(); ++i) {
+		destroy(m_frames[i]);
+	}
+	m_frames.resize(framesInFlight);
+}
+
+/// @brief One template entry per binding, the DescriptorInfo of the set are packed in binding order with the stride
+/// of the union so a buffer and an image binding read the same array
+VkDescriptorSetLayout DescriptorAllocator::createLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings) {
+	Layout& layout = m_layouts.emplace_back();
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutInfo.pBindings = bindings.data();
+
+	if (vkCreateDescriptorSetLayout(m_context->getDevice(), &layoutInfo, nullptr, &layout.layout) != VK_SUCCESS) {
+		m_layouts.pop_back();
+		throw std::runtime_error("failed to create descriptor set layout!");
+	}
+
+	std::vector<VkDescriptorUpdateTemplateEntry> entries(bindings.size());
+	for (size_t i = 0; i < bindings.size(); ++i) {
+		entries[i].dstBinding = bindings[i].binding;
+		entries[i].dstArrayElement = 0;
+		entries[i].descriptorCount = bindings[i].descriptorCount;
+		entries[i].descriptorType = bindings[i].descriptorType;
+		entries[i].offset = layout.types.size() * sizeof(DescriptorInfo);
+		entries[i].stride = sizeof(DescriptorInfo);
+		layout.types.insert(layout.types.end(), bindings[i].descriptorCount, bindings[i].descriptorType);
+	}
+
+	VkDescriptorUpdateTemplateCreateInfo templateInfo{};
+	templateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+	templateInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size());
+	templateInfo.pDescriptorUpdateEntries = entries.data();
+	templateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+	templateInfo.descriptorSetLayout = layout.layout;
+
+	if (vkCreateDescriptorUpdateTemplate(m_context->getDevice(), &templateInfo, nullptr, &layout.updateTemplate) != VK_SUCCESS) {
+		vkDestroyDescriptorSetLayout(m_context->getDevice(), layout.layout, nullptr);
+		m_layouts.pop_back();
+		throw std::runtime_error("failed to create descriptor update template!");
+	}
+	return layout.layout;
+}
+
+VkDescriptorSet DescriptorAllocator::getCached(VkDescriptorSetLayout setLayout, const DescriptorInfo* infos) {
+	Layout& layout = findLayout(setLayout);
+	uint64_t key = hash(layout, infos);
+
+	auto range = m_cache.equal_range(key);
+	for (auto it = range.first; it != range.second; ++it) {
+		if (it->second.layout == &layout && equal(layout, it->second.infos.data(), infos))
+			return it->second.set;
+	}
+
+	CachedSet cached;
+	cached.layout = &layout;
+	cached.infos.assign(infos, infos + layout.types.size());
+	if (!layout.freeSets.empty()) {
+		cached.set = layout.freeSets.back();
+		layout.freeSets.pop_back();
+	} else {
+		cached.set = allocate(m_persistent, layout);
+	}
+	vkUpdateDescriptorSetWithTemplate(m_context->getDevice(), cached.set, layout.updateTemplate, infos);
+
+	VkDescriptorSet set = cached.set;
+	m_cache.emplace(key, std::move(cached));
+	return set;
+}
+
+/// @brief Linear in the cache size, only called when a referenced resource is replaced
+void DescriptorAllocator::evict(VkDescriptorSet set) {
+	for (auto it = m_cache.begin(); it != m_cache.end(); ++it) {
+		if (it->second.set == set) {
+			it->second.layout->freeSets.push_back(set);
+			m_cache.erase(it);
+			return;
+		}
+	}
+}
+
+VkDescriptorSet DescriptorAllocator::allocateFrame(uint32_t frame, VkDescriptorSetLayout setLayout, const DescriptorInfo* infos) {
+	const Layout& layout = findLayout(setLayout);
+	VkDescriptorSet set = allocate(m_frames[frame], layout);
+	vkUpdateDescriptorSetWithTemplate(m_context->getDevice(), set, layout.updateTemplate, infos);
+	return set;
+}
+
+void DescriptorAllocator::resetFrame(uint32_t frame) {
+	reset(m_frames[frame]);
+}
+
+size_t DescriptorAllocator::getPoolCount() const {
+	size_t count = m_persistent.pools.size();
+	for (const auto& chain : m_frames) {
+		count += chain.pools.size();
+	}
+	return count;
+}
+
+DescriptorAllocator::Layout& DescriptorAllocator::findLayout(VkDescriptorSetLayout setLayout) {
+	for (auto& layout : m_layouts) {
+		if (layout.layout == setLayout)
+			return layout;
+	}
+	throw std::runtime_error("descriptor set layout not created by the allocator!");
+}
+
+VkDescriptorPool DescriptorAllocator::createPool(uint32_t maxSets) {
+	std::array<VkDescriptorPoolSize, g_pool_ratios.size()> poolSizes{};
+	for (size_t i = 0; i < g_pool_ratios.size(); ++i) {
+		poolSizes[i].type = g_pool_ratios[i].type;
+		poolSizes[i].descriptorCount = g_pool_ratios[i].perSet * maxSets;
+	}
+
+	VkDescriptorPoolCreateInfo infoPool{};
+	infoPool.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	infoPool.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	infoPool.pPoolSizes = poolSizes.data();
+	infoPool.maxSets = maxSets;
+
+	VkDescriptorPool pool;
+	if (vkCreateDescriptorPool(m_context->getDevice(), &infoPool, nullptr, &pool) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create descriptor pool!");
+	}
+	return pool;
+}
+
+/// @brief Tries the current pool of the chain then moves to the next one, created one size class larger when the
+/// chain has none left. a set the new pool cannot hold either is an error
+VkDescriptorSet DescriptorAllocator::allocate(PoolChain& chain, const Layout& layout) {
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &layout.layout;
+
+	VkDescriptorSet set;
+	for (int attempt = 0; attempt < 2; ++attempt) {
+		if (chain.current == chain.pools.size()) {
+			chain.pools.push_back(createPool(chain.nextSets));
+			chain.nextSets = std::min(chain.nextSets * 2, g_descriptor_pool_max_sets);
+		}
+		allocInfo.descriptorPool = chain.pools[chain.current];
+
+		VkResult result = vkAllocateDescriptorSets(m_context->getDevice(), &allocInfo, &set);
+		if (result == VK_SUCCESS)
+			return set;
+		if (result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL)
+			break;
+		// pool plein, on passe au suivant de la chaîne
+		++chain.current;
+	}
+	throw std::runtime_error("failed to allocate descriptor set!");
+}
+
+void DescriptorAllocator::reset(PoolChain& chain) {
+	// pools.size() quand le dernier est plein
+	size_t used = std::min(chain.current + 1, chain.pools.size());
+	for (size_t i = 0; i < used; ++i) {
+		vkResetDescriptorPool(m_context->getDevice(), chain.pools[i], 0);
+	}
+	chain.current = 0;
+}
+
+void DescriptorAllocator::destroy(PoolChain& chain) noexcept {
+	for (VkDescriptorPool pool : chain.pools) {
+		vkDestroyDescriptorPool(m_context->getDevice(), pool, nullptr);
+	}
+	chain.pools.clear();
+	chain.current = 0;
+	chain.nextSets = g_descriptor_pool_first_sets;
+}
+
+/// @brief FNV-1a over the fields each descriptor type reads, the unused bytes of the union are never hashed
+uint64_t DescriptorAllocator::hash(const Layout& layout, const DescriptorInfo* infos) {
+	uint64_t h = 14695981039346656037ull;
+	auto mixValue = [&h](auto value) {
+		const auto* bytes = reinterpret_cast<const unsigned char*>(&value);
+		for (size_t i = 0; i < sizeof(value); ++i) {
+			h = (h ^ bytes[i]) * 1099511628211ull;
+		}
+	};
+
+	for (size_t i = 0; i < layout.types.size(); ++i) {
+		if (isImage(layout.types[i])) {
+			mixValue(infos[i].image.sampler);
+			mixValue(infos[i].image.imageView);
+			mixValue(infos[i].image.imageLayout);
+		} else {
+			mixValue(infos[i].buffer.buffer);
+			mixValue(infos[i].buffer.offset);
+			mixValue(infos[i].buffer.range);
+		}
+	}
+	return h;
+}
+
+bool DescriptorAllocator::equal(const Layout& layout, const DescriptorInfo* a, const DescriptorInfo* b) {
+	for (size_t i = 0; i < layout.types.size(); ++i) {
+		if (isImage(layout.types[i])) {
+			if (a[i].image.sampler != b[i].image.sampler || a[i].image.imageView != b[i].image.imageView ||
+			    a[i].image.imageLayout != b[i].image.imageLayout)
+				return false;
+		} else {
+			if (a[i].buffer.buffer != b[i].buffer.buffer || a[i].buffer.offset != b[i].buffer.offset || a[i].buffer.range != b[i].buffer.range)
+				return false;
+		}
+	}
+	return true;
+}
@@ -4,21 +4,40 @@
 #include <VulkanApp/Utils/Uniforms.h>
 
 #include <array>
-#include <stdexcept>
 
 
-void Descriptors::init(VulkanContext* context, const uint32_t max_frames_in_flight, const std::vector<VkBuffer>& uniformBuffers, VkImageView textureImageView, VkSampler textureSampler){
+void Descriptors::init(VulkanContext* context, DescriptorAllocator* allocator, const uint32_t max_frames_in_flight, const std::vector<VkBuffer>& uniformBuffers,
+		       VkImageView textureImageView, VkSampler textureSampler){
 	m_context = context;
+	m_allocator = allocator;
 	createSetLayout();
-	createPool(max_frames_in_flight);
 	createSets(max_frames_in_flight, uniformBuffers, textureImageView, textureSampler);
 };
 
+/// @brief The layout and the sets belong to the allocator
 void Descriptors::cleanup() noexcept{
-	vkDestroyDescriptorPool(m_context->getDevice(), m_pool, nullptr);
-	vkDestroyDescriptorSetLayout(m_context->getDevice(), m_setLayout, nullptr);
+	m_sets.clear();
+	m_uniformBuffers.clear();
+	m_setLayout = VK_NULL_HANDLE;
 };
 
+/// @brief The old sets must not be used by a frame still in flight, they are evicted before their uniform buffers
+/// handles can be reused by the new ones
+void Descriptors::resize(const uint32_t max_frames_in_flight, const std::vector<VkBuffer>& uniformBuffers, VkImageView textureImageView, VkSampler textureSampler) {
+	for (VkDescriptorSet set : m_sets) {
+		m_allocator->evict(set);
+	}
+	createSets(max_frames_in_flight, uniformBuffers, textureImageView, textureSampler);
+}
+
+/// @brief Replaces the set of one frame, used when the texture moved in memory. the old set is evicted and
+/// rewritten through the update template, the set must not be used by a frame still in flight
+void Descriptors::updateTexture(uint32_t frame, VkImageView textureImageView, VkSampler textureSampler) {
+	m_allocator->evict(m_sets[frame]);
+	auto infos = makeInfos(m_uniformBuffers[frame], textureImageView, textureSampler);
+	m_sets[frame] = m_allocator->getCached(m_setLayout, infos.data());
+}
+
 /// @brief Creates set layout for mvp matrix in vertax stage and 2d sampler for textures in fragment stage
 void Descriptors::createSetLayout() {
 	VkDescriptorSetLayoutBinding uboLayoutBinding{};
@@ -35,83 +54,43 @@ void Descriptors::createSetLayout() {
 	samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 	samplerLayoutBinding.pImmutableSamplers = nullptr;
 
-	std::array<VkDescriptorSetLayoutBinding, 2> bindings = {uboLayoutBinding, samplerLayoutBinding};
-	VkDescriptorSetLayoutCreateInfo layoutInfo{};
-	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
-	layoutInfo.pBindings = bindings.data();
+	// viewProj * model de chaque objet, lue avec l'objectId des push constants ou le gl_InstanceIndex des draws indirects
+	VkDescriptorSetLayoutBinding objectLayoutBinding{};
+	objectLayoutBinding.binding = 2;
+	objectLayoutBinding.descriptorCount = 1;
+	objectLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	objectLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	objectLayoutBinding.pImmutableSamplers = nullptr;
 
-	if (vkCreateDescriptorSetLayout(m_context->getDevice(), &layoutInfo, nullptr, &m_setLayout) != VK_SUCCESS) {
-		throw std::runtime_error("failed to create descriptor set layout!");
-	}
-}
-
-void Descriptors::createPool(const uint32_t max_frames_in_flight) {
-	std::array<VkDescriptorPoolSize, 2> poolSizes{};
-	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	poolSizes[0].descriptorCount = static_cast<uint32_t>(max_frames_in_flight);
-	poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	poolSizes[1].descriptorCount = static_cast<uint32_t>(max_frames_in_flight);
-
-	VkDescriptorPoolCreateInfo infoPool{};
-	infoPool.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	infoPool.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-	infoPool.pPoolSizes = poolSizes.data();
-	infoPool.maxSets = static_cast<uint32_t>(max_frames_in_flight);
-
-	if (vkCreateDescriptorPool(m_context->getDevice(), &infoPool, nullptr, &m_pool) != VK_SUCCESS) {
-		throw std::runtime_error("failed to create descriptor pool!");
-	}
+	m_setLayout = m_allocator->createLayout({uboLayoutBinding, samplerLayoutBinding, objectLayoutBinding});
 }
 
-
+/// @brief One cached set per frame, the allocator writes each with a single template update
 void Descriptors::createSets( const uint32_t max_frames_in_flight, 
 							  const std::vector<VkBuffer>& uniformBuffers,
 							  VkImageView textureImageView,
 							  VkSampler textureSampler) { 
-
-	std::vector<VkDescriptorSetLayout> layouts(max_frames_in_flight, m_setLayout);
-
-	VkDescriptorSetAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	allocInfo.descriptorPool = m_pool;
-	allocInfo.descriptorSetCount = static_cast<uint32_t>(max_frames_in_flight);
-	allocInfo.pSetLayouts = layouts.data();
-
+	m_uniformBuffers.assign(uniformBuffers.begin(), uniformBuffers.begin() + max_frames_in_flight);
 	m_sets.resize(max_frames_in_flight);
 
-	if (vkAllocateDescriptorSets(m_context->getDevice(), &allocInfo, m_sets.data()) != VK_SUCCESS) {
-		throw std::runtime_error("failed to create descriptor sets!");
+	for (uint32_t i{0}; i < max_frames_in_flight; ++i) {
+		auto infos = makeInfos(uniformBuffers[i], textureImageView, textureSampler);
+		m_sets[i] = m_allocator->getCached(m_setLayout, infos.data());
 	}
+}
 
-	for (int i{0}; i < max_frames_in_flight; ++i) {
-		VkDescriptorBufferInfo bufferInfo{};
-		bufferInfo.buffer = uniformBuffers[i];
-		bufferInfo.offset = 0;
-		bufferInfo.range = sizeof(UniformBufferObject);
-
-		VkDescriptorImageInfo imageInfo{};
-		imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		imageInfo.imageView = textureImageView;
-		imageInfo.sampler = textureSampler;
-
-		std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
-		descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		descriptorWrites[0].dstSet = m_sets[i];
-		descriptorWrites[0].dstBinding = 0;
-		descriptorWrites[0].dstArrayElement = 0;
-		descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		descriptorWrites[0].descriptorCount = 1;
-		descriptorWrites[0].pBufferInfo = &bufferInfo; 
-		
-		descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		descriptorWrites[1].dstSet = m_sets[i];
-		descriptorWrites[1].dstBinding = 1;
-		descriptorWrites[1].dstArrayElement = 0;
-		descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		descriptorWrites[1].descriptorCount = 1;
-		descriptorWrites[1].pImageInfo = &imageInfo;
-
-		vkUpdateDescriptorSets(m_context->getDevice(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
-	}
-}
\ No newline at end of file
+std::array<DescriptorInfo, 3> Descriptors::makeInfos(VkBuffer uniformBuffer, VkImageView textureImageView, VkSampler textureSampler) const {
+	std::array<DescriptorInfo, 3> infos{};
+	infos[0].buffer.buffer = uniformBuffer;
+	infos[0].buffer.offset = 0;
+	infos[0].buffer.range = sizeof(FrameUniforms);
+
+	infos[1].image.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	infos[1].image.imageView = textureImageView;
+	infos[1].image.sampler = textureSampler;
+
+	infos[2].buffer.buffer = uniformBuffer;
+	infos[2].buffer.offset = g_object_clip_offset;
+	infos[2].buffer.range = VK_WHOLE_SIZE;
+	return infos;
+}
@@ -0,0 +1,478 @@
+#include <VulkanApp/Rendering/HiZCulling.h>
+
+#include <VulkanApp/Rendering/Pipeline.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+// la plus petite puissance de 2 >= value
+uint32_t nextPowerOfTwo(uint32_t value) {
+	uint32_t power = 1;
+	while (power < value) {
+		power <<= 1;
+	}
+	return power;
+}
+
+uint32_t groupCount(uint32_t threads, uint32_t groupSize) {
+	return (threads + groupSize - 1) / groupSize;
+}
+
+VkDescriptorSetLayoutBinding computeBinding(uint32_t binding, VkDescriptorType type) {
+	VkDescriptorSetLayoutBinding layoutBinding{};
+	layoutBinding.binding = binding;
+	layoutBinding.descriptorType = type;
+	layoutBinding.descriptorCount = 1;
+	layoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	return layoutBinding;
+}
+
+DescriptorInfo bufferInfo(VkBuffer buffer) {
+	DescriptorInfo info{};
+	info.buffer.buffer = buffer;
+	info.buffer.offset = 0;
+	info.buffer.range = VK_WHOLE_SIZE;
+	return info;
+}
+
+DescriptorInfo imageInfo(VkImageView view, VkImageLayout layout) {
+	DescriptorInfo info{};
+	info.image.sampler = VK_NULL_HANDLE;
+	info.image.imageView = view;
+	info.image.imageLayout = layout;
+	return info;
+}
+
+} // namespace
+
+void HiZCulling::init(VulkanContext* context, MemoryAllocator* allocator, DescriptorAllocator* descriptorAllocator, DeletionQueue* deletionQueue,
+		      UploadContext* uploads, VkPipelineCache cache, uint32_t maxFramesInFlight) {
+	m_context = context;
+	m_allocator = allocator;
+	m_descriptorAllocator = descriptorAllocator;
+	m_deletionQueue = deletionQueue;
+	m_uploads = uploads;
+
+	createPipelines(cache);
+
+	// lu par le cpu après la fence de la frame, coherent : pas de vkInvalidateMappedMemoryRanges
+	createBuffer(maxFramesInFlight * 2 * sizeof(uint32_t), VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, false, m_readbackBuffer, m_readbackAllocation);
+	std::memset(m_readbackAllocation.mapped, 0, maxFramesInFlight * 2 * sizeof(uint32_t));
+}
+
+void HiZCulling::cleanup() noexcept {
+	VkDevice device = m_context->getDevice();
+
+	destroyPyramid(false);
+	vkDestroyBuffer(device, m_drawBuffer, nullptr);
+	m_allocator->free(m_drawAllocation);
+	vkDestroyBuffer(device, m_indirectBuffer, nullptr);
+	m_allocator->free(m_indirectAllocation);
+	vkDestroyBuffer(device, m_visibilityBuffer, nullptr);
+	m_allocator->free(m_visibilityAllocation);
+	vkDestroyBuffer(device, m_readbackBuffer, nullptr);
+	m_allocator->free(m_readbackAllocation);
+	m_drawBuffer = VK_NULL_HANDLE;
+	m_indirectBuffer = VK_NULL_HANDLE;
+	m_visibilityBuffer = VK_NULL_HANDLE;
+	m_readbackBuffer = VK_NULL_HANDLE;
+	m_drawCount = 0;
+
+	vkDestroyPipeline(device, m_cullPipeline, nullptr);
+	vkDestroyPipeline(device, m_reducePipeline, nullptr);
+	vkDestroyPipeline(device, m_reduceMsPipeline, nullptr);
+	vkDestroyPipelineLayout(device, m_cullLayout, nullptr);
+	vkDestroyPipelineLayout(device, m_reduceLayout, nullptr);
+
+	// les layouts et les sets appartiennent au DescriptorAllocator
+	m_cullSets.clear();
+	m_reduceSets.clear();
+	m_retiredSets.clear();
+}
+
+bool HiZCulling::isSupported(VulkanContext* context, VkFormat depthFormat) {
+	if (!context->hasIndirectCount())
+		return false;
+
+	VkFormatProperties properties;
+	vkGetPhysicalDeviceFormatProperties(context->getPhysicalDevice(), depthFormat, &properties);
+	return (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+}
+
+void HiZCulling::createPipelines(VkPipelineCache cache) {
+	VkDevice device = m_context->getDevice();
+
+	m_cullSetLayout = m_descriptorAllocator->createLayout({
+	    computeBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER),
+	    computeBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER),
+	    computeBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER),
+	    computeBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER),
+	    computeBinding(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER),
+	    computeBinding(5, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE),
+	});
+	m_reduceSetLayout = m_descriptorAllocator->createLayout({
+	    computeBinding(0, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE),
+	    computeBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE),
+	});
+
+	VkPushConstantRange pushConstant{};
+	pushConstant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstant.offset = 0;
+	pushConstant.size = sizeof(CullConstants);
+
+	VkPipelineLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutInfo.setLayoutCount = 1;
+	layoutInfo.pSetLayouts = &m_cullSetLayout;
+	layoutInfo.pushConstantRangeCount = 1;
+	layoutInfo.pPushConstantRanges = &pushConstant;
+
+	if (vkCreatePipelineLayout(device, &layoutInfo, nullptr, &m_cullLayout) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create cull pipeline layout!");
+	}
+
+	pushConstant.size = sizeof(DepthReduceConstants);
+	layoutInfo.pSetLayouts = &m_reduceSetLayout;
+
+	if (vkCreatePipelineLayout(device, &layoutInfo, nullptr, &m_reduceLayout) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create depth reduce pipeline layout!");
+	}
+
+	m_cullPipeline = Pipeline::createCompute(m_context, g_cull_shader, m_cullLayout, cache);
+	m_reducePipeline = Pipeline::createCompute(m_context, g_depth_reduce_shader, m_reduceLayout, cache);
+	m_reduceMsPipeline = Pipeline::createCompute(m_context, g_depth_reduce_ms_shader, m_reduceLayout, cache);
+}
+
+void HiZCulling::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, bool shared, VkBuffer& buffer,
+			      Allocation& allocation) {
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = usage;
+	// sinon uniquement la queue graphics, upload compris
+	uint32_t families[3];
+	uint32_t familyCount = m_context->getSharingFamilies(families);
+	if (shared && familyCount > 1) {
+		bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		bufferInfo.queueFamilyIndexCount = familyCount;
+		bufferInfo.pQueueFamilyIndices = families;
+	} else {
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	}
+
+	if (vkCreateBuffer(m_context->getDevice(), &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create culling buffer!");
+	}
+	VkMemoryRequirements requirements;
+	vkGetBufferMemoryRequirements(m_context->getDevice(), buffer, &requirements);
+
+	allocation = m_allocator->allocate(requirements, properties, true);
+	vkBindBufferMemory(m_context->getDevice(), buffer, allocation.memory, allocation.offset);
+}
+
+/// @brief The draw buffer is filled through a staging buffer on the upload context, the indirect buffer holds the
+/// counts then drawCount commands per phase and is entirely written on the gpu, like the visibility
+void HiZCulling::setDraws(const std::vector<CullDraw>& draws) {
+	if (m_drawBuffer != VK_NULL_HANDLE) {
+		m_deletionQueue->push(m_drawBuffer, m_drawAllocation);
+		m_deletionQueue->push(m_indirectBuffer, m_indirectAllocation);
+		m_deletionQueue->push(m_visibilityBuffer, m_visibilityAllocation);
+		m_drawBuffer = VK_NULL_HANDLE;
+		m_indirectBuffer = VK_NULL_HANDLE;
+		m_visibilityBuffer = VK_NULL_HANDLE;
+	}
+
+	m_drawCount = static_cast<uint32_t>(draws.size());
+	if (draws.empty())
+		return;
+
+	VkDeviceSize drawSize = sizeof(CullDraw) * draws.size();
+	createBuffer(drawSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true,
+		     m_drawBuffer, m_drawAllocation);
+	createBuffer(g_indirect_counts_size + 2 * m_drawCount * g_indirect_command_size,
+		     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+			 VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true, m_indirectBuffer, m_indirectAllocation);
+	createBuffer(groupCount(m_drawCount, g_cull_group_size) * g_cull_group_size * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true, m_visibilityBuffer, m_visibilityAllocation);
+
+	VkBuffer stagingBuffer;
+	Allocation stagingAllocation;
+	createBuffer(drawSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, false,
+		     stagingBuffer, stagingAllocation);
+	std::memcpy(stagingAllocation.mapped, draws.data(), static_cast<size_t>(drawSize));
+
+	m_uploads->copyBuffer(stagingBuffer, m_drawBuffer, drawSize);
+	m_uploads->releaseAfterUpload(stagingBuffer, stagingAllocation);
+}
+
+/// @brief Level 0 is half the depth buffer rounded up to a power of two on each axis: Vulkan mips are rounded down,
+/// a level always covers exactly twice the pixels of the previous one and the texels past the depth buffer repeat
+/// its border. the clear to 1.0 is recorded on the upload context and the pyramid is left in SHADER_READ_ONLY
+void HiZCulling::createPyramid(VkExtent2D extent) {
+	destroyPyramid(true);
+
+	m_pyramidSource = extent;
+	m_pyramidExtent.width = nextPowerOfTwo((extent.width + 1) / 2);
+	m_pyramidExtent.height = nextPowerOfTwo((extent.height + 1) / 2);
+	m_pyramidLevels = 1;
+	while ((std::max(m_pyramidExtent.width, m_pyramidExtent.height) >> m_pyramidLevels) > 0) {
+		++m_pyramidLevels;
+	}
+
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.extent = {m_pyramidExtent.width, m_pyramidExtent.height, 1};
+	imageInfo.mipLevels = m_pyramidLevels;
+	imageInfo.arrayLayers = 1;
+	imageInfo.format = VK_FORMAT_R32_SFLOAT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	// construite par la queue graphics, lue par la phase 0 sur la queue compute
+	uint32_t families[3];
+	uint32_t familyCount = m_context->getSharingFamilies(families);
+	if (familyCount > 1) {
+		imageInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		imageInfo.queueFamilyIndexCount = familyCount;
+		imageInfo.pQueueFamilyIndices = families;
+	} else {
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	}
+
+	if (vkCreateImage(m_context->getDevice(), &imageInfo, nullptr, &m_pyramid) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create depth pyramid image!");
+	}
+	VkMemoryRequirements requirements;
+	vkGetImageMemoryRequirements(m_context->getDevice(), m_pyramid, &requirements);
+	m_pyramidAllocation = m_allocator->allocate(requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, false);
+	vkBindImageMemory(m_context->getDevice(), m_pyramid, m_pyramidAllocation.memory, m_pyramidAllocation.offset);
+
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = m_pyramid;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = VK_FORMAT_R32_SFLOAT;
+	viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	viewInfo.subresourceRange.baseMipLevel = 0;
+	viewInfo.subresourceRange.levelCount = m_pyramidLevels;
+	viewInfo.subresourceRange.baseArrayLayer = 0;
+	viewInfo.subresourceRange.layerCount = 1;
+
+	if (vkCreateImageView(m_context->getDevice(), &viewInfo, nullptr, &m_pyramidView) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create depth pyramid view!");
+	}
+
+	// une vue par niveau, un storage image n'en lit qu'un
+	m_mipViews.resize(m_pyramidLevels);
+	viewInfo.subresourceRange.levelCount = 1;
+	for (uint32_t level = 0; level < m_pyramidLevels; ++level) {
+		viewInfo.subresourceRange.baseMipLevel = level;
+		if (vkCreateImageView(m_context->getDevice(), &viewInfo, nullptr, &m_mipViews[level]) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create depth pyramid view!");
+		}
+	}
+
+	// profondeur du far plane : rien n'est caché par la pyramide avant qu'une frame l'ait construite
+	VkClearColorValue far{};
+	far.float32[0] = 1.0f;
+	VkImageSubresourceRange range{};
+	range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	range.baseMipLevel = 0;
+	range.levelCount = m_pyramidLevels;
+	range.baseArrayLayer = 0;
+	range.layerCount = 1;
+
+	m_uploads->transitionImageLayout(m_pyramid, m_pyramidLevels, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+	vkCmdClearColorImage(m_uploads->getCommandBuffer(), m_pyramid, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &far, 1, &range);
+	m_uploads->transitionImageLayout(m_pyramid, m_pyramidLevels, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
+
+void HiZCulling::destroyPyramid(bool deferred) noexcept {
+	if (m_pyramid == VK_NULL_HANDLE)
+		return;
+
+	if (deferred) {
+		for (VkImageView view : m_mipViews) {
+			m_deletionQueue->push(view);
+		}
+		m_deletionQueue->push(m_pyramidView);
+		m_deletionQueue->push(m_pyramid, m_pyramidAllocation);
+	} else {
+		for (VkImageView view : m_mipViews) {
+			vkDestroyImageView(m_context->getDevice(), view, nullptr);
+		}
+		vkDestroyImageView(m_context->getDevice(), m_pyramidView, nullptr);
+		vkDestroyImage(m_context->getDevice(), m_pyramid, nullptr);
+		m_allocator->free(m_pyramidAllocation);
+	}
+	m_mipViews.clear();
+	m_pyramidView = VK_NULL_HANDLE;
+	m_pyramid = VK_NULL_HANDLE;
+	m_pyramidLevels = 0;
+}
+
+/// @brief The sets come from the cache of the allocator, a set that is no longer returned is retired with the
+/// current frame number and evicted by collect() once that frame is finished. level 0 of the reduction samples the
+/// depth buffer, the other levels the previous mip that the pass keeps in GENERAL
+void HiZCulling::updateDescriptors(const std::vector<VkBuffer>& uniformBuffers, VkBuffer objectBuffer, VkImageView depthView,
+				   VkSampleCountFlagBits depthSamples) {
+	m_depthSamples = depthSamples;
+
+	std::vector<VkDescriptorSet> previous = m_cullSets;
+	previous.insert(previous.end(), m_reduceSets.begin(), m_reduceSets.end());
+
+	m_cullSets.resize(uniformBuffers.size());
+	m_cullInfos.resize(uniformBuffers.size());
+	for (size_t frame = 0; frame < uniformBuffers.size(); ++frame) {
+		m_cullInfos[frame] = {
+		    bufferInfo(uniformBuffers[frame]),
+		    bufferInfo(m_drawBuffer),
+		    bufferInfo(objectBuffer),
+		    bufferInfo(m_indirectBuffer),
+		    bufferInfo(m_visibilityBuffer),
+		    imageInfo(m_pyramidView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL),
+		};
+		m_cullSets[frame] = m_descriptorAllocator->getCached(m_cullSetLayout, m_cullInfos[frame].data());
+	}
+
+	m_reduceSets.resize(m_pyramidLevels);
+	for (uint32_t level = 0; level < m_pyramidLevels; ++level) {
+		std::array<DescriptorInfo, 2> infos{
+		    level == 0 ? imageInfo(depthView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) : imageInfo(m_mipViews[level - 1], VK_IMAGE_LAYOUT_GENERAL),
+		    imageInfo(m_mipViews[level], VK_IMAGE_LAYOUT_GENERAL),
+		};
+		m_reduceSets[level] = m_descriptorAllocator->getCached(m_reduceSetLayout, infos.data());
+	}
+
+	for (VkDescriptorSet set : m_cullSets) {
+		unretire(set);
+	}
+	for (VkDescriptorSet set : m_reduceSets) {
+		unretire(set);
+	}
+	for (VkDescriptorSet set : previous) {
+		if (std::find(m_cullSets.begin(), m_cullSets.end(), set) == m_cullSets.end() &&
+		    std::find(m_reduceSets.begin(), m_reduceSets.end(), set) == m_reduceSets.end()) {
+			retire(set);
+		}
+	}
+}
+
+void HiZCulling::retire(VkDescriptorSet set) {
+	m_retiredSets.push_back({set, m_frameNumber});
+}
+
+// le cache a rendu un set retiré pour les mêmes infos, il est de nouveau utilisé
+void HiZCulling::unretire(VkDescriptorSet set) {
+	m_retiredSets.erase(std::remove_if(m_retiredSets.begin(), m_retiredSets.end(), [set](const RetiredSet& retired) { return retired.set == set; }),
+			    m_retiredSets.end());
+}
+
+void HiZCulling::evictDescriptors() {
+	for (VkDescriptorSet set : m_cullSets) {
+		m_descriptorAllocator->evict(set);
+	}
+	for (VkDescriptorSet set : m_reduceSets) {
+		m_descriptorAllocator->evict(set);
+	}
+	for (const auto& retired : m_retiredSets) {
+		m_descriptorAllocator->evict(retired.set);
+	}
+	m_cullSets.clear();
+	m_cullInfos.clear();
+	m_reduceSets.clear();
+	m_retiredSets.clear();
+}
+
+void HiZCulling::collect(uint64_t frameNumber, uint64_t completedFrames) {
+	m_frameNumber = frameNumber;
+	auto it = std::remove_if(m_retiredSets.begin(), m_retiredSets.end(), [this, completedFrames](const RetiredSet& retired) {
+		if (retired.frameNumber >= completedFrames)
+			return false;
+		m_descriptorAllocator->evict(retired.set);
+		return true;
+	});
+	m_retiredSets.erase(it, m_retiredSets.end());
+}
+
+void HiZCulling::recordEarlyCull(VkCommandBuffer commandBuffer, uint32_t frame) {
+	vkCmdFillBuffer(commandBuffer, m_indirectBuffer, 0, g_indirect_counts_size, 0);
+
+	// les compteurs remis a zéro avant les atomicAdd de la phase 0
+	m_barriers.memory(VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			  VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+	m_barriers.flush(commandBuffer);
+
+	// le set n'est utilisé que par cette soumission, libéré avec la chaîne de la frame
+	recordCull(commandBuffer, m_descriptorAllocator->allocateFrame(frame, m_cullSetLayout, m_cullInfos[frame].data()), 0);
+}
+
+void HiZCulling::recordLateCull(VkCommandBuffer commandBuffer, uint32_t frame) {
+	recordCull(commandBuffer, m_cullSets[frame], 1);
+}
+
+void HiZCulling::recordCull(VkCommandBuffer commandBuffer, VkDescriptorSet set, uint32_t phase) {
+	CullConstants constants{m_drawCount, phase};
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullPipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullLayout, 0, 1, &set, 0, nullptr);
+	vkCmdPushConstants(commandBuffer, m_cullLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullConstants), &constants);
+	vkCmdDispatch(commandBuffer, groupCount(m_drawCount, g_cull_group_size), 1, 1);
+}
+
+/// @brief One dispatch per level, a compute to compute barrier between them: level i samples what level i - 1 wrote
+void HiZCulling::recordPyramid(VkCommandBuffer commandBuffer) {
+	glm::ivec2 srcSize{static_cast<int32_t>(m_pyramidSource.width), static_cast<int32_t>(m_pyramidSource.height)};
+
+	for (uint32_t level = 0; level < m_pyramidLevels; ++level) {
+		DepthReduceConstants constants{};
+		constants.srcSize = srcSize;
+		constants.dstSize = {static_cast<int32_t>(std::max(1u, m_pyramidExtent.width >> level)),
+				     static_cast<int32_t>(std::max(1u, m_pyramidExtent.height >> level))};
+		constants.samples = static_cast<int32_t>(m_depthSamples);
+
+		bool multisampled = level == 0 && m_depthSamples != VK_SAMPLE_COUNT_1_BIT;
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, multisampled ? m_reduceMsPipeline : m_reducePipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_reduceLayout, 0, 1, &m_reduceSets[level], 0, nullptr);
+		vkCmdPushConstants(commandBuffer, m_reduceLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(DepthReduceConstants), &constants);
+		vkCmdDispatch(commandBuffer, groupCount(constants.dstSize.x, g_depth_reduce_group_size), groupCount(constants.dstSize.y, g_depth_reduce_group_size), 1);
+
+		if (level + 1 < m_pyramidLevels) {
+			m_barriers.memory(VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+					  VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT);
+			m_barriers.flush(commandBuffer);
+		}
+		srcSize = constants.dstSize;
+	}
+}
+
+void HiZCulling::drawIndirect(VkCommandBuffer commandBuffer, uint32_t phase) {
+	vkCmdDrawIndexedIndirectCount(commandBuffer, m_indirectBuffer, g_indirect_counts_size + phase * m_drawCount * g_indirect_command_size,
+				      m_indirectBuffer, phase * sizeof(uint32_t), m_drawCount, static_cast<uint32_t>(g_indirect_command_size));
+}
+
+void HiZCulling::recordReadback(VkCommandBuffer commandBuffer, uint32_t frame) {
+	VkBufferCopy region{};
+	region.srcOffset = 0;
+	region.dstOffset = frame * 2 * sizeof(uint32_t);
+	region.size = 2 * sizeof(uint32_t);
+	vkCmdCopyBuffer(commandBuffer, m_indirectBuffer, m_readbackBuffer, 1, &region);
+
+	// la copie doit etre visible par le cpu une fois la fence signalée
+	m_barriers.memory(VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT);
+	m_barriers.flush(commandBuffer);
+}
+
+void HiZCulling::readStats(uint32_t frame, uint32_t& early, uint32_t& late) const {
+	const auto* counts = static_cast<const uint32_t*>(m_readbackAllocation.mapped) + frame * 2;
+	early = counts[0];
+	late = counts[1];
+}
@@ -0,0 +1,176 @@
+#include <VulkanApp/Rendering/OcclusionQueries.h>
+
+#include <VulkanApp/Resources/Mesh.h>
+
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+void OcclusionQueries::init(VulkanContext* context, MemoryAllocator* allocator, UploadContext* uploads, uint32_t maxQueries, uint32_t maxFramesInFlight) {
+	m_context = context;
+	m_allocator = allocator;
+	m_uploads = uploads;
+	m_maxQueries = maxQueries;
+
+	VkQueryPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	poolInfo.queryType = VK_QUERY_TYPE_OCCLUSION;
+	poolInfo.queryCount = maxFramesInFlight * maxQueries;
+
+	if (vkCreateQueryPool(m_context->getDevice(), &poolInfo, nullptr, &m_queryPool) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create occlusion query pool!");
+	}
+
+	if (usesConditionalRendering()) {
+		createBuffer(maxQueries * sizeof(uint32_t), VK_BUFFER_USAGE_CONDITIONAL_RENDERING_BIT_EXT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_predicateBuffer, m_predicateAllocation);
+	}
+	createProxy();
+
+	// drawFrame n'alloue pas : les listes de draws des slots et les résultats ont leur taille maximale
+	m_submittedDraws.resize(maxFramesInFlight);
+	for (auto& draws : m_submittedDraws) {
+		draws.reserve(maxQueries);
+	}
+	m_submitted.assign(maxFramesInFlight, false);
+	m_submittedFrameNumbers.assign(maxFramesInFlight, 0);
+	m_results.reserve(maxQueries);
+}
+
+void OcclusionQueries::cleanup() noexcept {
+	VkDevice device = m_context->getDevice();
+
+	vkDestroyQueryPool(device, m_queryPool, nullptr);
+	vkDestroyBuffer(device, m_predicateBuffer, nullptr);
+	m_allocator->free(m_predicateAllocation);
+	vkDestroyBuffer(device, m_proxyBuffer, nullptr);
+	m_allocator->free(m_proxyAllocation);
+	m_queryPool = VK_NULL_HANDLE;
+	m_predicateBuffer = VK_NULL_HANDLE;
+	m_proxyBuffer = VK_NULL_HANDLE;
+
+	m_submittedDraws.clear();
+	m_submitted.clear();
+	m_submittedFrameNumbers.clear();
+	m_results.clear();
+}
+
+void OcclusionQueries::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, Allocation& allocation) {
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = usage;
+	// uniquement la queue graphics, upload compris
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateBuffer(m_context->getDevice(), &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create occlusion buffer!");
+	}
+	VkMemoryRequirements requirements;
+	vkGetBufferMemoryRequirements(m_context->getDevice(), buffer, &requirements);
+
+	allocation = m_allocator->allocate(requirements, properties, true);
+	vkBindBufferMemory(m_context->getDevice(), buffer, allocation.memory, allocation.offset);
+}
+
+/// @brief The box [-1, 1] on each axis, the caller scales it to the bounding box of a draw. Vertex like the mesh so the
+/// position only pipelines read it, the winding does not matter: the proxies are drawn without culling
+void OcclusionQueries::createProxy() {
+	std::array<Vertex, 8> vertices{};
+	for (uint32_t corner = 0; corner < vertices.size(); ++corner) {
+		vertices[corner].pos = glm::vec3(corner & 1 ? 1.0f : -1.0f, corner & 2 ? 1.0f : -1.0f, corner & 4 ? 1.0f : -1.0f);
+	}
+	// deux triangles par face, les coins d'une face partagent le bit de son axe
+	constexpr std::array<uint32_t, g_proxy_index_count> indices{
+	    0, 2, 1, 1, 2, 3, // -z
+	    4, 5, 6, 5, 7, 6, // +z
+	    0, 1, 4, 1, 5, 4, // -y
+	    2, 6, 3, 3, 6, 7, // +y
+	    0, 4, 2, 2, 4, 6, // -x
+	    1, 3, 5, 3, 7, 5, // +x
+	};
+
+	VkDeviceSize verticesSize = sizeof(vertices);
+	VkDeviceSize bufferSize = verticesSize + sizeof(indices);
+	m_proxyIndicesOffset = verticesSize;
+	createBuffer(bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_proxyBuffer, m_proxyAllocation);
+
+	VkBuffer stagingBuffer;
+	Allocation stagingAllocation;
+	createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		     stagingBuffer, stagingAllocation);
+	std::memcpy(stagingAllocation.mapped, vertices.data(), static_cast<size_t>(verticesSize));
+	std::memcpy(static_cast<char*>(stagingAllocation.mapped) + verticesSize, indices.data(), sizeof(indices));
+
+	m_uploads->copyBuffer(stagingBuffer, m_proxyBuffer, bufferSize);
+	m_uploads->releaseAfterUpload(stagingBuffer, stagingAllocation);
+}
+
+void OcclusionQueries::recordReset(VkCommandBuffer commandBuffer, uint32_t frame, uint32_t count) {
+	if (count == 0)
+		return;
+	vkCmdResetQueryPool(commandBuffer, m_queryPool, frame * m_maxQueries, count);
+}
+
+void OcclusionQueries::bindProxy(VkCommandBuffer commandBuffer) {
+	VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_proxyBuffer, &offset);
+	vkCmdBindIndexBuffer(commandBuffer, m_proxyBuffer, m_proxyIndicesOffset, VK_INDEX_TYPE_UINT32);
+}
+
+/// @brief Not precise: only zero or not matters, which every implementation gives without the occlusionQueryPrecise
+/// feature
+void OcclusionQueries::drawProxy(VkCommandBuffer commandBuffer, uint32_t frame, uint32_t query) {
+	vkCmdBeginQuery(commandBuffer, m_queryPool, frame * m_maxQueries + query, 0);
+	vkCmdDrawIndexed(commandBuffer, g_proxy_index_count, 1, 0, 0, 0);
+	vkCmdEndQuery(commandBuffer, m_queryPool, frame * m_maxQueries + query);
+}
+
+/// @brief WAIT_BIT: the copy waits on the gpu for the queries of the pass before, the barrier of the render graph only
+/// covers the writes to the predicates
+void OcclusionQueries::recordResolve(VkCommandBuffer commandBuffer, uint32_t frame, uint32_t count) {
+	if (count == 0)
+		return;
+	vkCmdCopyQueryPoolResults(commandBuffer, m_queryPool, frame * m_maxQueries, count, m_predicateBuffer, 0, sizeof(uint32_t),
+				  VK_QUERY_RESULT_WAIT_BIT);
+}
+
+void OcclusionQueries::beginConditional(VkCommandBuffer commandBuffer, uint32_t query) const {
+	m_context->beginConditionalRendering(commandBuffer, m_predicateBuffer, query * sizeof(uint32_t));
+}
+
+void OcclusionQueries::endConditional(VkCommandBuffer commandBuffer) const {
+	m_context->endConditionalRendering(commandBuffer);
+}
+
+void OcclusionQueries::markSubmitted(uint32_t frame, const uint32_t* draws, uint32_t count, uint64_t frameNumber) {
+	m_submittedDraws[frame].assign(draws, draws + count); // capacité réservée
+	m_submitted[frame] = true;
+	m_submittedFrameNumbers[frame] = frameNumber;
+}
+
+bool OcclusionQueries::readResults(uint32_t frame) {
+	if (!m_submitted[frame])
+		return false;
+	// le slot précédent a pu finir après celui-ci, ses résultats n'apportent plus rien
+	if (m_submittedFrameNumbers[frame] < m_resultFrameNumber) {
+		m_submitted[frame] = false;
+		return false;
+	}
+
+	uint32_t count = static_cast<uint32_t>(m_submittedDraws[frame].size());
+	m_results.resize(count);
+	if (count > 0) {
+		// sans WAIT_BIT : VK_NOT_READY tant que la frame n'est pas finie, on réessaiera
+		VkResult result = vkGetQueryPoolResults(m_context->getDevice(), m_queryPool, frame * m_maxQueries, count, count * sizeof(uint32_t),
+							m_results.data(), sizeof(uint32_t), 0);
+		if (result != VK_SUCCESS)
+			return false;
+	}
+
+	m_submitted[frame] = false;
+	m_resultFrame = frame;
+	m_resultFrameNumber = m_submittedFrameNumbers[frame];
+	return true;
+}
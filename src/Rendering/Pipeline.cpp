@@ -3,22 +3,24 @@
 #include <VulkanApp/Utils/FileReader.h>
 #include <VulkanApp/Core/VulkanContext.h>
 #include <VulkanApp/Resources/Mesh.h>
+#include <VulkanApp/Utils/Uniforms.h>
 
 #include <vulkan/vulkan.h>
 #include <stdexcept>
 #include <iostream>
 
 /// @brief Creates a shader module and vector manages the alignment
+/// @param device
 /// @param code 
 /// @return 
-VkShaderModule Pipeline::createShaderModule(const std::vector<char>& code) {
+VkShaderModule Pipeline::createShaderModule(VkDevice device, const std::vector<char>& code) {
 	VkShaderModuleCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
 	createInfo.codeSize = code.size();
 	createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
 
 	VkShaderModule shaderModule;
-	if (vkCreateShaderModule(m_context->getDevice(), &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+	if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create shader module!");
 	}
 
@@ -26,13 +28,87 @@ VkShaderModule Pipeline::createShaderModule(const std::vector<char>& code) {
 }
 
 
-void Pipeline::init(VulkanContext* context, VkRenderPass renderPass, VkDescriptorSetLayout descriptorSetLayout) {
+void Pipeline::init(VulkanContext* context, const PipelineDesc& desc, VkDescriptorSetLayout descriptorSetLayout, VkPipelineCache cache) {
 	m_context = context;
-	m_renderPass = renderPass;
+	m_desc = desc;
 	m_descriptorSetLayout = descriptorSetLayout;
+	m_cache = cache;
 	createGraphicsPipeline();
 }
 
+void PipelineDesc::setSpecialization(uint32_t constantId, uint32_t value) {
+	for (uint32_t i = 0; i < specializationCount; ++i) {
+		if (specializationIds[i] == constantId) {
+			specializationValues[i] = value;
+			return;
+		}
+	}
+	if (specializationCount == g_max_specialization_constants) {
+		throw std::runtime_error("too many specialization constants!");
+	}
+	specializationIds[specializationCount] = constantId;
+	specializationValues[specializationCount] = value;
+	specializationCount++;
+}
+
+/// @brief FNV-1a over every field, the render pass by handle
+uint64_t PipelineDesc::hash() const {
+	uint64_t h = 14695981039346656037ull;
+	auto mix = [&h](const void* data, size_t size) {
+		const auto* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; ++i) {
+			h = (h ^ bytes[i]) * 1099511628211ull;
+		}
+	};
+	auto mixValue = [&mix](auto value) { mix(&value, sizeof(value)); };
+
+	mix(vertexShader.data(), vertexShader.size());
+	mixValue('\0'); // "ab" + "c" et "a" + "bc" ne donnent pas le même hash
+	mix(fragmentShader.data(), fragmentShader.size());
+	mixValue(specializationCount);
+	for (uint32_t i = 0; i < specializationCount; ++i) {
+		mixValue(specializationIds[i]);
+		mixValue(specializationValues[i]);
+	}
+	mixValue(vertexLayout);
+	mixValue(renderPass);
+	mixValue(subpass);
+	mixValue(colorFormat);
+	mixValue(depthFormat);
+	mixValue(topology);
+	mixValue(polygonMode);
+	mixValue(cullMode);
+	mixValue(frontFace);
+	mixValue(samples);
+	mixValue(sampleShading);
+	mixValue(minSampleShading);
+	mixValue(depthTest);
+	mixValue(depthWrite);
+	mixValue(depthCompare);
+	mixValue(blend);
+	return h;
+}
+
+bool PipelineDesc::operator==(const PipelineDesc& other) const {
+	if (specializationCount != other.specializationCount)
+		return false;
+	for (uint32_t i = 0; i < specializationCount; ++i) {
+		if (specializationIds[i] != other.specializationIds[i] || specializationValues[i] != other.specializationValues[i])
+			return false;
+	}
+	return vertexShader == other.vertexShader && fragmentShader == other.fragmentShader && vertexLayout == other.vertexLayout &&
+	       renderPass == other.renderPass && subpass == other.subpass && colorFormat == other.colorFormat && depthFormat == other.depthFormat && topology == other.topology && polygonMode == other.polygonMode &&
+	       cullMode == other.cullMode && frontFace == other.frontFace && samples == other.samples && sampleShading == other.sampleShading &&
+	       minSampleShading == other.minSampleShading && depthTest == other.depthTest && depthWrite == other.depthWrite && depthCompare == other.depthCompare && blend == other.blend;
+}
+
+void Pipeline::setDesc(const PipelineDesc& desc) {
+	VkPipeline pipeline = create(m_context, desc, m_layout, m_cache);
+	vkDestroyPipeline(m_context->getDevice(), m_pipeline, nullptr);
+	m_pipeline = pipeline;
+	m_desc = desc;
+}
+
 /// @brief destroys the pipeline then its layout
 void Pipeline::cleanup() {
 	if (m_pipeline != VK_NULL_HANDLE) {
@@ -45,28 +121,79 @@ void Pipeline::cleanup() {
 	}
 }
 
+/// @brief Creates the pipeline layout that binds the provided descriptor set layout and the DrawConstants push
+/// constants, shared by every variant, then the base variant m_desc
+void Pipeline::createGraphicsPipeline() {
+	// Pipeline layout, uniforms ect.
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &m_descriptorSetLayout;
+	// transformation et id de l'objet, par draw sans descriptor set
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(DrawConstants);
+
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(m_context->getDevice(), &pipelineLayoutInfo, nullptr, &m_layout) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create pipeline layout!");
+	} else {
+		std::cout << "Pipeline layout created" << '\n';
+	}
+
+	m_pipeline = create(m_context, m_desc, m_layout, m_cache);
+	std::cout << "Graphics pipeline created" << '\n';
+}
+
 /**
- * @brief Creates the graphics pipeline used for rendering.
+ * @brief Creates a graphics pipeline from its description.
  *
  * Implementation summary:
- * - Loads SPIR-V vertex and fragment shaders and creates shader modules.
- * - Configures vertex input (binding + attribute descriptions) from `Vertex`.
- * - Sets input assembly to triangle list.
+ * - Loads SPIR-V vertex and fragment shaders and creates shader modules, a depth only description has no
+ *   fragment stage and no color attachment.
+ * - Passes the specialization constants to both stages.
+ * - Configures vertex input (binding + attribute descriptions) from `Vertex`, only the position for
+ *   `VertexLayout::Position`.
+ * - Sets input assembly to the topology of the description.
  * - Uses dynamic viewport and scissor state so they can be set at command recording.
- * - Configures rasterizer (back-face culling, fill polygon mode, CCW front face).
- * - Enables MSAA using sample count provided by the `VulkanContext`.
- * - Sets up depth/stencil state (depth test/write enabled, compare = LESS).
- * - Configures color blending with blending disabled (simple replace).
- * - Creates a pipeline layout that binds the provided descriptor set layout.
- * - Finally creates the graphics pipeline for `m_renderPass` subpass 0.
+ * - Configures rasterizer (cull mode, polygon mode, front face of the description).
+ * - Enables MSAA using the sample count of the description.
+ * - Sets up depth/stencil state (depth test/write and compare op of the description).
+ * - Configures color blending, alpha blending when the description asks for it.
+ * - Finally creates the graphics pipeline for `desc.renderPass`, or for the attachment formats of the description
+ *   with dynamic rendering, through the shared pipeline cache when one is given.
+ *
+ * No member is touched, several variants can be built at the same time: the shader modules are per call
+ * and the pipeline cache is internally synchronized.
  */
-void Pipeline::createGraphicsPipeline() {
-
-	auto vertShaderCode{FileReader::readSPV(g_vertex_shader)};
-	auto fragShaderCode{FileReader::readSPV(g_fragment_shader)};
+VkPipeline Pipeline::create(VulkanContext* context, const PipelineDesc& desc, VkPipelineLayout layout, VkPipelineCache cache) {
+	VkDevice device = context->getDevice();
+
+	auto vertShaderCode{FileReader::readSPV(desc.vertexShader)};
+	VkShaderModule vertShaderModule{createShaderModule(device, vertShaderCode)};
+	// depth only : la profondeur vient du rasterizer, aucun fragment shader a éxécuter
+	VkShaderModule fragShaderModule{VK_NULL_HANDLE};
+	if (!desc.isDepthOnly()) {
+		auto fragShaderCode{FileReader::readSPV(desc.fragmentShader)};
+		fragShaderModule = createShaderModule(device, fragShaderCode);
+	}
 
-	VkShaderModule vertShaderModule{createShaderModule(vertShaderCode)};
-	VkShaderModule fragShaderModule{createShaderModule(fragShaderCode)};
+	// les constantes de spécialisation, le driver compile le shader avec ces valeurs (branches et boucles résolues)
+	std::array<VkSpecializationMapEntry, g_max_specialization_constants> specializationEntries{};
+	for (uint32_t i = 0; i < desc.specializationCount; ++i) {
+		specializationEntries[i].constantID = desc.specializationIds[i];
+		specializationEntries[i].offset = i * sizeof(uint32_t);
+		specializationEntries[i].size = sizeof(uint32_t);
+	}
+	VkSpecializationInfo specializationInfo{};
+	specializationInfo.mapEntryCount = desc.specializationCount;
+	specializationInfo.pMapEntries = specializationEntries.data();
+	specializationInfo.dataSize = desc.specializationCount * sizeof(uint32_t);
+	specializationInfo.pData = desc.specializationValues.data();
+	const VkSpecializationInfo* specialization = desc.specializationCount > 0 ? &specializationInfo : nullptr;
 
 	VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
 	vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -74,30 +201,32 @@ void Pipeline::createGraphicsPipeline() {
 
 	vertShaderStageInfo.module = vertShaderModule;
 	vertShaderStageInfo.pName = "main";
-
-	// vertShaderStageInfo.pSpecializationInfo to define constants => better optimisations
+	vertShaderStageInfo.pSpecializationInfo = specialization;
 
 	VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
 	fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 	fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
 	fragShaderStageInfo.module = fragShaderModule;
 	fragShaderStageInfo.pName = "main";
+	fragShaderStageInfo.pSpecializationInfo = specialization;
 
 	VkPipelineShaderStageCreateInfo shaderStages[]{vertShaderStageInfo, fragShaderStageInfo};
 
+	// VertexLayout::Position lit le meme buffer, seulement la position (location 0, le premier attribut)
 	auto bindingDescription = Vertex::getBindingDescription();
 	auto attributeDescriptions = Vertex::getAttributeDescriptions();
+	uint32_t attributeCount = desc.vertexLayout == VertexLayout::Position ? 1 : static_cast<uint32_t>(attributeDescriptions.size());
 
 	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 	vertexInputInfo.vertexBindingDescriptionCount = 1;
 	vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
+	vertexInputInfo.vertexAttributeDescriptionCount = attributeCount;
 	vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
 	VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
 	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	inputAssembly.topology = desc.topology;
 	inputAssembly.primitiveRestartEnable = VK_FALSE;
 
 	std::vector<VkDynamicState> dynamicStates{
@@ -120,10 +249,10 @@ void Pipeline::createGraphicsPipeline() {
 	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
 	rasterizer.depthClampEnable = VK_FALSE;
 	rasterizer.rasterizerDiscardEnable = VK_FALSE;
-	rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterizer.polygonMode = desc.polygonMode;
 	rasterizer.lineWidth = 1.0f; 
-	rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;	
-	rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+	rasterizer.cullMode = desc.cullMode;	
+	rasterizer.frontFace = desc.frontFace;
 
 	rasterizer.depthBiasEnable = VK_FALSE;
 	rasterizer.depthBiasConstantFactor = 0.0f;
@@ -133,9 +262,9 @@ void Pipeline::createGraphicsPipeline() {
 	// MSAA
 	VkPipelineMultisampleStateCreateInfo multisampling{};
 	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-	multisampling.sampleShadingEnable = VK_TRUE;
-	multisampling.rasterizationSamples = m_context->getMsaaSamples();
-	multisampling.minSampleShading = 0.2f;
+	multisampling.sampleShadingEnable = desc.sampleShading ? VK_TRUE : VK_FALSE;
+	multisampling.rasterizationSamples = desc.samples;
+	multisampling.minSampleShading = desc.minSampleShading;
 
 	// Depth / stencil testing
 	// see VkPipelineDepthStencilStateCreateInfo
@@ -148,40 +277,32 @@ void Pipeline::createGraphicsPipeline() {
 	// Config 
 	VkPipelineColorBlendAttachmentState colorBlendAttachment{};
 	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-	colorBlendAttachment.blendEnable = VK_FALSE; // on blend pas
-	// notre nouvelle image ne sera pas combiné avec l'ancienne
+	colorBlendAttachment.blendEnable = desc.blend ? VK_TRUE : VK_FALSE;
+	// sans blend notre nouvelle image ne sera pas combiné avec l'ancienne
 	// le plus commun c'est de blend en utilisant l'alpha channel
+	colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+	colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+	colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+	colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
 
 	VkPipelineColorBlendStateCreateInfo colorBlending{};
 	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
 	colorBlending.logicOpEnable = VK_FALSE;
 	colorBlending.logicOp = VK_LOGIC_OP_COPY;
-	colorBlending.attachmentCount = 1;
+	colorBlending.attachmentCount = desc.isDepthOnly() ? 0 : 1;
 	colorBlending.pAttachments = &colorBlendAttachment;
 	colorBlending.blendConstants[0] = 0.0f; 
 	colorBlending.blendConstants[1] = 0.0f; 
 	colorBlending.blendConstants[2] = 0.0f;
 	colorBlending.blendConstants[3] = 0.0f;
 
-	// Pipeline layout, uniforms ect.
-	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutInfo.setLayoutCount = 1;
-	pipelineLayoutInfo.pSetLayouts = &m_descriptorSetLayout;
-	pipelineLayoutInfo.pushConstantRangeCount = 0;	  
-	pipelineLayoutInfo.pPushConstantRanges = nullptr;
-
-	if (vkCreatePipelineLayout(m_context->getDevice(), &pipelineLayoutInfo, nullptr, &m_layout) != VK_SUCCESS) {
-		throw std::runtime_error("failed to create pipeline layout!");
-	} else {
-		std::cout << "Pipeline layout created" << '\n';
-	}
-
 	VkPipelineDepthStencilStateCreateInfo depthStencilInfo{};
 	depthStencilInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-	depthStencilInfo.depthTestEnable = VK_TRUE;
-	depthStencilInfo.depthWriteEnable = VK_TRUE;
-	depthStencilInfo.depthCompareOp = VK_COMPARE_OP_LESS;
+	depthStencilInfo.depthTestEnable = desc.depthTest ? VK_TRUE : VK_FALSE;
+	depthStencilInfo.depthWriteEnable = desc.depthWrite ? VK_TRUE : VK_FALSE;
+	depthStencilInfo.depthCompareOp = desc.depthCompare;
 	depthStencilInfo.depthBoundsTestEnable = VK_FALSE;
 	depthStencilInfo.minDepthBounds = 0.0f;		 
 	depthStencilInfo.maxDepthBounds = 1.0f;		
@@ -191,7 +312,7 @@ void Pipeline::createGraphicsPipeline() {
 
 	VkGraphicsPipelineCreateInfo pipelineInfo{};
 	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-	pipelineInfo.stageCount = 2;
+	pipelineInfo.stageCount = desc.isDepthOnly() ? 1 : 2;
 	pipelineInfo.pStages = shaderStages;
 
 	pipelineInfo.pVertexInputState = &vertexInputInfo;
@@ -203,19 +324,61 @@ void Pipeline::createGraphicsPipeline() {
 	pipelineInfo.pColorBlendState = &colorBlending;
 	pipelineInfo.pDynamicState = &dynamicState;
 	pipelineInfo.pDepthStencilState = &depthStencilInfo;
-	pipelineInfo.layout = m_layout;
-	pipelineInfo.renderPass = m_renderPass;
-	pipelineInfo.subpass = 0; 
+	pipelineInfo.layout = layout;
+	pipelineInfo.renderPass = desc.renderPass;
+	pipelineInfo.subpass = desc.subpass;
+
+	// sans render pass, les formats des attachments de vkCmdBeginRendering
+	VkPipelineRenderingCreateInfo renderingInfo{};
+	renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+	renderingInfo.colorAttachmentCount = desc.isDepthOnly() ? 0 : 1;
+	renderingInfo.pColorAttachmentFormats = &desc.colorFormat;
+	renderingInfo.depthAttachmentFormat = desc.depthFormat;
+	if (desc.renderPass == VK_NULL_HANDLE) {
+		pipelineInfo.pNext = &renderingInfo;
+	}
 	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; 
 	pipelineInfo.basePipelineIndex = -1;		 
 
-	if (vkCreateGraphicsPipelines(m_context->getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_pipeline) != VK_SUCCESS)
-	{
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	VkResult result = vkCreateGraphicsPipelines(device, cache, 1, &pipelineInfo, nullptr, &pipeline);
+
+	vkDestroyShaderModule(device, vertShaderModule, nullptr);
+	if (fragShaderModule != VK_NULL_HANDLE) {
+		vkDestroyShaderModule(device, fragShaderModule, nullptr);
+	}
+
+	if (result != VK_SUCCESS) {
 		throw std::runtime_error("failed to create graphics pipeline!");
-	} else {
-		std::cout << "Graphics pipeline created" << '\n';
 	}
+	return pipeline;
+}
 
-	vkDestroyShaderModule(m_context->getDevice(), vertShaderModule, nullptr);
-	vkDestroyShaderModule(m_context->getDevice(), fragShaderModule, nullptr);
-}
\ No newline at end of file
+/// @brief Compute pipeline of one shader, for the passes that are not draws (Hi-Z culling). same threading rules as
+/// create(), the caller owns the layout
+VkPipeline Pipeline::createCompute(VulkanContext* context, const std::string& shader, VkPipelineLayout layout, VkPipelineCache cache) {
+	VkDevice device = context->getDevice();
+
+	auto shaderCode{FileReader::readSPV(shader)};
+	VkShaderModule shaderModule{createShaderModule(device, shaderCode)};
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = shaderModule;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = layout;
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineInfo.basePipelineIndex = -1;
+
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	VkResult result = vkCreateComputePipelines(device, cache, 1, &pipelineInfo, nullptr, &pipeline);
+
+	vkDestroyShaderModule(device, shaderModule, nullptr);
+
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("failed to create compute pipeline!");
+	}
+	return pipeline;
+}
@@ -0,0 +1,94 @@
+#include <VulkanApp/Rendering/PipelineCache.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+void PipelineCache::init(VulkanContext* context, const std::string& path) {
+	m_context = context;
+	m_path = path;
+	m_loadedBytes = 0;
+
+	std::vector<char> data;
+	std::ifstream file(m_path, std::ios::ate | std::ios::binary);
+	if (file.is_open()) {
+		data.resize(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		file.read(data.data(), static_cast<std::streamsize>(data.size()));
+		if (!file) {
+			data.clear();
+		}
+	}
+
+	if (!data.empty() && !isCompatible(data)) {
+		std::cout << "Pipeline cache: " << m_path << " was made for another device or driver, starting cold" << '\n';
+		data.clear();
+	}
+
+	VkPipelineCacheCreateInfo cacheInfo{};
+	cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	cacheInfo.initialDataSize = data.size();
+	cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+	if (vkCreatePipelineCache(m_context->getDevice(), &cacheInfo, nullptr, &m_cache) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create pipeline cache!");
+	}
+	m_loadedBytes = data.size();
+}
+
+/// @brief Checks the VkPipelineCacheHeaderVersionOne at the start of the data against the physical device
+bool PipelineCache::isCompatible(const std::vector<char>& data) const {
+	VkPipelineCacheHeaderVersionOne header{};
+	if (data.size() < sizeof(header))
+		return false;
+	std::memcpy(&header, data.data(), sizeof(header));
+
+	VkPhysicalDeviceProperties properties{};
+	vkGetPhysicalDeviceProperties(m_context->getPhysicalDevice(), &properties);
+
+	return header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE && header.headerSize >= sizeof(header) && header.headerSize <= data.size()
+	       && header.vendorID == properties.vendorID && header.deviceID == properties.deviceID
+	       && std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+bool PipelineCache::save() const {
+	if (m_cache == VK_NULL_HANDLE)
+		return false;
+
+	size_t size = 0;
+	if (vkGetPipelineCacheData(m_context->getDevice(), m_cache, &size, nullptr) != VK_SUCCESS || size == 0)
+		return false;
+	std::vector<char> data(size);
+	if (vkGetPipelineCacheData(m_context->getDevice(), m_cache, &size, data.data()) != VK_SUCCESS)
+		return false;
+
+	// écrit a côté puis renommé : l'ancien fichier reste entier tant que le nouveau n'est pas complet
+	std::string temporary = m_path + ".tmp";
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		file.write(data.data(), static_cast<std::streamsize>(size));
+		// la fin du fichier n'est écrite qu'au close, une erreur de flush (disque plein) ne se voit qu'après
+		file.close();
+		if (file.fail()) {
+			std::cerr << "Pipeline cache: failed to write " << temporary << '\n';
+			std::remove(temporary.c_str());
+			return false;
+		}
+	}
+	// rename remplace le fichier de façon atomique sur posix, sous windows il échoue si le fichier existe
+	if (std::rename(temporary.c_str(), m_path.c_str()) != 0 && (std::remove(m_path.c_str()) != 0 || std::rename(temporary.c_str(), m_path.c_str()) != 0)) {
+		std::cerr << "Pipeline cache: failed to rename " << temporary << " to " << m_path << '\n';
+		return false;
+	}
+	return true;
+}
+
+void PipelineCache::cleanup() noexcept {
+	if (m_cache == VK_NULL_HANDLE)
+		return;
+	save();
+	vkDestroyPipelineCache(m_context->getDevice(), m_cache, nullptr);
+	m_cache = VK_NULL_HANDLE;
+}
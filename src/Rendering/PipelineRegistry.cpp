@@ -0,0 +1,123 @@
+#include <VulkanApp/Rendering/PipelineRegistry.h>
+
+#include <chrono>
+#include <exception>
+#include <iostream>
+
+void PipelineRegistry::init(VulkanContext* context, JobSystem* jobs, VkPipelineLayout layout, VkPipelineCache cache, const PipelineDesc& fallbackDesc,
+			    VkPipeline fallback) {
+	m_context = context;
+	m_jobs = jobs;
+	m_layout = layout;
+	m_cache = cache;
+	m_fallback = fallback;
+
+	Variant& variant = m_variants.emplace_back();
+	variant.desc = fallbackDesc;
+	variant.pipeline.store(fallback, std::memory_order_relaxed);
+	variant.state.store(State::Ready, std::memory_order_release);
+	variant.owned = false;
+	variant.fallbackCompatible = true;
+	m_ids.emplace(fallbackDesc.hash(), 0);
+}
+
+void PipelineRegistry::cleanup() noexcept {
+	if (m_jobs) {
+		try {
+			m_jobs->wait(m_compiling);
+		} catch (...) {
+			// compile() attrape ses erreurs, rien ne doit arriver ici
+		}
+	}
+	for (auto& variant : m_variants) {
+		VkPipeline pipeline = variant.pipeline.load(std::memory_order_acquire);
+		if (variant.owned && pipeline != VK_NULL_HANDLE) {
+			vkDestroyPipeline(m_context->getDevice(), pipeline, nullptr);
+		}
+	}
+	m_variants.clear();
+	m_ids.clear();
+	m_jobs = nullptr;
+}
+
+void PipelineRegistry::setFallback(const PipelineDesc& fallbackDesc, VkPipeline fallback) {
+	Variant& variant = m_variants[0];
+	// l'ancienne description n'a plus de variante, elle sera compilée si on la redemande
+	auto range = m_ids.equal_range(variant.desc.hash());
+	for (auto it = range.first; it != range.second; ++it) {
+		if (it->second == 0) {
+			m_ids.erase(it);
+			break;
+		}
+	}
+	m_fallback = fallback;
+	variant.desc = fallbackDesc;
+	variant.pipeline.store(fallback, std::memory_order_release);
+	m_ids.emplace(fallbackDesc.hash(), 0);
+	// les variantes de l'ancienne base ne sont plus compatibles avec le nouveau fallback
+	for (auto& other : m_variants) {
+		other.fallbackCompatible = isFallbackCompatible(other.desc);
+	}
+	m_generation.fetch_add(1, std::memory_order_acq_rel);
+}
+
+PipelineId PipelineRegistry::request(const PipelineDesc& desc) {
+	uint64_t hash = desc.hash();
+	auto range = m_ids.equal_range(hash);
+	for (auto it = range.first; it != range.second; ++it) {
+		if (m_variants[it->second].desc == desc)
+			return it->second;
+	}
+
+	PipelineId id = static_cast<PipelineId>(m_variants.size());
+	Variant& variant = m_variants.emplace_back();
+	variant.desc = desc;
+	variant.fallbackCompatible = isFallbackCompatible(desc);
+	m_ids.emplace(hash, id);
+
+	m_jobs->submit([this, &variant]() { compile(variant); }, &m_compiling);
+	return id;
+}
+
+/// @brief Runs on a job system thread. a failed variant of the material keeps drawing with the fallback instead of
+/// taking the frame down, the error is reported once
+void PipelineRegistry::compile(Variant& variant) {
+	auto start = std::chrono::high_resolution_clock::now();
+	try {
+		variant.pipeline.store(Pipeline::create(m_context, variant.desc, m_layout, m_cache), std::memory_order_relaxed);
+		variant.state.store(State::Ready, std::memory_order_release);
+		m_generation.fetch_add(1, std::memory_order_acq_rel);
+	} catch (const std::exception& e) {
+		std::cerr << "Pipeline variant " << variant.desc.vertexShader << " / " << variant.desc.fragmentShader << ": " << e.what() << '\n';
+		variant.state.store(State::Failed, std::memory_order_release);
+		return;
+	}
+	std::cout << "Pipeline variant compiled in " << std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count()
+		  << " ms" << '\n';
+}
+
+VkPipeline PipelineRegistry::get(PipelineId id) const {
+	const Variant& variant = m_variants[id];
+	if (variant.state.load(std::memory_order_acquire) != State::Ready)
+		return variant.fallbackCompatible ? m_fallback : VK_NULL_HANDLE;
+	return variant.pipeline.load(std::memory_order_relaxed);
+}
+
+bool PipelineRegistry::isReady(PipelineId id) const {
+	return m_variants[id].state.load(std::memory_order_acquire) == State::Ready;
+}
+
+bool PipelineRegistry::isFailed(PipelineId id) const {
+	return m_variants[id].state.load(std::memory_order_acquire) == State::Failed;
+}
+
+/// @brief The fallback draws in place of a variant only with the same shaders, inputs and attachments : a depth only
+/// or indirect variant bound as the material would not even match its render pass
+bool PipelineRegistry::isFallbackCompatible(const PipelineDesc& desc) const {
+	const PipelineDesc& fallback = m_variants[0].desc;
+	return desc.vertexShader == fallback.vertexShader && desc.fragmentShader == fallback.fragmentShader &&
+	       desc.specializationCount == fallback.specializationCount && desc.specializationIds == fallback.specializationIds &&
+	       desc.specializationValues == fallback.specializationValues && desc.vertexLayout == fallback.vertexLayout &&
+	       desc.renderPass == fallback.renderPass && desc.subpass == fallback.subpass && desc.colorFormat == fallback.colorFormat &&
+	       desc.depthFormat == fallback.depthFormat && desc.samples == fallback.samples;
+}
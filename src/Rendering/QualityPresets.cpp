@@ -0,0 +1,52 @@
+#include <VulkanApp/Rendering/QualityPresets.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace {
+
+// dans l'ordre de QualityPreset. ultra s'arrête a 8x : au dela le coût en bande passante ne se voit plus a l'écran
+constexpr std::array<QualitySettings, 4> g_quality_settings{{
+    {VK_SAMPLE_COUNT_1_BIT, 0.0f, 1.0f, 0.5f},
+    {VK_SAMPLE_COUNT_2_BIT, 0.0f, 4.0f, 0.75f},
+    {VK_SAMPLE_COUNT_4_BIT, 0.2f, 8.0f, 1.0f},
+    {VK_SAMPLE_COUNT_8_BIT, 0.5f, 16.0f, 1.0f},
+}};
+
+constexpr std::array<const char*, 4> g_quality_names{"low", "medium", "high", "ultra"};
+
+} // namespace
+
+QualitySettings getQualitySettings(QualityPreset preset) {
+	return g_quality_settings[static_cast<size_t>(preset)];
+}
+
+/// @brief Sample shading is kept with the count it was asked for: shading every sample of a 1x target is the same as
+/// not asking
+QualitySettings resolveQualitySettings(const VulkanContext* context, QualityPreset preset, bool upscale) {
+	QualitySettings settings = getQualitySettings(preset);
+	settings.msaaSamples = context->getMaxMsaa(settings.msaaSamples);
+	if (settings.msaaSamples == VK_SAMPLE_COUNT_1_BIT) {
+		settings.minSampleShading = 0.0f;
+	}
+	settings.maxAnisotropy = std::min(settings.maxAnisotropy, context->getMaxAnisotropy());
+	if (!upscale) {
+		settings.renderScale = 1.0f;
+	}
+	return settings;
+}
+
+const char* getQualityName(QualityPreset preset) {
+	return g_quality_names[static_cast<size_t>(preset)];
+}
+
+bool parseQualityPreset(const char* name, QualityPreset& preset) {
+	for (size_t i = 0; i < g_quality_names.size(); ++i) {
+		if (std::strcmp(name, g_quality_names[i]) == 0) {
+			preset = static_cast<QualityPreset>(i);
+			return true;
+		}
+	}
+	return false;
+}
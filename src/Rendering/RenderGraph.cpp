@@ -0,0 +1,587 @@
+#include <VulkanApp/Rendering/RenderGraph.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <stdexcept>
+
+namespace {
+
+// seules les écritures ont besoin d'être rendues disponibles par une barrier
+constexpr VkAccessFlags g_write_accesses{VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+					 VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT |
+					 VK_ACCESS_MEMORY_WRITE_BIT};
+
+VkImageUsageFlags getImageUsage(ResourceAccess access) {
+	switch (access) {
+	case ResourceAccess::ColorAttachmentWrite:
+		return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	case ResourceAccess::DepthAttachmentWrite:
+	case ResourceAccess::DepthAttachmentRead:
+		return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+	case ResourceAccess::SampledFragment:
+	case ResourceAccess::SampledCompute:
+		return VK_IMAGE_USAGE_SAMPLED_BIT;
+	case ResourceAccess::StorageReadCompute:
+	case ResourceAccess::StorageWriteCompute:
+		return VK_IMAGE_USAGE_STORAGE_BIT;
+	case ResourceAccess::TransferSrc:
+		return VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	case ResourceAccess::TransferDst:
+		return VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	default:
+		return 0;
+	}
+}
+
+VkBufferUsageFlags getBufferUsage(ResourceAccess access) {
+	switch (access) {
+	case ResourceAccess::StorageReadCompute:
+	case ResourceAccess::StorageWriteCompute:
+		return VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+	case ResourceAccess::TransferSrc:
+		return VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	case ResourceAccess::TransferDst:
+		return VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	case ResourceAccess::VertexBuffer:
+		return VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+	case ResourceAccess::IndexBuffer:
+		return VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+	case ResourceAccess::UniformBuffer:
+		return VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+	case ResourceAccess::IndirectBuffer:
+		return VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+	case ResourceAccess::ConditionalRendering:
+		return VK_BUFFER_USAGE_CONDITIONAL_RENDERING_BIT_EXT;
+	default:
+		return 0;
+	}
+}
+
+VkImageAspectFlags getFormatAspect(VkFormat format) {
+	switch (format) {
+	case VK_FORMAT_D16_UNORM:
+	case VK_FORMAT_D32_SFLOAT:
+	case VK_FORMAT_X8_D24_UNORM_PACK32:
+		return VK_IMAGE_ASPECT_DEPTH_BIT;
+	case VK_FORMAT_D16_UNORM_S8_UINT:
+	case VK_FORMAT_D24_UNORM_S8_UINT:
+	case VK_FORMAT_D32_SFLOAT_S8_UINT:
+		return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+	default:
+		return VK_IMAGE_ASPECT_COLOR_BIT;
+	}
+}
+
+double toMiB(VkDeviceSize bytes) {
+	return static_cast<double>(bytes) / (1024.0 * 1024.0);
+}
+
+} // namespace
+
+void RenderGraph::init(VulkanContext* context, MemoryAllocator* allocator, DeletionQueue* deletionQueue) {
+	m_context = context;
+	m_allocator = allocator;
+	m_deletionQueue = deletionQueue;
+}
+
+void RenderGraph::cleanup() noexcept {
+	destroyTransients(false);
+	m_resources.clear();
+	m_passes.clear();
+}
+
+void RenderGraph::reset() {
+	destroyTransients(true);
+	m_resources.clear();
+	m_passes.clear();
+	m_barriers.clear();
+	m_imageBarriers.clear();
+	m_imageBarrierResources.clear();
+	m_epilogue = BarrierBatch{};
+}
+
+RenderGraphResource RenderGraph::createImage(const std::string& name, const RenderGraphImageDesc& desc) {
+	Resource resource{};
+	resource.name = name;
+	resource.desc = desc;
+	resource.aspect = getFormatAspect(desc.format);
+	resource.imageUsage = desc.usage;
+	m_resources.push_back(resource);
+	return static_cast<RenderGraphResource>(m_resources.size() - 1);
+}
+
+RenderGraphResource RenderGraph::createBuffer(const std::string& name, VkDeviceSize size) {
+	Resource resource{};
+	resource.name = name;
+	resource.isImage = false;
+	resource.size = size;
+	m_resources.push_back(resource);
+	return static_cast<RenderGraphResource>(m_resources.size() - 1);
+}
+
+RenderGraphResource RenderGraph::importImage(const std::string& name, VkImageAspectFlags aspect, ResourceAccess initial, ResourceAccess final) {
+	Resource resource{};
+	resource.name = name;
+	resource.imported = true;
+	resource.aspect = aspect;
+	resource.initial = initial;
+	resource.final = final;
+	m_resources.push_back(resource);
+	return static_cast<RenderGraphResource>(m_resources.size() - 1);
+}
+
+RenderGraphResource RenderGraph::importBuffer(const std::string& name, ResourceAccess initial, ResourceAccess final) {
+	Resource resource{};
+	resource.name = name;
+	resource.isImage = false;
+	resource.imported = true;
+	resource.initial = initial;
+	resource.final = final;
+	m_resources.push_back(resource);
+	return static_cast<RenderGraphResource>(m_resources.size() - 1);
+}
+
+uint32_t RenderGraph::addPass(const std::string& name, PassFunction execute) {
+	Pass pass{};
+	pass.name = name;
+	pass.execute = std::move(execute);
+	m_passes.push_back(std::move(pass));
+	return static_cast<uint32_t>(m_passes.size() - 1);
+}
+
+/// @brief A resource has one access per pass, reading and writing it in the same pass must use the same access
+RenderGraph::Use& RenderGraph::findUse(uint32_t pass, RenderGraphResource resource, ResourceAccess access) {
+	auto& uses = m_passes[pass].uses;
+	auto it = std::find_if(uses.begin(), uses.end(), [resource](const Use& use) { return use.resource == resource; });
+	if (it != uses.end()) {
+		if (it->access != access) {
+			throw std::runtime_error("render graph pass " + m_passes[pass].name + " uses " + m_resources[resource].name + " with two accesses!");
+		}
+		return *it;
+	}
+	uses.push_back({resource, access, false, false});
+
+	Resource& used = m_resources[resource];
+	if (used.isImage) {
+		used.imageUsage |= getImageUsage(access);
+	} else {
+		used.bufferUsage |= getBufferUsage(access);
+	}
+	return uses.back();
+}
+
+/// @brief A read with a write access loads and modifies the resource, it counts as a write for culling
+void RenderGraph::read(uint32_t pass, RenderGraphResource resource, ResourceAccess access) {
+	Use& use = findUse(pass, resource, access);
+	use.read = true;
+	use.write = use.write || getAccessInfo(access).write;
+}
+
+void RenderGraph::write(uint32_t pass, RenderGraphResource resource, ResourceAccess access) {
+	findUse(pass, resource, access).write = true;
+}
+
+void RenderGraph::setSideEffects(uint32_t pass) {
+	m_passes[pass].sideEffects = true;
+}
+
+void RenderGraph::compile() {
+	cullPasses();
+	computeLifetimes();
+	createTransients();
+	allocateSlots();
+
+	// l'état final de chaque ressource sert de point de départ a la frame suivante et aux ressources aliasées
+	std::vector<State> finalStates(m_resources.size());
+	buildBarriers(finalStates, false);
+	buildBarriers(finalStates, true);
+}
+
+/// @brief Walks the passes backwards, a pass is kept if it writes an imported resource, has side effects
+/// or writes a resource that a kept pass reads
+void RenderGraph::cullPasses() {
+	std::vector<bool> needed(m_resources.size(), false);
+
+	for (size_t p = m_passes.size(); p-- > 0;) {
+		Pass& pass = m_passes[p];
+		bool live = pass.sideEffects;
+		for (const Use& use : pass.uses) {
+			if (use.write && (m_resources[use.resource].imported || needed[use.resource])) {
+				live = true;
+			}
+		}
+
+		pass.culled = !live;
+		if (!live)
+			continue;
+		for (const Use& use : pass.uses) {
+			if (use.read) {
+				needed[use.resource] = true;
+			}
+		}
+	}
+}
+
+void RenderGraph::computeLifetimes() {
+	for (uint32_t p = 0; p < m_passes.size(); ++p) {
+		if (m_passes[p].culled)
+			continue;
+		for (const Use& use : m_passes[p].uses) {
+			Resource& resource = m_resources[use.resource];
+			resource.firstPass = std::min(resource.firstPass, p);
+			resource.lastPass = std::max(resource.lastPass, p);
+		}
+	}
+}
+
+/// @brief Creates the transient images and buffers used by a kept pass, memory is bound by allocateSlots()
+void RenderGraph::createTransients() {
+	for (auto& resource : m_resources) {
+		if (resource.imported || resource.firstPass == std::numeric_limits<uint32_t>::max())
+			continue;
+
+		if (resource.isImage) {
+			VkImageCreateInfo imageInfo{};
+			imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+			imageInfo.imageType = VK_IMAGE_TYPE_2D;
+			imageInfo.extent = {resource.desc.extent.width, resource.desc.extent.height, 1};
+			imageInfo.mipLevels = 1;
+			imageInfo.arrayLayers = 1;
+			imageInfo.format = resource.desc.format;
+			imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+			imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			imageInfo.usage = resource.imageUsage;
+			imageInfo.samples = resource.desc.samples;
+			imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+			if (vkCreateImage(m_context->getDevice(), &imageInfo, nullptr, &resource.image) != VK_SUCCESS) {
+				throw std::runtime_error("failed to create render graph image!");
+			}
+			vkGetImageMemoryRequirements(m_context->getDevice(), resource.image, &resource.requirements);
+		} else {
+			VkBufferCreateInfo bufferInfo{};
+			bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+			bufferInfo.size = resource.size;
+			bufferInfo.usage = resource.bufferUsage;
+			bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+			if (vkCreateBuffer(m_context->getDevice(), &bufferInfo, nullptr, &resource.buffer) != VK_SUCCESS) {
+				throw std::runtime_error("failed to create render graph buffer!");
+			}
+			vkGetBufferMemoryRequirements(m_context->getDevice(), resource.buffer, &resource.requirements);
+		}
+	}
+}
+
+/// @brief Greedy interval placement: by first use, a resource takes the memory of one that is no longer used.
+/// buffers and images never share a slot, like the blocks of MemoryAllocator
+void RenderGraph::allocateSlots() {
+	std::vector<RenderGraphResource> order;
+	for (RenderGraphResource r = 0; r < m_resources.size(); ++r) {
+		if (m_resources[r].image != VK_NULL_HANDLE || m_resources[r].buffer != VK_NULL_HANDLE) {
+			if (!m_resources[r].imported) {
+				order.push_back(r);
+			}
+		}
+	}
+	std::stable_sort(order.begin(), order.end(), [this](RenderGraphResource a, RenderGraphResource b) {
+		return m_resources[a].firstPass < m_resources[b].firstPass;
+	});
+
+	m_slots.clear();
+	for (RenderGraphResource r : order) {
+		Resource& resource = m_resources[r];
+		const VkMemoryRequirements& requirements = resource.requirements;
+		bool linear = !resource.isImage;
+
+		auto slot = std::find_if(m_slots.begin(), m_slots.end(), [&](const MemorySlot& candidate) {
+			return candidate.linear == linear && candidate.lastPass < resource.firstPass &&
+			       (candidate.requirements.memoryTypeBits & requirements.memoryTypeBits) != 0;
+		});
+		if (slot == m_slots.end()) {
+			MemorySlot created{};
+			created.requirements = requirements;
+			created.linear = linear;
+			m_slots.push_back(created);
+			slot = m_slots.end() - 1;
+		} else {
+			slot->requirements.size = std::max(slot->requirements.size, requirements.size);
+			slot->requirements.alignment = std::max(slot->requirements.alignment, requirements.alignment);
+			slot->requirements.memoryTypeBits &= requirements.memoryTypeBits;
+		}
+		slot->lastPass = resource.lastPass;
+		slot->resources.push_back(r);
+		resource.slot = static_cast<uint32_t>(slot - m_slots.begin());
+	}
+
+	for (auto& slot : m_slots) {
+		slot.allocation = m_allocator->allocate(slot.requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, slot.linear);
+
+		// toutes les ressources du slot au même endroit, elles ne sont jamais vivantes en même temps
+		for (RenderGraphResource r : slot.resources) {
+			Resource& resource = m_resources[r];
+			if (resource.isImage) {
+				vkBindImageMemory(m_context->getDevice(), resource.image, slot.allocation.memory, slot.allocation.offset);
+
+				VkImageViewCreateInfo viewInfo{};
+				viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+				viewInfo.image = resource.image;
+				viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+				viewInfo.format = resource.desc.format;
+				// une vue de depth n'a que l'aspect depth, les barriers couvrent aussi le stencil
+				viewInfo.subresourceRange.aspectMask = (resource.aspect & VK_IMAGE_ASPECT_DEPTH_BIT) ? VK_IMAGE_ASPECT_DEPTH_BIT : resource.aspect;
+				viewInfo.subresourceRange.baseMipLevel = 0;
+				viewInfo.subresourceRange.levelCount = 1;
+				viewInfo.subresourceRange.baseArrayLayer = 0;
+				viewInfo.subresourceRange.layerCount = 1;
+
+				if (vkCreateImageView(m_context->getDevice(), &viewInfo, nullptr, &resource.view) != VK_SUCCESS) {
+					throw std::runtime_error("failed to create render graph image view!");
+				}
+			} else {
+				vkBindBufferMemory(m_context->getDevice(), resource.buffer, slot.allocation.memory, slot.allocation.offset);
+			}
+		}
+	}
+}
+
+/// @brief Simulates the execution, a barrier is needed after a write, before a write (execution only) and on layout
+/// changes. consecutive reads in the same layout share the state and need nothing. the first use of a transient waits
+/// for the previous resource of its slot, which is its own last use of the previous frame when it has the slot alone
+void RenderGraph::buildBarriers(std::vector<State>& finalStates, bool emit) {
+	std::vector<State> states(m_resources.size());
+	for (RenderGraphResource r = 0; r < m_resources.size(); ++r) {
+		if (m_resources[r].imported) {
+			const AccessInfo& initial = getAccessInfo(m_resources[r].initial);
+			states[r] = {initial.stages, initial.accesses, initial.layout, initial.write};
+		}
+	}
+
+	m_barriers.clear();
+	m_imageBarriers.clear();
+	m_imageBarrierResources.clear();
+
+	auto transition = [&](BarrierBatch& batch, RenderGraphResource r, ResourceAccess access, bool firstUse) {
+		const Resource& resource = m_resources[r];
+		const AccessInfo& info = getAccessInfo(access);
+		State& state = states[r];
+
+		if (firstUse) {
+			const MemorySlot& slot = m_slots[resource.slot];
+			auto it = std::find(slot.resources.begin(), slot.resources.end(), r);
+			size_t position = static_cast<size_t>(it - slot.resources.begin());
+			RenderGraphResource previous = slot.resources[(position + slot.resources.size() - 1) % slot.resources.size()];
+			if (emit && (resource.isImage || finalStates[previous].stages != 0)) {
+				addBarrier(batch, r, finalStates[previous], info, true);
+			}
+		} else {
+			bool layoutChange = resource.isImage && state.layout != info.layout;
+			if (!layoutChange && !state.write && (!info.write || state.stages == 0)) {
+				// lectures successives, ou rien avant : on ajoute les stages de ce lecteur a ceux a attendre
+				state.stages |= info.stages;
+				state.accesses |= info.accesses;
+				state.write = state.write || info.write;
+				return;
+			}
+			if (emit) {
+				addBarrier(batch, r, state, info, false);
+			}
+		}
+		state = {info.stages, info.accesses, info.layout, info.write};
+	};
+
+	for (uint32_t p = 0; p < m_passes.size(); ++p) {
+		Pass& pass = m_passes[p];
+		pass.barriers = BarrierBatch{};
+		pass.barriers.firstBarrier = static_cast<uint32_t>(m_barriers.size());
+		pass.barriers.firstImageBarrier = static_cast<uint32_t>(m_imageBarriers.size());
+		if (pass.culled)
+			continue;
+
+		for (const Use& use : pass.uses) {
+			const Resource& resource = m_resources[use.resource];
+			transition(pass.barriers, use.resource, use.access, !resource.imported && resource.firstPass == p);
+		}
+	}
+
+	m_epilogue = BarrierBatch{};
+	m_epilogue.firstBarrier = static_cast<uint32_t>(m_barriers.size());
+	m_epilogue.firstImageBarrier = static_cast<uint32_t>(m_imageBarriers.size());
+	for (RenderGraphResource r = 0; r < m_resources.size(); ++r) {
+		if (m_resources[r].imported && m_resources[r].final != ResourceAccess::None) {
+			transition(m_epilogue, r, m_resources[r].final, false);
+		}
+	}
+
+	finalStates = states;
+}
+
+void RenderGraph::addBarrier(BarrierBatch& batch, RenderGraphResource r, const State& from, const AccessInfo& to, bool discard) {
+	const Resource& resource = m_resources[r];
+
+	Barrier barrier{};
+	barrier.resource = r;
+	barrier.srcStages = from.stages; // 0 = VK_PIPELINE_STAGE_2_NONE
+	barrier.dstStages = to.stages;
+	barrier.srcAccesses = from.write ? (from.accesses & g_write_accesses) : 0;
+	barrier.dstAccesses = to.accesses;
+	barrier.oldLayout = discard ? VK_IMAGE_LAYOUT_UNDEFINED : from.layout;
+	barrier.newLayout = resource.isImage ? to.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+	// sans changement de layout une barrier globale suffit, elle est moins chère qu'une barrier par image
+	barrier.image = resource.isImage && (discard || barrier.oldLayout != barrier.newLayout);
+	m_barriers.push_back(barrier);
+	++batch.barrierCount;
+
+	if (!barrier.image) {
+		batch.hasMemoryBarrier = true;
+		batch.memorySrcStages |= barrier.srcStages;
+		batch.memoryDstStages |= barrier.dstStages;
+		batch.memorySrcAccesses |= barrier.srcAccesses;
+		batch.memoryDstAccesses |= barrier.dstAccesses;
+		return;
+	}
+
+	// avec synchronization2 chaque image garde ses propres stages au lieu de l'union du lot
+	VkImageMemoryBarrier2 imageBarrier{};
+	imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+	imageBarrier.srcStageMask = barrier.srcStages;
+	imageBarrier.dstStageMask = barrier.dstStages;
+	imageBarrier.srcAccessMask = barrier.srcAccesses;
+	imageBarrier.dstAccessMask = barrier.dstAccesses;
+	imageBarrier.oldLayout = barrier.oldLayout;
+	imageBarrier.newLayout = barrier.newLayout;
+	imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	imageBarrier.image = resource.image;
+	imageBarrier.subresourceRange.aspectMask = resource.aspect;
+	imageBarrier.subresourceRange.baseMipLevel = 0;
+	imageBarrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+	imageBarrier.subresourceRange.baseArrayLayer = 0;
+	imageBarrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+	m_imageBarriers.push_back(imageBarrier);
+	m_imageBarrierResources.push_back(r);
+	++batch.imageBarrierCount;
+}
+
+/// @brief Records the compiled barriers and passes, nothing is allocated
+void RenderGraph::execute(VkCommandBuffer commandBuffer) {
+	for (const auto& pass : m_passes) {
+		if (pass.culled)
+			continue;
+		recordBarriers(commandBuffer, pass.barriers);
+		pass.execute(commandBuffer);
+	}
+	recordBarriers(commandBuffer, m_epilogue);
+}
+
+void RenderGraph::recordBarriers(VkCommandBuffer commandBuffer, const BarrierBatch& batch) {
+	if (batch.barrierCount == 0)
+		return;
+
+	// les images importées ont pu changer depuis compile()
+	for (uint32_t i = batch.firstImageBarrier; i < batch.firstImageBarrier + batch.imageBarrierCount; ++i) {
+		m_imageBarriers[i].image = m_resources[m_imageBarrierResources[i]].image;
+	}
+
+	VkMemoryBarrier2 memoryBarrier{};
+	memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+	memoryBarrier.srcStageMask = batch.memorySrcStages;
+	memoryBarrier.dstStageMask = batch.memoryDstStages;
+	memoryBarrier.srcAccessMask = batch.memorySrcAccesses;
+	memoryBarrier.dstAccessMask = batch.memoryDstAccesses;
+
+	VkDependencyInfo dependencyInfo{};
+	dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	dependencyInfo.memoryBarrierCount = batch.hasMemoryBarrier ? 1 : 0;
+	dependencyInfo.pMemoryBarriers = &memoryBarrier;
+	dependencyInfo.imageMemoryBarrierCount = batch.imageBarrierCount;
+	dependencyInfo.pImageMemoryBarriers = m_imageBarriers.data() + batch.firstImageBarrier;
+
+	vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+}
+
+/// @param deferred true while frames in flight may still use the resources, they go through the deletion queue
+void RenderGraph::destroyTransients(bool deferred) noexcept {
+	for (auto& slot : m_slots) {
+		for (size_t i = 0; i < slot.resources.size(); ++i) {
+			Resource& resource = m_resources[slot.resources[i]];
+			// la mémoire du slot part avec sa premiere ressource
+			Allocation allocation = i == 0 ? slot.allocation : Allocation{};
+			if (deferred) {
+				if (resource.isImage) {
+					m_deletionQueue->push(resource.view);
+					m_deletionQueue->push(resource.image, allocation);
+				} else {
+					m_deletionQueue->push(resource.buffer, allocation);
+				}
+			} else {
+				vkDestroyImageView(m_context->getDevice(), resource.view, nullptr);
+				vkDestroyImage(m_context->getDevice(), resource.image, nullptr);
+				vkDestroyBuffer(m_context->getDevice(), resource.buffer, nullptr);
+				m_allocator->free(allocation);
+			}
+			resource.view = VK_NULL_HANDLE;
+			resource.image = VK_NULL_HANDLE;
+			resource.buffer = VK_NULL_HANDLE;
+		}
+	}
+	m_slots.clear();
+}
+
+void RenderGraph::dump(std::ostream& out) const {
+	uint32_t culledCount = static_cast<uint32_t>(std::count_if(m_passes.begin(), m_passes.end(), [](const Pass& pass) { return pass.culled; }));
+	VkDeviceSize aliased = 0;
+	for (const auto& slot : m_slots) {
+		aliased += slot.requirements.size;
+	}
+	VkDeviceSize separate = 0;
+	for (const auto& resource : m_resources) {
+		if (!resource.imported && resource.slot != std::numeric_limits<uint32_t>::max()) {
+			separate += resource.requirements.size;
+		}
+	}
+
+	out << std::fixed << std::setprecision(2);
+	out << "Render graph: " << m_passes.size() - culledCount << " passes (" << culledCount << " culled), "
+	    << m_resources.size() << " resources, transient memory " << toMiB(aliased) << " MiB in " << m_slots.size()
+	    << " slots (" << toMiB(separate) << " MiB without aliasing)" << '\n';
+
+	auto printBarriers = [&](const BarrierBatch& batch) {
+		for (uint32_t i = batch.firstBarrier; i < batch.firstBarrier + batch.barrierCount; ++i) {
+			const Barrier& barrier = m_barriers[i];
+			out << "    barrier " << m_resources[barrier.resource].name << ": ";
+			if (barrier.image) {
+				out << getLayoutName(barrier.oldLayout) << " -> " << getLayoutName(barrier.newLayout);
+			} else {
+				out << "memory";
+			}
+			out << std::hex << ", stages 0x" << barrier.srcStages << " -> 0x" << barrier.dstStages
+			    << ", access 0x" << barrier.srcAccesses << " -> 0x" << barrier.dstAccesses << std::dec << '\n';
+		}
+	};
+
+	for (uint32_t p = 0; p < m_passes.size(); ++p) {
+		const Pass& pass = m_passes[p];
+		out << "  [" << p << "] " << pass.name << (pass.culled ? " (culled)" : "") << '\n';
+		if (pass.culled)
+			continue;
+		printBarriers(pass.barriers);
+		for (const Use& use : pass.uses) {
+			out << "    " << (use.read && use.write ? "read/write " : use.write ? "write " : "read ")
+			    << m_resources[use.resource].name << " (" << getAccessName(use.access) << ")" << '\n';
+		}
+	}
+	out << "  end" << '\n';
+	printBarriers(m_epilogue);
+
+	for (uint32_t s = 0; s < m_slots.size(); ++s) {
+		const MemorySlot& slot = m_slots[s];
+		out << "  slot " << s << ": " << toMiB(slot.requirements.size) << " MiB";
+		for (RenderGraphResource r : slot.resources) {
+			const Resource& resource = m_resources[r];
+			out << ", " << resource.name << " [" << resource.firstPass << "-" << resource.lastPass << "]";
+		}
+		out << '\n';
+	}
+	out << std::defaultfloat;
+}
@@ -12,21 +12,44 @@
 void RenderPass::init(VulkanContext* context, SwapChain* swapChain){
 	m_context = context;
 	m_swapchain = swapChain;
-	createRenderPass();
+	setSamples(m_context->getMsaaSamples());
 }
 
 void RenderPass::cleanup() noexcept {
-	if (m_context && m_context->getDevice() != VK_NULL_HANDLE && m_renderPass != VK_NULL_HANDLE) {
-		vkDestroyRenderPass(m_context->getDevice(), m_renderPass, nullptr);
-		m_renderPass = VK_NULL_HANDLE;
+	if (m_context && m_context->getDevice() != VK_NULL_HANDLE) {
+		for (Passes& passes : m_passes) {
+			if (passes.main == VK_NULL_HANDLE)
+				continue;
+			vkDestroyRenderPass(m_context->getDevice(), passes.main, nullptr);
+			vkDestroyRenderPass(m_context->getDevice(), passes.afterPrepass, nullptr);
+			vkDestroyRenderPass(m_context->getDevice(), passes.depthPrepass, nullptr);
+			vkDestroyRenderPass(m_context->getDevice(), passes.depthPrepassLoad, nullptr);
+			passes = {};
+		}
+	}
+	m_current = &m_passes[0];
+}
+
+void RenderPass::setSamples(VkSampleCountFlagBits samples) {
+	size_t index = 0;
+	while ((1u << index) < static_cast<uint32_t>(samples)) {
+		++index;
 	}
+	m_current = &m_passes[index];
+	if (m_current->main != VK_NULL_HANDLE)
+		return;
+
+	m_current->main = createRenderPass(samples, false);
+	m_current->afterPrepass = createRenderPass(samples, true);
+	m_current->depthPrepass = createDepthPrepass(samples, false);
+	m_current->depthPrepassLoad = createDepthPrepass(samples, true);
 }
 
-VkFormat RenderPass::findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features) {
+VkFormat RenderPass::findSupportedFormat(VulkanContext* context, const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features) {
 
 	for (VkFormat format : candidates) {
 		VkFormatProperties props;
-		vkGetPhysicalDeviceFormatProperties(m_context->getPhysicalDevice(), format, &props);
+		vkGetPhysicalDeviceFormatProperties(context->getPhysicalDevice(), format, &props);
 
 		if (tiling == VK_IMAGE_TILING_OPTIMAL && (props.linearTilingFeatures & features) == features) {
 			return format;
@@ -38,8 +61,9 @@ VkFormat RenderPass::findSupportedFormat(const std::vector<VkFormat>& candidates
 	throw std::runtime_error("failed to find supported format");
 }
 
-VkFormat RenderPass::findDepthFormat() {
+VkFormat RenderPass::findDepthFormat(VulkanContext* context) {
 	return findSupportedFormat(
+	    context,
 	    {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
 	    VK_IMAGE_TILING_OPTIMAL,
 	    VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
@@ -53,23 +77,27 @@ VkFormat RenderPass::findDepthFormat() {
  *   - `colorAttachment`: multisampled color image (cleared at start, stored afterwards).
  *   - `depthAttachment`: depth/stencil buffer (depth test & write enabled).
  *   - `colorAttachmentResolve`: single-sample resolved image for presentation.
- * - Configures attachment references (color = 0, depth = 1, resolve = 2).
+ * - Configures attachment references (color = 0, depth = 1, resolve = 2). With 1x there is nothing to resolve: the
+ *   color attachment is the single-sample image and the resolve attachment is left out.
  * - Creates a single subpass that binds the color, depth and resolve attachments.
- * - Adds a subpass dependency (external -> 0) to synchronize color and depth writes
- *   before the subpass.
+ * - No layout transition nor subpass dependency: the attachments enter and leave the pass in
+ *   their attachment layouts, the RenderGraph records the barriers around it (including the
+ *   transition of the swapchain image to PRESENT_SRC).
  * - The `VkRenderPass` is then created for the swapchain format and the MSAA sample
- *   count provided by the `VulkanContext`.
+ *   count of the quality preset.
+ * - `afterPrepass` loads the depth written by the prepass in the read-only layout instead of clearing it, load ops
+ *   and layouts do not count for compatibility so both passes share pipelines and framebuffers.
  */
-void RenderPass::createRenderPass() {
+VkRenderPass RenderPass::createRenderPass(VkSampleCountFlagBits samples, bool afterPrepass) {
 	VkAttachmentDescription colorAttachment{};
 	colorAttachment.format = m_swapchain->getImageFormat(); 
-	colorAttachment.samples = m_context->getMsaaSamples();	
+	colorAttachment.samples = samples;	
 
 	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR; // clears framebuffer before write
 	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE; // stored then read
 	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE; 
 	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL; // le render graph s'occupe des transitions
 	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
 	VkAttachmentReference colorAttachmentRef{};
@@ -77,18 +105,20 @@ void RenderPass::createRenderPass() {
 	colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
 	VkAttachmentDescription depthAttachment{};
-	depthAttachment.format = findDepthFormat();
-	depthAttachment.samples = m_context->getMsaaSamples();
-	depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	depthAttachment.format = findDepthFormat(m_context);
+	depthAttachment.samples = samples;
+	depthAttachment.loadOp = afterPrepass ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
 	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 	depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	// apres la prepass la profondeur n'est plus que lue (test EQUAL), le layout read only le dit au driver
+	VkImageLayout depthLayout = afterPrepass ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	depthAttachment.initialLayout = depthLayout;
+	depthAttachment.finalLayout = depthLayout;
 
 	VkAttachmentReference depthAttachmentRef{};
 	depthAttachmentRef.attachment = 1;
-	depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	depthAttachmentRef.layout = depthLayout;
 
 	VkAttachmentDescription colorAttachmentResolve{};
 	colorAttachmentResolve.format = m_swapchain->getImageFormat();
@@ -97,8 +127,8 @@ void RenderPass::createRenderPass() {
 	colorAttachmentResolve.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 	colorAttachmentResolve.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	colorAttachmentResolve.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	colorAttachmentResolve.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	colorAttachmentResolve.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	colorAttachmentResolve.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	colorAttachmentResolve.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL; // PRESENT_SRC par le render graph
 
 	VkAttachmentReference colorAttachmentResolveRef{};
 	colorAttachmentResolveRef.attachment = 2;
@@ -110,31 +140,61 @@ void RenderPass::createRenderPass() {
 	subpass.colorAttachmentCount = 1;
 	subpass.pColorAttachments = &colorAttachmentRef;
 	subpass.pDepthStencilAttachment = &depthAttachmentRef;
-	subpass.pResolveAttachments = &colorAttachmentResolveRef;
+	subpass.pResolveAttachments = samples == VK_SAMPLE_COUNT_1_BIT ? nullptr : &colorAttachmentResolveRef;
 	// subpass.pPreserveAttachments to keep data
 
-	VkSubpassDependency dependency{};
-	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-	dependency.dstSubpass = 0;		
-	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT; // wait for swapchain read to write and depth buffer test
-	dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-
 	std::array<VkAttachmentDescription, 3> attachments = {colorAttachment, depthAttachment, colorAttachmentResolve};
 
 	VkRenderPassCreateInfo renderPassInfo{};
 	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+	renderPassInfo.attachmentCount = samples == VK_SAMPLE_COUNT_1_BIT ? 2 : static_cast<uint32_t>(attachments.size());
 	renderPassInfo.pAttachments = attachments.data();
 	renderPassInfo.subpassCount = 1;
 	renderPassInfo.pSubpasses = &subpass;
-	renderPassInfo.dependencyCount = 1;
-	renderPassInfo.pDependencies = &dependency;
+	renderPassInfo.dependencyCount = 0; // barriers du render graph, enregistrées hors de la render pass
 
-	if (vkCreateRenderPass(m_context->getDevice(), &renderPassInfo, nullptr, &m_renderPass) != VK_SUCCESS) {
+	VkRenderPass renderPass;
+	if (vkCreateRenderPass(m_context->getDevice(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create render pass!");
 	} else {
 		std::cout << "Render pass created" << '\n';
 	}
+	return renderPass;
+}
+
+/// @brief Single depth attachment with the sample count of the main pass, cleared then stored for it. like the main
+/// pass it leaves the layouts to the render graph. `load` keeps what a previous depth pass wrote instead
+VkRenderPass RenderPass::createDepthPrepass(VkSampleCountFlagBits samples, bool load) {
+	VkAttachmentDescription depthAttachment{};
+	depthAttachment.format = findDepthFormat(m_context);
+	depthAttachment.samples = samples;
+	depthAttachment.loadOp = load ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE; // lue par la passe principale
+	depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentReference depthAttachmentRef{};
+	depthAttachmentRef.attachment = 0;
+	depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	VkSubpassDescription subpass{};
+	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.colorAttachmentCount = 0;
+	subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+	VkRenderPassCreateInfo renderPassInfo{};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassInfo.attachmentCount = 1;
+	renderPassInfo.pAttachments = &depthAttachment;
+	renderPassInfo.subpassCount = 1;
+	renderPassInfo.pSubpasses = &subpass;
+	renderPassInfo.dependencyCount = 0;
+
+	VkRenderPass renderPass;
+	if (vkCreateRenderPass(m_context->getDevice(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create depth prepass!");
+	}
+	return renderPass;
 }
\ No newline at end of file
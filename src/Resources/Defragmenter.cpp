@@ -0,0 +1,265 @@
+#include <VulkanApp/Resources/Defragmenter.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+
+void Defragmenter::init(VulkanContext* context, MemoryAllocator* allocator, DeletionQueue* deletionQueue) {
+	m_context = context;
+	m_allocator = allocator;
+	m_deletionQueue = deletionQueue;
+
+	// assez pour un step ordinaire sans allouer pendant drawFrame
+	m_before.reserve(2, 0);
+	m_after.reserve(g_defrag_reserved_barriers, g_defrag_reserved_barriers);
+}
+
+/// @brief Forgets the registered resources, the retired ones belong to the deletion queue
+void Defragmenter::cleanup() noexcept {
+	m_movables.clear();
+	m_active = false;
+	m_releasePending = false;
+}
+
+/// @brief Declares a buffer the defragmenter is allowed to move, the barrier after the copy is deduced from its usage
+void Defragmenter::registerBuffer(VkBuffer* buffer, Allocation* allocation, const VkBufferCreateInfo& createInfo) {
+	Movable movable{};
+	movable.buffer = buffer;
+	movable.allocation = allocation;
+	movable.bufferInfo = createInfo;
+	movable.bufferInfo.pNext = nullptr;
+
+	if (createInfo.usage & VK_BUFFER_USAGE_VERTEX_BUFFER_BIT) {
+		movable.dstStages |= VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+		movable.dstAccess |= VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+	}
+	if (createInfo.usage & VK_BUFFER_USAGE_INDEX_BUFFER_BIT) {
+		movable.dstStages |= VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+		movable.dstAccess |= VK_ACCESS_INDEX_READ_BIT;
+	}
+	if (createInfo.usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT) {
+		movable.dstStages |= VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		movable.dstAccess |= VK_ACCESS_UNIFORM_READ_BIT;
+	}
+	if (createInfo.usage & VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT) {
+		movable.dstStages |= VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+		movable.dstAccess |= VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+	}
+	if (movable.dstStages == 0) {
+		movable.dstStages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+		movable.dstAccess = VK_ACCESS_MEMORY_READ_BIT;
+	}
+
+	for (uint32_t i = 0; i < createInfo.queueFamilyIndexCount && i < 3; ++i) {
+		movable.queueFamilies[i] = createInfo.pQueueFamilyIndices[i];
+	}
+	movable.bufferInfo.pQueueFamilyIndices = nullptr; // pointé sur queueFamilies au moment du déplacement, le Movable est copié
+
+	vkGetBufferMemoryRequirements(m_context->getDevice(), *buffer, &movable.requirements);
+	m_movables.push_back(movable);
+}
+
+/// @brief Declares a sampled image the defragmenter is allowed to move, all its mip levels are copied
+/// @param layout the layout the image is kept in between frames
+void Defragmenter::registerImage(VkImage* image, Allocation* allocation, const VkImageCreateInfo& createInfo,
+				 VkImageLayout layout, VkImageAspectFlags aspect) {
+	Movable movable{};
+	movable.image = image;
+	movable.allocation = allocation;
+	movable.imageInfo = createInfo;
+	movable.imageInfo.pNext = nullptr;
+	movable.imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	movable.layout = layout;
+	movable.aspect = aspect;
+	movable.dstStages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+	movable.dstAccess = VK_ACCESS_SHADER_READ_BIT;
+
+	for (uint32_t i = 0; i < createInfo.queueFamilyIndexCount && i < 3; ++i) {
+		movable.queueFamilies[i] = createInfo.pQueueFamilyIndices[i];
+	}
+	movable.imageInfo.pQueueFamilyIndices = nullptr;
+
+	vkGetImageMemoryRequirements(m_context->getDevice(), *image, &movable.requirements);
+	m_movables.push_back(movable);
+}
+
+void Defragmenter::unregister(const Allocation* allocation) {
+	m_movables.erase(std::remove_if(m_movables.begin(), m_movables.end(),
+					[allocation](const Movable& movable) { return movable.allocation == allocation; }),
+			 m_movables.end());
+}
+
+void Defragmenter::begin() {
+	m_active = true;
+}
+
+/// @brief Looks for a better place for the resource : a lower offset in its own block or a fuller block of the same type
+/// @return true if destination now holds a new allocation
+bool Defragmenter::findDestination(const Movable& movable, Allocation& destination, ArenaVector<MemoryBlock*>& blocks) {
+	MemoryBlock* source = movable.allocation->block;
+
+	// blocs triés du plus plein au moins plein, on ne remplit que des blocs placés avant la source
+	m_allocator->getBlocks(source->memoryType, blocks);
+	for (MemoryBlock* block : blocks) {
+		if (block->linear != source->linear)
+			continue;
+
+		if (block == source) {
+			destination = m_allocator->allocateInBlock(block, movable.requirements, movable.allocation->offset);
+			return destination.memory != VK_NULL_HANDLE;
+		}
+
+		destination = m_allocator->allocateInBlock(block, movable.requirements, block->size);
+		if (destination.memory != VK_NULL_HANDLE)
+			return true;
+	}
+	return false;
+}
+
+void Defragmenter::moveBuffer(VkCommandBuffer commandBuffer, Movable& movable, Allocation& destination) {
+	VkBuffer newBuffer;
+	movable.bufferInfo.pQueueFamilyIndices = movable.bufferInfo.queueFamilyIndexCount ? movable.queueFamilies : nullptr;
+	if (vkCreateBuffer(m_context->getDevice(), &movable.bufferInfo, nullptr, &newBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create defragmentation buffer!");
+	}
+	vkBindBufferMemory(m_context->getDevice(), newBuffer, destination.memory, destination.offset);
+
+	VkBufferCopy copyRegion{};
+	copyRegion.size = movable.bufferInfo.size;
+	vkCmdCopyBuffer(commandBuffer, *movable.buffer, newBuffer, 1, &copyRegion);
+
+	// enregistrée a la fin du step() avec celles des autres déplacements
+	m_after.buffer(newBuffer, 0, VK_WHOLE_SIZE,
+		       VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, movable.dstStages, movable.dstAccess);
+
+	m_deletionQueue->push(*movable.buffer, *movable.allocation);
+
+	*movable.buffer = newBuffer;
+	*movable.allocation = destination;
+}
+
+void Defragmenter::moveImage(VkCommandBuffer commandBuffer, Movable& movable, Allocation& destination, FrameArena& arena) {
+	VkImage newImage;
+	movable.imageInfo.pQueueFamilyIndices = movable.imageInfo.queueFamilyIndexCount ? movable.queueFamilies : nullptr;
+	if (vkCreateImage(m_context->getDevice(), &movable.imageInfo, nullptr, &newImage) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create defragmentation image!");
+	}
+	vkBindImageMemory(m_context->getDevice(), newImage, destination.memory, destination.offset);
+
+	const uint32_t mipLevels = movable.imageInfo.mipLevels;
+
+	VkImageSubresourceRange range{};
+	range.aspectMask = movable.aspect;
+	range.baseMipLevel = 0;
+	range.levelCount = mipLevels;
+	range.baseArrayLayer = 0;
+	range.layerCount = 1;
+
+	// l'ancienne image passe en source apres les lectures des frames precedentes
+	m_before.image(*movable.image, range, movable.layout, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		       movable.dstStages, 0, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT);
+	m_before.image(newImage, range, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		       VK_PIPELINE_STAGE_2_NONE, 0, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT);
+	m_before.flush(commandBuffer);
+
+	VkImageCopy* regions = arena.allocateArray<VkImageCopy>(mipLevels);
+	for (uint32_t mip = 0; mip < mipLevels; ++mip) {
+		VkImageCopy& region = regions[mip];
+		region = VkImageCopy{};
+		region.srcSubresource = {movable.aspect, mip, 0, 1};
+		region.dstSubresource = {movable.aspect, mip, 0, 1};
+		region.extent = {
+		    std::max(1u, movable.imageInfo.extent.width >> mip),
+		    std::max(1u, movable.imageInfo.extent.height >> mip),
+		    1};
+	}
+
+	vkCmdCopyImage(commandBuffer,
+		       *movable.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		       newImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		       mipLevels, regions);
+
+	m_after.image(newImage, range, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, movable.layout,
+		      VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, movable.dstStages, movable.dstAccess);
+
+	m_deletionQueue->push(*movable.image, *movable.allocation);
+
+	*movable.image = newImage;
+	*movable.allocation = destination;
+}
+
+/**
+ * @brief Moves live resources toward the fullest blocks until the budget of this frame is spent.
+ *
+ * Implementation summary:
+ * - Sources are visited from the emptiest block, highest offset first, so blocks drain from the end.
+ * - Each move creates a new handle bound to the destination and records a GPU copy, the barriers that make the
+ *   new resources usable are batched and recorded once after the last copy.
+ * - The old handle and allocation go to the deletion queue and are only freed once the frame is complete.
+ * - At least one move is done per call so a resource bigger than the byte budget still moves.
+ * - The pass ends when a full sweep finds nothing to move.
+ */
+DefragStats Defragmenter::step(VkCommandBuffer commandBuffer, uint64_t frameNumber, const DefragBudget& budget, FrameArena& arena) {
+	DefragStats stats{};
+	if (!m_active)
+		return stats;
+
+	ArenaVector<MemoryBlock*> blocks{ArenaAllocator<MemoryBlock*>(arena)};
+
+	auto start = std::chrono::steady_clock::now();
+
+	std::sort(m_movables.begin(), m_movables.end(), [](const Movable& a, const Movable& b) {
+		if (a.allocation->block->used != b.allocation->block->used)
+			return a.allocation->block->used < b.allocation->block->used;
+		return a.allocation->offset > b.allocation->offset;
+	});
+
+	bool budgetReached = false;
+	for (auto& movable : m_movables) {
+		double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (stats.moves > 0 && (stats.moves >= budget.maxMovesPerFrame || elapsed >= budget.maxMilliseconds ||
+					stats.bytesMoved + movable.allocation->size > budget.maxBytesPerFrame)) {
+			budgetReached = true;
+			break;
+		}
+
+		Allocation destination{};
+		if (!findDestination(movable, destination, blocks))
+			continue;
+
+		if (movable.buffer) {
+			moveBuffer(commandBuffer, movable, destination);
+		} else {
+			moveImage(commandBuffer, movable, destination, arena);
+		}
+
+		stats.moves++;
+		stats.bytesMoved += destination.size;
+	}
+	m_after.flush(commandBuffer);
+
+	if (stats.moves > 0) {
+		m_lastMoveFrame = frameNumber;
+		m_releasePending = true;
+	}
+
+	if (!budgetReached && stats.moves == 0) {
+		m_active = false;
+		std::cout << "Defragmentation done: " << m_total.moves << " moves, " << m_total.bytesMoved << " bytes, "
+			  << m_total.blocksReleased << " blocks released" << '\n';
+	}
+
+	m_total.moves += stats.moves;
+	m_total.bytesMoved += stats.bytesMoved;
+	return stats;
+}
+
+/// @brief Releases the blocks left empty once the deletion queue has freed the sources of the last moves
+void Defragmenter::collect(uint64_t completedFrames) noexcept {
+	if (!m_releasePending || m_lastMoveFrame >= completedFrames)
+		return;
+
+	m_total.blocksReleased += m_allocator->releaseEmptyBlocks();
+	m_releasePending = false;
+}
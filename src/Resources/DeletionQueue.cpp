@@ -0,0 +1,98 @@
+#include <VulkanApp/Resources/DeletionQueue.h>
+
+void DeletionQueue::init(VulkanContext* context, MemoryAllocator* allocator) {
+	m_context = context;
+	m_allocator = allocator;
+	m_frameNumber = 0;
+}
+
+void DeletionQueue::cleanup() noexcept {
+	flush();
+}
+
+void DeletionQueue::push(Entry entry) {
+	entry.frameNumber = m_frameNumber;
+	m_entries.push_back(entry);
+}
+
+void DeletionQueue::push(VkBuffer buffer, const Allocation& allocation) {
+	Entry entry{};
+	entry.buffer = buffer;
+	entry.allocation = allocation;
+	push(entry);
+}
+
+void DeletionQueue::push(VkImage image, const Allocation& allocation) {
+	Entry entry{};
+	entry.image = image;
+	entry.allocation = allocation;
+	push(entry);
+}
+
+void DeletionQueue::push(VkImageView view) {
+	Entry entry{};
+	entry.view = view;
+	push(entry);
+}
+
+void DeletionQueue::push(VkSampler sampler) {
+	Entry entry{};
+	entry.sampler = sampler;
+	push(entry);
+}
+
+void DeletionQueue::push(VkPipeline pipeline) {
+	Entry entry{};
+	entry.pipeline = pipeline;
+	push(entry);
+}
+
+void DeletionQueue::push(VkPipelineLayout layout) {
+	Entry entry{};
+	entry.layout = layout;
+	push(entry);
+}
+
+void DeletionQueue::push(VkFramebuffer framebuffer) {
+	Entry entry{};
+	entry.framebuffer = framebuffer;
+	push(entry);
+}
+
+/// @brief The swapchain must already be retired, passed as oldSwapchain to its replacement
+void DeletionQueue::push(VkSwapchainKHR swapchain) {
+	Entry entry{};
+	entry.swapchain = swapchain;
+	push(entry);
+}
+
+/// @brief Destroys the entries of frames that are complete.
+/// an entry tagged N may still be read by frame N, it goes once completedFrames > N
+void DeletionQueue::collect(uint64_t frameNumber, uint64_t completedFrames) noexcept {
+	m_frameNumber = frameNumber;
+	while (!m_entries.empty() && m_entries.front().frameNumber < completedFrames) {
+		destroy(m_entries.front());
+		m_entries.pop_front();
+	}
+}
+
+void DeletionQueue::flush() noexcept {
+	for (auto& entry : m_entries) {
+		destroy(entry);
+	}
+	m_entries.clear();
+}
+
+void DeletionQueue::destroy(Entry& entry) noexcept {
+	VkDevice device = m_context->getDevice();
+
+	vkDestroyFramebuffer(device, entry.framebuffer, nullptr);
+	vkDestroyImageView(device, entry.view, nullptr);
+	vkDestroyImage(device, entry.image, nullptr);
+	vkDestroyBuffer(device, entry.buffer, nullptr);
+	vkDestroySampler(device, entry.sampler, nullptr);
+	vkDestroyPipeline(device, entry.pipeline, nullptr);
+	vkDestroyPipelineLayout(device, entry.layout, nullptr);
+	vkDestroySwapchainKHR(device, entry.swapchain, nullptr);
+	m_allocator->free(entry.allocation);
+}
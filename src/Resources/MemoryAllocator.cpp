@@ -0,0 +1,219 @@
+#include <VulkanApp/Resources/MemoryAllocator.h>
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+void MemoryAllocator::init(VulkanContext* context) {
+	m_context = context;
+	vkGetPhysicalDeviceMemoryProperties(m_context->getPhysicalDevice(), &m_memoryProperties);
+}
+
+/// @brief Frees every block, allocations still alive at this point are leaked resources
+void MemoryAllocator::cleanup() noexcept {
+	for (auto& block : m_blocks) {
+		if (block->allocationCount != 0) {
+			std::cerr << "MemoryAllocator: block freed with " << block->allocationCount << " live allocations" << '\n';
+		}
+		if (block->mapped) {
+			vkUnmapMemory(m_context->getDevice(), block->memory);
+		}
+		vkFreeMemory(m_context->getDevice(), block->memory, nullptr);
+	}
+	m_blocks.clear();
+}
+
+/// @brief Finds a memory type matching both the resource requirements and the wanted properties
+uint32_t MemoryAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+	for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; i++) {
+		if ((typeFilter & (1 << i)) && (m_memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+			return i;
+	}
+
+	throw std::runtime_error("failed to find suitable memory type!");
+}
+
+/// @brief Allocates a new VkDeviceMemory block, host visible blocks are mapped once for their whole lifetime
+MemoryBlock* MemoryAllocator::createBlock(uint32_t memoryType, VkDeviceSize size, bool linear) {
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = size;
+	allocInfo.memoryTypeIndex = memoryType;
+
+	auto block = std::make_unique<MemoryBlock>();
+	if (vkAllocateMemory(m_context->getDevice(), &allocInfo, nullptr, &block->memory) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate memory block!");
+	}
+
+	block->size = size;
+	block->memoryType = memoryType;
+	block->linear = linear;
+	block->freeRanges.push_back({0, size});
+
+	if (m_memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+		vkMapMemory(m_context->getDevice(), block->memory, 0, VK_WHOLE_SIZE, 0, &block->mapped);
+	}
+
+	m_blocks.push_back(std::move(block));
+	return m_blocks.back().get();
+}
+
+/// @brief First fit in the block free list, the allocation has to end before maxOffset
+/// @return false if no free range can hold the request
+bool MemoryAllocator::tryAllocate(MemoryBlock* block, const VkMemoryRequirements& requirements, VkDeviceSize maxOffset, Allocation& allocation) {
+	for (size_t i = 0; i < block->freeRanges.size(); ++i) {
+		FreeRange range = block->freeRanges[i];
+		VkDeviceSize offset = alignUp(range.offset, requirements.alignment);
+		VkDeviceSize end = offset + requirements.size;
+
+		if (end > range.offset + range.size || end > maxOffset)
+			continue;
+
+		// free() est noexcept et insère sa range avant de fusionner : entre deux allocations il y a au plus une range,
+		// la place est réservée ici, la seule étape qui peut échouer
+		size_t needed = block->allocationCount + 3;
+		if (block->freeRanges.capacity() < needed) {
+			block->freeRanges.reserve(std::max(needed, block->freeRanges.capacity() * 2));
+		}
+
+		// on découpe la range : un trou avant (padding d'alignement) et le reste apres
+		block->freeRanges.erase(block->freeRanges.begin() + i);
+		if (end < range.offset + range.size) {
+			block->freeRanges.insert(block->freeRanges.begin() + i, {end, range.offset + range.size - end});
+		}
+		if (offset > range.offset) {
+			block->freeRanges.insert(block->freeRanges.begin() + i, {range.offset, offset - range.offset});
+		}
+
+		block->used += requirements.size;
+		block->allocationCount++;
+
+		allocation.memory = block->memory;
+		allocation.offset = offset;
+		allocation.size = requirements.size;
+		allocation.memoryType = block->memoryType;
+		allocation.mapped = block->mapped ? static_cast<char*>(block->mapped) + offset : nullptr;
+		allocation.block = block;
+		return true;
+	}
+	return false;
+}
+
+/// @brief Sub-allocates from an existing block of a compatible type or creates a new one
+/// @param linear true for buffers and linear images, false for optimal tiling images
+Allocation MemoryAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool linear) {
+	uint32_t memoryType = findMemoryType(requirements.memoryTypeBits, properties);
+
+	Allocation allocation{};
+	for (auto& block : m_blocks) {
+		if (block->memoryType != memoryType || block->linear != linear)
+			continue;
+		if (tryAllocate(block.get(), requirements, block->size, allocation))
+			return allocation;
+	}
+
+	// les grosses ressources ont leur propre block, sinon un block de taille fixe
+	VkDeviceSize heapSize = m_memoryProperties.memoryHeaps[m_memoryProperties.memoryTypes[memoryType].heapIndex].size;
+	VkDeviceSize blockSize = std::min(g_memory_block_size, std::max<VkDeviceSize>(heapSize / 8, requirements.size));
+	blockSize = std::max(blockSize, requirements.size);
+
+	MemoryBlock* block = createBlock(memoryType, blockSize, linear);
+	if (!tryAllocate(block, requirements, block->size, allocation)) {
+		throw std::runtime_error("failed to sub-allocate memory!");
+	}
+	return allocation;
+}
+
+/// @brief Allocates inside a given block only, used by the defragmenter to pick its destination
+/// @return an allocation with a null memory if the block has no room before maxOffset
+Allocation MemoryAllocator::allocateInBlock(MemoryBlock* block, const VkMemoryRequirements& requirements, VkDeviceSize maxOffset) {
+	Allocation allocation{};
+	if (!(requirements.memoryTypeBits & (1 << block->memoryType)))
+		return allocation;
+	tryAllocate(block, requirements, maxOffset, allocation);
+	return allocation;
+}
+
+/// @brief Gives the range back to its block and merges it with its neighbours, the block itself is kept
+void MemoryAllocator::free(Allocation& allocation) noexcept {
+	MemoryBlock* block = allocation.block;
+	if (!block)
+		return;
+
+	auto it = std::lower_bound(block->freeRanges.begin(), block->freeRanges.end(), allocation.offset,
+				   [](const FreeRange& range, VkDeviceSize offset) { return range.offset < offset; });
+	it = block->freeRanges.insert(it, {allocation.offset, allocation.size});
+
+	if (it + 1 != block->freeRanges.end() && it->offset + it->size == (it + 1)->offset) {
+		it->size += (it + 1)->size;
+		block->freeRanges.erase(it + 1);
+	}
+	if (it != block->freeRanges.begin() && (it - 1)->offset + (it - 1)->size == it->offset) {
+		(it - 1)->size += it->size;
+		block->freeRanges.erase(it);
+	}
+
+	block->used -= allocation.size;
+	block->allocationCount--;
+
+	allocation = Allocation{};
+}
+
+void MemoryAllocator::getBlocks(uint32_t memoryType, ArenaVector<MemoryBlock*>& blocks) {
+	blocks.clear();
+	blocks.reserve(m_blocks.size());
+	for (auto& block : m_blocks) {
+		if (block->memoryType == memoryType)
+			blocks.push_back(block.get());
+	}
+	// std::sort et non stable_sort, qui prend son buffer temporaire sur le heap : les égalités sont départagées par le
+	// handle, l'ordre reste le même d'un appel a l'autre
+	std::sort(blocks.begin(), blocks.end(), [](const MemoryBlock* a, const MemoryBlock* b) {
+		if (a->used != b->used)
+			return a->used > b->used;
+		return std::less<VkDeviceMemory>{}(a->memory, b->memory);
+	});
+}
+
+/// @brief Gathers usage and fragmentation metrics over every block whose memory type has the required properties
+MemoryStats MemoryAllocator::getStats(VkMemoryPropertyFlags requiredProperties) const {
+	MemoryStats stats{};
+	for (const auto& block : m_blocks) {
+		if ((m_memoryProperties.memoryTypes[block->memoryType].propertyFlags & requiredProperties) != requiredProperties)
+			continue;
+
+		stats.blockCount++;
+		stats.allocationCount += block->allocationCount;
+		stats.totalBytes += block->size;
+		stats.usedBytes += block->used;
+		stats.freeRangeCount += static_cast<uint32_t>(block->freeRanges.size());
+		for (const auto& range : block->freeRanges) {
+			stats.largestFreeRange = std::max(stats.largestFreeRange, range.size);
+		}
+	}
+	return stats;
+}
+
+/// @brief Gives the blocks without any allocation back to the driver
+/// @return the number of blocks freed
+uint32_t MemoryAllocator::releaseEmptyBlocks() noexcept {
+	uint32_t released = 0;
+	for (auto it = m_blocks.begin(); it != m_blocks.end();) {
+		if ((*it)->allocationCount == 0) {
+			if ((*it)->mapped) {
+				vkUnmapMemory(m_context->getDevice(), (*it)->memory);
+			}
+			vkFreeMemory(m_context->getDevice(), (*it)->memory, nullptr);
+			it = m_blocks.erase(it);
+			released++;
+		} else {
+			++it;
+		}
+	}
+	return released;
+}
@@ -0,0 +1,167 @@
+#include <VulkanApp/Sync/BarrierBatcher.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+// fusionne [base0, base0 + count0) et [base1, base1 + count1) s'ils se touchent, remaining = VK_REMAINING_*
+bool mergeRanges(uint32_t& base0, uint32_t& count0, uint32_t base1, uint32_t count1, uint32_t remaining) {
+	uint64_t end0 = count0 == remaining ? std::numeric_limits<uint64_t>::max() : static_cast<uint64_t>(base0) + count0;
+	uint64_t end1 = count1 == remaining ? std::numeric_limits<uint64_t>::max() : static_cast<uint64_t>(base1) + count1;
+	if (base1 > end0 || base0 > end1)
+		return false;
+
+	uint32_t base = std::min(base0, base1);
+	uint64_t end = std::max(end0, end1);
+	base0 = base;
+	count0 = end == std::numeric_limits<uint64_t>::max() ? remaining : static_cast<uint32_t>(end - base);
+	return true;
+}
+
+} // namespace
+
+void BarrierBatcher::reserve(size_t imageCount, size_t bufferCount) {
+	m_images.reserve(imageCount);
+	m_buffers.reserve(bufferCount);
+}
+
+void BarrierBatcher::image(VkImage image, const VkImageSubresourceRange& range, VkImageLayout oldLayout, VkImageLayout newLayout,
+			   VkPipelineStageFlags2 srcStages, VkAccessFlags2 srcAccesses, VkPipelineStageFlags2 dstStages, VkAccessFlags2 dstAccesses,
+			   uint32_t srcFamily, uint32_t dstFamily) {
+	for (auto& pending : m_images) {
+		if (pending.image != image || pending.subresourceRange.aspectMask != range.aspectMask ||
+		    pending.srcQueueFamilyIndex != srcFamily || pending.dstQueueFamilyIndex != dstFamily)
+			continue;
+
+		VkImageSubresourceRange& pendingRange = pending.subresourceRange;
+		bool sameLevels = pendingRange.baseMipLevel == range.baseMipLevel && pendingRange.levelCount == range.levelCount;
+		bool sameLayers = pendingRange.baseArrayLayer == range.baseArrayLayer && pendingRange.layerCount == range.layerCount;
+
+		// rien ne s'éxécute entre les deux, A -> B puis B -> C devient A -> C
+		if (sameLevels && sameLayers && pending.newLayout == oldLayout && srcFamily == VK_QUEUE_FAMILY_IGNORED) {
+			pending.newLayout = newLayout;
+			pending.dstStageMask = dstStages;
+			pending.dstAccessMask = dstAccesses;
+			return;
+		}
+
+		bool sameTransition = pending.oldLayout == oldLayout && pending.newLayout == newLayout &&
+				      pending.srcStageMask == srcStages && pending.srcAccessMask == srcAccesses &&
+				      pending.dstStageMask == dstStages && pending.dstAccessMask == dstAccesses;
+		if (!sameTransition)
+			continue;
+
+		if (sameLayers && mergeRanges(pendingRange.baseMipLevel, pendingRange.levelCount, range.baseMipLevel, range.levelCount,
+					      VK_REMAINING_MIP_LEVELS))
+			return;
+		if (sameLevels && mergeRanges(pendingRange.baseArrayLayer, pendingRange.layerCount, range.baseArrayLayer, range.layerCount,
+					      VK_REMAINING_ARRAY_LAYERS))
+			return;
+	}
+
+	VkImageMemoryBarrier2 barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+	barrier.srcStageMask = srcStages;
+	barrier.srcAccessMask = srcAccesses;
+	barrier.dstStageMask = dstStages;
+	barrier.dstAccessMask = dstAccesses;
+	barrier.oldLayout = oldLayout;
+	barrier.newLayout = newLayout;
+	barrier.srcQueueFamilyIndex = srcFamily;
+	barrier.dstQueueFamilyIndex = dstFamily;
+	barrier.image = image;
+	barrier.subresourceRange = range;
+	m_images.push_back(barrier);
+}
+
+void BarrierBatcher::buffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size,
+			    VkPipelineStageFlags2 srcStages, VkAccessFlags2 srcAccesses, VkPipelineStageFlags2 dstStages, VkAccessFlags2 dstAccesses,
+			    uint32_t srcFamily, uint32_t dstFamily) {
+	VkDeviceSize end = size == VK_WHOLE_SIZE ? std::numeric_limits<VkDeviceSize>::max() : offset + size;
+
+	for (auto& pending : m_buffers) {
+		if (pending.buffer != buffer || pending.srcQueueFamilyIndex != srcFamily || pending.dstQueueFamilyIndex != dstFamily)
+			continue;
+
+		VkDeviceSize pendingEnd = pending.size == VK_WHOLE_SIZE ? std::numeric_limits<VkDeviceSize>::max() : pending.offset + pending.size;
+
+		// pas de layout sur un buffer, deux barrières sur la même zone se cumulent
+		if (pending.offset == offset && pendingEnd == end) {
+			pending.srcStageMask |= srcStages;
+			pending.srcAccessMask |= srcAccesses;
+			pending.dstStageMask |= dstStages;
+			pending.dstAccessMask |= dstAccesses;
+			return;
+		}
+
+		bool sameMasks = pending.srcStageMask == srcStages && pending.srcAccessMask == srcAccesses &&
+				 pending.dstStageMask == dstStages && pending.dstAccessMask == dstAccesses;
+		if (!sameMasks || offset > pendingEnd || pending.offset > end)
+			continue;
+
+		VkDeviceSize mergedEnd = std::max(end, pendingEnd);
+		pending.offset = std::min(offset, pending.offset);
+		pending.size = mergedEnd == std::numeric_limits<VkDeviceSize>::max() ? VK_WHOLE_SIZE : mergedEnd - pending.offset;
+		return;
+	}
+
+	VkBufferMemoryBarrier2 barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+	barrier.srcStageMask = srcStages;
+	barrier.srcAccessMask = srcAccesses;
+	barrier.dstStageMask = dstStages;
+	barrier.dstAccessMask = dstAccesses;
+	barrier.srcQueueFamilyIndex = srcFamily;
+	barrier.dstQueueFamilyIndex = dstFamily;
+	barrier.buffer = buffer;
+	barrier.offset = offset;
+	barrier.size = size;
+	m_buffers.push_back(barrier);
+}
+
+/// @brief Every global barrier of the batch is OR-ed into one, a wider dependency is never wrong
+void BarrierBatcher::memory(VkPipelineStageFlags2 srcStages, VkAccessFlags2 srcAccesses, VkPipelineStageFlags2 dstStages, VkAccessFlags2 dstAccesses) {
+	if (!m_hasMemory) {
+		m_memory = VkMemoryBarrier2{};
+		m_memory.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+		m_hasMemory = true;
+	}
+	m_memory.srcStageMask |= srcStages;
+	m_memory.srcAccessMask |= srcAccesses;
+	m_memory.dstStageMask |= dstStages;
+	m_memory.dstAccessMask |= dstAccesses;
+}
+
+void BarrierBatcher::flush(VkCommandBuffer commandBuffer) {
+	if (empty())
+		return;
+
+	VkDependencyInfo dependencyInfo{};
+	dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	dependencyInfo.memoryBarrierCount = m_hasMemory ? 1 : 0;
+	dependencyInfo.pMemoryBarriers = &m_memory;
+	dependencyInfo.bufferMemoryBarrierCount = static_cast<uint32_t>(m_buffers.size());
+	dependencyInfo.pBufferMemoryBarriers = m_buffers.data();
+	dependencyInfo.imageMemoryBarrierCount = static_cast<uint32_t>(m_images.size());
+	dependencyInfo.pImageMemoryBarriers = m_images.data();
+
+	vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+	++m_flushCount;
+	clear();
+}
+
+void BarrierBatcher::clear() {
+	// clear() garde la capacité, les flush suivants n'allouent pas
+	m_images.clear();
+	m_buffers.clear();
+	m_hasMemory = false;
+}
+
+bool BarrierBatcher::touches(VkImage image) const {
+	return std::any_of(m_images.begin(), m_images.end(), [image](const VkImageMemoryBarrier2& barrier) { return barrier.image == image; });
+}
+
+bool BarrierBatcher::touches(VkBuffer buffer) const {
+	return std::any_of(m_buffers.begin(), m_buffers.end(), [buffer](const VkBufferMemoryBarrier2& barrier) { return barrier.buffer == buffer; });
+}
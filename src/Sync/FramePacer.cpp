@@ -0,0 +1,87 @@
+#include <VulkanApp/Sync/FramePacer.h>
+
+#include <thread>
+
+void FramePacer::init(VulkanContext* context, double targetFps, size_t statsCapacity) {
+	m_context = context;
+	m_period = targetFps > 0.0 ? std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / targetFps))
+				   : std::chrono::steady_clock::duration{0};
+	m_nextFrame = std::chrono::steady_clock::now();
+	m_nextMeasured = 0;
+	m_presented = 0;
+	m_latency.init(statsCapacity);
+}
+
+void FramePacer::limit() {
+	if (m_period.count() == 0)
+		return;
+
+	auto now = std::chrono::steady_clock::now();
+	if (now < m_nextFrame) {
+		std::this_thread::sleep_until(m_nextFrame);
+		m_nextFrame += m_period;
+	} else {
+		// en retard : on repart de maintenant, rattraper ferait des frames collées
+		m_nextFrame = now + m_period;
+	}
+}
+
+void FramePacer::markInput(uint64_t frameNumber) {
+	m_inputTimes[frameNumber % g_latency_ring_size] = std::chrono::steady_clock::now();
+}
+
+const void* FramePacer::getPresentChain(uint64_t frameNumber) {
+	if (!m_context->hasPresentWait())
+		return nullptr;
+
+	m_presentId = frameNumber + 1;
+	m_presentIdInfo = VkPresentIdKHR{};
+	m_presentIdInfo.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+	m_presentIdInfo.swapchainCount = 1;
+	m_presentIdInfo.pPresentIds = &m_presentId;
+	return &m_presentIdInfo;
+}
+
+void FramePacer::record(uint64_t frameNumber) {
+	auto latency = std::chrono::steady_clock::now() - m_inputTimes[frameNumber % g_latency_ring_size];
+	m_latency.add(std::chrono::duration<double, std::milli>(latency).count());
+}
+
+/// @brief With present_wait the display time is only seen when polled here, once per frame, so a latency can
+/// be up to one frame late. waitPresented() measures it exactly
+void FramePacer::markPresented(VkSwapchainKHR swapchain, uint64_t frameNumber) {
+	m_presented = frameNumber + 1;
+
+	if (!m_context->hasPresentWait()) {
+		record(frameNumber);
+		m_nextMeasured = m_presented;
+		return;
+	}
+
+	// les entrées plus anciennes que le ring sont écrasées, elles ne sont plus mesurables
+	if (m_presented - m_nextMeasured > g_latency_ring_size) {
+		m_nextMeasured = m_presented - g_latency_ring_size;
+	}
+	while (m_nextMeasured < m_presented && m_context->waitForPresent(swapchain, m_nextMeasured + 1, 0) == VK_SUCCESS) {
+		record(m_nextMeasured++);
+	}
+}
+
+void FramePacer::waitPresented(VkSwapchainKHR swapchain, uint64_t frameNumber) {
+	if (!m_context->hasPresentWait() || frameNumber >= m_presented)
+		return;
+
+	while (m_nextMeasured <= frameNumber) {
+		if (m_context->waitForPresent(swapchain, m_nextMeasured + 1, g_present_wait_timeout_ns) != VK_SUCCESS) {
+			// timeout ou swapchain périmée, ces frames ne seront pas mesurées
+			m_nextMeasured = frameNumber + 1;
+			return;
+		}
+		record(m_nextMeasured++);
+	}
+}
+
+void FramePacer::resetSwapchain(uint64_t nextFrame) {
+	m_nextMeasured = nextFrame;
+	m_presented = nextFrame;
+}
@@ -0,0 +1,45 @@
+#include <VulkanApp/Sync/FrameTimeline.h>
+
+#include <stdexcept>
+
+void FrameTimeline::init(VulkanContext* context) {
+	m_context = context;
+
+	VkSemaphoreTypeCreateInfo typeInfo{};
+	typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	typeInfo.initialValue = 0; // aucune frame finie
+
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreInfo.pNext = &typeInfo;
+
+	if (vkCreateSemaphore(m_context->getDevice(), &semaphoreInfo, nullptr, &m_semaphore) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create frame timeline semaphore!");
+	}
+}
+
+void FrameTimeline::cleanup() noexcept {
+	vkDestroySemaphore(m_context->getDevice(), m_semaphore, nullptr);
+	m_semaphore = VK_NULL_HANDLE;
+}
+
+/// @brief Non blocking, one vkGetSemaphoreCounterValue
+uint64_t FrameTimeline::getCompletedFrames() const {
+	uint64_t value = 0;
+	vkGetSemaphoreCounterValue(m_context->getDevice(), m_semaphore, &value);
+	return value;
+}
+
+void FrameTimeline::waitForFrames(uint64_t frameCount) const {
+	if (frameCount == 0)
+		return;
+
+	VkSemaphoreWaitInfo waitInfo{};
+	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &m_semaphore;
+	waitInfo.pValues = &frameCount;
+
+	vkWaitSemaphores(m_context->getDevice(), &waitInfo, UINT64_MAX);
+}
@@ -0,0 +1,64 @@
+#include <VulkanApp/Sync/FramesInFlightTuner.h>
+
+#include <algorithm>
+#include <cmath>
+
+void FramesInFlightTuner::init(uint32_t minFrames, uint32_t maxFrames) {
+	m_minFrames = minFrames;
+	m_maxFrames = std::max(minFrames, maxFrames);
+	m_sampleCount = 0;
+	m_candidate = 0;
+}
+
+void FramesInFlightTuner::add(double cpuMilliseconds, double gpuMilliseconds) {
+	if (m_sampleCount >= g_tuner_window_frames)
+		return;
+	m_cpuSamples[m_sampleCount] = cpuMilliseconds;
+	m_gpuSamples[m_sampleCount] = gpuMilliseconds;
+	m_sampleCount++;
+}
+
+/// @brief Evaluates the window once it is full, then starts a new one
+uint32_t FramesInFlightTuner::evaluate(uint32_t current) {
+	if (m_sampleCount < g_tuner_window_frames)
+		return 0;
+
+	uint32_t wanted = pick();
+	m_sampleCount = 0;
+
+	// hystérésis : un pic isolé ne doit pas faire osciller la profondeur
+	if (wanted == current) {
+		m_candidate = 0;
+		return 0;
+	}
+	if (wanted != m_candidate) {
+		m_candidate = wanted;
+		return 0;
+	}
+	m_candidate = 0;
+	return wanted;
+}
+
+/// @brief With d frames in flight the GPU has d - 1 frames queued while the CPU records the next one,
+/// it stays busy as long as a CPU frame is shorter than that. a CPU bound frame can never saturate the GPU,
+/// the CPU and GPU overlap with 2 frames already and a deeper queue would only add latency
+uint32_t FramesInFlightTuner::pick() const {
+	double cpuAverage = 0.0;
+	double gpuAverage = 0.0;
+	for (uint32_t i = 0; i < m_sampleCount; ++i) {
+		cpuAverage += m_cpuSamples[i];
+		gpuAverage += m_gpuSamples[i];
+	}
+	cpuAverage /= m_sampleCount;
+	gpuAverage /= m_sampleCount;
+
+	uint32_t frames = 2;
+	if (gpuAverage > 0.0 && cpuAverage < gpuAverage) {
+		// p95 cpu, les 5% restants sont considérés comme des accidents
+		std::array<double, g_tuner_window_frames> sorted = m_cpuSamples;
+		auto p95 = sorted.begin() + (m_sampleCount * 95) / 100;
+		std::nth_element(sorted.begin(), p95, sorted.begin() + m_sampleCount);
+		frames = 1 + static_cast<uint32_t>(std::ceil(*p95 / gpuAverage));
+	}
+	return std::clamp(frames, m_minFrames, m_maxFrames);
+}
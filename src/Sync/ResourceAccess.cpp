@@ -0,0 +1,97 @@
+#include <VulkanApp/Sync/ResourceAccess.h>
+
+#include <array>
+
+namespace {
+
+// dans l'ordre de ResourceAccess
+constexpr std::array<AccessInfo, 17> g_access_infos{{
+    {0, 0, VK_IMAGE_LAYOUT_UNDEFINED, false},
+    {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+     VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true},
+    {VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+     VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+     VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, true},
+    {VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+     VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, false},
+    {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false},
+    {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false},
+    {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, false},
+    {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, true},
+    {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, false},
+    {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, true},
+    {VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false},
+    {VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false},
+    {VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_UNIFORM_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false},
+    {VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false},
+    {VK_PIPELINE_STAGE_CONDITIONAL_RENDERING_BIT_EXT, VK_ACCESS_CONDITIONAL_RENDERING_READ_BIT_EXT, VK_IMAGE_LAYOUT_UNDEFINED, false},
+    {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, VK_IMAGE_LAYOUT_UNDEFINED, false},
+    {VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, false},
+}};
+
+constexpr std::array<const char*, 17> g_access_names{
+    "None", "ColorAttachmentWrite", "DepthAttachmentWrite", "DepthAttachmentRead", "SampledFragment", "SampledCompute",
+    "StorageReadCompute", "StorageWriteCompute", "TransferSrc", "TransferDst", "VertexBuffer", "IndexBuffer",
+    "UniformBuffer", "IndirectBuffer", "ConditionalRendering", "Acquire", "Present"};
+
+} // namespace
+
+const AccessInfo& getAccessInfo(ResourceAccess access) {
+	return g_access_infos[static_cast<size_t>(access)];
+}
+
+const char* getAccessName(ResourceAccess access) {
+	return g_access_names[static_cast<size_t>(access)];
+}
+
+AccessInfo getLayoutAccess(VkImageLayout layout) {
+	switch (layout) {
+	case VK_IMAGE_LAYOUT_UNDEFINED:
+	case VK_IMAGE_LAYOUT_PREINITIALIZED:
+		// rien a attendre, le contenu est perdu
+		return {VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0, layout, false};
+	case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+		return getAccessInfo(ResourceAccess::TransferDst);
+	case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+		return getAccessInfo(ResourceAccess::TransferSrc);
+	case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+		return {VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_ACCESS_SHADER_READ_BIT, layout, false};
+	case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+		return getAccessInfo(ResourceAccess::ColorAttachmentWrite);
+	case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+		return getAccessInfo(ResourceAccess::DepthAttachmentWrite);
+	case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:
+		return {VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_SHADER_READ_BIT, layout, false};
+	case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+		return getAccessInfo(ResourceAccess::Present);
+	default:
+		return {VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT, layout, true};
+	}
+}
+
+const char* getLayoutName(VkImageLayout layout) {
+	switch (layout) {
+	case VK_IMAGE_LAYOUT_UNDEFINED:
+		return "UNDEFINED";
+	case VK_IMAGE_LAYOUT_GENERAL:
+		return "GENERAL";
+	case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+		return "COLOR_ATTACHMENT";
+	case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+		return "DEPTH_STENCIL_ATTACHMENT";
+	case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:
+		return "DEPTH_STENCIL_READ_ONLY";
+	case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+		return "SHADER_READ_ONLY";
+	case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+		return "TRANSFER_SRC";
+	case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+		return "TRANSFER_DST";
+	case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+		return "PRESENT_SRC";
+	default:
+		return "OTHER";
+	}
+}
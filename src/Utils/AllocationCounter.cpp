@@ -0,0 +1,98 @@
+#include <VulkanApp/Utils/AllocationCounter.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// remplace les operator new/delete globaux pour compter les allocations,
+// permet de verifier que drawFrame n'alloue rien une fois en régime établi. le compte par thread laisse de coté ce que
+// les autres threads font en arrière plan (compilation de pipelines, chargements)
+
+static std::atomic<uint64_t> s_allocationCount{0};
+// types triviaux : pas d'initialisation dynamique, utilisables dans operator new a tout moment de la vie du thread
+static thread_local uint64_t t_allocationCount = 0;
+static thread_local std::atomic<uint64_t>* t_scopeTotal = nullptr;
+
+uint64_t AllocationCounter::getCount() noexcept {
+	return s_allocationCount.load(std::memory_order_relaxed);
+}
+
+uint64_t AllocationCounter::getThreadCount() noexcept {
+	return t_allocationCount;
+}
+
+AllocationCounter::Scope::Scope(std::atomic<uint64_t>& total) noexcept : m_previous(t_scopeTotal) {
+	t_scopeTotal = &total;
+}
+
+AllocationCounter::Scope::~Scope() {
+	t_scopeTotal = m_previous;
+}
+
+static void countAllocation() noexcept {
+	s_allocationCount.fetch_add(1, std::memory_order_relaxed);
+	if (t_scopeTotal) {
+		t_scopeTotal->fetch_add(1, std::memory_order_relaxed);
+	} else {
+		++t_allocationCount;
+	}
+}
+
+static void* countedAlloc(std::size_t size) {
+	countAllocation();
+	void* ptr = std::malloc(size ? size : 1);
+	if (!ptr)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+static void* countedAlignedAlloc(std::size_t size, std::align_val_t alignment) {
+	countAllocation();
+	std::size_t align = static_cast<std::size_t>(alignment);
+#ifdef _WIN32
+	void* ptr = _aligned_malloc(size ? size : 1, align);
+#else
+	void* ptr = std::aligned_alloc(align, ((size ? size : 1) + align - 1) & ~(align - 1));
+#endif
+	if (!ptr)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+static void alignedFree(void* ptr) noexcept {
+#ifdef _WIN32
+	_aligned_free(ptr);
+#else
+	std::free(ptr);
+#endif
+}
+
+void* operator new(std::size_t size) { return countedAlloc(size); }
+void* operator new[](std::size_t size) { return countedAlloc(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+	try {
+		return countedAlloc(size);
+	} catch (...) {
+		return nullptr;
+	}
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+	try {
+		return countedAlloc(size);
+	} catch (...) {
+		return nullptr;
+	}
+}
+void* operator new(std::size_t size, std::align_val_t alignment) { return countedAlignedAlloc(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return countedAlignedAlloc(size, alignment); }
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { alignedFree(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { alignedFree(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { alignedFree(ptr); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept { alignedFree(ptr); }
@@ -0,0 +1,44 @@
+#include <VulkanApp/Utils/FrameArena.h>
+
+#include <algorithm>
+
+static size_t alignUp(size_t value, size_t alignment) {
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+void FrameArena::init(size_t capacity) {
+	m_buffer = std::make_unique<std::byte[]>(capacity);
+	m_capacity = capacity;
+	m_used = 0;
+}
+
+/// @brief Releases everything allocated since the last reset.
+/// If the previous frame overflowed, the buffer grows so the same workload fits without heap allocations
+void FrameArena::reset() {
+	if (!m_overflow.empty()) {
+		size_t needed = m_used + m_overflowBytes;
+		m_overflow.clear();
+		m_overflowBytes = 0;
+		init(std::max(m_capacity * 2, needed * 2));
+		return;
+	}
+	m_used = 0;
+}
+
+/// @brief Bumps the offset, never returns nullptr. the address is aligned, not the offset : new[] only guarantees the
+/// fundamental alignment for the base of the buffer
+void* FrameArena::allocate(size_t size, size_t alignment) {
+	auto base = reinterpret_cast<uintptr_t>(m_buffer.get());
+	size_t offset = alignUp(base + m_used, alignment) - base;
+	if (offset + size <= m_capacity) {
+		m_used = offset + size;
+		m_highWater = std::max(m_highWater, m_used);
+		return m_buffer.get() + offset;
+	}
+
+	// new[] garantit l'alignement fondamental, on ajoute de la marge pour les types sur-alignés
+	m_overflow.push_back(std::make_unique<std::byte[]>(size + alignment));
+	m_overflowBytes += size + alignment;
+	auto address = reinterpret_cast<uintptr_t>(m_overflow.back().get());
+	return reinterpret_cast<void*>(alignUp(address, alignment));
+}
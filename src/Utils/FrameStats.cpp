@@ -0,0 +1,45 @@
+#include <VulkanApp/Utils/FrameStats.h>
+
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+
+void FrameStats::init(size_t capacity) {
+	m_samples.clear();
+	m_samples.reserve(capacity);
+}
+
+/// @brief Drops the sample once the reserved capacity is reached
+void FrameStats::add(double milliseconds) {
+	if (m_samples.size() < m_samples.capacity()) {
+		m_samples.push_back(milliseconds);
+	}
+}
+
+double FrameStats::average() const {
+	if (m_samples.empty())
+		return 0.0;
+	return std::accumulate(m_samples.begin(), m_samples.end(), 0.0) / static_cast<double>(m_samples.size());
+}
+
+/// @param p in [0, 1], 0.99 gives the time 99% of the frames are under
+double FrameStats::percentile(double p) const {
+	if (m_samples.empty())
+		return 0.0;
+
+	std::vector<double> sorted = m_samples;
+	std::sort(sorted.begin(), sorted.end());
+	size_t index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+	return sorted[std::min(index, sorted.size() - 1)];
+}
+
+double FrameStats::max() const {
+	if (m_samples.empty())
+		return 0.0;
+	return *std::max_element(m_samples.begin(), m_samples.end());
+}
+
+void FrameStats::print(const char* label) const {
+	std::cout << label << ": " << count() << " frames, avg " << average() << " ms, p50 " << percentile(0.5)
+		  << " ms, p99 " << percentile(0.99) << " ms, max " << max() << " ms" << '\n';
+}
@@ -0,0 +1,58 @@
+#include <VulkanApp/Utils/GpuTimer.h>
+
+#include <stdexcept>
+
+/// @brief Creates two timestamp queries per frame slot, does nothing if the graphics queue cannot write timestamps
+void GpuTimer::init(VulkanContext* context, uint32_t frameCount) {
+	m_context = context;
+	m_submitted.assign(frameCount, false);
+
+	VkPhysicalDeviceProperties properties{};
+	vkGetPhysicalDeviceProperties(m_context->getPhysicalDevice(), &properties);
+	if (!properties.limits.timestampComputeAndGraphics)
+		return;
+	m_timestampPeriod = properties.limits.timestampPeriod;
+
+	VkQueryPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	poolInfo.queryCount = frameCount * 2;
+
+	if (vkCreateQueryPool(m_context->getDevice(), &poolInfo, nullptr, &m_queryPool) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create timestamp query pool!");
+	}
+}
+
+void GpuTimer::cleanup() noexcept {
+	vkDestroyQueryPool(m_context->getDevice(), m_queryPool, nullptr);
+	m_queryPool = VK_NULL_HANDLE;
+	m_submitted.clear();
+}
+
+void GpuTimer::begin(VkCommandBuffer commandBuffer, uint32_t frame) {
+	if (!isSupported())
+		return;
+	// le reset est dans le command buffer, un primary resoumis depuis le cache repart de queries propres
+	vkCmdResetQueryPool(commandBuffer, m_queryPool, frame * 2, 2);
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_queryPool, frame * 2);
+}
+
+void GpuTimer::end(VkCommandBuffer commandBuffer, uint32_t frame) {
+	if (!isSupported())
+		return;
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_queryPool, frame * 2 + 1);
+}
+
+bool GpuTimer::getMilliseconds(uint32_t frame, double& milliseconds) const {
+	if (!isSupported() || !m_submitted[frame])
+		return false;
+
+	uint64_t timestamps[2]{};
+	VkResult result = vkGetQueryPoolResults(m_context->getDevice(), m_queryPool, frame * 2, 2, sizeof(timestamps), timestamps,
+						sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+	if (result != VK_SUCCESS)
+		return false;
+
+	milliseconds = static_cast<double>(timestamps[1] - timestamps[0]) * m_timestampPeriod / 1000000.0;
+	return true;
+}
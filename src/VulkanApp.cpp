@@ -8,6 +8,7 @@
 
 #include <VulkanApp/Core/VulkanContext.h>
 
+#include <VulkanApp/Utils/AllocationCounter.h>
 #include <VulkanApp/Utils/Uniforms.h>
 
 
@@ -19,6 +20,7 @@
 #include <GLFW/glfw3.h>
 #include <algorithm>
 #include <chrono>
+#include <cstddef>
 #include <cstring>
 #include <fstream>
 #include <glm/glm.hpp>
@@ -34,6 +36,7 @@ void VulkanApp::initWindow() {
 	m_window = glfwCreateWindow(g_screen_width, g_screen_height, "Vulkan App", nullptr, nullptr);
 	glfwSetWindowUserPointer(m_window, this);
 	glfwSetFramebufferSizeCallback(m_window, VulkanApp::framebufferResizeCallback);
+	glfwSetWindowRefreshCallback(m_window, VulkanApp::windowRefreshCallback);
 
 	glfwSetKeyCallback(m_window, VulkanApp::keyCallback);
 }
@@ -48,6 +51,64 @@ void VulkanApp::onKey(int key, int scancode, int action, int mods) {
 	if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
 		glfwSetWindowShouldClose(m_window, GLFW_TRUE);
 	}
+	if (key == GLFW_KEY_F && action == GLFW_PRESS) {
+		printMemoryStats();
+		m_defragmenter.begin();
+	}
+	if (key == GLFW_KEY_M && action == GLFW_PRESS) {
+		printMemoryStats();
+	}
+	// matériau sans back-face culling : la première fois la variante compile en arrière plan, le rendu continue avec le fallback
+	if (key == GLFW_KEY_V && action == GLFW_PRESS) {
+		if (m_twoSidedVariant == 0) {
+			PipelineDesc desc = m_pipeline.getDesc();
+			desc.cullMode = VK_CULL_MODE_NONE;
+			m_twoSidedVariant = m_pipelines.request(desc);
+		}
+		m_materialVariant = m_materialVariant == 0 ? m_twoSidedVariant : 0;
+		invalidateCommandBuffers();
+		// avec la prepass le changement attend que ses variantes soient compilées
+		if (m_prepassRequested.depth != 0) {
+			requestPrepassVariants();
+		}
+	}
+	// prepass de profondeur, activée par updateDepthPrepass une fois ses pipelines prêtes
+	if (key == GLFW_KEY_P && action == GLFW_PRESS) {
+		m_options.depthPrepass = !m_options.depthPrepass;
+		if (m_options.depthPrepass && m_prepassRequested.depth == 0) {
+			requestPrepassVariants();
+		}
+	}
+	// culling d'occlusion sur le gpu, activé par updateDepthPrepass une fois ses variantes indirectes prêtes
+	if (key == GLFW_KEY_H && action == GLFW_PRESS) {
+		if (m_hizSupported) {
+			m_options.hizCulling = !m_options.hizCulling;
+		} else {
+			std::cout << "Hi-Z culling: not supported" << '\n';
+		}
+	}
+	// occlusion queries, activées par updateDepthPrepass une fois la pipeline des boites prête
+	if (key == GLFW_KEY_O && action == GLFW_PRESS) {
+		if (m_occlusionSupported) {
+			m_options.occlusionQueries = !m_options.occlusionQueries;
+		} else {
+			std::cout << "Occlusion queries: not supported" << '\n';
+		}
+	}
+	// presets de qualité, appliqués par mainLoop entre deux frames
+	if (key >= GLFW_KEY_F1 && key <= GLFW_KEY_F4 && action == GLFW_PRESS) {
+		m_requestedQuality = static_cast<QualityPreset>(key - GLFW_KEY_F1);
+	}
+	// 1 pour l'interactif (latence minimale), 3-4 pour du débit, 0 laisse le tuner choisir
+	if (key >= GLFW_KEY_1 && key <= GLFW_KEY_4 && action == GLFW_PRESS) {
+		m_autoFramesInFlight = false;
+		m_requestedFramesInFlight = static_cast<uint32_t>(key - GLFW_KEY_0);
+	}
+	if (key == GLFW_KEY_0 && action == GLFW_PRESS) {
+		m_autoFramesInFlight = true;
+		m_framesTuner.init(2, g_max_frames_in_flight);
+		std::cout << "Frames in flight: auto" << '\n';
+	}
 }
 
 void VulkanApp::processInput(float dt) {
@@ -66,56 +127,353 @@ void VulkanApp::processInput(float dt) {
 	}
 }
 
+/// @brief In low latency mode drawFrame calls it itself, right after the acquire. only the state of the keys is read,
+/// the events are polled by mainLoop so that no callback runs in a half built frame
+void VulkanApp::sampleInput() {
+	double current = glfwGetTime();
+	processInput(static_cast<float>(current - m_lastInput));
+	m_lastInput = current;
+	m_pacer.markInput(m_frameNumber);
+}
+
 void VulkanApp::mainLoop() {
 
+	m_frameStats.init(m_options.benchFrames);
+	m_recordStats.init(m_options.benchFrames);
+	m_gpuStats.init(m_options.benchFrames);
+	m_gpuDirectStats.init(m_options.benchFrames);
+	m_gpuPrepassStats.init(m_options.benchFrames);
+	m_gpuHiZStats.init(m_options.benchFrames);
+	m_gpuOcclusionStats.init(m_options.benchFrames);
+	m_pacer.init(&m_context, m_options.targetFps, m_options.benchFrames);
+	m_lastFrame = glfwGetTime();
+	m_lastInput = m_lastFrame;
+	m_loopRunning = true;
+
 	while (!glfwWindowShouldClose(m_window)) {
+		if (m_options.benchFrames > 0 && m_frameNumber >= m_options.benchFrames)
+			break;
+
+		m_pacer.limit();
 
 		double current = glfwGetTime();
 		m_deltaTime = static_cast<float>(current - m_lastFrame);
 		m_lastFrame = current;
+		if (m_frameNumber > 0) {
+			m_frameStats.add(m_deltaTime * 1000.0);
+		}
 
-		processInput(m_deltaTime);
+		// basse latence : la frame précédente doit être a l'écran avant de lire les entrées de celle ci,
+		// sans present wait on se contente de la fin de son rendu
+		if (m_options.lowLatency && m_frameNumber > 0) {
+			if (m_context.hasPresentWait()) {
+				m_pacer.waitPresented(m_swapchain.getSwapChain(), m_frameNumber - 1);
+			} else {
+				m_frameTimeline.waitForFrame(m_frameNumber - 1);
+			}
+		}
+		// les callbacks des touches et du resize s'éxécutent ici, entre deux frames, jamais pendant drawFrame
 		glfwPollEvents();
+		// de même pour les appels GLFW demandés par les jobs
+		m_jobs.runMainThreadJobs();
+		if (!m_options.lowLatency) {
+			sampleInput();
+		}
+		// entre deux frames, drawFrame ne doit pas allouer
+		if (m_requestedFramesInFlight != 0) {
+			setFramesInFlight(m_requestedFramesInFlight);
+			m_requestedFramesInFlight = 0;
+		}
+		if (m_requestedQuality) {
+			applyQualityPreset(*m_requestedQuality);
+			m_requestedQuality.reset();
+		}
+		if (m_options.resizeBench) {
+			m_jobs.submit([this, frame = m_frameNumber] { scriptResize(frame); });
+		}
+		if (m_options.prepassBench && m_frameNumber == m_options.benchFrames / 2) {
+			m_options.depthPrepass = true;
+		}
+		updateDepthPrepass();
 		drawFrame();
 	}
+	m_loopRunning = false;
+
+	waitForFrames();
+
+	if (m_options.benchFrames > 0) {
+		printBenchmark();
+	}
+}
 
-	vkDeviceWaitIdle(m_context.getDevice());
+void VulkanApp::printBenchmark() {
+	bool concurrent = m_options.concurrentSharing && m_transferUploads.getQueueFamily() != m_graphicsUploads.getQueueFamily();
+	std::cout << "Sharing mode: " << (concurrent ? "CONCURRENT" : "EXCLUSIVE + ownership transfers")
+		  << (m_transferUploads.getQueueFamily() == m_graphicsUploads.getQueueFamily() ? " (single queue family)" : "") << '\n';
+	std::cout << "Uploads: " << m_uploadMilliseconds << " ms" << '\n';
+	std::cout << "Pipelines: " << m_pipelineMilliseconds << " ms, " << (m_pipelineCache.isWarm() ? "warm" : "cold") << " cache" << '\n';
+	std::cout << "Quality: " << getQualityName(m_options.quality) << ", msaa " << m_quality.msaaSamples << "x, render " << m_renderExtent.width << "x"
+		  << m_renderExtent.height << '\n';
+	std::cout << "Descriptors: " << m_descriptorAllocator.getPoolCount() << " pools, " << m_descriptorAllocator.getCachedCount() << " cached sets" << '\n';
+	std::cout << "Heap allocations: " << m_steadyAllocations << " in " << m_steadyFrames << " steady state frames" << '\n';
+	m_frameStats.print("Frames");
+	std::cout << "Pacing: " << (m_options.lowLatency ? "low latency" : "queued") << ", fps limit ";
+	if (m_options.targetFps > 0.0) {
+		std::cout << m_options.targetFps;
+	} else {
+		std::cout << "none";
+	}
+	std::cout << ", latency measured up to " << (m_pacer.measuresDisplay() ? "display (present wait)" : "vkQueuePresentKHR") << '\n';
+	m_pacer.getLatency().print("Input to present");
+	std::cout << "Swapchain: " << m_swapchainRecreations << " recreations for " << m_resizeEvents << " resize events" << '\n';
+	std::cout << "Rendering: " << (m_options.dynamicRendering ? "dynamic rendering" : "render pass + framebuffers") << '\n';
+	std::cout << "Recording: " << m_visibleDraws.size() << "/" << m_drawList.size() << " draws visible on " << m_recorder.getThreadCount() << " threads, "
+		  << (m_options.cacheCommands ? "cached command buffers" : "recorded every frame") << '\n';
+	if (m_hizCountedFrames > 0) {
+		std::cout << "Hi-Z: " << m_hizEarlyDraws / m_hizCountedFrames << " early + " << m_hizLateDraws / m_hizCountedFrames << " late of "
+			  << m_hiz.getDrawCount() << " draws per frame" << '\n';
+	}
+	if (m_occlusionCountedFrames > 0) {
+		std::cout << "Occlusion queries: " << m_occlusionSkipped / m_occlusionCountedFrames << " of " << m_occlusionTested / m_occlusionCountedFrames
+			  << " tested draws skipped per frame, "
+			  << (m_occlusion.usesConditionalRendering() ? "conditional rendering" : "cpu readback, at least one frame late") << '\n';
+	}
+	m_recordStats.print("Record");
+	std::cout << "Frames in flight: " << m_framesInFlight << (m_autoFramesInFlight ? " (auto)" : "") << '\n';
+	if (m_gpuStats.count() > 0) {
+		m_gpuStats.print("GPU");
+	}
+	// --prepass-bench, touches P et H : chaque mode sur la même scène
+	if (m_gpuPrepassStats.count() > 0 || m_gpuHiZStats.count() > 0 || m_gpuOcclusionStats.count() > 0) {
+		if (m_gpuDirectStats.count() > 0) {
+			m_gpuDirectStats.print("GPU without prepass");
+		}
+		if (m_gpuPrepassStats.count() > 0) {
+			m_gpuPrepassStats.print("GPU with depth prepass");
+		}
+		if (m_gpuHiZStats.count() > 0) {
+			m_gpuHiZStats.print("GPU with Hi-Z culling");
+		}
+		if (m_gpuOcclusionStats.count() > 0) {
+			m_gpuOcclusionStats.print("GPU with occlusion queries");
+		}
+	}
 }
 
 void VulkanApp::framebufferResizeCallback(GLFWwindow* window, int width, int height) {
 	auto app = reinterpret_cast<VulkanApp*>(glfwGetWindowUserPointer(window));
-	app->setResized(true);
+	app->onFramebufferResize();
+}
+
+void VulkanApp::onFramebufferResize() {
+	m_framebufferResized = true;
+	m_lastResizeEvent = glfwGetTime();
+	m_resizeEvents++;
+}
+
+bool VulkanApp::isResizeSettled() const {
+	return glfwGetTime() - m_lastResizeEvent >= g_resize_debounce_seconds;
+}
+
+/// @brief Some platforms run a modal loop inside glfwPollEvents while a window edge is dragged, the main loop is
+/// blocked until the button is released. GLFW asks for a refresh from that loop, a frame is drawn so the window keeps
+/// presenting during the resize
+void VulkanApp::windowRefreshCallback(GLFWwindow* window) {
+	auto app = reinterpret_cast<VulkanApp*>(glfwGetWindowUserPointer(window));
+	if (!app->m_loopRunning || app->m_inDrawFrame)
+		return;
+	app->drawFrame();
+}
+
+/// @brief Drags the bottom right corner back and forth for g_resize_bench_phase_frames, then holds still as long so the
+/// debounced recreation happens, like a user resizing in steps. runs as a job, the window is resized by the main
+/// thread between two frames
+void VulkanApp::scriptResize(uint64_t frame) {
+	uint64_t phase = frame / g_resize_bench_phase_frames;
+	if (phase % 2 == 1 || frame % g_resize_bench_step_frames != 0)
+		return;
+
+	// aller-retour de 0 a g_resize_bench_phase_frames / g_resize_bench_step_frames pas
+	int steps = static_cast<int>(g_resize_bench_phase_frames / g_resize_bench_step_frames);
+	int step = static_cast<int>((frame % g_resize_bench_phase_frames) / g_resize_bench_step_frames);
+	int offset = (step < steps / 2 ? step : steps - step) * g_resize_bench_step_pixels;
+	int width = static_cast<int>(g_screen_width) + offset;
+	int height = static_cast<int>(g_screen_height) + offset / 2;
+	m_jobs.submit([this, width, height] { glfwSetWindowSize(m_window, width, height); }, nullptr, JobAffinity::MainThread);
 }
 
 
 void VulkanApp::initVulkan() {
 
+	m_jobs.init(m_options.threads == 0 ? JobSystem::getDefaultWorkerCount() : m_options.threads - 1);
+	// lecture de l'obj (et dedup des vertices) et décodage du png pendant la création des objets vulkan
+	m_jobs.submit([this] { loadMesh(); }, &m_loading);
+	m_jobs.submit([this] { decodeTexture(); }, &m_loading);
+
 	m_context.init(m_window, true);
+	m_framesInFlight = std::clamp(m_options.framesInFlight, 1u, g_max_frames_in_flight);
+	m_autoFramesInFlight = m_options.autoFramesInFlight;
+	m_framesTuner.init(2, g_max_frames_in_flight);
+	m_allocator.init(&m_context);
+	m_deletionQueue.init(&m_context, &m_allocator);
+	m_defragmenter.init(&m_context, &m_allocator, &m_deletionQueue);
 	m_swapchain.init(&m_context, m_window);
-	m_renderPass.init(&m_context, &m_swapchain);
+	m_depthFormat = RenderPass::findDepthFormat(&m_context);
+	// le preset de départ, limité par le gpu : le render pass, les pipelines, le sampler et le graph en dépendent
+	m_quality = resolveQualitySettings(&m_context, m_options.quality, m_swapchain.canUpscale());
+	m_context.setMsaaSamples(m_quality.msaaSamples);
+	// avec dynamic rendering les attachments sont donnés a vkCmdBeginRendering, pas de render pass
+	if (!m_options.dynamicRendering) {
+		m_renderPass.init(&m_context, &m_swapchain);
+	}
 
 	createCommandPools();
 	createUniformBuffer();
 
+	// cibles msaa et depth, créées par le graph, puis les framebuffers avant les command buffers
+	// (le cache en a un par image de la swapchain)
+	m_renderGraph.init(&m_context, &m_allocator, &m_deletionQueue);
+	buildRenderGraph();
+
+	// le thread principal aide a finir le chargement, une erreur de lecture est relancée ici
+	m_jobs.wait(m_loading);
+
 	createTextureImage();
 	createTextureImageView();
 	createTextureImageSampler();
 
-	m_descriptors.init(&m_context, g_max_frames_in_flight, m_uniformBuffers, m_textureImageView, m_textureSampler);
-
-	m_pipeline.init(&m_context, m_renderPass.get(), m_descriptors.getSetLayout());
+	// les transformations des objets sont dans le set de la frame
+	buildDrawList();
+	createObjectBuffer();
+
+	m_descriptorAllocator.init(&m_context, m_framesInFlight);
+	m_descriptors.init(&m_context, &m_descriptorAllocator, m_framesInFlight, m_uniformBuffers, m_textureImageView, m_textureSampler);
+	m_descriptorsDirty.assign(m_framesInFlight, false);
+
+	// toutes les créations de pipelines passent par le même cache, relu au prochain lancement
+	m_pipelineCache.init(&m_context);
+	double pipelineStart = glfwGetTime();
+	PipelineDesc baseDesc;
+	baseDesc.samples = m_context.getMsaaSamples();
+	baseDesc.sampleShading = m_quality.minSampleShading > 0.0f;
+	baseDesc.minSampleShading = m_quality.minSampleShading;
+	if (m_options.dynamicRendering) {
+		baseDesc.colorFormat = m_swapchain.getImageFormat();
+		baseDesc.depthFormat = m_depthFormat;
+	} else {
+		baseDesc.renderPass = m_renderPass.get();
+	}
+	m_pipeline.init(&m_context, baseDesc, m_descriptors.getSetLayout(), m_pipelineCache.get());
+	m_pipelineMilliseconds = (glfwGetTime() - pipelineStart) * 1000.0;
+	m_pipelines.init(&m_context, &m_jobs, m_pipeline.getLayout(), m_pipelineCache.get(), m_pipeline.getDesc(), m_pipeline.get());
+	std::cout << "Pipelines: " << m_pipelineMilliseconds << " ms, "
+		  << (m_pipelineCache.isWarm() ? "warm cache (" + std::to_string(m_pipelineCache.getLoadedBytes()) + " bytes)" : std::string("cold")) << '\n';
+
+	// --hiz : draws comptés sur le gpu et depth buffer lu par un compute shader
+	m_hizSupported = HiZCulling::isSupported(&m_context, m_depthFormat) && !m_drawList.empty();
+	if (m_hizSupported) {
+		m_hiz.init(&m_context, &m_allocator, &m_descriptorAllocator, &m_deletionQueue, &m_graphicsUploads, m_pipelineCache.get(), g_max_frames_in_flight);
+		std::vector<CullDraw> cullDraws;
+		cullDraws.reserve(m_drawList.size());
+		for (const DrawItem& draw : m_drawList) {
+			cullDraws.push_back({glm::vec4(draw.center, draw.radius), draw.indexCount, draw.firstIndex, draw.vertexOffset, draw.objectId});
+		}
+		m_hiz.setDraws(cullDraws);
+	} else if (m_options.hizCulling) {
+		std::cout << "Hi-Z culling: not supported" << '\n';
+		m_options.hizCulling = false;
+	}
+	// --occlusion : au plus une query par draw et par frame, la boite part avec les uploads du mesh
+	m_occlusionSupported = !m_drawList.empty();
+	if (m_occlusionSupported) {
+		m_occlusion.init(&m_context, &m_allocator, &m_graphicsUploads, static_cast<uint32_t>(m_drawList.size()), g_max_frames_in_flight);
+	}
+	if (m_options.depthPrepass || m_options.prepassBench || m_options.hizCulling || m_options.occlusionQueries) {
+		requestPrepassVariants();
+	}
 
-	createColorRessources();
-	createDepthResources();
+	createMeshBuffer();
+	submitUploads();
 
+	createCommandBuffers();
+	m_frameTimeline.init(&m_context);
+	createSyncObjects();
+	createFrameArenas();
+	m_gpuTimer.init(&m_context, m_framesInFlight);
+}
 
-	loadMesh();
-	createMeshBuffer();
+/// @brief Per-frame resources for m_framesInFlight slots, the recorder and descriptor allocator already exist
+void VulkanApp::createFrameResources() {
+	createUniformBuffer();
+	m_descriptorAllocator.setFramesInFlight(m_framesInFlight);
+	m_descriptors.resize(m_framesInFlight, m_uniformBuffers, m_textureImageView, m_textureSampler);
+	m_descriptorsDirty.assign(m_framesInFlight, false);
+	// les nouveaux uniform buffers peuvent reprendre les handles des anciens, aucun set n'est gardé, même Hi-Z
+	// désactivé : le cache rendrait un set qui pointe encore sur les buffers détruits
+	if (m_hizSupported) {
+		m_hiz.evictDescriptors();
+	}
+	if (m_hizCulling) {
+		m_hiz.updateDescriptors(m_uniformBuffers, m_objectBuffer, m_renderGraph.getImageView(m_depthTarget), m_context.getMsaaSamples());
+	}
+	m_recorder.setFramesInFlight(m_framesInFlight);
+	m_compute.setFramesInFlight(m_framesInFlight);
 
 	createCommandBuffers();
 	createSyncObjects();
+	createFrameArenas();
+	m_gpuTimer.init(&m_context, m_framesInFlight);
+}
+
+/// @brief None of these may still be used by the GPU, the descriptor sets and secondaries go with their pools
+void VulkanApp::destroyFrameResources() noexcept {
+	for (size_t i = 0; i < m_uniformBuffers.size(); i++) {
+		vkDestroyBuffer(m_context.getDevice(), m_uniformBuffers[i], nullptr);
+		m_allocator.free(m_uniformBuffersAllocation[i]);
+	}
+	m_uniformBuffers.clear();
+	m_uniformBuffersAllocation.clear();
+	m_uniformBuffersMapped.clear();
+
+	for (size_t i = 0; i < m_imageAvailableSemaphores.size(); i++) {
+		vkDestroySemaphore(m_context.getDevice(), m_imageAvailableSemaphores[i], nullptr);
+		vkDestroySemaphore(m_context.getDevice(), m_renderFinishedSemaphores[i], nullptr);
+	}
+	m_imageAvailableSemaphores.clear();
+	m_renderFinishedSemaphores.clear();
+
+	if (!m_commandBuffers.empty()) {
+		vkFreeCommandBuffers(m_context.getDevice(), m_commandPool, static_cast<uint32_t>(m_commandBuffers.size()), m_commandBuffers.data());
+	}
+	if (!m_cachedCommandBuffers.empty()) {
+		vkFreeCommandBuffers(m_context.getDevice(), m_commandPool, static_cast<uint32_t>(m_cachedCommandBuffers.size()), m_cachedCommandBuffers.data());
+	}
+	m_commandBuffers.clear();
+	m_cachedCommandBuffers.clear();
+	m_cachedCommandBuffersValid.clear();
+
+	m_gpuTimer.cleanup();
+	m_frameArenas.clear();
+}
+
+/// @brief Waits once for every frame then rebuilds the per-frame resources, a setting change and not a per-frame cost.
+/// the frame timeline and the deletion queue count frames, not slots, and are left untouched
+void VulkanApp::setFramesInFlight(uint32_t count) {
+	count = std::clamp(count, 1u, g_max_frames_in_flight);
+	if (count == m_framesInFlight)
+		return;
+
+	waitForFrames();
+	// la timeline ne couvre pas la présentation qui peut encore attendre un renderFinished
+	m_context.getQueues().waitIdle(QueueRole::Present);
+
+	destroyFrameResources();
+	m_framesInFlight = count;
+	createFrameResources();
 
-    m_swapchain.createFrameBuffers(m_renderPass.get(), m_depthImageView, m_colorImageView);
+	// le slot reste m_frameNumber % m_framesInFlight
+	m_currentFrame = static_cast<int>(m_frameNumber % m_framesInFlight);
+	std::cout << "Frames in flight: " << m_framesInFlight << (m_autoFramesInFlight ? " (auto)" : "") << '\n';
 }
 
 void VulkanApp::createCommandPools() {
@@ -138,37 +496,38 @@ void VulkanApp::createCommandPools() {
 		std::cout << "Command pool created" << '\n';
 	}
 
-	VkCommandPoolCreateInfo poolTransferInfo{};
-	poolTransferInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-	poolTransferInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
-	poolTransferInfo.queueFamilyIndex = queueFamilyIndices.transferFamily.value();
+	// les transferts ont leur propre pool dans m_transferUploads
+	// chacun sa queue quand la famille en a assez, les uploads ne bloquent jamais la soumission du rendu
+	m_transferUploads.init(&m_context, &m_allocator, QueueRole::Transfer);
+	m_graphicsUploads.init(&m_context, &m_allocator, QueueRole::GraphicsUploads);
 
-	if (vkCreateCommandPool(m_context.getDevice(), &poolTransferInfo, nullptr, &m_commandPoolTransfer) != VK_SUCCESS) {
-		throw std::runtime_error("failed to create command pool!");
-	} else {
-		std::cout << "Command pool created" << '\n';
-	}
+	m_recorder.init(&m_context, &m_jobs, queueFamilyIndices.graphicsFamily.value(), m_framesInFlight);
+	m_compute.init(&m_context, m_framesInFlight);
+	m_recordDraws = [this](VkCommandBuffer commandBuffer, uint32_t first, uint32_t count) {
+		AllocationCounter::Scope allocations(m_jobAllocations);
+		recordDraws(commandBuffer, first, count);
+	};
 }
 
-void VulkanApp::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkSharingMode sharingMode, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
+void VulkanApp::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkSharingMode sharingMode, VkMemoryPropertyFlags properties, VkBuffer& buffer, Allocation& bufferAllocation, bool defragmentable) {
 
 	VkBufferCreateInfo bufferInfo{};
 	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 	bufferInfo.size = size;
 	bufferInfo.usage = usage;
-	bufferInfo.sharingMode = sharingMode;
 
-	auto indices = m_context.getQueueFamilies();
-	std::set<uint32_t> uniqueIndices = {
-	    indices.graphicsFamily.value(),
-	    indices.transferFamily.value(),
-	};
-	std::vector<uint32_t> queueFamilyIndices(uniqueIndices.begin(), uniqueIndices.end());
+	uint32_t queueFamilyIndices[3];
+	uint32_t familyCount = m_context.getSharingFamilies(queueFamilyIndices);
+	// CONCURRENT demande au moins deux familles différentes, sinon EXCLUSIVE est équivalent
+	if (familyCount < 2) {
+		sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	}
+	bufferInfo.sharingMode = sharingMode;
 
 	if (sharingMode == VK_SHARING_MODE_CONCURRENT) {
 		// on défini les queues qui vont acceder a notre buffer
-		bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(queueFamilyIndices.size());
-		bufferInfo.pQueueFamilyIndices = queueFamilyIndices.data();
+		bufferInfo.queueFamilyIndexCount = familyCount;
+		bufferInfo.pQueueFamilyIndices = queueFamilyIndices;
 	} else {
 		bufferInfo.queueFamilyIndexCount = 0;
 		bufferInfo.pQueueFamilyIndices = nullptr;
@@ -180,23 +539,18 @@ void VulkanApp::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkShar
 	VkMemoryRequirements memRequirements;
 	vkGetBufferMemoryRequirements(m_context.getDevice(), buffer, &memRequirements);
 
-	VkMemoryAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memRequirements.size;
-	allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+	bufferAllocation = m_allocator.allocate(memRequirements, properties, true);
 	// VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, permet de ne pas flush la mémoire, on s'assure que la mémoire mappé
 	// match le contenu de la mémoire alloué, peut etre moins performant que flush mais pas important pour l'instant
+	// l'allocator sous-alloue dans de gros blocs, un vkAllocateMemory par ressource atteint vite maxMemoryAllocationCount
 
-	if (vkAllocateMemory(m_context.getDevice(), &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-		// alloue la mémoire, en fonction de VK_MEMORY_PROPERTY, sur le gpu ou la ram
-		throw std::runtime_error("failed to allocate vertex buffer memory");
-	}
-	// normalement
+	vkBindBufferMemory(m_context.getDevice(), buffer, bufferAllocation.memory, bufferAllocation.offset);
+	// fait le lien entre l'object buffer et l'espace mémoire attribué
+	// dernier param : offset dans le bloc, l'allocator le garde divisible par memRequirements.alignment
 
-	vkBindBufferMemory(m_context.getDevice(), buffer, bufferMemory, 0);
-	// fait le lien entre l'object buffer et l'espace mémoire attribué a bufferMemory
-	// dernier param : offset, ici 0, si c'est différent de 0,
-	// l'offset doit etre divisible par memRequirements.alignment
+	if (defragmentable) {
+		m_defragmenter.registerBuffer(&buffer, &bufferAllocation, bufferInfo);
+	}
 };
 
 void VulkanApp::createMeshBuffer() {
@@ -213,101 +567,130 @@ void VulkanApp::createMeshBuffer() {
 	VkDeviceSize bufferSize = m_indicesOffset + indicesSize;
 
 	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
+	Allocation stagingBufferAllocation;
 
 	createBuffer(
 	    bufferSize,
 	    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-	    VK_SHARING_MODE_CONCURRENT,
+	    VK_SHARING_MODE_EXCLUSIVE, // lu seulement par la transfer queue
 	    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-	    stagingBuffer, stagingBufferMemory);
+	    stagingBuffer, stagingBufferAllocation);
 	setObjectName(stagingBuffer, "MeshStagingBuffer");
 
-	void* data;
-	vkMapMemory(m_context.getDevice(), stagingBufferMemory, 0, bufferSize, 0, &data);
+	// le bloc host visible est mappé en permanence par l'allocator
+	void* data = stagingBufferAllocation.mapped;
 	memcpy(data, m_mesh.verticesData(), static_cast<size_t>(verticesSize));
 
 	memcpy(static_cast<char*>(data) + m_indicesOffset, m_mesh.indicesData(), static_cast<size_t>(indicesSize));
-	vkUnmapMemory(m_context.getDevice(), stagingBufferMemory);
 
 	createBuffer(
 	    bufferSize,
 	    VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-	    VK_SHARING_MODE_CONCURRENT,
-	    // sharing mode concurrent car va etre utilisé par la transfert queue et la graphics queue
-	    // comme j'ai fais en sorte de séparer les deux si possible
+	    getUploadSharingMode(),
+	    // utilisé par la transfert queue puis la graphics queue, en EXCLUSIVE la propriété est transférée explicitement
 	    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-	    m_meshBuffer, m_meshBufferMemory);
+	    m_meshBuffer, m_meshBufferAllocation, true);
 
 	setObjectName(m_meshBuffer, "MeshsssssBuffer");
 
-	copyBuffer(stagingBuffer, m_meshBuffer, bufferSize);
+	m_transferUploads.copyBuffer(stagingBuffer, m_meshBuffer, bufferSize);
+	m_transferUploads.releaseAfterUpload(stagingBuffer, stagingBufferAllocation);
 
-	vkDestroyBuffer(m_context.getDevice(), stagingBuffer, nullptr);
-	vkFreeMemory(m_context.getDevice(), stagingBufferMemory, nullptr);
+	if (!m_options.concurrentSharing) {
+		m_transferUploads.releaseBuffer(m_meshBuffer, m_graphicsUploads.getQueueFamily());
+		m_graphicsUploads.acquireBuffer(m_meshBuffer, m_transferUploads.getQueueFamily(), VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+						VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT);
+	}
 }
 
-void VulkanApp::createUniformBuffer() {
-	VkDeviceSize bufferSize = sizeof(UniformBufferObject);
+/// @brief Same path as the mesh: staged on the transfer queue then acquired by the graphics queue, where cull.comp
+/// reads it. the transforms never change after buildDrawList
+void VulkanApp::createObjectBuffer() {
+	VkDeviceSize bufferSize = sizeof(glm::mat4) * m_objectTransforms.size();
+
+	VkBuffer stagingBuffer;
+	Allocation stagingBufferAllocation;
 
-	m_uniformBuffers.resize(g_max_frames_in_flight);
-	m_uniformBuffersMemory.resize(g_max_frames_in_flight);
-	m_uniformBuffersMapped.resize(g_max_frames_in_flight);
+	createBuffer(
+	    bufferSize,
+	    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+	    VK_SHARING_MODE_EXCLUSIVE,
+	    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+	    stagingBuffer, stagingBufferAllocation);
+	setObjectName(stagingBuffer, "ObjectStagingBuffer");
 
-	for (int i{0}; i < g_max_frames_in_flight; ++i) {
+	memcpy(stagingBufferAllocation.mapped, m_objectTransforms.data(), static_cast<size_t>(bufferSize));
 
-		createBuffer(
-		    bufferSize,
-		    VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-		    VK_SHARING_MODE_EXCLUSIVE,
-		    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		    m_uniformBuffers[i], m_uniformBuffersMemory[i]);
+	// pas défragmentable : le handle est dans les sets en cache. avec une famille compute séparée la phase 0 du Hi-Z
+	// le lit en même temps que la queue graphics, un buffer EXCLUSIVE n'a qu'une famille propriétaire a la fois
+	VkSharingMode sharingMode = m_context.hasAsyncCompute() ? VK_SHARING_MODE_CONCURRENT : getUploadSharingMode();
+	createBuffer(
+	    bufferSize,
+	    VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+	    sharingMode,
+	    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+	    m_objectBuffer, m_objectBufferAllocation);
+	setObjectName(m_objectBuffer, "ObjectBuffer");
 
-		setObjectName(m_uniformBuffers[i], "UniformBuffer");
+	m_transferUploads.copyBuffer(stagingBuffer, m_objectBuffer, bufferSize);
+	m_transferUploads.releaseAfterUpload(stagingBuffer, stagingBufferAllocation);
 
-		vkMapMemory(m_context.getDevice(), m_uniformBuffersMemory[i], 0, bufferSize, 0, &m_uniformBuffersMapped[i]);
+	if (sharingMode == VK_SHARING_MODE_EXCLUSIVE) {
+		m_transferUploads.releaseBuffer(m_objectBuffer, m_graphicsUploads.getQueueFamily());
+		m_graphicsUploads.acquireBuffer(m_objectBuffer, m_transferUploads.getQueueFamily(), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
 	}
 }
 
-void VulkanApp::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
+/// @brief EXCLUSIVE unless --concurrent is given, createBuffer / createImage fall back to EXCLUSIVE with a single family
+VkSharingMode VulkanApp::getUploadSharingMode() const {
+	return m_options.concurrentSharing ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE;
+}
+
+/// @brief Submits the recorded uploads, one batch per queue, without waiting for them on the CPU
+/// the mipmaps batch waits for the texture copy on the GPU, the first frames wait for both
+void VulkanApp::submitUploads() {
+	m_transferTicket = m_transferUploads.submit();
+	if (m_transferTicket.value != 0) {
+		m_graphicsUploads.waitFor(m_transferUploads.getSemaphore(), m_transferTicket.value, VK_PIPELINE_STAGE_TRANSFER_BIT);
+	}
+	m_graphicsTicket = m_graphicsUploads.submit();
+
+	// en benchmark on mesure la latence complète des uploads, quitte à bloquer le cpu
+	if (m_options.benchFrames > 0) {
+		double start = glfwGetTime();
+		m_graphicsUploads.wait(m_graphicsTicket);
+		m_transferUploads.wait(m_transferTicket);
+		m_uploadMilliseconds = (glfwGetTime() - start) * 1000.0;
+	}
+}
 
-	VkCommandBuffer commandBuffer = beginSingleTimeCommands(m_commandPoolTransfer);
-	// commence a record sur la pool de transfer vu qu'on va copier des données
+/// @brief FrameUniforms then the clip matrix of each object, both rewritten by updateUniformBuffer
+void VulkanApp::createUniformBuffer() {
+	VkDeviceSize bufferSize = g_object_clip_offset + sizeof(glm::mat4) * getObjectCount();
 
-	VkBufferCopy copyRegion{};
-	copyRegion.srcOffset = 0; // Optional
-	copyRegion.dstOffset = 0; // Optional
-	copyRegion.size = size;
-	vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
-	// commande pour effectuer le transfer
+	m_uniformBuffers.resize(m_framesInFlight);
+	m_uniformBuffersAllocation.resize(m_framesInFlight);
+	m_uniformBuffersMapped.resize(m_framesInFlight);
 
-	endSingleTimeCommands(commandBuffer, m_commandPoolTransfer, m_context.getTransferQueue());
-}
+	for (uint32_t i{0}; i < m_framesInFlight; ++i) {
 
-// on a besoin de combiner les besoin de notre app et les besoins de notre buffer
-// on recupère le type de mémoire gpu qui nous permet ça
-uint32_t VulkanApp::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
-	VkPhysicalDeviceMemoryProperties memProperties;
-	vkGetPhysicalDeviceMemoryProperties(m_context.getPhysicalDevice(), &memProperties);
+		// lu aussi par la phase 0 du Hi-Z sur la queue compute
+		createBuffer(
+		    bufferSize,
+		    VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		    VK_SHARING_MODE_CONCURRENT,
+		    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		    m_uniformBuffers[i], m_uniformBuffersAllocation[i]);
 
-	// memProperties.memoryHeaps, ressources mémoire comme Vram, swap space in RAM (quand la vram est épuisé) ect.
-	// memProperties.memoryTypes, types de mémoire dans ces heaps
-	// on s'occupera pas de la heap, mais ca a un impact sur les perfs, dans d'autres applis faut vérifier
+		setObjectName(m_uniformBuffers[i], "UniformBuffer");
 
-	for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-		if (typeFilter & (1 << i) && (memProperties.memoryTypes[i].propertyFlags & properties))
-			// si i = 0 => 0001, i = 0 => 0010
-			// permet de vérifier si le type est compatible mais pas suffisant, ex : si typeFilter 1010, a i =1 ca se stopperai mais pas forcement bon
-			// on a rajoute le check sur les propriétés pour voir si c'est vraiment compatible
-			return i;
+		m_uniformBuffersMapped[i] = m_uniformBuffersAllocation[i].mapped;
 	}
-
-	throw std::runtime_error("failed to find suitable memory type!");
 }
 
 void VulkanApp::createCommandBuffers() {
 
-	m_commandBuffers.resize(g_max_frames_in_flight);
+	m_commandBuffers.resize(m_framesInFlight);
 
 	VkCommandBufferAllocateInfo allocInfo{};
 	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -321,9 +704,92 @@ void VulkanApp::createCommandBuffers() {
 	} else {
 		std::cout << "Command buffer created" << '\n';
 	}
+
+	m_commandsDirty.assign(m_framesInFlight, true);
+	allocateCachedCommandBuffers();
+}
+
+/// @brief Grows the cache to the current swapchain image count. buffers are never freed before cleanup,
+/// a frame in flight may still execute one after a swapchain recreation
+void VulkanApp::allocateCachedCommandBuffers() {
+	size_t count = m_swapchain.getImageCount() * m_framesInFlight;
+	size_t allocated = m_cachedCommandBuffers.size();
+	if (!m_options.cacheCommands || count <= allocated)
+		return;
+
+	m_cachedCommandBuffers.resize(count);
+	m_cachedCommandBuffersValid.resize(count, false);
+
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = m_commandPool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = static_cast<uint32_t>(count - allocated);
+
+	if (vkAllocateCommandBuffers(m_context.getDevice(), &allocInfo, m_cachedCommandBuffers.data() + allocated) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate cached command buffers!");
+	}
+}
+
+void VulkanApp::invalidateCommandBuffers() {
+	std::fill(m_commandsDirty.begin(), m_commandsDirty.end(), true);
+}
+
+/// @brief Returns the primary to submit for this frame, recorded again only when something it references changed.
+/// a defragmentation records copies and moves resources every frame, the cache is bypassed while it runs
+VkCommandBuffer VulkanApp::recordFrame(uint32_t imageIndex) {
+	// une variante est prête, les command buffers qui bindent le fallback a sa place sont réenregistrés
+	uint32_t pipelineGeneration = m_pipelines.getGeneration();
+	if (pipelineGeneration != m_pipelineGeneration) {
+		m_pipelineGeneration = pipelineGeneration;
+		invalidateCommandBuffers();
+	}
+
+	if (!m_defragmenter.isActive() && m_frameNumber % 256 == 0) {
+		MemoryStats stats = m_allocator.getStats(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		if (stats.fragmentation() > g_defrag_threshold && stats.freeBytes() - stats.largestFreeRange > g_defrag_min_wasted_bytes) {
+			m_defragmenter.begin();
+		}
+	}
+
+	if (!m_options.cacheCommands || m_defragmenter.isActive()) {
+		vkResetCommandBuffer(m_commandBuffers[m_currentFrame], 0);
+		recordCommandBuffer(m_commandBuffers[m_currentFrame], imageIndex, true);
+		// les secondaires du slot ont été réenregistrés et les ressources ont pu bouger
+		invalidateCommandBuffers();
+		return m_commandBuffers[m_currentFrame];
+	}
+
+	// mettre a jour un set invalide les command buffers qui le bindent
+	if (m_descriptorsDirty[m_currentFrame]) {
+		m_descriptors.updateTexture(m_currentFrame, m_textureImageView, m_textureSampler);
+		m_descriptorsDirty[m_currentFrame] = false;
+		m_commandsDirty[m_currentFrame] = true;
+	}
+
+	if (m_commandsDirty[m_currentFrame]) {
+		// sans framebuffer dans l'inheritance les secondaires servent pour toutes les images.
+		// le Hi-Z enregistre ses draws indirects dans le primary
+		if (!m_hizCulling) {
+			recordSecondaries(VK_NULL_HANDLE);
+		}
+		for (size_t image = 0; image < m_swapchain.getImageCount(); ++image) {
+			m_cachedCommandBuffersValid[image * m_framesInFlight + m_currentFrame] = false;
+		}
+		m_commandsDirty[m_currentFrame] = false;
+	}
+
+	size_t index = imageIndex * m_framesInFlight + m_currentFrame;
+	if (!m_cachedCommandBuffersValid[index]) {
+		vkResetCommandBuffer(m_cachedCommandBuffers[index], 0);
+		recordCommandBuffer(m_cachedCommandBuffers[index], imageIndex, false);
+		m_cachedCommandBuffersValid[index] = true;
+	}
+	return m_cachedCommandBuffers[index];
 }
 
-void VulkanApp::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+/// @param recordSecondaries false when the secondaries of the frame slot were already recorded by recordSecondaries()
+void VulkanApp::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex, bool recordSecondaries) {
 	// writes command qu'on veut execute
 
 	VkCommandBufferBeginInfo beginInfo{};
@@ -335,14 +801,40 @@ void VulkanApp::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imag
 		throw std::runtime_error("failed to begin recording command buffer!");
 	}
 
+	m_gpuTimer.begin(commandBuffer, m_currentFrame);
+
+	// les copies de defragmentation doivent etre hors de la render pass
+	recordDefragmentation(commandBuffer);
+
+	// barriers et passes compilées par le graph, la passe principale est recordMainPass
+	m_recordingImage = imageIndex;
+	m_recordingSecondaries = recordSecondaries;
+	m_renderGraph.setImage(m_swapchainTarget, m_swapchain.getImages()[imageIndex]);
+	m_renderGraph.execute(commandBuffer);
+
+	m_gpuTimer.end(commandBuffer, m_currentFrame);
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to record command buffer!");
+	}
+}
+
+/// @brief Main pass of the render graph, the graph has already moved its attachments to their layouts
+void VulkanApp::recordMainPass(VkCommandBuffer commandBuffer) {
+	if (m_options.dynamicRendering) {
+		recordMainPassDynamic(commandBuffer);
+		return;
+	}
+
 	VkRenderPassBeginInfo renderPassInfo{};
 	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-	renderPassInfo.renderPass = m_renderPass.get();
-	renderPassInfo.framebuffer = m_swapchain.getFramebuffers()[imageIndex];
+	// compatibles, la seule différence est la profondeur chargée en lecture seule apres la prepass
+	renderPassInfo.renderPass = m_depthPrepass ? m_renderPass.getAfterPrepass() : m_renderPass.get();
+	renderPassInfo.framebuffer = m_swapchain.getFramebuffers()[m_recordingImage];
 	// on bind sur quelle swapchainFramebuffer on va écrire (qui est est lui meme relié a une swap chain image)
 
 	renderPassInfo.renderArea.offset = {0, 0};
-	renderPassInfo.renderArea.extent = m_swapchain.getExtent();
+	renderPassInfo.renderArea.extent = m_renderExtent;
 	// size of render area, pour de meilleur perfs, ca doit match la render area de l'attachment
 
 	std::array<VkClearValue, 2> clearValues{}; // mtn un tableau, on clear l'image et la profondeur
@@ -354,16 +846,278 @@ void VulkanApp::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imag
 	renderPassInfo.pClearValues = clearValues.data();
 	// valeurs utilisé par VK_ATTACHMENT_LOAD_OP_CLEAR
 
-	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, m_hizCulling ? VK_SUBPASS_CONTENTS_INLINE : VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
 	// render pass commence
 
 	// les fonction ckCmd sont pour enregistrer les commandes,
 	// 1 er param le command buffer, ensuite infos de la renderpass,
 	// 3 eme, comment les drawing commands dans la render pass vont etre passé
 	// VK_SUBPASS_CONTENTS_INLINE, on met les commandes dans le primary command buffer, pas de secondaire utilisé
-	// VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS, éxécuté depuis le secondaire
+	// VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS, éxécuté depuis le secondaire, c'est ce qu'on fait :
+	// la liste de draws est enregistrée par plusieurs threads, le primary ne fait que les éxécuter dans l'ordre
+
+	// Hi-Z : les commandes des deux phases, quelques draws indirects qui ne valent pas des secondaires
+	if (m_hizCulling) {
+		recordIndirectDraws(commandBuffer, m_pipelines.get(m_prepassVariants.main), 0, 2);
+		vkCmdEndRenderPass(commandBuffer);
+		return;
+	}
+
+	// les secondaires sont enregistrés apres la defragmentation qui a pu mettre a jour le set de la frame
+	if (m_recordingSecondaries) {
+		this->recordSecondaries(renderPassInfo.framebuffer);
+	}
+
+	vkCmdExecuteCommands(commandBuffer, m_recorder.getCommandBufferCount(m_currentFrame), m_recorder.getCommandBuffers(m_currentFrame));
+
+	vkCmdEndRenderPass(commandBuffer);
+}
+
+/// @brief Same pass as the render pass path: msaa color cleared then resolved into the swapchain image, depth cleared
+/// (or loaded after the prepass) and discarded. the attachments are views of the graph and of the swapchain, nothing
+/// is created per image. below 1 the render scale sends the pass to the scaled target, without msaa it is the color
+/// attachment itself
+void VulkanApp::recordMainPassDynamic(VkCommandBuffer commandBuffer) {
+	VkImageView target = m_scaledTarget != g_invalid_resource ? m_renderGraph.getImageView(m_scaledTarget) : m_swapchain.getImageViews()[m_recordingImage];
+
+	VkRenderingAttachmentInfo colorAttachment{};
+	colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+	colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	if (m_colorTarget != g_invalid_resource) {
+		colorAttachment.imageView = m_renderGraph.getImageView(m_colorTarget);
+		colorAttachment.resolveMode = VK_RESOLVE_MODE_AVERAGE_BIT;
+		colorAttachment.resolveImageView = target;
+		colorAttachment.resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL; // PRESENT_SRC par le render graph
+	} else {
+		colorAttachment.imageView = target;
+		colorAttachment.resolveMode = VK_RESOLVE_MODE_NONE;
+	}
+	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	colorAttachment.clearValue.color = {{0.0f, 0.0f, 0.0f, 1.0f}};
+
+	VkRenderingAttachmentInfo depthAttachment{};
+	depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+	depthAttachment.imageView = m_renderGraph.getImageView(m_depthTarget);
+	// apres la prepass : chargée et seulement lue par le test EQUAL
+	depthAttachment.imageLayout = m_depthPrepass ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	depthAttachment.loadOp = m_depthPrepass ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.clearValue.depthStencil = {1.0f, 0};
+
+	VkRenderingInfo renderingInfo{};
+	renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+	renderingInfo.flags = m_hizCulling ? 0 : VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
+	renderingInfo.renderArea.offset = {0, 0};
+	renderingInfo.renderArea.extent = m_renderExtent;
+	renderingInfo.layerCount = 1;
+	renderingInfo.colorAttachmentCount = 1;
+	renderingInfo.pColorAttachments = &colorAttachment;
+	renderingInfo.pDepthAttachment = &depthAttachment;
+
+	vkCmdBeginRendering(commandBuffer, &renderingInfo);
+
+	if (m_hizCulling) {
+		recordIndirectDraws(commandBuffer, m_pipelines.get(m_prepassVariants.main), 0, 2);
+		vkCmdEndRendering(commandBuffer);
+		return;
+	}
+
+	if (m_recordingSecondaries) {
+		this->recordSecondaries(VK_NULL_HANDLE);
+	}
+
+	vkCmdExecuteCommands(commandBuffer, m_recorder.getCommandBufferCount(m_currentFrame), m_recorder.getCommandBuffers(m_currentFrame));
+
+	vkCmdEndRendering(commandBuffer);
+}
+
+/// @brief Linear blit of the whole scaled target onto the swapchain image, the graph moved both to their transfer
+/// layouts. the swapchain format supports it, resolveQualitySettings keeps the scale at 1 otherwise
+void VulkanApp::recordUpscale(VkCommandBuffer commandBuffer) {
+	VkExtent2D swapchainExtent = m_swapchain.getExtent();
+
+	VkImageBlit blit{};
+	blit.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+	blit.srcOffsets[1] = {static_cast<int32_t>(m_renderExtent.width), static_cast<int32_t>(m_renderExtent.height), 1};
+	blit.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+	blit.dstOffsets[1] = {static_cast<int32_t>(swapchainExtent.width), static_cast<int32_t>(swapchainExtent.height), 1};
+
+	vkCmdBlitImage(commandBuffer, m_renderGraph.getImage(m_scaledTarget), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_swapchain.getImages()[m_recordingImage],
+		       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+}
+
+/// @param framebuffer optionnel mais peut aider le driver, VK_NULL_HANDLE pour des secondaires réutilisés sur toutes les images
+void VulkanApp::recordSecondaries(VkFramebuffer framebuffer) {
+	VkCommandBufferInheritanceInfo inheritanceInfo{};
+	inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritanceInfo.renderPass = m_renderPass.get();
+	inheritanceInfo.subpass = 0;
+	inheritanceInfo.framebuffer = framebuffer;
+
+	// dynamic rendering : pas de render pass a hériter, les formats et le sample count de vkCmdBeginRendering
+	VkFormat colorFormat = m_swapchain.getImageFormat();
+	VkCommandBufferInheritanceRenderingInfo renderingInheritance{};
+	renderingInheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+	renderingInheritance.colorAttachmentCount = 1;
+	renderingInheritance.pColorAttachmentFormats = &colorFormat;
+	renderingInheritance.depthAttachmentFormat = m_depthFormat;
+	renderingInheritance.rasterizationSamples = m_context.getMsaaSamples();
+	if (m_options.dynamicRendering) {
+		inheritanceInfo.pNext = &renderingInheritance;
+	}
+
+	m_recorder.record(m_currentFrame, inheritanceInfo, static_cast<uint32_t>(m_visibleDraws.size()), m_recordDraws);
+}
+
+/// @brief Records draws [first, first + count) of the visible list, called on the job system threads.
+/// a secondary inherits nothing but the render pass, all the state is bound again
+void VulkanApp::recordDraws(VkCommandBuffer commandBuffer, uint32_t first, uint32_t count) {
+	recordDrawRange(commandBuffer, m_pipelines.get(m_depthPrepass ? m_prepassVariants.main : m_materialVariant), m_visibleDraws.data(), first, count,
+			m_occlusionQueries && m_occlusion.usesConditionalRendering());
+}
+
+/// @brief Depth only pass before the main one, the same visible list with the position only pipeline. recorded inline:
+/// the recorder has one set of secondaries per frame slot, the primary holding it is cached all the same
+void VulkanApp::recordDepthPrepass(VkCommandBuffer commandBuffer) {
+	beginDepthPass(commandBuffer, true);
+	recordDrawRange(commandBuffer, m_pipelines.get(m_prepassVariants.depth), m_visibleDraws.data(), 0, static_cast<uint32_t>(m_visibleDraws.size()), false);
+	endDepthPass(commandBuffer);
+}
+
+/// @brief Without the prepass only the occluders write the depth, the main pass clears it and draws everything again.
+/// the boxes are tested against that depth, a draw inside its own box never hides it. the queries are reset in the
+/// command buffer, a cached primary starts from clean ones
+void VulkanApp::recordOcclusionPass(VkCommandBuffer commandBuffer) {
+	uint32_t queryCount = static_cast<uint32_t>(m_occlusionDraws.size());
+	m_occlusion.recordReset(commandBuffer, m_currentFrame, queryCount);
+
+	beginDepthPass(commandBuffer, true);
+	const uint32_t* occluders = m_depthPrepass ? m_visibleDraws.data() : m_occluderDraws.data();
+	size_t occluderCount = m_depthPrepass ? m_visibleDraws.size() : m_occluderDraws.size();
+	recordDrawRange(commandBuffer, m_pipelines.get(m_prepassVariants.depth), occluders, 0, static_cast<uint32_t>(occluderCount), false);
+
+	// même layout et même set que les draws, seuls les buffers changent
+	bindDrawState(commandBuffer, m_pipelines.get(m_prepassVariants.proxy));
+	m_occlusion.bindProxy(commandBuffer);
+	for (uint32_t query = 0; query < queryCount; ++query) {
+		const DrawItem& draw = m_drawList[m_occlusionDraws[query]];
+		glm::mat4 box = glm::scale(glm::translate(glm::mat4(1.0f), draw.center), draw.extent);
+		DrawConstants constants{box, draw.objectId};
+		vkCmdPushConstants(commandBuffer, m_pipeline.getLayout(), VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(DrawConstants), &constants);
+		m_occlusion.drawProxy(commandBuffer, m_currentFrame, query);
+	}
+	endDepthPass(commandBuffer);
+}
+
+/// @brief Phase 0 of the Hi-Z culling on the compute queue. it waits for the previous frame, which built the pyramid
+/// and last used the counts, and for the uploads still pending : the draws, the object transforms and the pyramid clear
+void VulkanApp::recordEarlyCull() {
+	constexpr VkPipelineStageFlags stages = VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+	if (m_frameNumber > 0) {
+		m_compute.waitFor(m_frameTimeline.getSemaphore(), FrameTimeline::signalValue(m_frameNumber - 1), stages);
+	}
+	if (m_transferTicket.value != 0) {
+		m_compute.waitFor(m_transferUploads.getSemaphore(), m_transferTicket.value, stages);
+	}
+	if (m_graphicsTicket.value != 0) {
+		m_compute.waitFor(m_graphicsUploads.getSemaphore(), m_graphicsTicket.value, stages);
+	}
+	m_hiz.recordEarlyCull(m_compute.getCommandBuffer(m_currentFrame), m_currentFrame);
+}
+
+/// @brief The first phase clears the depth, the second one adds the draws the new pyramid showed were visible
+void VulkanApp::recordHiZDepth(VkCommandBuffer commandBuffer, uint32_t phase) {
+	beginDepthPass(commandBuffer, phase == 0);
+	recordIndirectDraws(commandBuffer, m_pipelines.get(m_prepassVariants.depth), phase, 1);
+	endDepthPass(commandBuffer);
+}
+
+void VulkanApp::beginDepthPass(VkCommandBuffer commandBuffer, bool clear) {
+	VkClearValue clearValue{};
+	clearValue.depthStencil = {1.0f, 0};
+
+	if (m_options.dynamicRendering) {
+		VkRenderingAttachmentInfo depthAttachment{};
+		depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+		depthAttachment.imageView = m_renderGraph.getImageView(m_depthTarget);
+		depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		depthAttachment.loadOp = clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
+		depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		depthAttachment.clearValue = clearValue;
+
+		VkRenderingInfo renderingInfo{};
+		renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+		renderingInfo.renderArea.offset = {0, 0};
+		renderingInfo.renderArea.extent = m_renderExtent;
+		renderingInfo.layerCount = 1;
+		renderingInfo.colorAttachmentCount = 0;
+		renderingInfo.pDepthAttachment = &depthAttachment;
+
+		vkCmdBeginRendering(commandBuffer, &renderingInfo);
+		return;
+	}
+
+	VkRenderPassBeginInfo renderPassInfo{};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	// compatibles, le même framebuffer sert aux deux
+	renderPassInfo.renderPass = clear ? m_renderPass.getDepthPrepass() : m_renderPass.getDepthPrepassLoad();
+	renderPassInfo.framebuffer = m_swapchain.getDepthFramebuffer();
+	renderPassInfo.renderArea.offset = {0, 0};
+	renderPassInfo.renderArea.extent = m_renderExtent;
+	renderPassInfo.clearValueCount = clear ? 1 : 0;
+	renderPassInfo.pClearValues = &clearValue;
+
+	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+}
+
+void VulkanApp::endDepthPass(VkCommandBuffer commandBuffer) {
+	if (m_options.dynamicRendering) {
+		vkCmdEndRendering(commandBuffer);
+	} else {
+		vkCmdEndRenderPass(commandBuffer);
+	}
+}
+
+void VulkanApp::recordDrawRange(VkCommandBuffer commandBuffer, VkPipeline pipeline, const uint32_t* draws, uint32_t first, uint32_t count,
+				bool conditional) {
+	bindDrawState(commandBuffer, pipeline);
+
+	// utilisation de l'index buffer mtn, les push constants ne sont poussées que quand l'objet change
+	uint32_t currentObject = std::numeric_limits<uint32_t>::max();
+	for (uint32_t i = first; i < first + count; ++i) {
+		const DrawItem& draw = m_drawList[draws[i]];
+		if (draw.objectId != currentObject) {
+			currentObject = draw.objectId;
+			vkCmdPushConstants(commandBuffer, m_pipeline.getLayout(), VK_SHADER_STAGE_VERTEX_BIT, offsetof(DrawConstants, objectId), sizeof(uint32_t),
+					   &currentObject);
+		}
+		// le prédicat est lu a l'éxécution, le command buffer en cache reste valide quand la visibilité change
+		uint32_t query = m_drawQuery[draws[i]];
+		if (conditional && query != g_no_query) {
+			m_occlusion.beginConditional(commandBuffer, query);
+			vkCmdDrawIndexed(commandBuffer, draw.indexCount, 1, draw.firstIndex, draw.vertexOffset, 0);
+			m_occlusion.endConditional(commandBuffer);
+		} else {
+			vkCmdDrawIndexed(commandBuffer, draw.indexCount, 1, draw.firstIndex, draw.vertexOffset, 0);
+		}
+	}
+}
+
+/// @brief The variants with INDIRECT_DRAWS read the model matrix at gl_InstanceIndex, the firstInstance cull.comp
+/// wrote. the push constants are still declared by the shader and must be defined once
+void VulkanApp::recordIndirectDraws(VkCommandBuffer commandBuffer, VkPipeline pipeline, uint32_t firstPhase, uint32_t phaseCount) {
+	bindDrawState(commandBuffer, pipeline);
+
+	DrawConstants constants{glm::mat4(1.0f), 0};
+	vkCmdPushConstants(commandBuffer, m_pipeline.getLayout(), VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(DrawConstants), &constants);
+	for (uint32_t phase = firstPhase; phase < firstPhase + phaseCount; ++phase) {
+		m_hiz.drawIndirect(commandBuffer, phase);
+	}
+}
 
-	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.get());
+void VulkanApp::bindDrawState(VkCommandBuffer commandBuffer, VkPipeline pipeline) {
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
 	// VK_PIPELINE_BIND_POINT_GRAPHICS, c'est une pipeline de rendu
 
 	VkBuffer vertexBuffers[]{m_meshBuffer};
@@ -379,8 +1133,8 @@ void VulkanApp::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imag
 	// si c'est 0,0 à width height alors on écrit dans tout le buffer
 	viewport.x = 0.0f;
 	viewport.y = 0.0f;
-	viewport.width = static_cast<float>(m_swapchain.getExtent().width);
-	viewport.height = static_cast<float>(m_swapchain.getExtent().height);
+	viewport.width = static_cast<float>(m_renderExtent.width);
+	viewport.height = static_cast<float>(m_renderExtent.height);
 	viewport.minDepth = 0.0f;
 	viewport.maxDepth = 1.0f;
 	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
@@ -388,7 +1142,7 @@ void VulkanApp::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imag
 	VkRect2D scissor{}; // seuls les pixels dans cette région seront rendu
 	// reste ignoré.
 	scissor.offset = {0, 0};
-	scissor.extent = m_swapchain.getExtent();
+	scissor.extent = m_renderExtent;
 	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
 	// la command pour draw 1 triangle de 3 index :
@@ -400,56 +1154,97 @@ void VulkanApp::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imag
 				VK_PIPELINE_BIND_POINT_GRAPHICS,
 				m_pipeline.getLayout(),
 				0, 1, &m_descriptors.getSets()[m_currentFrame], 0, nullptr);
-
-	// utilisation de l'index buffer mtn
-	vkCmdDrawIndexed(commandBuffer, m_mesh.indicesCount(), 1, 0, 0, 0);
-
-	vkCmdEndRenderPass(commandBuffer);
-
-	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
-		throw std::runtime_error("failed to record command buffer!");
-	}
 }
 
 void VulkanApp::createSyncObjects() {
 
-	m_imageAvailableSemaphores.resize(g_max_frames_in_flight);
-	m_renderFinishedSemaphores.resize(g_max_frames_in_flight);
-	m_inFlightFences.resize(g_max_frames_in_flight);
+	m_imageAvailableSemaphores.resize(m_framesInFlight);
+	m_renderFinishedSemaphores.resize(m_framesInFlight);
 
 	VkSemaphoreCreateInfo semaphoreInfo{};
 	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-	VkFenceCreateInfo fenceInfo{};
-	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT; // créer en signaled,
-	// car sinon on attend a l'infini car pour la 1ere  frame on attend de terminer de draw sauf qu'on draw pas
-
-	for (size_t i = 0; i < g_max_frames_in_flight; i++) {
+	// acquire et present n'acceptent que des sémaphores binaires, la fin des frames est suivie par m_frameTimeline
+	for (size_t i = 0; i < m_framesInFlight; i++) {
 		if (vkCreateSemaphore(m_context.getDevice(), &semaphoreInfo, nullptr, &m_imageAvailableSemaphores[i]) != VK_SUCCESS ||
-		    vkCreateSemaphore(m_context.getDevice(), &semaphoreInfo, nullptr, &m_renderFinishedSemaphores[i]) != VK_SUCCESS ||
-		    vkCreateFence(m_context.getDevice(), &fenceInfo, nullptr, &m_inFlightFences[i]) != VK_SUCCESS) {
+		    vkCreateSemaphore(m_context.getDevice(), &semaphoreInfo, nullptr, &m_renderFinishedSemaphores[i]) != VK_SUCCESS) {
 			throw std::runtime_error("failed to create semaphores!");
 		}
 	}
 	std::cout << "Sync objects created" << '\n';
 }
 
+void VulkanApp::createFrameArenas() {
+	m_frameArenas.resize(m_framesInFlight);
+	for (auto& arena : m_frameArenas) {
+		arena.init(g_frame_arena_size);
+	}
+}
+
 void VulkanApp::drawFrame() {
-	// attendre frame precedente fini
-	vkWaitForFences(m_context.getDevice(), 1, &m_inFlightFences[m_currentFrame], VK_TRUE, UINT64_MAX); // bloque le cpu (host)
-	// prend un array de fence, ici 1 seule, VK_TRUE, on attend toutes les fences
-	// UINT64_MAX en gros desactive le timeout tellement c grand
+	// drawFrame peut être rappelé par windowRefreshCallback depuis glfwPollEvents ou glfwWaitEvents
+	m_inDrawFrame = true;
+	struct DrawFrameGuard {
+		bool& flag;
+		~DrawFrameGuard() { flag = false; }
+	} guard{m_inDrawFrame};
+
+	// allocations de ce thread et des jobs d'enregistrement lancés par la frame, pas celles du travail en arrière plan
+	const bool busyAtStart = m_defragmenter.isActive() || m_pipelines.isCompiling();
+	const uint64_t threadAllocations = AllocationCounter::getThreadCount();
+	const uint64_t jobAllocations = m_jobAllocations.load(std::memory_order_relaxed);
+
+	// temps cpu de la frame sans les attentes du gpu et de la swapchain, pour le tuner
+	auto frameStart = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double, std::milli> blocked{0.0};
+
+	// attendre que la frame qui utilisait ce slot soit finie, m_frameNumber - m_framesInFlight
+	if (m_frameNumber >= m_framesInFlight) {
+		m_frameTimeline.waitForFrame(m_frameNumber - m_framesInFlight); // bloque le cpu (host)
+	}
+	blocked += std::chrono::high_resolution_clock::now() - frameStart;
+
+	// la frame précédente de ce slot est finie, ses timestamps sont lisibles
+	double gpuMilliseconds = 0.0;
+	bool gpuTimed = m_gpuTimer.getMilliseconds(m_currentFrame, gpuMilliseconds);
+	// et les draws gardés par le Hi-Z, copiés par la passe "hiz stats"
+	if (m_options.benchFrames > 0 && m_frameNumber >= m_framesInFlight && m_slotHiZ[m_currentFrame]) {
+		uint32_t early = 0;
+		uint32_t late = 0;
+		m_hiz.readStats(m_currentFrame, early, late);
+		m_hizEarlyDraws += early;
+		m_hizLateDraws += late;
+		m_hizCountedFrames++;
+	}
+	// sans conditional rendering les draws cachés sont retirés par cullDrawList, plus loin
+	if (m_occlusionQueries && (m_options.benchFrames > 0 || !m_occlusion.usesConditionalRendering())) {
+		readOcclusionResults();
+	}
+
+	// le gpu a fini cette frame, tout ce qui a été alloué dans son arena peut être réutilisé
+	m_frameArenas[m_currentFrame].reset();
+	m_descriptorAllocator.resetFrame(m_currentFrame);
+
+	// une seule lecture du compteur, tout ce qui a été libéré par une frame finie peut etre détruit
+	uint64_t completedFrames = m_frameTimeline.getCompletedFrames();
+	m_deletionQueue.collect(m_frameNumber, completedFrames);
+	if (m_hizSupported) {
+		m_hiz.collect(m_frameNumber, completedFrames);
+	}
+	m_defragmenter.collect(completedFrames);
+	m_transferUploads.collect();
+	m_graphicsUploads.collect();
 
 	// prendre une image de la swapchain
 	uint32_t imageIndex; // index de la vkimagedans le swap chain images
+	auto acquireStart = std::chrono::high_resolution_clock::now();
 	VkResult result = vkAcquireNextImageKHR(m_context.getDevice(), m_swapchain.getSwapChain(), UINT64_MAX, m_imageAvailableSemaphores[m_currentFrame], VK_NULL_HANDLE, &imageIndex);
+	blocked += std::chrono::high_resolution_clock::now() - acquireStart;
 	// m_imageAvailableSemaphore signaled quand on a fini
 
 	if (result == VK_ERROR_OUT_OF_DATE_KHR) {
 		// VK_ERROR_OUT_OF_DATE_KHR, on peut plus du tout utilisé la swap chain et la surface pour rendre car elles sont devenu incompatibles
 		// on la recréer et on skip ce draw
-		// par contre ca peut créer un deadlock, on décale le reset lock apres le check
 		recreateSwapChain();
 		return;
 	} else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
@@ -458,48 +1253,139 @@ void VulkanApp::drawFrame() {
 	// result peut être VK_SUBOPTIMAL_KHR, la surface match pas exactement la swap chain
 	// mais on peut quand meme l'utiliser donc on conitnue
 
-	updateUniformBuffer(m_currentFrame);
+	// le plus tard possible : tout ce qui reste avant la présentation est l'enregistrement et le gpu. l'état des touches
+	// vient du glfwPollEvents de mainLoop, fait après la présentation de la frame précédente
+	if (m_options.lowLatency) {
+		sampleInput();
+	}
 
-	vkResetFences(m_context.getDevice(), 1, &m_inFlightFences[m_currentFrame]); // on débloque l'éxécution manuellement, ici pour eviter deadlock
-	// on est sur d'avoir une image a draw
-	// si on reset et que recreate swap chain est appelé, alors on sera toujours
-	// sur la fence m_inFlightFences[m_currentFrame] et on sera bloqué par vkWaitForFences
+	updateUniformBuffer(m_currentFrame);
+	// Hi-Z : frustum et occlusion sont testés par cull.comp, la liste visible n'est pas utilisée
+	if (!m_hizCulling) {
+		cullDrawList();
+	}
 
-	// record un command buffer pour draw sur l'image
-	vkResetCommandBuffer(m_commandBuffers[m_currentFrame], 0);
-	recordCommandBuffer(m_commandBuffers[m_currentFrame], imageIndex);
+	// record un command buffer pour draw sur l'image, ou reprendre celui en cache
+	auto recordStart = std::chrono::high_resolution_clock::now();
+	VkCommandBuffer commandBuffer = recordFrame(imageIndex);
+	if (m_options.benchFrames > 0) {
+		m_recordStats.add(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - recordStart).count());
+	}
 
 	// submit l'image
 	VkSubmitInfo submitInfo{};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-	VkSemaphore waitSemaphores[]{m_imageAvailableSemaphores[m_currentFrame]};
-	VkPipelineStageFlags waitStages[]{VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+	VkSemaphore waitSemaphores[4]{m_imageAvailableSemaphores[m_currentFrame]};
+	VkPipelineStageFlags waitStages[4]{VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+	uint64_t waitValues[4]{0}; // ignoré pour le sémaphore binaire
+	uint32_t waitCount = 1;
 	// on veut attendre au niveau de l'écriture dans le frame buffer
 	// ca veut dire que le gpu peut executer des shaders juste on écrit pas encore
-	submitInfo.waitSemaphoreCount = 1;
+
+	// tant que les uploads ne sont pas finis le gpu les attend, le cpu ne bloque jamais
+	// TRANSFER car la defragmentation peut copier le mesh ou la texture en début de frame, VERTEX_SHADER et
+	// COMPUTE_SHADER pour le buffer des objets, les draws du Hi-Z et sa pyramide
+	constexpr VkPipelineStageFlags uploadStages = VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+						      VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+	if (m_transferTicket.value != 0) {
+		if (m_transferUploads.isComplete(m_transferTicket)) {
+			m_transferTicket = {};
+		} else {
+			waitSemaphores[waitCount] = m_transferUploads.getSemaphore();
+			waitStages[waitCount] = uploadStages;
+			waitValues[waitCount++] = m_transferTicket.value;
+		}
+	}
+	if (m_graphicsTicket.value != 0) {
+		if (m_graphicsUploads.isComplete(m_graphicsTicket)) {
+			m_graphicsTicket = {};
+		} else {
+			waitSemaphores[waitCount] = m_graphicsUploads.getSemaphore();
+			waitStages[waitCount] = uploadStages;
+			waitValues[waitCount++] = m_graphicsTicket.value;
+		}
+	}
+
+	// le compute enregistré pendant la frame part avant le rendu, qui ne l'attend qu'aux stages qui lisent ses
+	// résultats. avec une famille compute séparée il s'éxécute en même temps que la fin de la frame précédente
+	if (m_hizCulling) {
+		recordEarlyCull();
+	}
+	if (uint64_t computeValue = m_compute.submit(m_currentFrame)) {
+		waitSemaphores[waitCount] = m_compute.getSemaphore();
+		waitStages[waitCount] = g_compute_consumer_stages;
+		waitValues[waitCount++] = computeValue;
+	}
+
+	VkSemaphore signalSemaphores[]{m_renderFinishedSemaphores[m_currentFrame], m_frameTimeline.getSemaphore()};
+	uint64_t signalValues[]{0, FrameTimeline::signalValue(m_frameNumber)};
+
+	VkTimelineSemaphoreSubmitInfo timelineInfo{};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineInfo.waitSemaphoreValueCount = waitCount;
+	timelineInfo.pWaitSemaphoreValues = waitValues;
+	timelineInfo.signalSemaphoreValueCount = 2;
+	timelineInfo.pSignalSemaphoreValues = signalValues;
+	submitInfo.pNext = &timelineInfo;
+
+	submitInfo.waitSemaphoreCount = waitCount;
 	submitInfo.pWaitSemaphores = waitSemaphores;
 	submitInfo.pWaitDstStageMask = waitStages;
 
 	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &m_commandBuffers[m_currentFrame];
+	submitInfo.pCommandBuffers = &commandBuffer;
 	// les buffers a submit pour execution
 
-	VkSemaphore signalSemaphores[] = {m_renderFinishedSemaphores[m_currentFrame]};
-	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.signalSemaphoreCount = 2;
 	submitInfo.pSignalSemaphores = signalSemaphores;
-	// on va signal ce sémaphore apres que le command buffer soit executé
+	// on va signal ces sémaphores apres que le command buffer soit executé :
+	// le binaire pour la présentation, la timeline passe a m_frameNumber + 1
 
-	if (vkQueueSubmit(m_context.getGraphicsQueue(), 1, &submitInfo, m_inFlightFences[m_currentFrame]) != VK_SUCCESS) {
+	if (m_context.getQueues().submit(QueueRole::Render, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
 		throw std::runtime_error("failed to submit draw command buffer!");
 	}
+	m_gpuTimer.markSubmitted(m_currentFrame);
+
+	if (gpuTimed) {
+		double cpuMilliseconds = (std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - frameStart) - blocked).count();
+		if (m_options.benchFrames > 0) {
+			m_gpuStats.add(gpuMilliseconds);
+			// le Hi-Z passe aussi par la prepass, il a son propre compte
+			if (m_slotHiZ[m_currentFrame]) {
+				m_gpuHiZStats.add(gpuMilliseconds);
+			} else if (m_slotOcclusion[m_currentFrame]) {
+				m_gpuOcclusionStats.add(gpuMilliseconds);
+			} else {
+				(m_slotPrepass[m_currentFrame] ? m_gpuPrepassStats : m_gpuDirectStats).add(gpuMilliseconds);
+			}
+		}
+		if (m_autoFramesInFlight) {
+			m_framesTuner.add(cpuMilliseconds, gpuMilliseconds);
+			// appliqué par mainLoop avant la prochaine frame
+			if (uint32_t wanted = m_framesTuner.evaluate(m_framesInFlight)) {
+				m_requestedFramesInFlight = wanted;
+			}
+		}
+	}
+	// après la lecture du temps de la soumission précédente de ce slot, qui compte pour son propre mode
+	m_slotPrepass[m_currentFrame] = m_depthPrepass;
+	m_slotHiZ[m_currentFrame] = m_hizCulling;
+	m_slotOcclusion[m_currentFrame] = m_occlusionQueries;
+	if (m_occlusionQueries) {
+		m_occlusion.markSubmitted(m_currentFrame, m_occlusionDraws.data(), static_cast<uint32_t>(m_occlusionDraws.size()), m_frameNumber);
+	}
+
+	m_frameNumber++;
+	m_currentFrame = (m_currentFrame + 1) % m_framesInFlight;
+	// on avance le slot meme si la présentation demande une recréation, le slot doit rester m_frameNumber % m_framesInFlight
 
 	// presenter l'image a la swap chain image pour affichage
 	VkPresentInfoKHR presentInfo{};
 	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
 	presentInfo.waitSemaphoreCount = 1;
-	presentInfo.pWaitSemaphores = signalSemaphores;
+	presentInfo.pWaitSemaphores = signalSemaphores; // seulement le binaire
 	// quels semaphores on va attendre avant de presenter l'image
 	// tant que l'image n'est pas rendu, on att
 
@@ -515,36 +1401,47 @@ void VulkanApp::drawFrame() {
 	// permet de spécifier un array Vkresult
 	// pour savoir si la présentation a marché dans chaque swap chain
 
-	result = vkQueuePresentKHR(m_context.getPresentQueue(), &presentInfo);
+	// VkPresentIdKHR quand present wait est disponible, m_frameNumber a déjà avancé
+	presentInfo.pNext = m_pacer.getPresentChain(m_frameNumber - 1);
+
+	result = m_context.getQueues().present(presentInfo);
+	m_pacer.markPresented(m_swapchain.getSwapChain(), m_frameNumber - 1);
 	// asynchrone, donc le cpu va continuer
 	// et commencer a acquerir une image pour le prochain rendu
 
-	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || m_framebufferResized) {
-		// la on recréer meme si VK_SUBOPTIMAL_KHR
-		// car on veut le meilleur rendu
-		m_framebufferResized = false;
+	// VK_ERROR_OUT_OF_DATE_KHR : plus rien ne peut y être présenté, on recrée tout de suite.
+	// sinon on recrée aussi pour VK_SUBOPTIMAL_KHR, pour le meilleur rendu, mais seulement une fois le resize fini :
+	// pendant un drag l'ancienne swapchain est encore présentable (étirée), une recréation par évènement ferait des pics
+	if (result == VK_ERROR_OUT_OF_DATE_KHR || ((result == VK_SUBOPTIMAL_KHR || m_framebufferResized) && isResizeSettled())) {
 		recreateSwapChain();
 		return;
-	} else if (result != VK_SUCCESS) {
+	} else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
 		throw std::runtime_error("failed to present swap chain image!");
 	}
 
-	m_currentFrame = (m_currentFrame + 1) % g_max_frames_in_flight;
+	// décidé a la fin : recordFrame peut avoir lancé une defragmentation, qui crée des ressources, et une compilation
+	// de variante exécutée par ce thread pendant qu'il attend ses jobs serait comptée avec la frame
+	bool steadyState = m_frameNumber > g_allocation_check_warmup_frames && !busyAtStart && !m_defragmenter.isActive() && !m_pipelines.isCompiling();
+	if (steadyState) {
+		uint64_t allocations = AllocationCounter::getThreadCount() - threadAllocations + m_jobAllocations.load(std::memory_order_relaxed) - jobAllocations;
+		m_steadyAllocations += allocations;
+		m_steadyFrames++;
+		if (allocations != 0 && !m_heapAllocationReported) {
+			std::cerr << "drawFrame: " << allocations << " heap allocations in frame " << m_frameNumber - 1 << '\n';
+			m_heapAllocationReported = true;
+		}
+	}
+}
+
+/// @brief Waits until the GPU has finished every submitted frame, it no longer uses any frame resource
+void VulkanApp::waitForFrames() {
+	m_frameTimeline.waitForFrames(m_frameNumber);
 }
 
 void VulkanApp::cleanupSwapChain() {
 
 	m_swapchain.cleanup();
-
-	vkDestroyImageView(m_context.getDevice(), m_colorImageView, nullptr);
-	vkDestroyImage(m_context.getDevice(), m_colorImage, nullptr);
-	vkFreeMemory(m_context.getDevice(), m_colorImageMemory, nullptr);
-
-	vkDestroyImageView(m_context.getDevice(), m_depthImageView, nullptr);
-	vkDestroyImage(m_context.getDevice(), m_depthImage, nullptr);
-	vkFreeMemory(m_context.getDevice(), m_depthImageMemory, nullptr);
-
-
+	m_renderGraph.cleanup();
 }
 
 void VulkanApp::recreateSwapChain() {
@@ -558,50 +1455,75 @@ void VulkanApp::recreateSwapChain() {
 	// quand on est minimiser width et height sont a 0, tant que c'est le cas,
 	//  on fait rien, boucle infini, tant qu'on a pas re ouvert
 
-	vkDeviceWaitIdle(m_context.getDevice());
-
-	m_swapchain.recreate(m_window);
-
-	// les images views doivent etre recrée car sont lies au dimensions des images de la swapchain
-	createColorRessources();
-	createDepthResources();
-
-	m_swapchain.createFrameBuffers(m_renderPass.get(), m_depthImageView, m_colorImageView);
+	// pas de vkDeviceWaitIdle : les frames en vol utilisent encore les anciennes images,
+	// elles passent par la deletion queue et sont détruites quand leur fence est atteinte
+	m_swapchain.recreate(m_window, m_deletionQueue);
+	m_swapchainRecreations++;
+	// aussi quand la recréation vient de l'acquire, la taille prise est la dernière
+	m_framebufferResized = false;
+	// les ids présentés a l'ancienne swapchain ne seront jamais attendus
+	m_pacer.resetSwapchain(m_frameNumber);
+
+	// les cibles du graph dépendent de la taille de la swapchain, les anciennes passent par la deletion queue
+	buildRenderGraph();
+
+	// les primaries en cache référencent les anciens framebuffers
+	allocateCachedCommandBuffers();
+	std::fill(m_cachedCommandBuffersValid.begin(), m_cachedCommandBuffersValid.end(), false);
+	invalidateCommandBuffers();
 }
 
 void VulkanApp::cleanup() {	    // les queues sont détruites implicitement
 
-    vkDeviceWaitIdle(m_context.getDevice());
+	waitForFrames();
+	// la timeline ne couvre pas la dernière présentation, elle peut encore attendre un renderFinished
+	m_context.getQueues().waitIdle(QueueRole::Present);
+	m_deletionQueue.cleanup();
 
 	cleanupSwapChain();
 
+	m_defragmenter.cleanup();
+
 	vkDestroySampler(m_context.getDevice(), m_textureSampler, nullptr);
 	vkDestroyImageView(m_context.getDevice(), m_textureImageView, nullptr);
 	vkDestroyImage(m_context.getDevice(), m_textureImage, nullptr);
-	vkFreeMemory(m_context.getDevice(), m_textureImageMemory, nullptr);
+	m_allocator.free(m_textureImageAllocation);
 
-	for (size_t i = 0; i < g_max_frames_in_flight; i++) {
-		vkDestroyBuffer(m_context.getDevice(), m_uniformBuffers[i], nullptr);
-		vkFreeMemory(m_context.getDevice(), m_uniformBuffersMemory[i], nullptr);
+	if (m_hizSupported) {
+		m_hiz.cleanup();
+	}
+	if (m_occlusionSupported) {
+		m_occlusion.cleanup();
 	}
+	destroyFrameResources();
+	m_descriptors.cleanup();
+	m_descriptorAllocator.cleanup();
 
 	//vkDestroyDescriptorPool(m_context.getDevice(), m_descriptorPool, nullptr);
 	//vkDestroyDescriptorSetLayout(m_context.getDevice(), m_descriptorSetLayout, nullptr);
 	vkDestroyBuffer(m_context.getDevice(), m_meshBuffer, nullptr);
-	vkFreeMemory(m_context.getDevice(), m_meshBufferMemory, nullptr);
-
-	for (size_t i = 0; i < g_max_frames_in_flight; i++) {
-		vkDestroySemaphore(m_context.getDevice(), m_imageAvailableSemaphores[i], nullptr);
-		vkDestroySemaphore(m_context.getDevice(), m_renderFinishedSemaphores[i], nullptr);
-		vkDestroyFence(m_context.getDevice(), m_inFlightFences[i], nullptr);
-	}
-	vkDestroyCommandPool(m_context.getDevice(), m_commandPoolTransfer, nullptr);
+	m_allocator.free(m_meshBufferAllocation);
+	vkDestroyBuffer(m_context.getDevice(), m_objectBuffer, nullptr);
+	m_allocator.free(m_objectBufferAllocation);
+
+	m_frameTimeline.cleanup();
+	m_transferUploads.cleanup();
+	m_graphicsUploads.cleanup();
+	m_recorder.cleanup();
+	m_compute.cleanup();
 	vkDestroyCommandPool(m_context.getDevice(), m_commandPool, nullptr);
+	// attend les variantes en cours de compilation, elles utilisent les threads du job system
+	m_pipelines.cleanup();
+	m_jobs.cleanup();
 
 	m_pipeline.cleanup();
+	// écrit sur le disque pour le prochain lancement
+	m_pipelineCache.cleanup();
 
 	m_renderPass.cleanup();
 
+	m_allocator.cleanup();
+
 	m_context.cleanup();
 
 	glfwDestroyWindow(m_window);
@@ -613,21 +1535,67 @@ void VulkanApp::updateUniformBuffer(uint32_t currentImage) {
 	auto currentTime{std::chrono::high_resolution_clock::now()};
 	float time{std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count()};
 
-	UniformBufferObject ubo{};
-	ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(45.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-
-	// rotation avec le temps qui passe sur l'éxe y
+	// rotation avec le temps qui passe sur l'éxe z, de toute la scène : elle reste dans le buffer de la frame,
+	// les command buffers en cache n'ont que les id des objets
+	glm::mat4 turntable = glm::rotate(glm::mat4(1.0f), time * glm::radians(45.0f), glm::vec3(0.0f, 0.0f, 1.0f));
 
-	ubo.view = m_camera.getViewMatrix();
+	FrameUniforms frame{};
+	frame.view = m_camera.getViewMatrix() * turntable;
 	// caméra en hauter et qui regarde en 0,0,0, up de la camera en 0,0,1
 
-	ubo.proj = glm::perspective(glm::radians(45.0f), m_swapchain.getExtent().width / static_cast<float>(m_swapchain.getExtent().height), 0.1f, 10.0f);
+	frame.proj = glm::perspective(glm::radians(45.0f), m_swapchain.getExtent().width / static_cast<float>(m_swapchain.getExtent().height), g_near_plane, 10.0f);
 	// camera d'un fov de 45, avec la taille = a celle de nos images et un near plan à 0.1F et far a 10.0f
 
-	ubo.proj[1][1] *= -1; // car glm pour OpenGL et l'axe y est inversé par rapport a vulkan
+	frame.proj[1][1] *= -1; // car glm pour OpenGL et l'axe y est inversé par rapport a vulkan
 
-	memcpy(m_uniformBuffersMapped[currentImage], &ubo, sizeof(ubo));
+	frame.viewProj = frame.proj * frame.view;
+	m_viewProjection = frame.viewProj;
+	m_cameraPosition = glm::vec3(glm::inverse(frame.view)[3]);
+
+	// cull.comp : le frustum, de quoi projeter une sphère et la taille de la pyramide
+	updateFrustumPlanes();
+	std::copy(std::begin(m_frustumPlanes), std::end(m_frustumPlanes), std::begin(frame.frustumPlanes));
+	frame.cullProjection = glm::vec4(frame.proj[0][0], frame.proj[1][1], frame.proj[2][2], frame.proj[3][2]);
+	VkExtent2D pyramidSource = m_hiz.getPyramidSource();
+	frame.cullScreen = glm::vec4(static_cast<float>(pyramidSource.width), static_cast<float>(pyramidSource.height),
+				     static_cast<float>(m_hiz.getPyramidLevels()), g_near_plane);
+
+	memcpy(m_uniformBuffersMapped[currentImage], &frame, sizeof(frame));
 	// m_uniformBuffersMapped adresse accessible ou vont être stockées les données de l'ubo
+
+	// une multiplication par objet ici plutot qu'une par sommet dans le vertex shader
+	auto* clip = reinterpret_cast<glm::mat4*>(static_cast<char*>(m_uniformBuffersMapped[currentImage]) + g_object_clip_offset);
+	for (size_t object = 0; object < m_objectTransforms.size(); ++object) {
+		clip[object] = frame.viewProj * m_objectTransforms[object];
+	}
+}
+
+/// @brief Runs one budgeted defragmentation step then patches what references the moved resources
+/// the texture view is recreated and each descriptor set is rewritten when its own frame comes back
+void VulkanApp::recordDefragmentation(VkCommandBuffer commandBuffer) {
+	VkImage textureImage = m_textureImage;
+
+	m_defragmenter.step(commandBuffer, m_frameNumber, DefragBudget{}, m_frameArenas[m_currentFrame]);
+
+	if (m_textureImage != textureImage) {
+		// l'ancienne vue est encore utilisée par les frames en vol
+		m_deletionQueue.push(m_textureImageView);
+		m_textureImageView = createImageView(m_textureImage, VK_FORMAT_R8G8B8A8_SRGB, m_mipLevels, VK_IMAGE_ASPECT_COLOR_BIT);
+		std::fill(m_descriptorsDirty.begin(), m_descriptorsDirty.end(), true);
+	}
+
+	// on a attendu la fence de cette frame, son set n'est plus utilisé par le gpu
+	if (m_descriptorsDirty[m_currentFrame]) {
+		m_descriptors.updateTexture(m_currentFrame, m_textureImageView, m_textureSampler);
+		m_descriptorsDirty[m_currentFrame] = false;
+	}
+}
+
+void VulkanApp::printMemoryStats() {
+	MemoryStats stats = m_allocator.getStats();
+	std::cout << "Memory: " << stats.blockCount << " blocks, " << stats.allocationCount << " allocations, "
+		  << stats.usedBytes << "/" << stats.totalBytes << " bytes used, largest free range " << stats.largestFreeRange
+		  << ", " << stats.freeRangeCount << " free ranges, fragmentation " << stats.fragmentation() << '\n';
 }
 
 
@@ -644,70 +1612,78 @@ void VulkanApp::setObjectName(VkBuffer buffer, const char* name) {
 		func(m_context.getDevice(), &nameInfo);
 }
 
-void VulkanApp::createTextureImage() {
-	int texWidth;
-	int texHeight;
+/// @brief Reads and decodes the texture file, runs as a job while initVulkan creates the device objects
+void VulkanApp::decodeTexture() {
 	int texChannels;
 
-	stbi_uc* pixels = stbi_load(g_texture_path.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-
-	VkDeviceSize imgSize = texWidth * texHeight * 4;
-	if (!pixels) {
+	m_texturePixels = stbi_load(g_texture_path.c_str(), &m_textureWidth, &m_textureHeight, &texChannels, STBI_rgb_alpha);
+	if (!m_texturePixels) {
 		throw std::runtime_error("failed to load image!");
 	}
+}
+
+/// @brief Uploads the pixels decoded by decodeTexture, m_loading must be done
+void VulkanApp::createTextureImage() {
+	int texWidth = m_textureWidth;
+	int texHeight = m_textureHeight;
+
+	VkDeviceSize imgSize = texWidth * texHeight * 4;
 
 	// pour avoir notre mipmap on prend la + grande dimension, on recupere par combien de fois on peut diviser par 2
 	m_mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight))));
 
 	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
+	Allocation stagingBufferAllocation;
 
 	createBuffer(
 	    imgSize,
 	    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
 	    VK_SHARING_MODE_EXCLUSIVE,
 	    VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-	    stagingBuffer, stagingBufferMemory);
+	    stagingBuffer, stagingBufferAllocation);
 
 	setObjectName(stagingBuffer, "ImageStagingBuffer");
 
-	void* data;
-	vkMapMemory(m_context.getDevice(), stagingBufferMemory, 0, imgSize, 0, &data);
-	memcpy(data, pixels, static_cast<size_t>(imgSize));
-	vkUnmapMemory(m_context.getDevice(), stagingBufferMemory);
+	memcpy(stagingBufferAllocation.mapped, m_texturePixels, static_cast<size_t>(imgSize));
 
-	stbi_image_free(pixels);
+	stbi_image_free(m_texturePixels);
+	m_texturePixels = nullptr;
 
 	createImage(texWidth, texHeight,
 		    VK_FORMAT_R8G8B8A8_SRGB /*4 int8 pour chaque pixels */, m_mipLevels,
 		    VK_SAMPLE_COUNT_1_BIT,
-		    VK_SHARING_MODE_CONCURRENT, // besoin de la queue transfer et graphics comme j'ai les deux dans deux queues différentes
+		    getUploadSharingMode(), // besoin de la queue transfer et graphics comme j'ai les deux dans deux queues différentes
 		    VK_IMAGE_TILING_OPTIMAL,	// ici pour avoir un accès le plus efficace possible
 		    // tiling linéaire row major order
 		    VK_IMAGE_USAGE_TRANSFER_SRC_BIT /*l'image servira de source et destinaation pour les transfert car on va generer les mipmaps*/ | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, // on veut pouvoir transferer des données, et l'utiliser comme sampler
 		    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,																			   // stocker de manière a avoir un accès rapide
-		    m_textureImage, m_textureImageMemory);
+		    m_textureImage, m_textureImageAllocation, true);
 
 	// modifier l'état de l'image en gros pour effectuer certaines opérations ici
 	// VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL pour copier les données
-	transitionImageLayout(m_commandPoolTransfer, m_context.getTransferQueue(), m_textureImage,
-			      VK_FORMAT_R8G8B8A8_SRGB, m_mipLevels,
-			      VK_IMAGE_LAYOUT_UNDEFINED /*on s'occupe pas de l'état precedent*/,
-			      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-
-	copyBufferToImage(m_commandPoolTransfer, m_context.getTransferQueue(), stagingBuffer, m_textureImage, texWidth, texHeight);
-
-	// une
-	generateMipmaps(m_commandPool, m_context.getGraphicsQueue(), m_textureImage, VK_FORMAT_R8G8B8A8_SRGB, texWidth, texHeight, m_mipLevels);
+	// tout est enregistré dans les batchs, soumis ensemble par submitUploads
+	m_transferUploads.transitionImageLayout(m_textureImage, m_mipLevels,
+						VK_IMAGE_LAYOUT_UNDEFINED /*on s'occupe pas de l'état precedent*/,
+						VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+	m_transferUploads.copyBufferToImage(stagingBuffer, m_textureImage, texWidth, texHeight);
+	m_transferUploads.releaseAfterUpload(stagingBuffer, stagingBufferAllocation);
+
+	// les mipmaps sont générées sur la graphics queue, elle doit d'abord acquérir l'image
+	// toutes les mips sont transférées, les dernières sont encore vides mais déjà en TRANSFER_DST
+	if (!m_options.concurrentSharing) {
+		m_transferUploads.releaseImage(m_textureImage, m_mipLevels, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, m_graphicsUploads.getQueueFamily());
+		m_graphicsUploads.acquireImage(m_textureImage, m_mipLevels, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, m_transferUploads.getQueueFamily(),
+					       VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT);
+	}
 
-	vkDestroyBuffer(m_context.getDevice(), stagingBuffer, nullptr);
-	vkFreeMemory(m_context.getDevice(), stagingBufferMemory, nullptr);
+	m_graphicsUploads.generateMipmaps(m_textureImage, VK_FORMAT_R8G8B8A8_SRGB, texWidth, texHeight, m_mipLevels);
 }
 
 void VulkanApp::createImage(uint32_t width, uint32_t height, VkFormat format, uint32_t mipLevels,
 			    VkSampleCountFlagBits numSamples, VkSharingMode sharingMode,
 			    VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties,
-			    VkImage& image, VkDeviceMemory& imageMemory) {
+			    VkImage& image, Allocation& imageAllocation, bool defragmentable) {
 
 	VkImageCreateInfo imageInfo{};
 	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -721,15 +1697,17 @@ void VulkanApp::createImage(uint32_t width, uint32_t height, VkFormat format, ui
 	imageInfo.tiling = tiling;
 	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 	imageInfo.usage = usage;
-	imageInfo.sharingMode = sharingMode;
 	imageInfo.samples = numSamples;
 
-	auto indices = m_context.getQueueFamilies();
-	std::set<uint32_t> uniqueIndices{indices.transferFamily.value(), indices.graphicsFamily.value()};
-	std::vector<uint32_t> queueIndices(uniqueIndices.begin(), uniqueIndices.end());
+	uint32_t queueIndices[3];
+	uint32_t familyCount = m_context.getSharingFamilies(queueIndices);
+	if (familyCount < 2) {
+		sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	}
+	imageInfo.sharingMode = sharingMode;
 	if (sharingMode == VK_SHARING_MODE_CONCURRENT) {
-		imageInfo.queueFamilyIndexCount = static_cast<uint32_t>(queueIndices.size());
-		imageInfo.pQueueFamilyIndices = queueIndices.data(); //
+		imageInfo.queueFamilyIndexCount = familyCount;
+		imageInfo.pQueueFamilyIndices = queueIndices; //
 	}
 
 	imageInfo.flags = 0; // Optional, voir pour 3D voxel en grande partie vide ex => nuages
@@ -741,135 +1719,14 @@ void VulkanApp::createImage(uint32_t width, uint32_t height, VkFormat format, ui
 	VkMemoryRequirements memRequirements;
 	vkGetImageMemoryRequirements(m_context.getDevice(), image, &memRequirements);
 
-	VkMemoryAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memRequirements.size;
-	allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-	if (vkAllocateMemory(m_context.getDevice(), &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-		throw std::runtime_error("failed to allocate image memory!");
-	}
-
-	vkBindImageMemory(m_context.getDevice(), image, imageMemory, 0);
-}
-
-// record et execute un command buffer
-VkCommandBuffer VulkanApp::beginSingleTimeCommands(VkCommandPool commandPool) {
-	VkCommandBufferAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	allocInfo.commandPool = commandPool;
-	allocInfo.commandBufferCount = 1;
-
-	VkCommandBuffer commandBuffer;
-	vkAllocateCommandBuffers(m_context.getDevice(), &allocInfo, &commandBuffer);
-
-	VkCommandBufferBeginInfo beginInfo{};
-	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-	vkBeginCommandBuffer(commandBuffer, &beginInfo);
-	return commandBuffer;
-}
-
-void VulkanApp::endSingleTimeCommands(VkCommandBuffer commandBuffer, VkCommandPool commandPool, VkQueue queue) {
-	vkEndCommandBuffer(commandBuffer);
-
-	VkSubmitInfo submitInfo{};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &commandBuffer;
-
-	vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
-	// envoie a la queue ce qu'on a record,
-	// on a pas a attendre, on veut lancer le transfert directement
-
-	vkQueueWaitIdle(queue);
-	// par contre on doit bien attendre que se soit fini, soit :
-	// on utilise des fences et on pourrait lancer plusieurs transferts en meme temps et attendre qu'ils aient tous fini
-	// soit on sait que le transfert est fini avec vkQueueWaitIdle
+	imageAllocation = m_allocator.allocate(memRequirements, properties, tiling == VK_IMAGE_TILING_LINEAR);
 
-	vkFreeCommandBuffers(m_context.getDevice(), commandPool, 1, &commandBuffer);
-}
-
-void VulkanApp::transitionImageLayout(VkCommandPool commandPool, VkQueue queue,
-				      VkImage image, VkFormat format, uint32_t mipLevels,
-				      VkImageLayout oldLayout, VkImageLayout newLayout) {
-	VkCommandBuffer commandBuffer = beginSingleTimeCommands(commandPool);
-
-	VkImageMemoryBarrier barrier{};
-	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-
-	barrier.oldLayout = oldLayout; // VK_IMAGE_LAYOUT_UNDEFINED, si on s'occupe pas de ce qu'il y a avant
-	barrier.newLayout = newLayout;
-
-	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-
-	barrier.image = image;
-	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	barrier.subresourceRange.baseMipLevel = 0;
-	barrier.subresourceRange.levelCount = mipLevels;
-	barrier.subresourceRange.baseArrayLayer = 0;
-	barrier.subresourceRange.layerCount = 1;
-
-	VkPipelineStageFlags srcStage;
-	VkPipelineStageFlags dstStage;
-
-	if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-		// on passe de l'état precedent (peut importe) au trasfert
+	vkBindImageMemory(m_context.getDevice(), image, imageAllocation.memory, imageAllocation.offset);
 
-		barrier.srcAccessMask = 0;			      // met met le masque a 0
-		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT; // on va écrire
-
-		srcStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT; // on peut écrire sans attendre une étape
-		dstStage = VK_PIPELINE_STAGE_TRANSFER_BIT;    // le transfert s'effectur a cette pseudo etape de la pipeline
-							      // pas une vraie étape du pipeline graphique
-
-	} else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-		// on veut passer dans l'état pret pour lecture par un shader
-		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-		srcStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-		dstStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT; // sera lu au niveau du fragments hader
-
-	} else {
-		throw std::invalid_argument("unsupported layout transition!");
+	// seulement les images samplées, elles restent en SHADER_READ_ONLY entre les frames
+	if (defragmentable) {
+		m_defragmenter.registerImage(&image, &imageAllocation, imageInfo, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT);
 	}
-
-	vkCmdPipelineBarrier(commandBuffer,
-			     srcStage, dstStage,
-			     0,
-			     0, nullptr,
-			     0, nullptr,
-			     1, &barrier);
-
-	endSingleTimeCommands(commandBuffer, commandPool, queue);
-}
-
-void VulkanApp::copyBufferToImage(VkCommandPool commandPool, VkQueue queue, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height) {
-	VkCommandBuffer commandBuffer = beginSingleTimeCommands(commandPool);
-
-	VkBufferImageCopy region{};
-	region.bufferOffset = 0;
-	region.bufferRowLength = 0;
-	region.bufferImageHeight = 0;
-
-	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	region.imageSubresource.mipLevel = 0;
-	region.imageSubresource.baseArrayLayer = 0;
-	region.imageSubresource.layerCount = 1;
-
-	region.imageOffset = {0, 0, 0};
-	region.imageExtent = {
-	    width,
-	    height,
-	    1};
-
-	vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-
-	endSingleTimeCommands(commandBuffer, commandPool, queue);
 }
 
 VkImageView VulkanApp::createImageView(VkImage image, VkFormat format, uint32_t mipLevels, VkImageAspectFlags aspectFlags) {
@@ -919,11 +1776,9 @@ void VulkanApp::createTextureImageSampler() {
 	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
 	// pour chaque axe on peut définir comme les uv font se comporter quand on dépasse 0, 1
 
-	samplerInfo.anisotropyEnable = VK_TRUE;
-	VkPhysicalDeviceProperties properties{};
-	vkGetPhysicalDeviceProperties(m_context.getPhysicalDevice(), &properties);
-	// recup les info du gpu pour connaitre la valeur max du filtrage
-	samplerInfo.maxAnisotropy = properties.limits.maxSamplerAnisotropy;
+	// le niveau du preset, déjà limité au max du gpu
+	samplerInfo.anisotropyEnable = m_quality.maxAnisotropy > 1.0f ? VK_TRUE : VK_FALSE;
+	samplerInfo.maxAnisotropy = m_quality.maxAnisotropy;
 
 	samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK; // couleur quand on sample en dehors de l'image
 
@@ -950,127 +1805,517 @@ bool VulkanApp::hasStencilComponent(VkFormat format) {
 	return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT;
 }
 
-void VulkanApp::createDepthResources() {
+/// @brief Declares the passes of a frame and compiles them for the current swapchain extent and quality preset, the
+/// previous transient targets go through the deletion queue
+void VulkanApp::buildRenderGraph() {
+	m_renderGraph.reset();
+
+	VkExtent2D swapchainExtent = m_swapchain.getExtent();
+	m_renderExtent = {std::max(1u, static_cast<uint32_t>(swapchainExtent.width * m_quality.renderScale)),
+			  std::max(1u, static_cast<uint32_t>(swapchainExtent.height * m_quality.renderScale))};
+	VkExtent2D extent = m_renderExtent;
+	bool upscale = extent.width != swapchainExtent.width || extent.height != swapchainExtent.height;
+
+	// sans msaa la passe principale écrit directement sa cible, il n'y a rien a resolve
+	m_colorTarget = g_invalid_resource;
+	if (m_context.getMsaaSamples() != VK_SAMPLE_COUNT_1_BIT) {
+		m_colorTarget = m_renderGraph.createImage("color", {m_swapchain.getImageFormat(), extent, m_context.getMsaaSamples(), VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT});
+	}
+	m_depthTarget = m_renderGraph.createImage("depth", {m_depthFormat, extent, m_context.getMsaaSamples(), 0});
+	// acquise au stage color attachment output (attente du sémaphore), présentée a la fin
+	m_swapchainTarget = m_renderGraph.importImage("swapchain", VK_IMAGE_ASPECT_COLOR_BIT, ResourceAccess::Acquire, ResourceAccess::Present);
+	m_scaledTarget = upscale ? m_renderGraph.createImage("scaled", {m_swapchain.getImageFormat(), extent, VK_SAMPLE_COUNT_1_BIT, 0}) : g_invalid_resource;
+	RenderGraphResource target = upscale ? m_scaledTarget : m_swapchainTarget;
+
+	// Hi-Z : phase 0 contre la pyramide de la frame précédente, profondeur de ses draws, nouvelle pyramide, phase 1
+	// pour ce que la phase 0 a caché a tort. les passes de profondeur remplacent la prepass. la phase 0 et la remise
+	// a zéro des compteurs sont sur le compute context (recordEarlyCull), le rendu les attend par son sémaphore :
+	// les commandes et la visibilité arrivent déjà écrites
+	if (m_hizCulling) {
+		m_indirectTarget = m_renderGraph.importBuffer("indirect draws", ResourceAccess::IndirectBuffer, ResourceAccess::IndirectBuffer);
+		m_pyramidTarget = m_renderGraph.importImage("depth pyramid", VK_IMAGE_ASPECT_COLOR_BIT, ResourceAccess::SampledCompute, ResourceAccess::SampledCompute);
+		m_visibilityTarget = m_renderGraph.importBuffer("visibility", ResourceAccess::StorageReadCompute, ResourceAccess::StorageReadCompute);
+
+		uint32_t depthEarly = m_renderGraph.addPass("depth early", [this](VkCommandBuffer commandBuffer) { recordHiZDepth(commandBuffer, 0); });
+		m_renderGraph.write(depthEarly, m_depthTarget, ResourceAccess::DepthAttachmentWrite);
+		m_renderGraph.read(depthEarly, m_indirectTarget, ResourceAccess::IndirectBuffer);
+
+		// tous les niveaux sont réécrits, le contenu précédent n'est pas gardé
+		uint32_t build = m_renderGraph.addPass("hiz build", [this](VkCommandBuffer commandBuffer) { m_hiz.recordPyramid(commandBuffer); });
+		m_renderGraph.read(build, m_depthTarget, ResourceAccess::SampledCompute);
+		m_renderGraph.write(build, m_pyramidTarget, ResourceAccess::StorageWriteCompute);
+
+		uint32_t cullLate = m_renderGraph.addPass("cull late", [this](VkCommandBuffer commandBuffer) { m_hiz.recordLateCull(commandBuffer, m_currentFrame); });
+		m_renderGraph.read(cullLate, m_pyramidTarget, ResourceAccess::SampledCompute);
+		m_renderGraph.read(cullLate, m_visibilityTarget, ResourceAccess::StorageReadCompute);
+		m_renderGraph.read(cullLate, m_indirectTarget, ResourceAccess::StorageWriteCompute);
+		m_renderGraph.write(cullLate, m_indirectTarget, ResourceAccess::StorageWriteCompute);
+
+		uint32_t depthLate = m_renderGraph.addPass("depth late", [this](VkCommandBuffer commandBuffer) { recordHiZDepth(commandBuffer, 1); });
+		m_renderGraph.read(depthLate, m_depthTarget, ResourceAccess::DepthAttachmentWrite);
+		m_renderGraph.write(depthLate, m_depthTarget, ResourceAccess::DepthAttachmentWrite);
+		m_renderGraph.read(depthLate, m_indirectTarget, ResourceAccess::IndirectBuffer);
+	} else if (m_occlusionQueries) {
+		// remplace la prepass quand elle est active. sans elle la passe principale efface la profondeur : rien ne lit
+		// ce que la passe écrit, seules ses queries comptent
+		uint32_t occlusion = m_renderGraph.addPass("occlusion", [this](VkCommandBuffer commandBuffer) { recordOcclusionPass(commandBuffer); });
+		m_renderGraph.write(occlusion, m_depthTarget, ResourceAccess::DepthAttachmentWrite);
+		m_renderGraph.setSideEffects(occlusion);
+
+		if (m_occlusion.usesConditionalRendering()) {
+			m_predicateTarget = m_renderGraph.importBuffer("occlusion predicates", ResourceAccess::ConditionalRendering, ResourceAccess::ConditionalRendering);
+			uint32_t resolve = m_renderGraph.addPass("occlusion resolve", [this](VkCommandBuffer commandBuffer) {
+				m_occlusion.recordResolve(commandBuffer, m_currentFrame, static_cast<uint32_t>(m_occlusionDraws.size()));
+			});
+			m_renderGraph.write(resolve, m_predicateTarget, ResourceAccess::TransferDst);
+		}
+	} else if (m_depthPrepass) {
+		// la prepass écrit toute la profondeur, la passe principale ne fait plus que la lire
+		uint32_t prepass = m_renderGraph.addPass("depth prepass", [this](VkCommandBuffer commandBuffer) { recordDepthPrepass(commandBuffer); });
+		m_renderGraph.write(prepass, m_depthTarget, ResourceAccess::DepthAttachmentWrite);
+	}
+
+	uint32_t mainPass = m_renderGraph.addPass("main", [this](VkCommandBuffer commandBuffer) { recordMainPass(commandBuffer); });
+	if (m_colorTarget != g_invalid_resource) {
+		m_renderGraph.write(mainPass, m_colorTarget, ResourceAccess::ColorAttachmentWrite);
+	}
+	if (m_depthPrepass) {
+		m_renderGraph.read(mainPass, m_depthTarget, ResourceAccess::DepthAttachmentRead);
+	} else {
+		m_renderGraph.write(mainPass, m_depthTarget, ResourceAccess::DepthAttachmentWrite);
+	}
+	m_renderGraph.write(mainPass, target, ResourceAccess::ColorAttachmentWrite); // resolve, ou la couleur sans msaa
+	if (m_hizCulling) {
+		m_renderGraph.read(mainPass, m_indirectTarget, ResourceAccess::IndirectBuffer);
+	}
+	if (m_occlusionQueries && m_occlusion.usesConditionalRendering()) {
+		m_renderGraph.read(mainPass, m_predicateTarget, ResourceAccess::ConditionalRendering);
+	}
+
+	if (upscale) {
+		uint32_t upscalePass = m_renderGraph.addPass("upscale", [this](VkCommandBuffer commandBuffer) { recordUpscale(commandBuffer); });
+		m_renderGraph.read(upscalePass, m_scaledTarget, ResourceAccess::TransferSrc);
+		m_renderGraph.write(upscalePass, m_swapchainTarget, ResourceAccess::TransferDst);
+	}
+
+	// --bench : les compteurs des deux phases, lus par drawFrame quand le slot revient
+	if (m_hizCulling && m_options.benchFrames > 0) {
+		uint32_t stats = m_renderGraph.addPass("hiz stats", [this](VkCommandBuffer commandBuffer) { m_hiz.recordReadback(commandBuffer, m_currentFrame); });
+		m_renderGraph.read(stats, m_indirectTarget, ResourceAccess::TransferSrc);
+		m_renderGraph.setSideEffects(stats);
+	}
+
+	m_renderGraph.compile();
+	if (m_options.dumpRenderGraph) {
+		m_renderGraph.dump(std::cout);
+	}
+
+	if (!m_options.dynamicRendering) {
+		VkImageView colorView = m_colorTarget != g_invalid_resource ? m_renderGraph.getImageView(m_colorTarget) : VK_NULL_HANDLE;
+		VkImageView scaledView = upscale ? m_renderGraph.getImageView(m_scaledTarget) : VK_NULL_HANDLE;
+		m_swapchain.createFrameBuffers(m_renderPass.get(), extent, m_renderGraph.getImageView(m_depthTarget), colorView, scaledView);
+		if (m_depthPrepass || m_occlusionQueries) {
+			m_swapchain.createDepthFrameBuffer(m_renderPass.getDepthPrepass(), extent, m_renderGraph.getImageView(m_depthTarget));
+		}
+	}
+
+	if (m_hizCulling) {
+		// la pyramide suit la taille du depth buffer, effacée par un batch de la queue graphics que la frame attend
+		VkExtent2D pyramidSource = m_hiz.getPyramidSource();
+		if (m_hiz.getPyramid() == VK_NULL_HANDLE || pyramidSource.width != extent.width || pyramidSource.height != extent.height) {
+			m_hiz.createPyramid(extent);
+			m_graphicsTicket = m_graphicsUploads.submit();
+		}
+		m_renderGraph.setImage(m_pyramidTarget, m_hiz.getPyramid());
+		m_renderGraph.setBuffer(m_indirectTarget, m_hiz.getIndirectBuffer());
+		m_renderGraph.setBuffer(m_visibilityTarget, m_hiz.getVisibilityBuffer());
+		m_hiz.updateDescriptors(m_uniformBuffers, m_objectBuffer, m_renderGraph.getImageView(m_depthTarget), m_context.getMsaaSamples());
+	}
+	if (m_occlusionQueries && m_occlusion.usesConditionalRendering()) {
+		m_renderGraph.setBuffer(m_predicateTarget, m_occlusion.getPredicateBuffer());
+	}
+}
+
+/// @brief The depth only variant keeps the cull mode of the material, a face missing from the prepass would fail the
+/// EQUAL test of the main pass. sample shading is useless without a fragment shader. the boxes of the occlusion queries
+/// are depth only too, tested without writing: a box must not hide the draws behind it
+void VulkanApp::requestPrepassVariants() {
+	const PipelineDesc& material = m_pipelines.getDesc(m_materialVariant);
+
+	PipelineDesc depthDesc = material;
+	depthDesc.vertexShader = g_depth_vertex_shader;
+	depthDesc.fragmentShader.clear();
+	depthDesc.vertexLayout = VertexLayout::Position;
+	depthDesc.sampleShading = false;
+	depthDesc.minSampleShading = 0.0f; // le même depth only pour tous les presets d'un sample count
+	if (m_options.dynamicRendering) {
+		depthDesc.colorFormat = VK_FORMAT_UNDEFINED;
+	} else {
+		depthDesc.renderPass = m_renderPass.getDepthPrepass();
+	}
 
-	VkFormat depthFormat = m_renderPass.findDepthFormat();
+	// la profondeur finale est déjà là : seuls les fragments visibles passent, une seule fois par sample
+	PipelineDesc mainDesc = material;
+	mainDesc.depthCompare = VK_COMPARE_OP_EQUAL;
+	mainDesc.depthWrite = false;
 
-	createImage(m_swapchain.getExtent().width, m_swapchain.getExtent().height , depthFormat, 1, m_context.getMsaaSamples(),
-		    VK_SHARING_MODE_EXCLUSIVE,
-		    VK_IMAGE_TILING_OPTIMAL,
-		    VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-		    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_depthImage, m_depthImageMemory);
+	// Hi-Z : INDIRECT_DRAWS, la matrice de l'objet vient de firstInstance et non des push constants
+	bool indirect = m_options.hizCulling && m_hizSupported;
+	if (indirect) {
+		depthDesc.setSpecialization(0, 1);
+		mainDesc.setSpecialization(0, 1);
+	}
 
-	m_depthImageView = createImageView(m_depthImage, depthFormat, 1, VK_IMAGE_ASPECT_DEPTH_BIT);
+	m_prepassRequested.depth = m_pipelines.request(depthDesc);
+	m_prepassRequested.main = m_pipelines.request(mainDesc);
+	m_prepassRequested.indirect = indirect;
+
+	// la caméra peut être dans la boite d'un draw sans query, pas dans une autre : les faces arrière comptent aussi
+	m_prepassRequested.proxy = 0;
+	if (m_options.occlusionQueries && m_occlusionSupported && !indirect) {
+		PipelineDesc proxyDesc = depthDesc;
+		proxyDesc.depthWrite = false;
+		proxyDesc.depthCompare = VK_COMPARE_OP_LESS_OR_EQUAL;
+		proxyDesc.cullMode = VK_CULL_MODE_NONE;
+		proxyDesc.setSpecialization(1, 1); // BOX_PROXY
+		m_prepassRequested.proxy = m_pipelines.request(proxyDesc);
+	}
+}
+
+/// @brief Turning the prepass, the Hi-Z culling or the occlusion queries on or off changes the passes of the graph, so
+/// it waits for the frames in flight like any other setting change. a new material with the prepass on only swaps the
+/// variants. the Hi-Z needs the prepass variants with indirect draws, they are requested again when the mode asks for
+/// the other kind. the occlusion queries use the depth variant and the boxes, never with the Hi-Z which already culls
+void VulkanApp::updateDepthPrepass() {
+	// une variante qui n'a pas compilé ne sera jamais prête : le mode qui en a besoin est éteint au lieu d'attendre ou
+	// de dessiner avec une pipeline qui ne va pas avec sa passe
+	if (m_prepassRequested.depth != 0) {
+		bool failed = m_pipelines.isFailed(m_prepassRequested.depth) || m_pipelines.isFailed(m_prepassRequested.main);
+		if (failed && m_prepassRequested.indirect && m_options.hizCulling) {
+			std::cout << "Hi-Z culling: pipeline variants failed, turned off" << '\n';
+			m_options.hizCulling = false;
+		} else if (failed && !m_prepassRequested.indirect && (m_options.depthPrepass || m_options.occlusionQueries)) {
+			std::cout << "Depth prepass: pipeline variants failed, prepass and occlusion queries turned off" << '\n';
+			m_options.depthPrepass = false;
+			m_options.occlusionQueries = false;
+		} else if (m_pipelines.isFailed(m_prepassRequested.proxy) && m_options.occlusionQueries) {
+			std::cout << "Occlusion queries: box pipeline failed, turned off" << '\n';
+			m_options.occlusionQueries = false;
+		}
+	}
+
+	bool hiz = m_options.hizCulling && m_hizSupported;
+	bool prepass = m_options.depthPrepass || hiz;
+	bool occlusion = m_options.occlusionQueries && m_occlusionSupported && !hiz;
+	bool variants = prepass || occlusion;
+	if (variants && (m_prepassRequested.depth == 0 || m_prepassRequested.indirect != hiz || (occlusion && m_prepassRequested.proxy == 0))) {
+		requestPrepassVariants();
+	}
+
+	bool ready = m_prepassRequested.depth != 0 && m_pipelines.isReady(m_prepassRequested.depth) && m_pipelines.isReady(m_prepassRequested.main) &&
+		     (!occlusion || m_pipelines.isReady(m_prepassRequested.proxy));
+	bool wanted = prepass && ready;
+	if (variants && !ready)
+		return; // compilation en cours, on garde le mode actuel
+
+	if (wanted == m_depthPrepass && hiz == m_hizCulling && occlusion == m_occlusionQueries) {
+		if ((m_depthPrepass || m_occlusionQueries) &&
+		    (m_prepassVariants.depth != m_prepassRequested.depth || m_prepassVariants.main != m_prepassRequested.main ||
+		     m_prepassVariants.proxy != m_prepassRequested.proxy)) {
+			m_prepassVariants = m_prepassRequested;
+			invalidateCommandBuffers();
+		}
+		return;
+	}
+
+	waitForFrames();
+	bool hizChanged = hiz != m_hizCulling;
+	bool occlusionChanged = occlusion != m_occlusionQueries;
+	m_depthPrepass = wanted;
+	m_hizCulling = hiz;
+	m_occlusionQueries = occlusion;
+	m_prepassVariants = m_prepassRequested;
+	// les résultats d'un mode précédent ne valent plus rien, les queries repartent de la prochaine frame
+	std::fill(m_drawOccluded.begin(), m_drawOccluded.end(), 0);
+	// les framebuffers et les cibles du graph sont recréés, les primaries en cache les référencent
+	buildRenderGraph();
+	std::fill(m_cachedCommandBuffersValid.begin(), m_cachedCommandBuffersValid.end(), false);
+	invalidateCommandBuffers();
+	std::cout << "Depth prepass: " << (m_depthPrepass ? "on" : "off") << '\n';
+	if (hizChanged) {
+		std::cout << "Hi-Z culling: " << (m_hizCulling ? "on" : "off") << '\n';
+	}
+	if (occlusionChanged) {
+		std::cout << "Occlusion queries: " << (m_occlusionQueries ? "on" : "off") << '\n';
+	}
+}
+
+/// @brief Waits for the frames in flight like any other setting change, then rebuilds only what changed: the render
+/// passes and the pipelines for the sample count, the pipelines for the sample shading rate, the sampler for the
+/// anisotropy and the targets of the graph for the sample count or the render scale. the passes and variants of a
+/// previous preset are kept, switching back does not compile them again
+void VulkanApp::applyQualityPreset(QualityPreset preset) {
+	QualitySettings settings = resolveQualitySettings(&m_context, preset, m_swapchain.canUpscale());
+	m_options.quality = preset;
+	std::cout << "Quality: " << getQualityName(preset) << ", msaa " << settings.msaaSamples << "x, sample shading " << settings.minSampleShading
+		  << ", anisotropy " << settings.maxAnisotropy << ", render scale " << settings.renderScale << '\n';
+
+	bool samplesChanged = settings.msaaSamples != m_quality.msaaSamples;
+	bool shadingChanged = settings.minSampleShading != m_quality.minSampleShading;
+	bool anisotropyChanged = settings.maxAnisotropy != m_quality.maxAnisotropy;
+	bool scaleChanged = settings.renderScale != m_quality.renderScale;
+	if (!samplesChanged && !shadingChanged && !anisotropyChanged && !scaleChanged)
+		return;
+
+	waitForFrames();
+	m_quality = settings;
+
+	if (samplesChanged) {
+		m_context.setMsaaSamples(settings.msaaSamples);
+		if (!m_options.dynamicRendering) {
+			m_renderPass.setSamples(settings.msaaSamples);
+		}
+	}
+	if (samplesChanged || shadingChanged) {
+		rebuildPipelines();
+	}
+	if (samplesChanged) {
+		// les variantes actives ne vont plus avec le render pass, updateDepthPrepass rallume les modes avec les nouvelles
+		m_prepassVariants = {};
+		m_depthPrepass = false;
+		m_hizCulling = false;
+		m_occlusionQueries = false;
+		std::fill(m_drawOccluded.begin(), m_drawOccluded.end(), 0);
+	}
+	if (anisotropyChanged) {
+		// aucune frame en vol, les sets de toutes les frames sont réécrits tout de suite
+		vkDestroySampler(m_context.getDevice(), m_textureSampler, nullptr);
+		createTextureImageSampler();
+		for (uint32_t frame = 0; frame < m_framesInFlight; ++frame) {
+			m_descriptors.updateTexture(frame, m_textureImageView, m_textureSampler);
+		}
+		std::fill(m_descriptorsDirty.begin(), m_descriptorsDirty.end(), false);
+	}
+	if (samplesChanged || scaleChanged) {
+		buildRenderGraph();
+		std::fill(m_cachedCommandBuffersValid.begin(), m_cachedCommandBuffersValid.end(), false);
+	}
+	invalidateCommandBuffers();
+}
+
+/// @brief The base pipeline is built on the main thread, it is the fallback of every variant. the material and the
+/// prepass variants are asked for again from it and compile in the background, updateDepthPrepass swaps the prepass
+/// ones in once ready
+void VulkanApp::rebuildPipelines() {
+	PipelineDesc baseDesc = m_pipeline.getDesc();
+	baseDesc.samples = m_quality.msaaSamples;
+	baseDesc.sampleShading = m_quality.minSampleShading > 0.0f;
+	baseDesc.minSampleShading = m_quality.minSampleShading;
+	if (!m_options.dynamicRendering) {
+		baseDesc.renderPass = m_renderPass.get();
+	}
+	m_pipeline.setDesc(baseDesc);
+	m_pipelines.setFallback(m_pipeline.getDesc(), m_pipeline.get());
+
+	bool twoSided = m_materialVariant != 0;
+	if (m_twoSidedVariant != 0) {
+		PipelineDesc desc = baseDesc;
+		desc.cullMode = VK_CULL_MODE_NONE;
+		m_twoSidedVariant = m_pipelines.request(desc);
+	}
+	m_materialVariant = twoSided ? m_twoSidedVariant : 0;
+
+	if (m_prepassRequested.depth != 0) {
+		requestPrepassVariants();
+	}
 }
 
 void VulkanApp::loadMesh() {
 	m_mesh.loadMesh(g_model_path);
 }
 
-void VulkanApp::generateMipmaps(VkCommandPool commandPool, VkQueue queue, VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels) {
-	// on regarde si le format support le linear blitting
-	VkFormatProperties formatProperties;
-	vkGetPhysicalDeviceFormatProperties(m_context.getPhysicalDevice(), imageFormat, &formatProperties);
-	if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)) {
-		throw std::runtime_error("texture image format does not support linear blitting!");
-	}
-
-	VkCommandBuffer commandBuffer = beginSingleTimeCommands(commandPool);
-
-	VkImageMemoryBarrier barrier{};
-	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-	barrier.image = image;
-
-	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-
-	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	barrier.subresourceRange.baseArrayLayer = 0;
-	barrier.subresourceRange.layerCount = 1;
-	barrier.subresourceRange.levelCount = 1;
-
-	int32_t mipWidth = texWidth;
-	int32_t mipHeight = texHeight;
-
-	for (uint32_t i = 1; i < mipLevels; i++) {
-		barrier.subresourceRange.baseMipLevel = i - 1;
-		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-
-		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
-				     0, nullptr,
-				     0, nullptr,
-				     1, &barrier); // permet d'attendre que le transfert avec copy ou la mipmap soit fini avant de continuer et de pouvoir écrire
-
-		VkImageBlit blit{};
-		blit.srcOffsets[0] = {0, 0, 0};
-		blit.srcOffsets[1] = {mipWidth, mipHeight, 1};
-		blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		blit.srcSubresource.mipLevel = i - 1;
-		blit.srcSubresource.baseArrayLayer = 0;
-		blit.srcSubresource.layerCount = 1;
-		// on va prendre la taille de la texture du miplevel precendent i-1
-
-		blit.dstOffsets[0] = {0, 0, 0};
-		blit.dstOffsets[1] = {
-		    mipWidth > 1 ? mipWidth / 2 : 1,
-		    mipHeight > 1 ? mipHeight / 2 : 1,
-		    1};
-		blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		blit.dstSubresource.mipLevel = i;
-		blit.dstSubresource.baseArrayLayer = 0;
-		blit.dstSubresource.layerCount = 1;
-		// on va "écrire" le miplevel i en fonction des données du miplevel precedent
-
-		vkCmdBlitImage(commandBuffer, // queue a besoin de la queue graphics
-			       image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-			       image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			       1, &blit,
-			       VK_FILTER_LINEAR); // interpolation
-
-		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-		vkCmdPipelineBarrier(commandBuffer, // attend que blit termine avant de sample
-				     VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
-				     0, nullptr,
-				     0, nullptr,
-				     1, &barrier);
-
-		if (mipWidth > 1)
-			mipWidth /= 2;
-		if (mipHeight > 1)
-			mipHeight /= 2;
-	}
-
-	// on transitionne en mode shader read le dernier mipLevel
-	barrier.subresourceRange.baseMipLevel = mipLevels - 1;
-	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-	vkCmdPipelineBarrier(commandBuffer,
-			     VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
-			     0, nullptr,
-			     0, nullptr,
-			     1, &barrier);
-
-	endSingleTimeCommands(commandBuffer, commandPool, queue);
-}
-
-
-void VulkanApp::createColorRessources() {
-	VkFormat colorFormat = m_swapchain.getImageFormat();
+/// @brief Splits the mesh into draws of g_draw_chunk_triangles with their bounding spheres and boxes, --stress repeats
+/// the whole list. the largest chunks are the occluders of the occlusion queries
+void VulkanApp::buildDrawList() {
+	constexpr uint32_t chunkIndices = g_draw_chunk_triangles * 3;
+	uint32_t indexCount = m_mesh.indicesCount();
+	uint32_t chunkCount = (indexCount + chunkIndices - 1) / chunkIndices;
+
+	std::vector<DrawItem> chunks;
+	chunks.reserve(chunkCount);
+	for (uint32_t first = 0; first < indexCount; first += chunkIndices) {
+		DrawItem draw{std::min(chunkIndices, indexCount - first), first, 0, glm::vec3(0.0f), 0.0f, 0};
+
+		// centre de la boite englobante, puis le vertex le plus loin pour le rayon
+		glm::vec3 min{std::numeric_limits<float>::max()};
+		glm::vec3 max{std::numeric_limits<float>::lowest()};
+		for (uint32_t i = first; i < first + draw.indexCount; ++i) {
+			const glm::vec3& pos = m_mesh.vertex(m_mesh.index(i)).pos;
+			min = glm::min(min, pos);
+			max = glm::max(max, pos);
+		}
+		draw.center = (min + max) * 0.5f;
+		draw.extent = (max - min) * 0.5f;
+		for (uint32_t i = first; i < first + draw.indexCount; ++i) {
+			draw.radius = std::max(draw.radius, glm::length(m_mesh.vertex(m_mesh.index(i)).pos - draw.center));
+		}
+		chunks.push_back(draw);
+	}
+	float maxRadius = 0.0f;
+	for (const DrawItem& chunk : chunks) {
+		maxRadius = std::max(maxRadius, chunk.radius);
+	}
+	for (DrawItem& chunk : chunks) {
+		chunk.occluder = chunk.radius >= maxRadius * g_occluder_radius_ratio;
+	}
 
-	createImage(m_swapchain.getExtent().width, m_swapchain.getExtent().height, colorFormat, 1, m_context.getMsaaSamples(),
-		    VK_SHARING_MODE_EXCLUSIVE, VK_IMAGE_TILING_OPTIMAL,
-		    VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
-		    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_colorImage, m_colorImageMemory);
+	m_drawList.clear();
+	m_drawList.reserve(chunks.size() * getObjectCount());
+	// un objet par copie, toutes a l'identité : les copies se superposent, seul le coût d'enregistrement nous intéresse
+	m_objectTransforms.assign(getObjectCount(), glm::mat4(1.0f));
+	for (uint32_t copy = 0; copy < getObjectCount(); ++copy) {
+		for (DrawItem& chunk : chunks) {
+			chunk.objectId = copy;
+		}
+		m_drawList.insert(m_drawList.end(), chunks.begin(), chunks.end());
+	}
+
+	// tailles maximales réservées ici, cullDrawList n'alloue pas
+	m_drawVisible.assign(m_drawList.size(), 0);
+	m_visibleDraws.clear();
+	m_visibleDraws.reserve(m_drawList.size());
+	m_drawQuery.assign(m_drawList.size(), g_no_query);
+	m_drawOccluded.assign(m_drawList.size(), 0);
+	m_occlusionDraws = ArenaVector<uint32_t>();
+	m_occluderDraws = ArenaVector<uint32_t>();
+	m_cullDraws = [this](uint32_t first, uint32_t count) {
+		AllocationCounter::Scope allocations(m_jobAllocations);
+		cullDraws(first, count);
+	};
+	invalidateCommandBuffers();
+}
+
+/// @brief Planes of m_viewProjection, for cullDrawList and the uniforms of cull.comp
+void VulkanApp::updateFrustumPlanes() {
+	// plans du frustum dans l'espace du monde (Gribb-Hartmann), depth en [0, 1] donc near = 3e ligne seule
+	const glm::mat4& m = m_viewProjection;
+	glm::vec4 rows[4];
+	for (int row = 0; row < 4; ++row) {
+		rows[row] = glm::vec4(m[0][row], m[1][row], m[2][row], m[3][row]);
+	}
+	m_frustumPlanes[0] = rows[3] + rows[0];
+	m_frustumPlanes[1] = rows[3] - rows[0];
+	m_frustumPlanes[2] = rows[3] + rows[1];
+	m_frustumPlanes[3] = rows[3] - rows[1];
+	m_frustumPlanes[4] = rows[2];
+	m_frustumPlanes[5] = rows[3] - rows[2];
+	for (auto& plane : m_frustumPlanes) {
+		// normalisés pour comparer la distance au rayon
+		plane /= glm::length(glm::vec3(plane));
+	}
+}
+
+/// @brief Frustum culls the draw list on the job system and compacts the visible draws on the calling thread.
+/// the cached command buffers are invalidated only when the visible set changed. updateUniformBuffer has set the planes.
+/// with the occlusion queries the queries are numbered here too, and without conditional rendering the draws hidden by
+/// the last results are left out: their boxes are still tested
+void VulkanApp::cullDrawList() {
+	m_jobs.parallelFor(static_cast<uint32_t>(m_drawList.size()), 0, m_cullDraws);
+
+	bool changed = false;
+	bool skipOccluded = m_occlusionQueries && !m_occlusion.usesConditionalRendering();
+	size_t visibleCount = 0;
+	uint32_t queryCount = 0;
+	// l'arena de la frame a été remise a zéro, celles de la frame précédente ne sont plus lues
+	FrameArena& arena = m_frameArenas[m_currentFrame];
+	m_occlusionDraws = ArenaVector<uint32_t>(ArenaAllocator<uint32_t>(arena));
+	m_occlusionDraws.reserve(m_drawList.size());
+	m_occluderDraws = ArenaVector<uint32_t>(ArenaAllocator<uint32_t>(arena));
+	m_occluderDraws.reserve(m_drawList.size());
+	for (uint32_t i = 0; i < m_drawList.size(); ++i) {
+		// la query est dans le command buffer de la passe d'occlusion et dans celui des draws (prédicat)
+		uint32_t query = m_drawVisible[i] == 2 ? queryCount++ : g_no_query;
+		changed |= m_drawQuery[i] != query;
+		m_drawQuery[i] = query;
+		if (query == g_no_query) {
+			m_drawOccluded[i] = 0;
+		}
+
+		if (!m_drawVisible[i])
+			continue;
+		if (query != g_no_query) {
+			m_occlusionDraws.push_back(i); // capacités réservées ci-dessus
+		} else {
+			m_occluderDraws.push_back(i);
+		}
+		if (skipOccluded && m_drawOccluded[i])
+			continue;
+		if (visibleCount < m_visibleDraws.size()) {
+			changed |= m_visibleDraws[visibleCount] != i;
+			m_visibleDraws[visibleCount] = i;
+		} else {
+			m_visibleDraws.push_back(i); // capacité réservée par buildDrawList
+			changed = true;
+		}
+		++visibleCount;
+	}
+	if (visibleCount != m_visibleDraws.size()) {
+		m_visibleDraws.resize(visibleCount);
+		changed = true;
+	}
+
+	if (changed) {
+		invalidateCommandBuffers();
+	}
+}
+
+/// @brief A draw is culled when its sphere, moved by the transform of its object, lies entirely behind one of the
+/// planes, runs on the job system threads. with the occlusion queries a visible draw gets one unless it is an occluder
+/// or the near plane may cut its box: a clipped box could hide a draw in front of the camera
+void VulkanApp::cullDraws(uint32_t first, uint32_t count) {
+	for (uint32_t i = first; i < first + count; ++i) {
+		const DrawItem& draw = m_drawList[i];
+		const glm::mat4& model = m_objectTransforms[draw.objectId];
+		glm::vec3 center = glm::vec3(model * glm::vec4(draw.center, 1.0f));
+		// la plus grande échelle des axes, la sphère reste englobante
+		float scale = std::max({glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))});
+		float radius = draw.radius * scale;
+		bool inside = true;
+		for (const auto& plane : m_frustumPlanes) {
+			if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+				inside = false;
+				break;
+			}
+		}
+		// la boite dépasse la sphère dans ses coins, sa demi diagonale l'englobe
+		bool queried = inside && m_occlusionQueries && !draw.occluder &&
+			       glm::length(center - m_cameraPosition) > glm::length(draw.extent) * scale + g_near_plane;
+		m_drawVisible[i] = queried ? 2 : inside;
+	}
+}
+
+/// @brief The slot before this one may have finished since, it is newer than the slot about to be reused whose frame
+/// is done. a draw that lost its query since keeps no result
+void VulkanApp::readOcclusionResults() {
+	uint32_t previous = (m_currentFrame + m_framesInFlight - 1) % m_framesInFlight;
+	bool read = m_occlusion.readResults(previous);
+	read |= m_occlusion.readResults(m_currentFrame); // refusé s'il est plus vieux
+	if (!read)
+		return;
 
-	m_colorImageView = createImageView(m_colorImage, colorFormat, 1, VK_IMAGE_ASPECT_COLOR_BIT);
+	const std::vector<uint32_t>& draws = m_occlusion.getResultDraws();
+	const std::vector<uint32_t>& samples = m_occlusion.getResults();
+	uint32_t hiddenCount = 0;
+	for (size_t query = 0; query < draws.size(); ++query) {
+		bool hidden = samples[query] == 0;
+		hiddenCount += hidden;
+		if (m_drawQuery[draws[query]] != g_no_query) {
+			m_drawOccluded[draws[query]] = hidden;
+		}
+	}
+	if (m_options.benchFrames > 0) {
+		m_occlusionTested += draws.size();
+		m_occlusionSkipped += hiddenCount;
+		m_occlusionCountedFrames++;
+	}
 }
\ No newline at end of file
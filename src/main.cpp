@@ -1,21 +1,98 @@
 #include <VulkanApp/VulkanApp.h>
+#include <VulkanApp/Jobs/JobBenchmark.h>
 
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <optional>
 #include <stdexcept>
 #include <vector>
 #include <set>
 
-int main() {
+// --concurrent : ressources uploadées en CONCURRENT (comparaison avec les transferts de propriété)
+// --bench N : rend N frames puis affiche les temps, lancer avec et sans --concurrent pour comparer
+// --threads N / --stress N : threads du job system et répétitions de la liste de draws,
+// ex: --bench 500 --stress 200 --threads 1 puis --threads 32 pour voir le temps d'enregistrement baisser
+// --no-cache : réenregistre les command buffers a chaque frame au lieu de resoumettre ceux en cache
+// --frames N|auto : frames in flight, 1 pour la latence, 3-4 pour le débit, auto mesure les temps cpu et gpu
+// --graph-dump : affiche le render graph compilé (passes gardées, barriers, mémoire aliasée)
+// --low-latency : attend que la frame précédente soit affichée puis lit les entrées juste avant d'enregistrer,
+// une frame de latence en moins au prix du recouvrement cpu/gpu. la latence entrée -> présentation est affichée avec --bench
+// --fps-limit N : limite le cpu a N frames par seconde, moins de frames en file quand le gpu ou l'écran va plus vite
+// --resize-bench N : rend N frames en redimensionnant la fenêtre par script (drag puis pause), les pics sont dans max / p99
+// --dynamic-rendering : la passe principale utilise vkCmdBeginRendering au lieu de la VkRenderPass et des framebuffers,
+// comparer les deux avec --bench (et --resize-bench, plus de framebuffers recréés)
+// --depth-prepass : passe de profondeur seule (position seulement) puis la passe principale en EQUAL sans écriture,
+// chaque pixel n'est shadé qu'une fois (par sample avec le sample shading). touche P pour basculer
+// --hiz : culling d'occlusion en deux phases sur le gpu contre une pyramide de profondeur, draws indirects comptés
+// sur le gpu (active la prepass). touche H pour basculer, --bench affiche les draws de chaque phase
+// --quality low|medium|high|ultra : msaa, sample shading, filtrage anisotrope et échelle de rendu, limités par le gpu.
+// touches F1 a F4 pendant le rendu, seul ce que le preset change est reconstruit
+// --occlusion : les boites des petits draws sont testées par des occlusion queries contre les gros, les draws cachés
+// sont sautés par VK_EXT_conditional_rendering, ou une frame plus tard sans. touche O, ignoré avec --hiz
+// --prepass-bench N : rend N frames, sans puis avec la prepass, les temps gpu des deux modes sont affichés
+// --job-bench N : mesure le job system de 1 a N threads sans fenêtre ni gpu, puis quitte
+int main(int argc, char** argv) {
 	VulkanApp app;
+	AppOptions options;
+
+	for (int i = 1; i < argc; ++i) {
+		if (std::strcmp(argv[i], "--concurrent") == 0) {
+			options.concurrentSharing = true;
+		} else if (std::strcmp(argv[i], "--bench") == 0 && i + 1 < argc) {
+			options.benchFrames = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		} else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+			options.threads = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		} else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+			if (std::strcmp(argv[++i], "auto") == 0) {
+				options.autoFramesInFlight = true;
+			} else {
+				options.framesInFlight = static_cast<uint32_t>(std::strtoul(argv[i], nullptr, 10));
+			}
+		} else if (std::strcmp(argv[i], "--graph-dump") == 0) {
+			options.dumpRenderGraph = true;
+		} else if (std::strcmp(argv[i], "--dynamic-rendering") == 0) {
+			options.dynamicRendering = true;
+		} else if (std::strcmp(argv[i], "--no-cache") == 0) {
+			options.cacheCommands = false;
+		} else if (std::strcmp(argv[i], "--low-latency") == 0) {
+			options.lowLatency = true;
+		} else if (std::strcmp(argv[i], "--fps-limit") == 0 && i + 1 < argc) {
+			options.targetFps = std::strtod(argv[++i], nullptr);
+		} else if (std::strcmp(argv[i], "--resize-bench") == 0 && i + 1 < argc) {
+			options.resizeBench = true;
+			options.benchFrames = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		} else if (std::strcmp(argv[i], "--depth-prepass") == 0) {
+			options.depthPrepass = true;
+		} else if (std::strcmp(argv[i], "--hiz") == 0) {
+			options.hizCulling = true;
+		} else if (std::strcmp(argv[i], "--occlusion") == 0) {
+			options.occlusionQueries = true;
+		} else if (std::strcmp(argv[i], "--quality") == 0 && i + 1 < argc) {
+			if (!parseQualityPreset(argv[++i], options.quality)) {
+				std::cerr << "unknown quality preset " << argv[i] << ", expected low, medium, high or ultra" << '\n';
+				return EXIT_FAILURE;
+			}
+		} else if (std::strcmp(argv[i], "--prepass-bench") == 0 && i + 1 < argc) {
+			options.prepassBench = true;
+			options.benchFrames = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		} else if (std::strcmp(argv[i], "--stress") == 0 && i + 1 < argc) {
+			options.stressCopies = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		} else if (std::strcmp(argv[i], "--job-bench") == 0 && i + 1 < argc) {
+			runJobBenchmark(static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)));
+			return EXIT_SUCCESS;
+		} else {
+			std::cerr << "unknown option " << argv[i] << '\n';
+			return EXIT_FAILURE;
+		}
+	}
 
 	try {
-		app.run();
+		app.run(options);
 	} catch (const std::exception& e) {
 		std::cerr << e.what() << std::endl;
 		return EXIT_FAILURE;